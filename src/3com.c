@@ -72,6 +72,7 @@
 #include "ld.h"
 #include "nubus.h"
 #include "sdu.h"
+#include "snapshot.h"
 
 /* 3COM 3C400 Multibus Ethernet */
 /* Note that Lambda requires the byte-ordering switch to be ON!
@@ -652,6 +653,16 @@ uint32_t ether_rx_pkt(){
 #endif /* Stub code */
 
 // Device
+// Snapshot support
+void enet_snapshot(int op __attribute__ ((unused))){
+  SNAP_ITEM(ETH_MECSR_MEBACK);
+  SNAP_ITEM(ETH_HW_ADDR);
+  SNAP_ITEM(ETH_Addr_RAM);
+  SNAP_ITEM(ETH_TX_Buffer);
+  SNAP_ITEM(ETH_RX_Buffer);
+  SNAP_ITEM(eth_cycle_count);
+}
+
 void enet_reset(){
   if(ether_fd < 0){
     // tuntap initialization
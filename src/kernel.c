@@ -71,6 +71,9 @@
 #include "3com.h"
 #include "tapemaster.h"
 #include "syms.h"
+#include "snapshot.h"
+#include "pace.h"
+#include "log.h"
 
 // Processor states
 extern struct lambdaState pS[2];
@@ -107,6 +110,15 @@ int cp_state[2] = { 0,0 };      // 0 = cold, 1 = bootstrap, 2 = lisp, 3 = lisp +
 int debug_log_enable = 0;
 int debug_log_trigger = 0;
 int dump_seq = 0;
+char snapshot_fn[128] = "lam.snap";     // Snapshot file name
+char resume_fn[128] = "";               // Snapshot to resume from, if any
+volatile int snapshot_rq = 0;           // Snapshot requested
+int checkpoint_interval = 0;            // Seconds between checkpoints, 0 = none
+int checkpoint_slices = 0;              // Slices since the last checkpoint
+uint64_t bench_cycles = 0;              // Benchmark length in bus cycles, 0 = no benchmark
+#ifdef HEADLESS
+char kbd_script_fn[128] = "";           // Keyboard script to play, if any
+#endif
 #ifdef CONFIG_PHYSKBD
 char kbd_filename[128] = {"/dev/ttyS0"}; // File name for physical keyboard serial port
 int kbd_fd = -1;                         // File desc for physical keyboard serial port
@@ -289,7 +301,7 @@ struct lmkey {
 // Whether to honour SDL_QUIT event (generated e.g. by Command-Q on a Mac)
 int quit_on_sdl_quit = 1;
 
-// Throttle timers
+// Coarse timers, in tenths of a second. Pacing is done by pace.c.
 volatile uint64_t real_time = 0;
 volatile uint64_t emu_time = 0;
 volatile uint32_t stat_time = 20;
@@ -338,6 +350,13 @@ int video_width = VIDEO_WIDTH;
 int video_height = DEFAULT_VIDEO_HEIGHT;
 #endif
 
+#ifdef HEADLESS
+// Headless state
+int video_width = VIDEO_WIDTH;
+int video_height = DEFAULT_VIDEO_HEIGHT;
+char last_status[64] = "";
+#endif
+
 // Stringify macros
 #define STR_EXPAND(tok) #tok
 #define STR(tok) STR_EXPAND(tok)
@@ -493,7 +512,7 @@ void init_sdl_to_keysym_map(void){
   // SDLK_F9 = CONSOLE SWITCH
   // SDLK_F10 = MOUSE CAPTURE/RELEASE
   // SDLK_F11 = RETURN TO NEWBOOT
-  // SDLK_F12 = DUMP STATE
+  // SDLK_F12 = SWITCH TAPE / DUMP / SNAPSHOT
 
   map[SDLK_CAPSLOCK] = 0x03; // CAPSLOCK
 
@@ -610,7 +629,7 @@ void init_sdl_to_scancode_map(void){
   // SDL_SCANCODE_F9 = CONSOLE SWITCH
   // SDL_SCANCODE_F10 = MOUSE MODE SWITCH
   // SDL_SCANCODE_F11 = RETURN TO NEWBOOT
-  // SDL_SCANCODE_F12 = SWITCH TAPE / DUMP
+  // SDL_SCANCODE_F12 = SWITCH TAPE / DUMP / SNAPSHOT
 
   map[SDL_SCANCODE_CAPSLOCK] = 0x03; // CAPSLOCK
 
@@ -640,22 +659,8 @@ void init_sdl_to_scancode_map(void){
 void FB_dump(int vn);
 void write_nvram();
 void write_rtc_nvram();
-
-// Logging
-uint8_t loglevel[MAX_LOGTYPE];
-// Make sure this stays in sync with the #defines in ld.h, or you're gonna have a bad time
-static const char *logtype_name[] = { "SYSTEM",
-				      "SDU",
-				      "LAMBDA",
-				      "NUBUS",
-				      "MULTIBUS",
-				      "RTC",
-				      "VCMEM",
-				      "3COM",
-				      "SMD",
-				      "TAPEMASTER",
-				      "MEM",
-				      "LISP" };
+void map_key(int sval, int dval);
+int find_lm_key_named(char *name);
 
 // SDL items
 // Update rates
@@ -677,17 +682,6 @@ uint8_t mouse_last_buttons=0x07;
 uint8_t mouse_io_ring[2][0x100];
 uint8_t mouse_io_ring_top[2],mouse_io_ring_bottom[2];
 
-int logmsgf(int type, int level, const char *format, ...){
-  va_list args;
-  int rv = 0;
-  if(type > MAX_LOGTYPE || loglevel[type] >= level){
-    va_start(args, format);
-    rv = vprintf(format, args);
-    va_end(args);
-  }
-  return(rv);
-}
-
 // Keyboard TX ring
 int put_rx_ring(int vn,unsigned char ch){
   // printf("put_rx_ring: code %o @ %d\n",ch,keyboard_io_ring_top);
@@ -718,7 +712,10 @@ void kbd_handle_char(int symcode, int down){
   // Check for debug
   if(sdlchar == SDLK_F12){
     if(down){
-      if(((kb_buckybits&KB_BB_LSHIFT)|(kb_buckybits&KB_BB_RSHIFT)) != 0){
+      if(((kb_buckybits&KB_BB_LMETA)|(kb_buckybits&KB_BB_RMETA)) != 0){
+        printf("SNAPSHOT REQUESTED FROM CONSOLE\n");
+        snapshot_rq = 1;
+      }else if(((kb_buckybits&KB_BB_LSHIFT)|(kb_buckybits&KB_BB_RSHIFT)) != 0){
 	printf("DEBUG: DUMP REQUESTED FROM CONSOLE\n");
 	lambda_dump(DUMP_ALL);
 	FB_dump(0);
@@ -788,18 +785,8 @@ void kbd_handle_char(int symcode, int down){
       printf("CONSW: %d\n",active_console);
       // Update window title
       stat_time = 20;
-      // Refresh display bitmap from stored image
-      uint32_t *p = screen->pixels;
-      uint32_t *s = FB_Image[active_console];
-      int i,j;
-      for (i = 0; i < video_width; i++) {
-	for (j = 0; j < video_height; j++)
-	  *p++ = *s++;
-      }
-      // Redraw it
-      SDL_UpdateRect(screen, 0, 0, video_width, video_height);
-      // Reset accumulation
-      u_minh = 0x7fffffff; u_maxh = 0; u_minv = 0x7fffffff; u_maxv = 0;
+      // Refresh display from stored image
+      framebuffer_redraw();
 #ifndef CONFIG_PHYSMS
       // If we are in shared mouse mode, move the pointer to where the new console thinks it should be
       if(mouse_op_mode == 1 && cp_state[active_console] == 3){
@@ -959,6 +946,20 @@ void warp_mouse_callback(int cp){
 }
 #endif
 
+// Redraw the display from the stored image of the active console
+void framebuffer_redraw(){
+  uint32_t *p = screen->pixels;
+  uint32_t *s = FB_Image[active_console];
+  int i,j;
+  for (i = 0; i < video_width; i++) {
+    for (j = 0; j < video_height; j++)
+      *p++ = *s++;
+  }
+  SDL_UpdateRect(screen, 0, 0, video_width, video_height);
+  // Reset accumulation
+  u_minh = 0x7fffffff; u_maxh = 0; u_minv = 0x7fffffff; u_maxv = 0;
+}
+
 void set_bow_mode(int vn,int mode){
   int i,j;
 
@@ -1165,130 +1166,18 @@ int sdl_init(int width, int height){
   return(0);
 }
 
-// Framebuffer management
-void framebuffer_update_word(int vn,uint32_t addr,uint32_t data){
-  // Given 1BPP data and a vcmem framebuffer address, translate to 32BPP and write to host
-  uint32_t row,col;  // Row and column of guest write
-  uint32_t outpos;   // Actual host FB offset
-  uint64_t mask = 1; // Mask for pixel state
-  uint32_t *FrameBuffer; // Address of framebuffer
-
-  col = addr*8;      // This many pixels in
-  row = (col/1024);  // Obtain row
-  col -= (row*1024); // Remove row pixels
-  FrameBuffer = (uint32_t *)screen->pixels;
-
-  outpos = col+((screen->pitch/4)*row);
-
-  if(outpos >= (uint32_t)(video_width*video_height)){
-    return;
-  }
-
-  if(active_console == vn){
-    while(mask < 0x100000000LL){
-      if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
-	FB_Image[vn][outpos] = FrameBuffer[outpos] = pixel_on;
-      }else{
-	FB_Image[vn][outpos] = FrameBuffer[outpos] = pixel_off;
-      }  
-      outpos++;
-      mask <<= 1;
-    }
-    accumulate_update(col, row, 32, 1);
-  }else{
-    while(mask < 0x100000000LL){
-      if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
-	FB_Image[vn][outpos] = pixel_on;
-      }else{
-	FB_Image[vn][outpos] = pixel_off;
-      }  
-      outpos++;
-      mask <<= 1;
-    }
-  }
-}
-
-void framebuffer_update_hword(int vn,uint32_t addr,uint16_t data){
-  uint32_t row,col;  // Row and column of guest write
-  uint32_t outpos;   // Actual host FB offset
-  uint64_t mask = 1; // Mask for pixel state
-  uint32_t *FrameBuffer; // Address of framebuffer
-
-  col = addr*8;      // This many pixels in
-  row = (col/1024);  // Obtain row
-  col -= (row*1024); // Remove row pixels
-  FrameBuffer = (uint32_t *)screen->pixels;
-
-  outpos = col+((screen->pitch/4)*row);
-
-  if(outpos >= (uint32_t)(video_width*video_height)){
-    return;
-  }
-
-  if(active_console == vn){
-    while(mask < 0x10000LL){
-      if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
-	FB_Image[vn][outpos] = FrameBuffer[outpos] = pixel_on;	
-      }else{
-	FB_Image[vn][outpos] = FrameBuffer[outpos] = pixel_off;
-      }  
-      outpos++;
-      mask <<= 1;
-    }
-    accumulate_update(col, row, 16, 1);
-  }else{
-    while(mask < 0x10000LL){
-      if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
-	FB_Image[vn][outpos] = pixel_on;
-      }else{
-	FB_Image[vn][outpos] = pixel_off;
-      }  
-      outpos++;
-      mask <<= 1;
-    }
-  }
-}
-
-void framebuffer_update_byte(int vn,uint32_t addr,uint8_t data){
-  // Given 1BPP data and a vcmem framebuffer address, translate to 32BPP and write to host
-  uint32_t row,col;  // Row and column of guest write
+// Copy pixels of console vn's stored image to the host framebuffer
+static void framebuffer_draw(int vn,uint32_t col,uint32_t row,int pixels){
   uint32_t outpos;   // Actual host FB offset
-  uint32_t mask = 1; // Mask for pixel state
   uint32_t *FrameBuffer; // Address of framebuffer
 
-  col = addr*8;      // This many pixels in
-  row = (col/1024);  // Obtain row
-  col -= (row*1024); // Remove row pixels
   FrameBuffer = (uint32_t *)screen->pixels;
-
   outpos = col+((screen->pitch/4)*row);
-
   if(outpos >= (uint32_t)(video_width*video_height)){
     return;
   }
-
-  if(active_console == vn){
-    while(mask < 0x100){
-      if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
-	FB_Image[vn][outpos] = FrameBuffer[outpos] = pixel_on;
-      }else{
-	FB_Image[vn][outpos] = FrameBuffer[outpos] = pixel_off;	
-      }    
-      outpos++;
-      mask <<= 1;
-    }
-    accumulate_update(col, row, 8, 1);
-  }else{
-    while(mask < 0x100){
-      if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
-        FB_Image[vn][outpos] = pixel_on;
-      }else{
-        FB_Image[vn][outpos] = pixel_off;
-      }
-      outpos++;
-      mask <<= 1;
-    }
-  }
+  memcpy(FrameBuffer+outpos,FB_Image[vn]+col+(VIDEO_WIDTH*row),pixels*4);
+  accumulate_update(col, row, pixels, 1);
 }
 
 #endif /* SDL1 code */
@@ -1301,7 +1190,10 @@ void kbd_handle_char(int scancode, int down){
   // Check for debug
   if(sdlchar == SDL_SCANCODE_F12){
     if(down){
-      if(((kb_buckybits&KB_BB_LSHIFT)|(kb_buckybits&KB_BB_RSHIFT)) != 0){
+      if(((kb_buckybits&KB_BB_LMETA)|(kb_buckybits&KB_BB_RMETA)) != 0){
+        printf("SNAPSHOT REQUESTED FROM CONSOLE\n");
+        snapshot_rq = 1;
+      }else if(((kb_buckybits&KB_BB_LSHIFT)|(kb_buckybits&KB_BB_RSHIFT)) != 0){
         printf("DEBUG: DUMP REQUESTED FROM CONSOLE\n");
         lambda_dump(DUMP_ALL);
         FB_dump(0);
@@ -1370,22 +1262,8 @@ void kbd_handle_char(int scancode, int down){
       printf("CONSW: %d\n",active_console);
       // Update window title
       stat_time = 20;
-      // Refresh display bitmap from stored image
-      uint32_t *p = FrameBuffer;
-      uint32_t *s = FB_Image[active_console];
-      int i,j;
-      for (i = 0; i < VIDEO_WIDTH; i++) {
-        for (j = 0; j < MAX_VIDEO_HEIGHT; j++)
-          *p++ = *s++;
-      }
-      // Redraw it
-      SDL_UpdateTexture(SDLTexture, NULL, FrameBuffer, (VIDEO_WIDTH*4));
-      SDL_RenderClear(SDLRenderer);
-      SDL_RenderCopy(SDLRenderer, SDLTexture, NULL, NULL);
-      SDL_RenderPresent(SDLRenderer);
-
-      // Reset accumulation
-      u_minh = 0x7fffffff; u_maxh = 0; u_minv = 0x7fffffff; u_maxv = 0;
+      // Refresh display from stored image
+      framebuffer_redraw();
 
 #ifndef CONFIG_PHYSMS
       // If we are in shared mouse mode, move the pointer to where the new console thinks it should be
@@ -1541,6 +1419,23 @@ void warp_mouse_callback(int cp){
 }
 #endif
 
+// Redraw the display from the stored image of the active console
+void framebuffer_redraw(){
+  uint32_t *p = FrameBuffer;
+  uint32_t *s = FB_Image[active_console];
+  int i,j;
+  for (i = 0; i < VIDEO_WIDTH; i++) {
+    for (j = 0; j < MAX_VIDEO_HEIGHT; j++)
+      *p++ = *s++;
+  }
+  SDL_UpdateTexture(SDLTexture, NULL, FrameBuffer, (VIDEO_WIDTH*4));
+  SDL_RenderClear(SDLRenderer);
+  SDL_RenderCopy(SDLRenderer, SDLTexture, NULL, NULL);
+  SDL_RenderPresent(SDLRenderer);
+  // Reset accumulation
+  u_minh = 0x7fffffff; u_maxh = 0; u_minv = 0x7fffffff; u_maxv = 0;
+}
+
 void set_bow_mode(int vn,int mode){
   int i,j;
 
@@ -1788,91 +1683,310 @@ int sdl_init(int width, int height){
   return 0;
 }
 
-// Framebuffer management
-void framebuffer_update_word(int vn,uint32_t addr,uint32_t data){
-  // Given 1BPP data and a vcmem framebuffer address, translate to 32BPP and write to host
-  uint32_t row,col;  // Row and column of guest write
-  uint32_t outpos;   // Actual host FB offset
-  uint64_t mask = 1; // Mask for pixel state
+// Copy pixels of console vn's stored image to the host framebuffer
+static void framebuffer_draw(int vn,uint32_t col,uint32_t row,int pixels){
+  uint32_t outpos = col+(VIDEO_WIDTH*row);
+  memcpy(FrameBuffer+outpos,FB_Image[vn]+outpos,pixels*4);
+  accumulate_update(col, row, pixels, 1);
+}
 
-  col = addr*8;      // This many pixels in
-  row = (col/1024);  // Obtain row
-  col -= (row*1024); // Remove row pixels
+#endif /* SDL2 code */
 
-  outpos = col+(VIDEO_WIDTH*row);
+#ifdef HEADLESS
+// Headless code: no display and no SDL. Guest framebuffer writes still go to FB_Image,
+// and keyboard input comes from a script file instead of a window.
+// Each script line is one of:
+//   wait N        Wait N tenths of a second of emulated time
+//   key NAME      Press and release a Lambda key (by name or octal keycode)
+//   down NAME     Press a Lambda key
+//   up NAME       Release a Lambda key
+//   type TEXT     Type the rest of the line
+//   screenshot    Write the VC screenshots
+//   quit          Stop the emulator
+// Blank lines and lines starting with # are ignored.
+FILE *kbd_script = NULL;
+uint64_t kbd_script_wait = 0;  // emu_time the script resumes at
+int kbd_script_line = 0;
+// Key events not yet sent, one per input frame. Bit 8 set means key down.
+uint16_t kbd_queue[1024];
+int kbd_queue_top = 0;
+int kbd_queue_bottom = 0;
+
+void kbd_handle_char(int lmkey, int down){
+  unsigned char outchar=0;
 
-  if(outpos >= (uint32_t)(VIDEO_WIDTH*MAX_VIDEO_HEIGHT)){
+  // Keycodes are Lambda keycodes already
+  outchar = map[lmkey];
+
+  // We send 2 characters. First is keycode, second is key state + bucky bits.
+  put_rx_ring(active_console,outchar); // Keycode
+  // Next is key up/down state and bucky bits
+  outchar = 0x80; // This is the "second byte" flag
+  if(down){
+    // Key Down
+    outchar |= 0x40; // Key Down Flag
+    if(modmap[lmkey] != 0){
+      kb_buckybits |= modmap[lmkey];
+    }
+    // Take "down" bucky bits
+    if(((kb_buckybits&KB_BB_LSHIFT)|(kb_buckybits&KB_BB_RSHIFT)) != 0){ outchar |= 0x20; }
+    if(((kb_buckybits&KB_BB_LCTL)|(kb_buckybits&KB_BB_RCTL)) != 0){ outchar |= 0x10; }
+    if(((kb_buckybits&KB_BB_LMETA)|(kb_buckybits&KB_BB_RMETA)) != 0){ outchar |= 0x08; }
+    if(((kb_buckybits&KB_BB_LSUPER)|(kb_buckybits&KB_BB_RSUPER)) != 0){ outchar |= 0x04; }
+    if(((kb_buckybits&KB_BB_LHYPER)|(kb_buckybits&KB_BB_RHYPER)) != 0){ outchar |= 0x02; }
+    if((kb_buckybits&KB_BB_GREEK) != 0){ outchar |= 0x01; }
+  }else{
+    // Key Up
+    if(modmap[lmkey] != 0){
+      kb_buckybits &= ~modmap[lmkey];
+    }
+    // Take "up" bucky bits
+    if((kb_buckybits&KB_BB_MODELOCK) != 0){ outchar |= 0x10; }
+    if((kb_buckybits&KB_BB_ALTLOCK) != 0){ outchar |= 0x08; }
+    if((kb_buckybits&KB_BB_CAPSLOCK) != 0){ outchar |= 0x04; }
+    if((kb_buckybits&KB_BB_REPEAT) != 0){ outchar |= 0x02; }
+    if(((kb_buckybits&KB_BB_LTOP)|(kb_buckybits&KB_BB_RTOP)) != 0){ outchar |= 0x01; }
+  }
+  // Send result
+  put_rx_ring(active_console,outchar);
+}
+
+void kbd_queue_key(int lmkey, int down){
+  if(((kbd_queue_top+1)%1024) == kbd_queue_bottom){
+    printf("KBD SCRIPT: Line %d: Too many keys queued\n",kbd_script_line);
     return;
   }
+  kbd_queue[kbd_queue_top] = lmkey|(down ? 0x100 : 0);
+  kbd_queue_top = (kbd_queue_top+1)%1024;
+}
 
-  if(active_console == vn){
-    while(mask < 0x100000000LL){
-      if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
-	FB_Image[vn][outpos] = FrameBuffer[outpos] = pixel_on;
-      }else{
-	FB_Image[vn][outpos] = FrameBuffer[outpos] = pixel_off;
-      }
-      outpos++;
-      mask <<= 1;
-    }
-    accumulate_update(col, row, 32, 1);
+// Find a key by name or octal keycode
+int kbd_script_key(char *name){
+  int key = -1;
+  if(name[0] >= '0' && name[0] <= '7' && name[1] != 0){
+    key = strtol(name,NULL,8);
   }else{
-    while(mask < 0x100000000LL){
-      if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
-        FB_Image[vn][outpos] = pixel_on;
-      }else{
-        FB_Image[vn][outpos] = pixel_off;
+    key = find_lm_key_named(name);
+  }
+  if(key < 0 || key > 0177){
+    printf("KBD SCRIPT: Line %d: Unknown Lambda key '%s'\n",kbd_script_line,name);
+    return(-1);
+  }
+  return(key);
+}
+
+// Queue the keys that type one character
+void kbd_script_type(char ch){
+  char name[2];
+  int key;
+  int shift = 0;
+  if(ch == ' '){
+    key = 0134; // Space
+  }else{
+    if(ch >= 'A' && ch <= 'Z'){
+      shift = 1;
+    }
+    if(ch >= 'a' && ch <= 'z'){
+      ch -= 0x20; // Key names are upper case
+    }
+    name[0] = ch;
+    name[1] = 0;
+    key = find_lm_key_named(name);
+  }
+  if(key < 0){
+    printf("KBD SCRIPT: Line %d: Can't type '%c'\n",kbd_script_line,ch);
+    return;
+  }
+  if(shift){ kbd_queue_key(024,1); } // Left Shift
+  kbd_queue_key(key,1);
+  kbd_queue_key(key,0);
+  if(shift){ kbd_queue_key(024,0); }
+}
+
+// Run script lines until one has to wait
+void kbd_script_step(){
+  char buf[256];
+  while(kbd_script != NULL && emu_time >= kbd_script_wait && kbd_queue_top == kbd_queue_bottom){
+    char *tok,*arg;
+    if(fgets(buf,256,kbd_script) == NULL){
+      printf("KBD SCRIPT: Done\n");
+      fclose(kbd_script);
+      kbd_script = NULL;
+      return;
+    }
+    kbd_script_line++;
+    tok = strtok(buf," \t\r\n");
+    if(tok == NULL || tok[0] == '#'){ continue; }
+    if(strcasecmp(tok,"type") == 0){
+      arg = strtok(NULL,"\r\n");
+      while(arg != NULL && *arg != 0){
+	kbd_script_type(*arg);
+	arg++;
       }
-      outpos++;
-      mask <<= 1;
+      continue;
+    }
+    if(strcasecmp(tok,"screenshot") == 0){
+      FB_dump(0);
+      FB_dump(1);
+      continue;
+    }
+    if(strcasecmp(tok,"quit") == 0){
+      printf("KBD SCRIPT: Quit\n");
+      ld_die_rq = 1;
+      return;
+    }
+    if(strcasecmp(tok,"wait") != 0 && strcasecmp(tok,"key") != 0 &&
+       strcasecmp(tok,"down") != 0 && strcasecmp(tok,"up") != 0){
+      printf("KBD SCRIPT: Line %d: Unknown command '%s'\n",kbd_script_line,tok);
+      continue;
+    }
+    arg = strtok(NULL," \t\r\n");
+    if(arg == NULL){
+      printf("KBD SCRIPT: Line %d: Missing parameter\n",kbd_script_line);
+      continue;
+    }
+    if(strcasecmp(tok,"wait") == 0){
+      kbd_script_wait = emu_time+atoi(arg);
+      continue;
+    }
+    // key, down or up
+    {
+      int key = kbd_script_key(arg);
+      if(key < 0){ continue; }
+      if(strcasecmp(tok,"up") != 0){ kbd_queue_key(key,1); }
+      if(strcasecmp(tok,"down") != 0){ kbd_queue_key(key,0); }
     }
   }
 }
 
-void framebuffer_update_hword(int vn,uint32_t addr,uint16_t data){
-  uint32_t row,col;  // Row and column of guest write
-  uint32_t outpos;   // Actual host FB offset
-  uint64_t mask = 1; // Mask for pixel state
+#ifndef CONFIG_PHYSMS
+// Lisp updated the mouse position
+void warp_mouse_callback(int cp __attribute__ ((unused))){
+  // No pointer to move
+}
+#endif
 
-  col = addr*8;      // This many pixels in
-  row = (col/1024);  // Obtain row
-  col -= (row*1024); // Remove row pixels
+// Nothing to redraw
+void framebuffer_redraw(){
+}
 
-  outpos = col+(VIDEO_WIDTH*row);
+void set_bow_mode(int vn,int mode){
+  int i,j;
 
-  if(outpos >= (uint32_t)(VIDEO_WIDTH*MAX_VIDEO_HEIGHT)){
-    return;
+  if(black_on_white[vn] == mode){
+    return;                   /* noop */
   }
+  logmsgf(LT_VCMEM,10,"VC %d BLACK-ON-WHITE MODE now %d\n",vn,mode);
+  black_on_white[vn] = mode;  /* update */
 
-  if(active_console == vn){
-    while(mask < 0x10000){
-      if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
-	FB_Image[vn][outpos] = FrameBuffer[outpos] = pixel_on;
-      }else{
-	FB_Image[vn][outpos] = FrameBuffer[outpos] = pixel_off;
-      }  
-      outpos++;
-      mask <<= 1;
+  // invert pixels
+  uint32_t *p = FB_Image[vn];
+  for (i = 0; i < VIDEO_WIDTH; i++) {
+    for (j = 0; j < MAX_VIDEO_HEIGHT; j++) {
+      *p = (*p == pixel_off ? pixel_on : pixel_off);
+      p++;
     }
-    accumulate_update(col, row, 16, 1);
-  }else{
-    while(mask < 0x10000){
-      if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
-	FB_Image[vn][outpos] = pixel_on;
-      }else{
-	FB_Image[vn][outpos] = pixel_off;
-      }  
-      outpos++;
-      mask <<= 1;
+  }
+}
+
+void sdl_refresh(int vblank){
+  // No display to refresh
+  if(vblank != 0){
+    return;
+  }
+  // Input frame: send one queued key event, or get more from the script
+  if(kbd_queue_top == kbd_queue_bottom){
+    kbd_script_step();
+  }
+  if(kbd_queue_top != kbd_queue_bottom){
+    kbd_handle_char(kbd_queue[kbd_queue_bottom]&0xFF,(kbd_queue[kbd_queue_bottom]&0x100) != 0);
+    kbd_queue_bottom = (kbd_queue_bottom+1)%1024;
+  }
+}
+
+static void sdl_cleanup(void){
+  if(sdu_conn_fd > 0){
+    close(sdu_conn_fd);
+  }
+  if(sdu_fd > 0){
+    close(sdu_fd);
+  }
+  write_nvram();
+  write_rtc_nvram();
+}
+
+// Gets called every 100000 microseconds (so 10 times a second)
+static void itimer_callback(int signum __attribute__ ((unused))){
+  // Real time passed
+  real_time++;
+  // Also increment status update counter
+  stat_time++;
+}
+
+int sdl_init(int width, int height){
+  int i,j;
+  struct sigaction sigact;
+
+  // Capture SIGALRM for our callback
+  sigact.sa_handler = itimer_callback;
+  sigemptyset(&sigact.sa_mask);
+  sigact.sa_flags = SA_RESTART; // Attempt to restart syscalls interrupted by this signal
+  sigaction(SIGALRM,&sigact,NULL);
+
+  printf("Headless display width %d height %d\n", width, height);
+
+  // Keys are Lambda keycodes, so the keymap is one-to-one
+  i = 0;
+  while(i < 0200){
+    map_key(i,i);
+    i++;
+  }
+
+  // Open keyboard script
+  if(kbd_script_fn[0] != 0){
+    kbd_script = fopen(kbd_script_fn,"r");
+    if(kbd_script == NULL){
+      perror(kbd_script_fn);
+      exit(-1);
     }
   }
+
+  // Clean up if we die
+  atexit(sdl_cleanup);
+
+  // Clear stored bitmaps
+  uint32_t *p = FB_Image[0];
+  for (i = 0; i < VIDEO_WIDTH; i++) {
+    for (j = 0; j < MAX_VIDEO_HEIGHT; j++)
+      *p++ = pixel_off;
+  }
+  p = FB_Image[1];
+  for (i = 0; i < VIDEO_WIDTH; i++) {
+    for (j = 0; j < MAX_VIDEO_HEIGHT; j++)
+      *p++ = pixel_off;
+  }
+
+  // Kick interval timer
+  struct itimerval itv;
+  bzero((uint8_t *)&itv,sizeof(struct itimerval));
+  itv.it_interval.tv_usec = 100000;
+  itv.it_value.tv_usec = 100000;
+  setitimer(ITIMER_REAL,&itv,NULL);
+
+  // Done
+  return 0;
 }
 
-void framebuffer_update_byte(int vn,uint32_t addr,uint8_t data){
-  // Given 1BPP data and a vcmem framebuffer address, translate to 32BPP and write to host
+#endif /* Headless code */
+
+// Framebuffer management
+// Given 1BPP data and a vcmem framebuffer address, translate to 32BPP and store it
+// in the console's image. If that console is on the host display, draw it there too.
+static void framebuffer_update(int vn,uint32_t addr,uint32_t data,int bits){
   uint32_t row,col;  // Row and column of guest write
-  uint32_t outpos;   // Actual host FB offset
+  uint32_t outpos;   // Stored image offset
   uint32_t mask = 1; // Mask for pixel state
+  int x = 0;
 
   col = addr*8;      // This many pixels in
   row = (col/1024);  // Obtain row
@@ -1884,31 +1998,34 @@ void framebuffer_update_byte(int vn,uint32_t addr,uint8_t data){
     return;
   }
 
-  if(active_console == vn){
-    while(mask < 0x100){
-      if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
-	FB_Image[vn][outpos] = FrameBuffer[outpos] = pixel_on;
-      }else{
-	FB_Image[vn][outpos] = FrameBuffer[outpos] = pixel_off;
-      }
-      outpos++;
-      mask <<= 1;
-    }
-    accumulate_update(col, row, 8, 1);
-  }else{
-    while(mask < 0x100){
-      if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
-        FB_Image[vn][outpos] = pixel_on;
-      }else{
-        FB_Image[vn][outpos] = pixel_off;
-      }
-      outpos++;
-      mask <<= 1;
+  while(x < bits){
+    if((black_on_white[vn] == 0 && (data&mask) != mask) || (black_on_white[vn] == 1 && (data&mask) == mask)){
+      FB_Image[vn][outpos] = pixel_on;
+    }else{
+      FB_Image[vn][outpos] = pixel_off;
     }
+    outpos++;
+    mask <<= 1;
+    x++;
   }
+#ifndef HEADLESS
+  if(active_console == vn){
+    framebuffer_draw(vn,col,row,bits);
+  }
+#endif
 }
 
-#endif /* SDL2 code */
+void framebuffer_update_word(int vn,uint32_t addr,uint32_t data){
+  framebuffer_update(vn,addr,data,32);
+}
+
+void framebuffer_update_hword(int vn,uint32_t addr,uint16_t data){
+  framebuffer_update(vn,addr,data,16);
+}
+
+void framebuffer_update_byte(int vn,uint32_t addr,uint8_t data){
+  framebuffer_update(vn,addr,data,8);
+}
 
 void read_sdu_rom(){
   extern uint8_t SDU_ROM[];
@@ -3406,6 +3523,148 @@ int yaml_lam_mapping_loop(yaml_parser_t *parser){
 	  }
 	  goto value_done;
 	}
+	if(strcmp(key,"snapshot") == 0){
+	  strncpy(snapshot_fn,value,127);
+	  snapshot_fn[127] = 0;
+	  goto value_done;
+	}
+	if(strcmp(key,"checkpoint") == 0){
+	  int val = atoi(value);
+	  if(val < 0){
+	    printf("lam: Invalid checkpoint interval %s\n",value);
+	    return(-1);
+	  }
+	  checkpoint_interval = val;
+	  goto value_done;
+	}
+	if(strcmp(key,"checkpoint_max") == 0){
+	  extern int checkpoint_max;
+	  int val = atoi(value);
+	  if(val < 1){
+	    printf("lam: Invalid checkpoint_max %s\n",value);
+	    return(-1);
+	  }
+	  checkpoint_max = val;
+	  goto value_done;
+	}
+	if(strcmp(key,"resume") == 0){
+	  strncpy(resume_fn,value,127);
+	  resume_fn[127] = 0;
+	  goto value_done;
+	}
+	if(strcmp(key,"pace_slice") == 0){
+	  int val = atoi(value);
+	  if(val < 10 || val > 100000){
+	    printf("lam: Invalid pace_slice value %s (10-100000 microseconds)\n",value);
+	    return(-1);
+	  }
+	  pace_slice = val;
+	  goto value_done;
+	}
+	if(strcmp(key,"catchup") == 0){
+	  if(strcasecmp(value,"all") == 0){
+	    pace_catchup = PACE_CATCHUP_ALL;
+	  }else{
+	    int val = atoi(value);
+	    if(val < 0){
+	      printf("lam: Invalid catchup value %s (all, or milliseconds)\n",value);
+	      return(-1);
+	    }
+	    pace_catchup = val;
+	  }
+	  goto value_done;
+	}
+	if(strcmp(key,"turbo") == 0){
+	  if((strcasecmp(value,"on") == 0) || (strcasecmp(value,"yes") == 0) || (strcasecmp(value,"true") == 0)){
+	    pace_turbo = 1;
+	  }else if((strcasecmp(value,"off") == 0) || (strcasecmp(value,"no") == 0) || (strcasecmp(value,"false") == 0)){
+	    pace_turbo = 0;
+	  }else{
+	    printf("lam: turbo: unrecognized value '%s' (expecting on/true/yes or off/false/no)\n", value);
+	    return(-1);
+	  }
+	  goto value_done;
+	}
+	if(strcmp(key,"fast_memory") == 0){
+	  if((strcasecmp(value,"on") == 0) || (strcasecmp(value,"yes") == 0) || (strcasecmp(value,"true") == 0)){
+	    fast_memory = 1;
+	  }else if((strcasecmp(value,"off") == 0) || (strcasecmp(value,"no") == 0) || (strcasecmp(value,"false") == 0)){
+	    fast_memory = 0;
+	  }else{
+	    printf("lam: fast_memory: unrecognized value '%s' (expecting on/true/yes or off/false/no)\n", value);
+	    return(-1);
+	  }
+	  goto value_done;
+	}
+	if(strcmp(key,"sdu_clock") == 0){
+	  int val = atoi(value);
+	  if(val < 100 || val > 1000000){
+	    printf("lam: Invalid sdu_clock value %s (100-1000000 KHz)\n",value);
+	    return(-1);
+	  }
+	  sdu_clock = val;
+	  goto value_done;
+	}
+	if(strcmp(key,"benchmark") == 0){
+	  bench_cycles = strtoull(value,NULL,10);
+	  goto value_done;
+	}
+	if(strcmp(key,"nubus_trace") == 0){
+	  strncpy(nubus_trace_fn,value,127);
+	  nubus_trace_fn[127] = 0;
+	  goto value_done;
+	}
+	if(strcmp(key,"nubus_trace_size") == 0){
+	  nubus_trace_size = strtoull(value,NULL,10);
+	  goto value_done;
+	}
+#ifdef HEADLESS
+	if(strcmp(key,"keyboard_script") == 0){
+	  strncpy(kbd_script_fn,value,127);
+	  kbd_script_fn[127] = 0;
+	  goto value_done;
+	}
+#endif
+	if(strcmp(key,"idle_detect") == 0){
+	  extern int idle_detect;
+	  if((strcasecmp(value,"on") == 0) || (strcasecmp(value,"yes") == 0) || (strcasecmp(value,"true") == 0)){
+	    idle_detect = 1;
+	  }else{
+	    if((strcasecmp(value,"off") == 0) || (strcasecmp(value,"no") == 0) || (strcasecmp(value,"false") == 0)){
+	      idle_detect = 0;
+	    }else{
+	      printf("lam: idle_detect: unrecognized value '%s' (expecting on/true/yes or off/false/no)\n", value);
+	      return(-1);
+	    }
+	  }
+	  goto value_done;
+	}
+	if(strcmp(key,"idle_symbol") == 0){
+	  extern char idle_symbol[];
+	  strncpy(idle_symbol,value,127);
+	  idle_symbol[127] = 0;
+	  goto value_done;
+	}
+	if(strcmp(key,"idle_checks") == 0){
+	  extern int idle_checks;
+	  int val = atoi(value);
+	  if(val < 1){
+	    printf("lam: Invalid idle_checks value %s\n",value);
+	    return(-1);
+	  }
+	  idle_checks = val;
+	  goto value_done;
+	}
+	if(strcmp(key,"idle_slices") == 0){
+	  extern int idle_slices;
+	  int val = atoi(value);
+	  if(val < 1 || val > 100){
+	    printf("lam: Invalid idle_slices value %s\n",value);
+	    return(-1);
+	  }
+	  idle_slices = val;
+	  goto value_done;
+	}
 #ifdef CONFIG_PHYSKBD
 	if(strcmp(key,"kb_file") == 0){
 	  strncpy(kbd_filename,value,128);
@@ -4223,6 +4482,22 @@ int yaml_log_mapping_loop(yaml_parser_t *parser){
 	  printf("Global log level %d\n",val);
 	  goto value_done;
 	}
+	if(strcasecmp(key,"async") == 0){
+	  if((strcasecmp(value,"on") == 0) || (strcasecmp(value,"yes") == 0) || (strcasecmp(value,"true") == 0)){
+	    log_async = 1;
+	  }else if((strcasecmp(value,"off") == 0) || (strcasecmp(value,"no") == 0) || (strcasecmp(value,"false") == 0)){
+	    log_async = 0;
+	  }else{
+	    printf("log: async: unrecognized value '%s' (expecting on/true/yes or off/false/no)\n", value);
+	    return(-1);
+	  }
+	  goto value_done;
+	}
+	if(strcasecmp(key,"binary") == 0){
+	  strncpy(log_binary_fn,value,127);
+	  log_binary_fn[127] = 0;
+	  goto value_done;
+	}
 	while(x < MAX_LOGTYPE){
 	  if(strcasecmp(key,logtype_name[x]) == 0){
 	    // Yes
@@ -4343,6 +4618,10 @@ int yaml_event_loop(yaml_parser_t *parser){
 	rv = yaml_network_mapping_loop(parser);
 	goto map_done;
       }
+      if(strcmp(key,"memory") == 0){
+	rv = yaml_memory_mapping_loop(parser);
+	goto map_done;
+      }
       if(strcmp(key,"disk") == 0){
 	rv = yaml_disk_mapping_loop(parser);
 	goto map_done;
@@ -4432,11 +4711,19 @@ void try_yaml_buf(char *buf){
 
 // One nubus clock cycle
 // Can be driven by the SDU 8088 or not.
-int bcount = 0; // Bus Cycle Counter
+int bcount = 0; // Bus Cycle Counter (counts timer ticks, see pace.h)
 int icount=0; // Main cycle counter
+int pace_mark=0; // icount at the last pacing check
+int sdu_mark=0; // icount at the last run of the 8088
+int pace_cycles=0; // Cycles between pacing checks
 
 // The Lambda and nubus are run at 5 MHz.
 void nubus_cycle(int sdu){
+  // Guest timers tick this cycle?
+  timer_acc += timer_step;
+  timer_tick = timer_acc>>16;
+  timer_acc &= (TIMER_STEP_ONE-1);
+  timer_ticks += timer_tick;
   if(bcount == 5){
     // Update microsecond clock if that's enabled (NB: AUX stat only!)
     if(pS[0].RG_Mode.Aux_Stat_Count_Control == 6){
@@ -4452,6 +4739,8 @@ void nubus_cycle(int sdu){
 #ifdef CONFIG_2X2
   lambda_clockpulse(1);
 #endif
+  // Whoever owns the addressed card answers
+  nubus_slave_cycle();
   // Other devices go here  
   sdu_clock_pulse();
   // If the SDU isn't driving the clock pulse, clock stuff on the multibus too.
@@ -4460,17 +4749,98 @@ void nubus_cycle(int sdu){
     tapemaster_clock_pulse();
     enet_clock_pulse();
   }
-  mem_clock_pulse();
   vcmem_clock_pulse(0);
 #ifdef CONFIG_2X2
   vcmem_clock_pulse(1);
 #endif
   // Nubus signal maintenance goes last
   nubus_clock_pulse();
-  bcount++; // Count bus cycles  
+  bcount += timer_tick; // Count bus cycles
   icount++; // Main cycle
 }
 
+// Snapshot support
+void kernel_snapshot(int op){
+  SNAP_ITEM(cp_state);
+  SNAP_ITEM(bcount);
+  SNAP_ITEM(icount);
+  SNAP_ITEM(keyboard_io_ring);
+  SNAP_ITEM(keyboard_io_ring_top);
+  SNAP_ITEM(keyboard_io_ring_bottom);
+  SNAP_ITEM(mouse_io_ring);
+  SNAP_ITEM(mouse_io_ring_top);
+  SNAP_ITEM(mouse_io_ring_bottom);
+#ifndef CONFIG_PHYSMS
+  SNAP_ITEM(mouse_phase);
+  SNAP_ITEM(mouse_last_buttons);
+#endif
+  SNAP_ITEM(active_console);
+  SNAP_ITEM(black_on_white);
+  SNAP_ITEM(FB_Image);
+  if(op == SNAP_LOAD){
+    stat_time = 20;
+#ifdef BURR_BROWN
+    if(debug_target_mode < 10){
+      framebuffer_redraw();
+    }
+#else
+    framebuffer_redraw();
+#endif
+  }
+}
+
+// Snapshot request signal
+static void snapshot_signal(int signum __attribute__ ((unused))){
+  snapshot_rq = 1;
+}
+
+// Benchmark state
+struct timespec bench_start;
+uint64_t bench_done = 0;                // Bus cycles run so far
+unsigned long bench_cycle_base[2],bench_stall_base[2],bench_idle_base[2];
+uint64_t bench_exec_base;
+
+void bench_begin(){
+  extern uint64_t totalexec;
+  int x = 0;
+  while(x < 2){
+    bench_cycle_base[x] = pS[x].cycle_count;
+    bench_stall_base[x] = pS[x].stall_count;
+    bench_idle_base[x] = pS[x].idle_count;
+    x++;
+  }
+  bench_exec_base = totalexec;
+  bench_done = 0;
+  clock_gettime(CLOCK_MONOTONIC,&bench_start);
+  printf("Benchmark: running %llu bus cycles\n",(unsigned long long)bench_cycles);
+}
+
+void bench_report(){
+  extern uint64_t totalexec;
+  struct timespec now;
+  double secs;
+  int x = 0;
+  clock_gettime(CLOCK_MONOTONIC,&now);
+  secs = (now.tv_sec-bench_start.tv_sec)+((now.tv_nsec-bench_start.tv_nsec)/1000000000.0);
+  if(secs <= 0){ secs = 0.000001; }
+  // The bus runs at 5 MHz in real time
+  printf("Benchmark: %llu bus cycles in %.3f seconds (%.1f%% of real time)\n",
+	 (unsigned long long)bench_done,secs,((bench_done/5000000.0)/secs)*100.0);
+#ifdef CONFIG_2X2
+  while(x < 2){
+#else
+  while(x < 1){
+#endif
+    unsigned long cycles = pS[x].cycle_count-bench_cycle_base[x];
+    unsigned long stalls = pS[x].stall_count-bench_stall_base[x];
+    unsigned long idles = pS[x].idle_count-bench_idle_base[x];
+    printf("Benchmark: CP %d: %.0f cycles/sec, stall ratio %.4f, idle ratio %.4f\n",x,cycles/secs,
+	   cycles > 0 ? (double)stalls/cycles : 0.0,cycles > 0 ? (double)idles/cycles : 0.0);
+    x++;
+  }
+  printf("Benchmark: SDU: %.0f 8088 instructions/sec\n",(totalexec-bench_exec_base)/secs);
+}
+
 // Main
 int main(int argc, char *argv[]){
 #ifndef HAVE_YAML_H
@@ -4619,6 +4989,44 @@ int main(int argc, char *argv[]){
 	}
       }
 #endif      
+      // Resume from snapshot
+      if(strcmp("-r",argv[x]) == 0){
+	if(x+1 < argc){
+	  strncpy(resume_fn,argv[x+1],127);
+	  resume_fn[127] = 0;
+	  x++;
+	}else{
+	  printf("lam: Required parameter missing\n");
+	  exit(-1);
+	}
+      }
+      // Turbo
+      if(strcmp("-t",argv[x]) == 0){
+	pace_turbo = 1;
+      }
+      // Benchmark
+      if(strcmp("-b",argv[x]) == 0){
+	if(x+1 < argc){
+	  bench_cycles = strtoull(argv[x+1],NULL,10);
+	  x++;
+	}else{
+	  printf("lam: Required parameter missing\n");
+	  exit(-1);
+	}
+      }
+#ifdef HEADLESS
+      // Keyboard script
+      if(strcmp("-k",argv[x]) == 0){
+	if(x+1 < argc){
+	  strncpy(kbd_script_fn,argv[x+1],127);
+	  kbd_script_fn[127] = 0;
+	  x++;
+	}else{
+	  printf("lam: Required parameter missing\n");
+	  exit(-1);
+	}
+      }
+#endif
       if(strcmp("-?",argv[x]) == 0){
         printf("\nUsage: lam [OPTIONS]\n");
         printf("Valid options:\n");
@@ -4629,6 +5037,12 @@ int main(int argc, char *argv[]){
 #ifdef BURR_BROWN
 	printf("  -d                  Enable debug target mode\n");
 #endif
+	printf("  -b CYCLES           Run a benchmark of CYCLES bus cycles and exit\n");
+	printf("  -t                  Turbo mode: run as fast as possible\n");
+#ifdef HEADLESS
+	printf("  -k FILE             Play keyboard script FILE\n");
+#endif
+	printf("  -r FILE             Resume from snapshot FILE\n");
 	printf("  -?                  Print this text\n");
 	exit(0);
       }
@@ -4636,6 +5050,15 @@ int main(int argc, char *argv[]){
     }
   }
 
+  if(log_start() < 0){
+    exit(-1);
+  }
+  if(nubus_trace_start() < 0){
+    exit(-1);
+  }
+  if(mem_alloc() < 0){
+    exit(-1);
+  }
   if(smd_init() < 0){
     exit(-1);
   }
@@ -4687,6 +5110,15 @@ int main(int argc, char *argv[]){
   read_sdu_rom();
   read_vcmem_rom();
 
+  // Resume from a snapshot if we were asked to
+  if(resume_fn[0] != 0){
+    if(snapshot_load(resume_fn) < 0){
+      exit(-1);
+    }
+  }
+  // Snapshot on request from outside
+  signal(SIGUSR1,snapshot_signal);
+
   // If the debug switch is on debug/install mode
   if(sdu_rotary_switch == 0){
     // Wait here for telnet
@@ -4696,9 +5128,23 @@ int main(int argc, char *argv[]){
     }
   }
   
+  // Start the clock, benchmarks run unpaced
+  if(bench_cycles > 0){
+    bench_begin();
+  }else{
+    pace_init();
+  }
+  pace_mark = icount;
+  sdu_mark = icount;
+  pace_cycles = pace_slice_cycles();
+
   while(ld_die_rq == 0){
+    int slice_start;
     // New loop
     icount -= 500000; // Don't clobber extra cycles if they happened
+    pace_mark -= 500000;
+    sdu_mark -= 500000;
+    slice_start = icount;
     // Run for 1/10th of a second, or 100000 cycles
     // The lambda runs at 5 MHz, so this loop has to run 5 times for each wall-clock cycle.
     // icount gets incremented with each nubus cycle.
@@ -4709,11 +5155,12 @@ int main(int argc, char *argv[]){
 	// Clock debug interface
         debug_clockpulse();
 #endif
-	if(x == 0){
-	  // The 8088 does more than one cycle worth of work in one tick,
-	  // so we clock it here. 1 MIPS was as fast as an 8088 got.
+	if(x == 0 && icount-sdu_mark >= SDU_SLICE){
+	  // The 8088 runs a slice at a time, as many instructions as fit.
 	  // NB: This will cause nubus cycles if the 8088 has to wait for the bus!
-	  i8086_clockpulse();
+	  int sdu_start = icount;
+	  i8086_run(icount-sdu_mark);
+	  sdu_mark = sdu_start;
 	}
 	// Step lambda and nubus (8088 might have already done this!)
 	nubus_cycle(0);
@@ -4721,6 +5168,17 @@ int main(int argc, char *argv[]){
       }
       // NOTE THAT IN THE BEST CASE, ICOUNT WILL INCREMENT BY 5 HERE
       // WITH HEAVY LAMBDA/SDU INTERACTION (DISK IO!), THIS CAN BE SEVERAL MULTIPLES OF 5!
+      // Keep pace with real time
+      if(icount-pace_mark >= pace_cycles && bench_cycles == 0){
+	// Turbo mode has nothing to hurry for if every processor is parked
+#ifdef CONFIG_2X2
+	int parked = (pS[0].idle_park > 0 && pS[1].idle_park > 0);
+#else
+	int parked = (pS[0].idle_park > 0);
+#endif
+	pace_run(icount-pace_mark,pace_turbo && !parked);
+	pace_mark = icount;
+      }
       // Clock input
       if((icount%input_fps) < 30){
 	if(input_frame == 0){
@@ -4782,6 +5240,8 @@ int main(int argc, char *argv[]){
       case 3: // Lisp Running
 	if(pS[active_console].cpu_die_rq){
 	  sprintf(statbuf[1],"Halted");
+	}else if(pS[active_console].idle_park > 0){
+	  sprintf(statbuf[1],"Idle");
 	}else{
 	  sprintf(statbuf[1],"Running");
 	}
@@ -4790,24 +5250,54 @@ int main(int argc, char *argv[]){
 	sprintf(statbuf[1],"Unknown State %d",cp_state[active_console]);
 	break;
       }
-      sprintf(statbuf[2]," | DT %lld",(emu_time-real_time));
+      if(pace_turbo){
+	sprintf(statbuf[2]," | Turbo %d%%",pace_speed());
+      }else{
+	sprintf(statbuf[2]," | DT %lld ms",(long long)pace_drift());
+      }
       sprintf(titlebuf,"%s%s%s",statbuf[0],statbuf[1],statbuf[2]);
 #ifdef SDL1
       SDL_WM_SetCaption(titlebuf, "LambdaDelta");
 #endif
 #ifdef SDL2
       SDL_SetWindowTitle(SDLWindow, titlebuf);
+#endif
+#ifdef HEADLESS
+      // No title bar, so print it when the state changes
+      if(strcmp(statbuf[1],last_status) != 0){
+	printf("%s%s\n",statbuf[0],statbuf[1]);
+	strcpy(last_status,statbuf[1]);
+      }
 #endif
       stat_time = 0;
     }
+    // Take a snapshot if one was requested
+    if(snapshot_rq != 0){
+      snapshot_rq = 0;
+      snapshot_save(snapshot_fn);
+      checkpoint_slices = 0;
+    }
+    // Or a checkpoint if it's time
+    if(checkpoint_interval > 0){
+      checkpoint_slices++;
+      if(checkpoint_slices >= checkpoint_interval*10){
+	snapshot_checkpoint(snapshot_fn);
+	checkpoint_slices = 0;
+      }
+    }
+    // Check for idle processors
+    lambda_idle_check(0);
+#ifdef CONFIG_2X2
+    lambda_idle_check(1);
+#endif
     // Emulated time passed
     emu_time++;
-    // Timer won't wrap for many years, so we don't have to care about that
-    // Are we ahead of real time?
-    if(emu_time > real_time){
-      // Yes, wait.
-      while(emu_time > real_time){
-	usleep(0); // Allow real time to pass
+    // Benchmarks run unthrottled until they have done enough cycles
+    if(bench_cycles > 0){
+      bench_done += icount-slice_start;
+      if(bench_done >= bench_cycles){
+	bench_report();
+	ld_die_rq = 1;
       }
     }
     // Otherwise loop
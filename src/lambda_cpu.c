@@ -22,6 +22,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <strings.h>
 #include <stdlib.h>
 
@@ -31,6 +32,7 @@
 #include "mem.h"
 #include "sdu.h"
 #include "syms.h"
+#include "snapshot.h"
 
 #ifdef XBEEP
 // BEEP support. The addresses of XBEEP and XFALSE are looked up in lambda_initialize.
@@ -38,9 +40,37 @@ uint32_t xbeep_addr = 0;
 uint32_t xfalse_addr = 0;
 #endif
 
+// Idle detection. Set from the configuration.
+int idle_detect = 0;         // Enable
+int idle_checks = 3;         // Checks in a row with an unchanged HRAM before parking
+int idle_slices = 4;         // Slices to stay parked
+char idle_symbol[128] = "";  // Microcode symbol of the idle loop
+uint32_t idle_addr = 0;      // Its address
+static uint64_t idle_set[2][0x10000/64]; // Micro-PCs in the HRAM at the last check
+int idle_parked = 0;         // Some processor is parked
+#define IDLE_SLICE_CYCLES 500000
+
+// A memory cycle completes this many cycles after it starts (bus busy 3 to 1)
+#define MEM_WAIT_CYCLES 2
+
 // FIXME: Remove the #define and the conditionals later
 #define ISTREAM
 
+// Core variants.
+// The hot path is written once as inline functions taking a constant trace flag.
+// The instrumented core honors the trace flags; the lean cores are built with
+// tracing compiled out and the processor number fixed.
+#define LCORE static inline __attribute__((always_inline))
+#define UTRACE (trace && pS[I].microtrace)
+#define MTRACE (trace && pS[I].macrotrace)
+#define NTRACE (trace && NUbus_trace)
+
+// Opcode handler for each core variant
+#define UINST_VARIANTS(op)						\
+  static void op##_trace(int I){ op##_core(I,true); }			\
+  static void op##_lean0(int I){ (void)I; op##_core(0,false); }		\
+  static void op##_lean1(int I){ (void)I; op##_core(1,false); }
+
 // Configuration PROM message
 static uint8_t prom_string[0x12] = "LMI LAMBDA V5.0";
 static uint8_t prom_modelno_string[0x12] = "LAM001 V5.0";
@@ -60,6 +90,7 @@ ShadowMemoryPageEnt ShadowMemoryPageMap[0x20000];
 
 // Processor states
 struct lambdaState pS[2];
+struct lambdaCache pC[2];
 
 #ifdef SHADOW
 // Shadow memory maintenance
@@ -75,6 +106,8 @@ Q shadow_read(uint32_t addr){
 // Utility functions
 void debug_disassemble_IR(int I);
 void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR);
+void decode_uinst(UInst ui,DecodedUInst *ent);
+void decode_ireg(int I);
   
 uint32_t ldb(uint64_t value, int size, int position){
   uint64_t mask,result;
@@ -109,7 +142,7 @@ int debugtrace_ptr[2] = { 0,0 };
 #endif
 
 // Barrel Shifter
-void operate_shifter(int I){
+LCORE void operate_shifter_core(int I,const bool trace){
   // uint32_t x=0;
   uint32_t Mask = 0;
   int left_mask_index;
@@ -118,26 +151,27 @@ void operate_shifter(int I){
 
   // Shifter run
   // Rotate R
-  if(pS[I].Iregister.Byte.Rotate_Source != 0){
+  if(pS[I].Idecode.Byte.Rotate_Source != 0){
     // Lambda doesn't have a rotate direction field
-    R = left_rotate(R,pS[I].Iregister.Byte.Pos);
-    if(pS[I].Iregister.Byte.Len == 040 && pS[I].Iregister.Byte.Rotate_Mask == 0){
+    R = left_rotate(R,pS[I].Idecode.Byte.Pos);
+    if(pS[I].Idecode.Byte.Len == 040 && pS[I].Idecode.Byte.Rotate_Mask == 0){
+      pS[I].Idecode.Byte.Len = 0;
       pS[I].Iregister.Byte.Len = 0;
     }
   }
   // Create mask
   // Get Right mask
-  if(pS[I].Iregister.Byte.Rotate_Mask != 0){
-    right_mask_index = pS[I].Iregister.Byte.Pos;
+  if(pS[I].Idecode.Byte.Rotate_Mask != 0){
+    right_mask_index = pS[I].Idecode.Byte.Pos;
   }else{
     right_mask_index = 0;
   }
   right_mask_index &= 037;
   // Get Left mask
-  // left_mask_index = (right_mask_index + (pS[I].Iregister.Byte.Len)) % 32;
-  left_mask_index = (right_mask_index + (pS[I].Iregister.Byte.Len)) % 33;
+  // left_mask_index = (right_mask_index + (pS[I].Idecode.Byte.Len)) % 32;
+  left_mask_index = (right_mask_index + (pS[I].Idecode.Byte.Len)) % 33;
   /*
-  left_mask_index = (right_mask_index + (pS[I].Iregister.Byte.Len));
+  left_mask_index = (right_mask_index + (pS[I].Idecode.Byte.Len));
   if (left_mask_index == 040) left_mask_index = 037;
   left_mask_index %= 32;
   */
@@ -177,7 +211,7 @@ void operate_shifter(int I){
   // Final mask
   Mask = shift_left_mask[left_mask_index]&shift_right_mask[right_mask_index];
 
-  if(pS[I].microtrace){
+  if(UTRACE){
     logmsgf(LT_LAMBDA,10,"SHIFTER: LMI = %d RMI = %d SLM = 0x%X SRM = 0x%X MASK = 0x%X\n",
 	   left_mask_index,right_mask_index,
 	   shift_left_mask[left_mask_index],shift_right_mask[right_mask_index],
@@ -214,11 +248,15 @@ void operate_shifter(int I){
   pS[I].Obus |= pS[I].Abus&(~Mask);
   // SAVE R FOR LATER ABUSE
   pS[I].Rbus = R;
-  if(pS[I].microtrace){
+  if(UTRACE){
     logmsgf(LT_LAMBDA,10,"SHIFTER: COMPLETED! O = 0x%X\n",pS[I].Obus);
   }
 }
 
+void operate_shifter(int I){
+  operate_shifter_core(I,true);
+}
+
 /* 
    MICROINSTRUCTION BITS
 
@@ -738,9 +776,17 @@ void lambda_initialize(int I,int ID){
   pS[I].wrote_uPC = false;
   pS[I].NOP_Next = false;
   pS[I].mirInvalid = 0;
+  pS[I].ublock_cycles = 0;
+  pS[I].idle_park = 0;
+  pS[I].idle_stable = 0;
+  pS[I].mem_wait = 0;
+  bzero((uint8_t *)pC[I].vm_tlb,sizeof(pC[I].vm_tlb));
+  decode_ireg(I);
+  lambda_flush_blocks(I);
   if(ID != 0){
     // Clobber erasable memories
     bzero((uint8_t *)pS[I].WCS,(64*1024)*8);
+    lambda_invalidate_wcs(I,-1);
     // Reset PC
     pS[I].loc_ctr_reg.raw = 0;
     pS[I].loc_ctr_cnt = 0;
@@ -757,6 +803,7 @@ void lambda_initialize(int I,int ID){
     // Set up slot assignments
     pS[I].NUbus_ID = ID;
     pS[I].RG_Mode.NUbus_ID = (pS[I].NUbus_ID&0x0F);  
+    nubus_register_slave(ID,lambda_nubus_slave,I,0);
     // Let's experimentally reset bits in the LV1 and LV2 maps
     x=0;
     while(x < 4096){
@@ -796,7 +843,7 @@ void lambda_initialize(int I,int ID){
 // ALU items
 // ALU operation M-A or (M-A-1)
 // Used by JUMP
-void alu_sub_stub(int I,int Carry){
+LCORE void alu_sub_stub_core(int I,int Carry){
   pS[I].ALU_Result = pS[I].Mbus - pS[I].Abus - (Carry ? 0 : 1);
   // FIXNUM Overflow Check
   if((((pS[I].Mbus^pS[I].Abus)&(pS[I].Mbus^pS[I].ALU_Result))&0x01000000)==0x01000000){
@@ -804,8 +851,12 @@ void alu_sub_stub(int I,int Carry){
   }
 }
 
+void alu_sub_stub(int I,int Carry){
+  alu_sub_stub_core(I,Carry);
+}
+
 // Sanitize results
-void alu_cleanup_result(int I){
+LCORE void alu_cleanup_result_core(int I){
   // Reduce carry-out to a flag without use of boolean type
   if((pS[I].ALU_Result&0xFFFFFFFF00000000LL) != 0){ pS[I].ALU_Carry_Out = 1; }
   // Clean Output (ALU is 32 bits wide)
@@ -814,8 +865,12 @@ void alu_cleanup_result(int I){
   pS[I].Obus = pS[I].ALU_Result;
 }
 
+void alu_cleanup_result(int I){
+  alu_cleanup_result_core(I);
+}
+
 // Arrange for carry-out
-void fix_alu_carry_out(int I){
+LCORE void fix_alu_carry_out_core(int I){
   int cout = ((pS[I].ALU_Result < pS[I].Mbus ? 1 : 0) + ((pS[I].Mbus>>31)&1) + ((pS[I].Abus>>31)&1)) & 1;
   pS[I].ALU_Result &= 0xffffffff;
   if (cout){
@@ -823,8 +878,12 @@ void fix_alu_carry_out(int I){
   }
 }
 
-void operate_alu(int I){
-  switch(pS[I].Iregister.ALU.Operation){
+void fix_alu_carry_out(int I){
+  fix_alu_carry_out_core(I);
+}
+
+LCORE void operate_alu_core(int I){
+  switch(pS[I].Idecode.ALU.Operation){
   case 0: // LAM-ALU-SETZ
     pS[I].ALU_Result = 0;
     break;
@@ -868,7 +927,7 @@ void operate_alu(int I){
   case 020: // LAM-ALU-MSTEP
     if((pS[I].Qregister&0x01)==0x01){
       pS[I].ALU_Result = pS[I].Mbus + pS[I].Abus;
-      fix_alu_carry_out(I);
+      fix_alu_carry_out_core(I);
     }else{
       pS[I].ALU_Result = pS[I].Mbus;
       pS[I].ALU_Result &= 0xffffffff;
@@ -925,32 +984,32 @@ void operate_alu(int I){
     break;
   case 026: // LAM-ALU-M-A-1
     // alu_sub_stub(I,1);
-    alu_sub_stub(I, pS[I].Iregister.ALU.Carry);
+    alu_sub_stub_core(I, pS[I].Idecode.ALU.Carry);
     break;
   case 031: // LAM-ALU-ADD
-    pS[I].ALU_Result = pS[I].Mbus + pS[I].Abus + (pS[I].Iregister.ALU.Carry ? 1 : 0);
+    pS[I].ALU_Result = pS[I].Mbus + pS[I].Abus + (pS[I].Idecode.ALU.Carry ? 1 : 0);
     if((((pS[I].Mbus^pS[I].ALU_Result)&(pS[I].Abus^pS[I].ALU_Result))&0x01000000)==0x01000000){
       pS[I].ALU_Fixnum_Oflow=1;
     }
-    fix_alu_carry_out(I);
+    fix_alu_carry_out_core(I);
     break;
   case 034: // LAM-??? (Raven ALU-Opcode-M)
     // M or M+1
     pS[I].ALU_Result = pS[I].Mbus;
-    if(pS[I].Iregister.ALU.Carry != 0){
+    if(pS[I].Idecode.ALU.Carry != 0){
       pS[I].ALU_Result++;
     }
-    fix_alu_carry_out(I);
+    fix_alu_carry_out_core(I);
     break;
   case 037: // LAM-ALU-M+M
-    pS[I].ALU_Result = pS[I].Mbus + pS[I].Mbus + (pS[I].Iregister.ALU.Carry ? 1 : 0);
+    pS[I].ALU_Result = pS[I].Mbus + pS[I].Mbus + (pS[I].Idecode.ALU.Carry ? 1 : 0);
     if((((pS[I].Mbus^pS[I].ALU_Result)&(pS[I].Mbus^pS[I].ALU_Result))&0x01000000)==0x01000000){
       pS[I].ALU_Fixnum_Oflow=1;
     }
-    fix_alu_carry_out(I);
+    fix_alu_carry_out_core(I);
     break;
   default:
-    logmsgf(LT_LAMBDA,0,"Unknown ALU Operation %o\n",pS[I].Iregister.ALU.Operation);
+    logmsgf(LT_LAMBDA,0,"Unknown ALU Operation %o\n",pS[I].Idecode.ALU.Operation);
     pS[I].cpu_die_rq = 1;
   }
   
@@ -960,24 +1019,28 @@ void operate_alu(int I){
   pS[I].ALU_Result &= 0xFFFFFFFF;
   
   // For logical operations the carry-out flag is the integer sign bit.
-  if((pS[I].Iregister.ALU.Operation < 030) && (pS[I].Iregister.ALU.Operation != 020)){
+  if((pS[I].Idecode.ALU.Operation < 030) && (pS[I].Idecode.ALU.Operation != 020)){
     pS[I].ALU_Carry_Out = (pS[I].ALU_Result & 0x80000000) ? 1 : 0;
   }    
   
   // The mask bit selects where the high bits of the result come from.
   // If it's set, they come from the A-bus.
-  if(pS[I].Iregister.ALU.Mask > 0){ 
+  if(pS[I].Idecode.ALU.Mask > 0){ 
     pS[I].ALU_Result &= 0x01FFFFFF;
     pS[I].ALU_Result |= (pS[I].Abus&0xFE000000);
   }
 }
 
-void handle_o_bus(int I){
+void operate_alu(int I){
+  operate_alu_core(I);
+}
+
+LCORE void handle_o_bus_core(int I){
   // Determine output location
   pS[I].Obus_Input = pS[I].ALU_Result;
   
   // Load pS[I].Obus 
-  switch(pS[I].Iregister.ALU.Output){
+  switch(pS[I].Idecode.ALU.Output){
     
   case 0: // LAM-OB-MSK
     // Run things through the MASKER PROM.
@@ -993,11 +1056,11 @@ void handle_o_bus(int I){
     // "if the m source is all ones and the a source is all zeroes, then the output should be identical to the contents of the masker prom"
     // (But that was for byte operations!)
     
-    if(pS[I].Iregister.ALU.Mask){ logmsgf(LT_LAMBDA,0,"MASKER: BIT 8 SET\n"); pS[I].cpu_die_rq = 1; }
-    if(pS[I].Iregister.ALU.Output&0x040){ logmsgf(LT_LAMBDA,0,"MASKER: BIT 11 SET\n"); pS[I].cpu_die_rq = 1; }
+    if(pS[I].Idecode.ALU.Mask){ logmsgf(LT_LAMBDA,0,"MASKER: BIT 8 SET\n"); pS[I].cpu_die_rq = 1; }
+    if(pS[I].Idecode.ALU.Output&0x040){ logmsgf(LT_LAMBDA,0,"MASKER: BIT 11 SET\n"); pS[I].cpu_die_rq = 1; }
     if(pS[I].Iregister.ALU.Spare&0x040){ logmsgf(LT_LAMBDA,0,"MASKER: BIT 29 SET\n"); pS[I].cpu_die_rq = 1; }
     
-    if(pS[I].Iregister.ALU.Operation != 0){	
+    if(pS[I].Idecode.ALU.Operation != 0){	
       // logmsgf(LT_LAMBDA,10,"MASKER: Masker PROM unimplemented\n");
       // pS[I].cpu_die_rq = 1;	
     }
@@ -1041,15 +1104,19 @@ void handle_o_bus(int I){
     pS[I].Obus = ((pS[I].Obus >> 16) & 0x0000ffff) | ((pS[I].Obus << 16) & 0xffff0000);
     break;
   default:
-    logmsgf(LT_LAMBDA,0,"Unknown output select %o\n",pS[I].Iregister.ALU.Output);
+    logmsgf(LT_LAMBDA,0,"Unknown output select %o\n",pS[I].Idecode.ALU.Output);
     pS[I].cpu_die_rq = 1;
   }
 }
 
+void handle_o_bus(int I){
+  handle_o_bus_core(I);
+}
+
 // Q register
-void handle_q_register(int I){
-  if(pS[I].Iregister.ALU.QControl > 0){
-    switch(pS[I].Iregister.ALU.QControl){
+LCORE void handle_q_register_core(int I){
+  if(pS[I].Idecode.ALU.QControl > 0){
+    switch(pS[I].Idecode.ALU.QControl){
     case 1: // LAM-Q-LEFT
       // Shift
       pS[I].Qregister = pS[I].Qregister << 1;
@@ -1069,15 +1136,56 @@ void handle_q_register(int I){
       pS[I].Qregister=pS[I].ALU_Result;
       break;
     default:
-      logmsgf(LT_LAMBDA,0,"Unknown Q control %o\n",pS[I].Iregister.ALU.QControl);
+      logmsgf(LT_LAMBDA,0,"Unknown Q control %o\n",pS[I].Idecode.ALU.QControl);
       pS[I].cpu_die_rq = 1;
     }
   }
 }
 
+void handle_q_register(int I){
+  handle_q_register_core(I);
+}
+
 // Virtual memory mapping process 
-void VM_resolve_address(int I,int access,int force){
-  if(pS[I].microtrace){
+// Save the outcome of a translation
+static void vm_tlb_fill(int I,VMTLBEnt *ent,uint32_t key){
+  ent->key = key;
+  ent->lv1_gen = pC[I].vm_lv1_gen[pS[I].VMAregister.VM.VPage_Block];
+  ent->lv2_gen = pC[I].vm_lv2_gen[pS[I].vm_lv2_index.raw];
+  ent->lv2_index = pS[I].vm_lv2_index.raw;
+  ent->gcv = pS[I].cached_gcv;
+  ent->fault = (pS[I].Page_Fault != 0);
+  ent->phys_addr = pS[I].vm_phys_addr;
+  ent->byte_mode = pS[I].vm_byte_mode;
+  ent->valid = true;
+}
+
+LCORE void VM_resolve_address_core(int I,int access,int force,const bool trace){
+  uint32_t key = (pS[I].VMAregister.raw>>8)&0x1FFFF;
+  VMTLBEnt *ent;
+  key <<= 2;
+  if(access == VM_WRITE || access == VM_BYTE_WRITE){ key |= 2; }
+  if(force != 0){ key |= 1; }
+  ent = &pC[I].vm_tlb[key&(VM_TLB_SIZE-1)];
+#ifndef SHADOW
+  // Try the translation cache first
+  if(ent->valid && ent->key == key && UTRACE == false &&
+     ent->lv1_gen == pC[I].vm_lv1_gen[pS[I].VMAregister.VM.VPage_Block] &&
+     ent->lv2_gen == pC[I].vm_lv2_gen[ent->lv2_index]){
+    pS[I].vm_lv2_index.raw = ent->lv2_index;
+    pS[I].cached_gcv = ent->gcv;
+    if(ent->fault){
+      pS[I].Page_Fault = 1;
+      return;
+    }
+    pS[I].Page_Fault = 0;
+    pS[I].vm_phys_addr.raw = ent->phys_addr.raw;
+    pS[I].vm_phys_addr.Offset = pS[I].VMAregister.VM.Offset;
+    pS[I].vm_byte_mode = ent->byte_mode;
+    return;
+  }
+#endif
+  if(UTRACE){
     logmsgf(LT_LAMBDA,10,"VM: Access %o Force %o: VMA = 0x%X\n",
 	   access,force,pS[I].VMAregister.raw);
     logmsgf(LT_LAMBDA,10,"VM: LV1 ENT = 0x%X (LV2 Block %o MB %o MB-Validity %o)\n",
@@ -1103,7 +1211,7 @@ void VM_resolve_address(int I,int access,int force){
   pS[I].vm_lv2_index.LV2_Block = pS[I].vm_lv1_map[pS[I].VMAregister.VM.VPage_Block].LV2_Block;
 
   // Print LV2 data
-  if(pS[I].microtrace){
+  if(UTRACE){
     logmsgf(LT_LAMBDA,10,"VM: LV2 CTL ENT = 0x%X (Meta %o Status %o Access %o Force-Allowed %o Packet_Code %o Packetize-Writes %o Enable-Cache %o Lock-Nubus %o)\n",
 	   pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].raw,
 	   pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Meta,
@@ -1136,10 +1244,11 @@ void VM_resolve_address(int I,int access,int force){
 
   // Page fault / halt tests
   if(pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Access == 0){
-    if(pS[I].microtrace){
+    if(UTRACE){
       logmsgf(LT_LAMBDA,10,"VM: No-access page fault\n");
     }
     pS[I].Page_Fault = 1;
+    vm_tlb_fill(I,ent,key);
     return;
   }
 
@@ -1148,10 +1257,11 @@ void VM_resolve_address(int I,int access,int force){
   if(pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Access == 1){ // && (access == VM_READ || access == VM_BYTE_READ)){
     // If we did not use force or force is disabled...
     if(force == 0 || pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Force_Allowed == 0){
-      if(pS[I].microtrace){
+      if(UTRACE){
 	logmsgf(LT_LAMBDA,10,"VM: No-read-access page fault\n");
       }
       pS[I].Page_Fault = 1;
+      vm_tlb_fill(I,ent,key);
       return;
     }
   }  
@@ -1161,10 +1271,11 @@ void VM_resolve_address(int I,int access,int force){
   if((pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Access) == 2 && (access == VM_WRITE || access == VM_BYTE_WRITE)){
     // If we did not use force or force is disabled...
     if(force == 0 || pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Force_Allowed == 0){
-      if(pS[I].microtrace){
+      if(UTRACE){
 	logmsgf(LT_LAMBDA,10,"VM: No-write-access page fault\n");
       }
       pS[I].Page_Fault = 1;
+      vm_tlb_fill(I,ent,key);
       return;
     }
   }  
@@ -1214,6 +1325,10 @@ void VM_resolve_address(int I,int access,int force){
     }
     pS[I].vm_byte_mode = 2; // Byte access
   }
+  // Don't remember translations that stopped the processor
+  if(pS[I].cpu_die_rq == 0){
+    vm_tlb_fill(I,ent,key);
+  }
 
 #ifdef SHADOW
   // Shadow memory maintenance if writing and not page fault.
@@ -1227,18 +1342,22 @@ void VM_resolve_address(int I,int access,int force){
 #endif
 
   // Log result!
-  if(pS[I].microtrace){
+  if(UTRACE){
     logmsgf(LT_LAMBDA,10,"VM: Resulting PA 0x%X\n",pS[I].vm_phys_addr.raw);
   }
 }
 
+void VM_resolve_address(int I,int access,int force){
+  VM_resolve_address_core(I,access,force,true);
+}
+
 // Source fetch handling
-void handle_source(int I,int source_mode){
+LCORE void handle_source_core(int I,int source_mode,const bool trace){
   // Handle A Bus Input
-  pS[I].Abus = pS[I].Amemory[pS[I].Iregister.ASource];
+  pS[I].Abus = pS[I].Amemory[pS[I].Idecode.ASource];
   // Handle M Bus Input
-  if(pS[I].Iregister.MSource > 077){
-    switch(pS[I].Iregister.MSource){
+  if(pS[I].Idecode.MSource > 077){
+    switch(pS[I].Idecode.MSource){
     case 0100: // LAM-M-SRC-INTERRUPT-POINTER
       pS[I].Mbus = pS[I].InterruptVector;
       break;
@@ -1250,7 +1369,7 @@ void handle_source(int I,int source_mode){
         // Right half
         pS[I].Mbus = pS[I].MIregister.mi[1].raw&077;
       }
-      if(pS[I].microtrace){
+      if(UTRACE){
         logmsgf(LT_LAMBDA,10,"MACRO-IR-DISPLACEMENT: LC = 0x%X, MIR = 0x%X, Fetched 0x%X\n",
 	       pS[I].LCregister.raw,pS[I].MIregister.raw,pS[I].Mbus);
       }
@@ -1266,7 +1385,7 @@ void handle_source(int I,int source_mode){
         // Right half
         pS[I].Mbus = pS[I].MIregister.mi[1].raw;
       }
-      if(pS[I].microtrace){
+      if(UTRACE){
         logmsgf(LT_LAMBDA,10,"MACRO-IR: LC = 0x%X, MIR = 0x%X, Fetched 0x%X\n",
 	       pS[I].LCregister.raw,pS[I].MIregister.raw,pS[I].Mbus);
       }
@@ -1283,7 +1402,7 @@ void handle_source(int I,int source_mode){
         pS[I].MIDAddr.Hi = pS[I].RG_Mode.MID_Hi_Adr;
         // Perform read
         pS[I].Mbus = pS[I].MIDmemory[pS[I].MIDAddr.raw];
-        if(pS[I].microtrace){
+        if(UTRACE){
           logmsgf(LT_LAMBDA,10,"MI: LAM-M-SRC-MACRO.IR.DECODE.RAM\n");
           logmsgf(LT_LAMBDA,10,"MID READ: MIR = 0x%X LC = 0x%X RG.Hi = %o RG.Enable_Misc_MID = %o (OPCODE %o) GENERATED ADDR %o DATA = 0x%X\n",
 		 pS[I].MIregister.raw,pS[I].LCregister.raw,pS[I].RG_Mode.MID_Hi_Adr,pS[I].RG_Mode.Enable_Misc_MID,
@@ -1313,7 +1432,7 @@ void handle_source(int I,int source_mode){
       if(source_mode == 1){ break; }
       // Same as above, but pops stack.
       if(pS[I].popj_after_nxt == 0){
-        if(pS[I].microtrace){
+        if(UTRACE){
           logmsgf(LT_LAMBDA,10,"PJAN armed with a MICRO-STACK-POP\n");
         }
         // PJAN is armed. We want this call to return to my caller instead of here.
@@ -1346,7 +1465,7 @@ void handle_source(int I,int source_mode){
       pS[I].vm_lv2_index.VPage_Offset = pS[I].MDregister.VM.VPage_Offset;
       pS[I].vm_lv2_index.LV2_Block = pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].LV2_Block;
       pS[I].Mbus = pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].raw;
-      if(pS[I].microtrace){
+      if(UTRACE){
         logmsgf(LT_LAMBDA,10,"VM: READ LV2 CTL ENT 0x%X\n",pS[I].vm_lv2_index.raw);
       }
       break;
@@ -1356,13 +1475,13 @@ void handle_source(int I,int source_mode){
       pS[I].vm_lv2_index.VPage_Offset = pS[I].MDregister.VM.VPage_Offset;
       pS[I].vm_lv2_index.LV2_Block = pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].LV2_Block;
       pS[I].Mbus = pS[I].vm_lv2_adr[pS[I].vm_lv2_index.raw].raw;
-      if(pS[I].microtrace){
+      if(UTRACE){
         logmsgf(LT_LAMBDA,10,"VM: READ LV2 ADR ENT 0x%X\n",pS[I].vm_lv2_index.raw);
       }
       break;
     case 0126: // LAM-M-SRC-LC
       pS[I].Mbus = pS[I].LCregister.raw;
-      if(pS[I].microtrace || pS[I].macrotrace){
+      if(UTRACE || MTRACE){
         logmsgf(LT_LAMBDA,10,"MI: LC READ: LC = 0x%X (0%o)\n",pS[I].LCregister.raw,pS[I].LCregister.raw);
       }
       break;
@@ -1388,7 +1507,7 @@ void handle_source(int I,int source_mode){
         pS[I].Mbus = pS[I].Mmemory[0x800+pS[I].pdl_ptr_reg];
         pS[I].pdl_ptr_reg--; pS[I].pdl_ptr_reg &= 0x7FF;
       }
-      if(pS[I].microtrace || pS[I].macrotrace){
+      if(UTRACE || MTRACE){
         logmsgf(LT_LAMBDA,10,"MI: C-PDL-BUFFER-POINTER-POP: Addr Hi = 0x%X, NEW PTR = %o, DATA = %o\n",
 	       pS[I].DP_Mode.PDL_Addr_Hi,pS[I].pdl_ptr_reg,pS[I].Mbus);
       }
@@ -1399,7 +1518,7 @@ void handle_source(int I,int source_mode){
       }else{
         pS[I].Mbus = pS[I].Mmemory[0x800+pS[I].pdl_index_reg];
       }
-      if(pS[I].microtrace || pS[I].macrotrace){
+      if(UTRACE || MTRACE){
         logmsgf(LT_LAMBDA,10,"MI: C-PDL-BUFFER-INDEX: Addr Hi = %X, INDEX = %o, DATA = %o\n",
 	       pS[I].DP_Mode.PDL_Addr_Hi,pS[I].pdl_index_reg,pS[I].Mbus);
       }
@@ -1434,7 +1553,7 @@ void handle_source(int I,int source_mode){
         disp_word.raw = pS[I].MIDmemory[addr];
 
         // Log it
-        if(pS[I].microtrace){
+        if(UTRACE){
           logmsgf(LT_LAMBDA,10,"MI: MACRO-IR-DISPATCH-MISC\n");
           logmsgf(LT_LAMBDA,10,"MID: MIR = 0x%X LC = 0x%X RG.Hi = %o RG.Enable_Misc_MID = %o: GENERATED ADDR %o DATA = 0x%X\n",
 		 pS[I].MIregister.raw,pS[I].LCregister.raw,pS[I].RG_Mode.MID_Hi_Adr,
@@ -1524,7 +1643,7 @@ void handle_source(int I,int source_mode){
       }else{
         pS[I].Mbus = pS[I].Mmemory[0x800+pS[I].pdl_ptr_reg];
       }
-      if(pS[I].microtrace || pS[I].macrotrace){
+      if(UTRACE || MTRACE){
         logmsgf(LT_LAMBDA,10,"MI: C-PDL-BUFFER-POINTER: Addr Hi = 0x%X, INDEX = %o, DATA = %o\n",
 	       pS[I].DP_Mode.PDL_Addr_Hi,pS[I].pdl_index_reg,pS[I].Mbus);
       }
@@ -1533,32 +1652,56 @@ void handle_source(int I,int source_mode){
       pS[I].Mbus = 0;
       break;
     default:
-      logmsgf(LT_LAMBDA,0,"Unknown MF-Source %o\n",pS[I].Iregister.MSource);
+      logmsgf(LT_LAMBDA,0,"Unknown MF-Source %o\n",pS[I].Idecode.MSource);
       pS[I].cpu_die_rq = 1;
     }
   }else{
-    pS[I].Mbus = pS[I].Mmemory[pS[I].Iregister.MSource];
+    pS[I].Mbus = pS[I].Mmemory[pS[I].Idecode.MSource];
   }
   // Done! Load MFO bus from M bus (for source cycle)
   pS[I].MFObus = pS[I].Mbus;
 }
 
+void handle_source(int I,int source_mode){
+  handle_source_core(I,source_mode,true);
+}
+
+// Start a memory cycle. With fast memory, RAM accesses complete at once,
+// and the result is held back for the cycles the bus handshake would take.
+LCORE void lambda_mem_request(int I,int access,uint32_t addr,uint32_t data){
+  if(fast_memory != 0){
+    uint32_t result = data;
+    if(mem_fast_request(access,addr,&result) != 0){
+      pS[I].mem_wait = MEM_WAIT_CYCLES;
+      pS[I].mem_wait_read = ((access&0x01) == 0);
+      pS[I].mem_wait_data = result;
+      if(nubus_trace_map != NULL){
+	uint64_t start = nubus_trace_begin(pS[I].NUbus_ID);
+	nubus_trace_record(pS[I].NUbus_ID,access,addr,result,NUBUS_TR_ACK|NUBUS_TR_FAST,start,
+			   NUbus_cycles-start,(NUbus_cycles-start)+MEM_WAIT_CYCLES);
+      }
+      return;
+    }
+  }
+  nubus_io_request(access,pS[I].NUbus_ID,addr,data);
+}
+
 // Destination selector handling
-void handle_destination(int I){
-  if(pS[I].Iregister.Destination.A.Flag != 0){
+LCORE void handle_destination_core(int I,const bool trace){
+  if(pS[I].Idecode.Destination.A.Flag != 0){
     // A-Memory store
-    pS[I].Amemory[pS[I].Iregister.Destination.A.Addr] = pS[I].Obus;
+    pS[I].Amemory[pS[I].Idecode.Destination.A.Addr] = pS[I].Obus;
 #ifndef CONFIG_PHYSMS
-    if(pS[I].Iregister.Destination.A.Addr == mouse_x_loc[I] || pS[I].Iregister.Destination.A.Addr == mouse_y_loc[I]){
+    if(pS[I].Idecode.Destination.A.Addr == mouse_x_loc[I] || pS[I].Idecode.Destination.A.Addr == mouse_y_loc[I]){
       warp_mouse_callback(I);
     }
 #endif
   }else{
     // A+M-Memory and/or functional destination store
-    pS[I].Amemory[pS[I].Iregister.Destination.M.Addr] = pS[I].Obus;
-    pS[I].Mmemory[pS[I].Iregister.Destination.M.Addr] = pS[I].Obus;
-    if(pS[I].Iregister.Destination.F.Dest > 0){
-      switch(pS[I].Iregister.Destination.F.Dest){
+    pS[I].Amemory[pS[I].Idecode.Destination.M.Addr] = pS[I].Obus;
+    pS[I].Mmemory[pS[I].Idecode.Destination.M.Addr] = pS[I].Obus;
+    if(pS[I].Idecode.Destination.F.Dest > 0){
+      switch(pS[I].Idecode.Destination.F.Dest){
       case 001: // LAM-FUNC-DEST-LC
 	// On Raven, writing LC also sets needfetch.
 	// Let's do that here too.
@@ -1567,7 +1710,7 @@ void handle_destination(int I){
 	  pS[I].Obus--;
 	}
 	pS[I].LCregister.raw = pS[I].Obus;
-	if(pS[I].microtrace || pS[I].macrotrace){
+	if(UTRACE || MTRACE){
 	  logmsgf(LT_LAMBDA,10,"MI: LC SET: NEW LC = 0x%X (0%o), need-fetch set\n",
 		 pS[I].LCregister.raw,pS[I].LCregister.raw);
 	}
@@ -1594,7 +1737,7 @@ void handle_destination(int I){
 	// Perform write
 	pS[I].MIDmemory[pS[I].MIDAddr.raw] = pS[I].Obus;
 	// Log it
-	if(pS[I].microtrace){
+	if(UTRACE){
 	  logmsgf(LT_LAMBDA,10,"MID WRITE: MIR = 0x%X RG.Hi = %o RG.Enable_Misc_MID = %o (OPCODE %o) GENERATED ADDR %o DATA = 0x%X\n",
 		 pS[I].MIregister.raw,pS[I].RG_Mode.MID_Hi_Adr,pS[I].RG_Mode.Enable_Misc_MID,
 		 pS[I].MIregister.mi[0].Misc.Opcode,pS[I].MIDAddr.raw,pS[I].Obus);
@@ -1603,7 +1746,7 @@ void handle_destination(int I){
       case 006: // LAM-FUNC-DEST-CRAM-HIGH
 	// Same trick as LAM-FUNC-DEST-CRAM-MAP?
 	// Addressed by the previous instruction, so loc_ctr_reg
-	if(pS[I].microtrace){
+	if(UTRACE){
 	  logmsgf(LT_LAMBDA,10,"CRAM WRITE HI: Addr %o w/ data %o\n",pS[I].loc_ctr_reg.raw,pS[I].Obus);
 	}	
         {
@@ -1616,13 +1759,14 @@ void handle_destination(int I){
           tmp <<= 32;
           pS[I].WCS[paddr].raw &= 0xFFFFFFFF;
           pS[I].WCS[paddr].raw |= tmp;
+          lambda_invalidate_wcs(I,paddr);
           pS[I].cram_write_cyc = true;
         }
 	break;
       case 007: // LAM-FUNC-DEST-CRAM-LOW
 	// Same trick as LAM-FUNC-DEST-CRAM-MAP?
 	// Addressed by the previous instruction, so pS[I].loc_ctr_reg
-	if(pS[I].microtrace){
+	if(UTRACE){
 	  logmsgf(LT_LAMBDA,10,"CRAM WRITE LO: Addr %o w/ data %o\n",pS[I].loc_ctr_reg.raw,pS[I].Obus);
 	}
         {
@@ -1633,6 +1777,7 @@ void handle_destination(int I){
 
           pS[I].WCS[paddr].raw &= 0xFFFFFFFF00000000LL;
           pS[I].WCS[paddr].raw |= (pS[I].Obus&0xFFFFFFFF);
+          lambda_invalidate_wcs(I,paddr);
           pS[I].cram_write_cyc = true;
         }
 	break;
@@ -1645,7 +1790,7 @@ void handle_destination(int I){
 	  pS[I].pdl_ptr_reg &= 0x7FF;
 	  pS[I].Mmemory[0x800+pS[I].pdl_ptr_reg] = pS[I].Obus;	  
 	}
-        if(pS[I].microtrace || pS[I].macrotrace){
+        if(UTRACE || MTRACE){
 	  logmsgf(LT_LAMBDA,10,"MI: C-PDL-BUFFER-POINTER: Addr Hi = 0x%X, PTR = %o, DATA = %o\n",
 		 pS[I].DP_Mode.PDL_Addr_Hi,pS[I].pdl_ptr_reg,pS[I].Obus);
 	}
@@ -1660,7 +1805,7 @@ void handle_destination(int I){
 	  pS[I].pdl_ptr_reg &= 0x7FF;
 	  pS[I].Mmemory[0x800+pS[I].pdl_ptr_reg] = pS[I].Obus;	  
 	}
-        if(pS[I].microtrace || pS[I].macrotrace){
+        if(UTRACE || MTRACE){
 	  logmsgf(LT_LAMBDA,10,"MI: C-PDL-BUFFER-POINTER-PUSH: Addr Hi = 0x%X, NEW PTR = %o, DATA = %o\n",
 		 pS[I].DP_Mode.PDL_Addr_Hi,pS[I].pdl_ptr_reg,pS[I].Obus);
 	}
@@ -1674,7 +1819,7 @@ void handle_destination(int I){
           pS[I].pdl_ptr_reg &= 0x7FF;
           pS[I].Mmemory[0x800+pS[I].pdl_index_reg] = pS[I].Obus;
         }
-        if(pS[I].microtrace || pS[I].macrotrace){
+        if(UTRACE || MTRACE){
           logmsgf(LT_LAMBDA,10,"MI: C-PDL-BUFFER-INDEX: Addr Hi = 0x%X, PTR = %o, DATA = %o\n",
 		 pS[I].DP_Mode.PDL_Addr_Hi,pS[I].pdl_index_reg,pS[I].Obus);
         }
@@ -1687,7 +1832,7 @@ void handle_destination(int I){
 	}else{
 	  pS[I].pdl_ptr_reg = pS[I].Obus&0x7FF;	  
 	}
-        if(pS[I].microtrace || pS[I].macrotrace){
+        if(UTRACE || MTRACE){
 	  logmsgf(LT_LAMBDA,10,"MI: PDL-BUFFER-POINTER: Addr Hi = 0x%X, PTR = %o, DATA = %o\n",
 		 pS[I].DP_Mode.PDL_Addr_Hi,pS[I].pdl_ptr_reg,pS[I].Obus);
 	}
@@ -1695,7 +1840,7 @@ void handle_destination(int I){
       case 015: // LAM-FUNC-DEST-MICRO-STACK-PUSH
 	pS[I].uPCS_ptr_reg++; pS[I].uPCS_ptr_reg &= 0xFF;
 	pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].Obus;
-	if(pS[I].microtrace){
+	if(UTRACE){
           char *location;
           char symloc[100];
           int offset;
@@ -1730,7 +1875,7 @@ void handle_destination(int I){
       case 021: // LAM-FUNC-DEST-VMA-START-READ
 	// Load VMA from pS[I].Obus and initiate a read.
 	pS[I].VMAregister.raw = pS[I].Obus; // Load VMA
-	VM_resolve_address(I,VM_READ,0);
+	VM_resolve_address_core(I,VM_READ,0,trace);
 	if(pS[I].Page_Fault == 0 && pS[I].ConReg.Enable_NU_Master == 1){
 	  // Do it
 	  if(pS[I].RG_Mode.Aux_Stat_Count_Control == 01){
@@ -1739,13 +1884,13 @@ void handle_destination(int I){
 	  if(pS[I].RG_Mode.Main_Stat_Count_Control == 01){
 	    pS[I].stat_counter_main++;
 	  }
-	  nubus_io_request(pS[I].vm_byte_mode|VM_READ,pS[I].NUbus_ID,pS[I].vm_phys_addr.raw,0);
+	  lambda_mem_request(I,pS[I].vm_byte_mode|VM_READ,pS[I].vm_phys_addr.raw,0);
 	}
 	break;
       case 022: // LAM-FUNC-DEST-VMA-START-WRITE
 	// Load VMA from pS[I].Obus and initiate a write.
 	pS[I].VMAregister.raw = pS[I].Obus; // Load VMA
-	VM_resolve_address(I,VM_WRITE,0);
+	VM_resolve_address_core(I,VM_WRITE,0,trace);
 	if(pS[I].Page_Fault == 0 && pS[I].ConReg.Enable_NU_Master == 1){
 	  // Do it
 	  if(pS[I].RG_Mode.Aux_Stat_Count_Control == 01){
@@ -1754,7 +1899,7 @@ void handle_destination(int I){
 	  if(pS[I].RG_Mode.Main_Stat_Count_Control == 01){
 	    pS[I].stat_counter_main++;
 	  }
-	  nubus_io_request(pS[I].vm_byte_mode|VM_WRITE,pS[I].NUbus_ID,pS[I].vm_phys_addr.raw,pS[I].MDregister.raw);
+	  lambda_mem_request(I,pS[I].vm_byte_mode|VM_WRITE,pS[I].vm_phys_addr.raw,pS[I].MDregister.raw);
 	}
 	break;
       case 023: // LAM-FUNC-DEST-L1-MAP
@@ -1763,8 +1908,9 @@ void handle_destination(int I){
 	// 20000 per page	
 	// pS[I].vm_lv1_map[ldb(pS[I].MDregister.raw,12,13)].raw = pS[I].Obus;
 	pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].raw = pS[I].Obus;
+	pC[I].vm_lv1_gen[pS[I].MDregister.VM.VPage_Block]++;
 	// cached_lv1 = pS[I].VMAregister;	
-	if(pS[I].microtrace){
+	if(UTRACE){
           logmsgf(LT_LAMBDA,10,"VM: WRITE LV1 ENT 0x%X DATA 0x%X RESULT 0x%X (Meta %o Validity %o LV2_Block %o)\n",
 		 pS[I].MDregister.VM.VPage_Block,
 		 pS[I].Obus,
@@ -1782,6 +1928,7 @@ void handle_destination(int I){
 	pS[I].vm_lv2_index.VPage_Offset = pS[I].MDregister.VM.VPage_Offset;
 	pS[I].vm_lv2_index.LV2_Block = pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].LV2_Block;
 	pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].raw = pS[I].Obus;
+	pC[I].vm_lv2_gen[pS[I].vm_lv2_index.raw]++;
 	// If we wrote something we don't understand, stop.
 	/*
 	if(pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Byte_Code != 0){
@@ -1796,7 +1943,7 @@ void handle_destination(int I){
 	  pS[I].cpu_die_rq = 1;
 	}
 	// Invert the meta bits?
-        if(pS[I].microtrace || pS[I].cpu_die_rq == 1){
+        if(UTRACE || pS[I].cpu_die_rq == 1){
 	  logmsgf(LT_LAMBDA,10,"VM: WRITE LV2 CTL ENT 0x%X (Meta %o Status %o Access %o Force-Allowed %o Packet-Code %o Packetize-Writes %o Enable-Cache %o Lock-Nubus %o Unused %o)\n",
 		 pS[I].vm_lv2_index.raw,pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Meta,pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Status,
 		 pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Access,pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Force_Allowed,
@@ -1808,11 +1955,12 @@ void handle_destination(int I){
       case 026: // LAM-FUNC-DEST-CRAM-MAP
 	// WWII?
 	// Addressed by the previous instruction, so pS[I].loc_ctr_reg
-	if(pS[I].microtrace){
+	if(UTRACE){
 	  logmsgf(LT_LAMBDA,10,"CRAM MAP WRITE: Addr %o w/ data %o\n",
 		 pS[I].loc_ctr_reg.Page,pS[I].Obus);
 	}
 	pS[I].CRAM_map[pS[I].loc_ctr_reg.Page] = pS[I].Obus;
+	lambda_flush_blocks(I);
 	pS[I].cram_write_cyc = true;
 	// if(pS[I].loc_ctr_reg.Page < 07770){ pS[I].cpu_die_rq = 1; }
 	break;
@@ -1822,7 +1970,7 @@ void handle_destination(int I){
 	break;	
       case 032: // LAM-FUNC-DEST-MD-START-WRITE
 	pS[I].MDregister.raw = pS[I].Obus;
-	VM_resolve_address(I,VM_WRITE,0);
+	VM_resolve_address_core(I,VM_WRITE,0,trace);
 	if(pS[I].Page_Fault == 0 && pS[I].ConReg.Enable_NU_Master == 1){
 	  // Do it
 	  if(pS[I].RG_Mode.Aux_Stat_Count_Control == 01){
@@ -1831,7 +1979,7 @@ void handle_destination(int I){
 	  if(pS[I].RG_Mode.Main_Stat_Count_Control == 01){
 	    pS[I].stat_counter_main++;
 	  }
-	  nubus_io_request(pS[I].vm_byte_mode|VM_WRITE,pS[I].NUbus_ID,pS[I].vm_phys_addr.raw,pS[I].MDregister.raw);
+	  lambda_mem_request(I,pS[I].vm_byte_mode|VM_WRITE,pS[I].vm_phys_addr.raw,pS[I].MDregister.raw);
 	}
 	break;
       case 033: // LAM-FUNC-DEST-C-PDL-INDEX-INC
@@ -1844,14 +1992,14 @@ void handle_destination(int I){
           pS[I].pdl_ptr_reg &= 0x7FF;
           pS[I].Mmemory[0x800+pS[I].pdl_index_reg] = pS[I].Obus;
         }
-        if(pS[I].microtrace || pS[I].macrotrace){
+        if(UTRACE || MTRACE){
           logmsgf(LT_LAMBDA,10,"MI: C-PDL-INDEX-INC: Addr Hi = 0x%X, PTR = %o, DATA = %o\n",
 		 pS[I].DP_Mode.PDL_Addr_Hi,pS[I].pdl_index_reg,pS[I].Obus);
         }
         break;
       case 035: // LAM-FUNC-DEST-MICRO-STACK-POINTER-IF-POP (used by LAM)
 	// "COMPLICATED. Works only on POP"
-	if(pS[I].Iregister.MSource == 0112){
+	if(pS[I].Idecode.MSource == 0112){
 	  pS[I].pdl_index_reg = (pS[I].Obus&0xFFF);
 	}
 	break;
@@ -1865,7 +2013,7 @@ void handle_destination(int I){
           pS[I].pdl_ptr_reg &= 0x7FF;
           pS[I].Mmemory[0x800+pS[I].pdl_index_reg] = pS[I].Obus;
         }
-        if(pS[I].microtrace || pS[I].macrotrace){
+        if(UTRACE || MTRACE){
           logmsgf(LT_LAMBDA,10,"MI: C-PDL-INDEX-DEC: Addr Hi = 0x%X, PTR = %o, DATA = %o\n",
 		 pS[I].DP_Mode.PDL_Addr_Hi,pS[I].pdl_index_reg,pS[I].Obus);
         }
@@ -1883,7 +2031,7 @@ void handle_destination(int I){
 	  // x = pS[I].Multiplier_Input&0x7FFF;
 	  // y = ((pS[I].Multiplier_Input>>15)&0x7FFF);	  
 	  pS[I].Multiplier_Output = pS[I].Multiplier_FT;
-	  if(pS[I].microtrace){
+	  if(UTRACE){
 	    logmsgf(LT_LAMBDA,10,"MULTIPLIER: INPUT = 0x%X, X = 0x%X, Y = 0x%X, FT = 0x%X, OUT = 0x%X\n",
 		   pS[I].Multiplier_Input,x,y,pS[I].Multiplier_FT,pS[I].Multiplier_Output);
 	  }
@@ -1906,7 +2054,7 @@ void handle_destination(int I){
 	// Investigation stops
 	// if(pS[I].RG_Mode.Sequence_Break != 0){ pS[I].cpu_die_rq = 1; }
 	// if(pS[I].RG_Mode.Interrupt_Enable != 0){ pS[I].cpu_die_rq = 1; }
-	if(pS[I].microtrace || pS[I].cpu_die_rq == 1){
+	if(UTRACE || pS[I].cpu_die_rq == 1){
 	  logmsgf(LT_LAMBDA,10,"RG Mode = %o (",pS[I].RG_Mode.raw);
 	  if(pS[I].RG_Mode.Aux_Stat_Count_Control != 0){ logmsgf(LT_LAMBDA,10,"Aux_Stat_Count_Control:%o ",pS[I].RG_Mode.Aux_Stat_Count_Control); }
 	  if(pS[I].RG_Mode.Aux_Stat_Count_Clock != 0){ logmsgf(LT_LAMBDA,10,"Aux_Stat_Count_Clock:%o ",pS[I].RG_Mode.Aux_Stat_Count_Clock); }
@@ -1933,7 +2081,7 @@ void handle_destination(int I){
 	}else{
 	  pS[I].pdl_index_reg = pS[I].Obus&0x7FF;	  
 	}
-        if(pS[I].microtrace || pS[I].macrotrace){
+        if(UTRACE || MTRACE){
 	  logmsgf(LT_LAMBDA,10,"MI: PDL-BUFFER-INDEX: Addr Hi = 0x%X, INDEX = %o, DATA = %o\n",
 		 pS[I].DP_Mode.PDL_Addr_Hi,pS[I].pdl_index_reg,pS[I].Obus);
 	}
@@ -1941,7 +2089,7 @@ void handle_destination(int I){
       case 061: // LAM-FUNC-DEST-VMA-START-READ-FORCE
 	// Load VMA from pS[I].Obus and initiate a read with force.
 	pS[I].VMAregister.raw = pS[I].Obus; // Load VMA
-	VM_resolve_address(I,VM_READ,1);
+	VM_resolve_address_core(I,VM_READ,1,trace);
 	if(pS[I].Page_Fault == 0 && pS[I].ConReg.Enable_NU_Master == 1){
 	  // Do it
 	  if(pS[I].RG_Mode.Aux_Stat_Count_Control == 01){
@@ -1950,7 +2098,7 @@ void handle_destination(int I){
 	  if(pS[I].RG_Mode.Main_Stat_Count_Control == 01){
 	    pS[I].stat_counter_main++;
 	  }
-	  nubus_io_request(pS[I].vm_byte_mode|VM_READ,pS[I].NUbus_ID,pS[I].vm_phys_addr.raw,0);
+	  lambda_mem_request(I,pS[I].vm_byte_mode|VM_READ,pS[I].vm_phys_addr.raw,0);
 	}
 	break;
       case 064: // LAM-FUNC-DEST-L2-MAP-PHYSICAL-PAGE
@@ -1961,13 +2109,14 @@ void handle_destination(int I){
         pS[I].vm_lv2_index.VPage_Offset = pS[I].MDregister.VM.VPage_Offset;
         pS[I].vm_lv2_index.LV2_Block = pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].LV2_Block;
         pS[I].vm_lv2_adr[pS[I].vm_lv2_index.raw].raw = pS[I].Obus;
-	if(pS[I].microtrace){
+        pC[I].vm_lv2_gen[pS[I].vm_lv2_index.raw]++;
+	if(UTRACE){
 	  logmsgf(LT_LAMBDA,10,"VM: LV2 ADR ENT 0x%X = 0x%X\n",pS[I].vm_lv2_index.raw,pS[I].Obus);
 	}
         break;
       case 072: // LAM-FUNC-DEST-MD-START-WRITE-FORCE
 	pS[I].MDregister.raw = pS[I].Obus;
-	VM_resolve_address(I,VM_WRITE,1);
+	VM_resolve_address_core(I,VM_WRITE,1,trace);
 	if(pS[I].Page_Fault == 0 && pS[I].ConReg.Enable_NU_Master == 1){
 	  // Do it
 	  if(pS[I].RG_Mode.Aux_Stat_Count_Control == 01){
@@ -1976,19 +2125,26 @@ void handle_destination(int I){
 	  if(pS[I].RG_Mode.Main_Stat_Count_Control == 01){
 	    pS[I].stat_counter_main++;
 	  }
-	  nubus_io_request(pS[I].vm_byte_mode|VM_WRITE,pS[I].NUbus_ID,pS[I].vm_phys_addr.raw,pS[I].MDregister.raw);
+	  lambda_mem_request(I,pS[I].vm_byte_mode|VM_WRITE,pS[I].vm_phys_addr.raw,pS[I].MDregister.raw);
 	}
 	break;
       default:
-	logmsgf(LT_LAMBDA,0,"Unknown F-Dest %o\n",pS[I].Iregister.Destination.F.Dest);
+	logmsgf(LT_LAMBDA,0,"Unknown F-Dest %o\n",pS[I].Idecode.Destination.F.Dest);
 	pS[I].cpu_die_rq = 1;
       }
     }
   } 
 }
 
+void handle_destination(int I){
+  handle_destination_core(I,true);
+}
+
 // NUbus Slave
 void lambda_nubus_slave(int I){
+  // Stop retiring a straight-line block, so what the spy interface sees or
+  // changes takes effect from the next cycle
+  pS[I].ublock_cycles = 0;
   switch(NUbus_Address.Addr){
     // SPY interface
   case 0x000 ... 0x3FF:
@@ -2076,6 +2232,7 @@ void lambda_nubus_slave(int I){
       case 004: // HIGH IREG
 	if(NUbus_Request == VM_WRITE){
           pS[I].Iregister.word[1] = NUbus_Data.word;
+          decode_ireg(I);
           logmsgf(LT_LAMBDA,10,"RG: SPY: HI IREG Write, data 0x%X\n",NUbus_Data.word);
 	  logmsgf(LT_LAMBDA,10,"DISASSEMBLY OF WRITTEN UI:\n");
 	  disassemble_IR(I);
@@ -2088,6 +2245,7 @@ void lambda_nubus_slave(int I){
         }
         if(NUbus_Request == VM_BYTE_WRITE){
           pS[I].Iregister.byte[4+NUbus_Address.Byte] = NUbus_Data.byte[NUbus_Address.Byte];
+          decode_ireg(I);
           logmsgf(LT_LAMBDA,10,"RG: SPY: HI IREG Byte Write, data 0x%X\n",NUbus_Data.byte[NUbus_Address.Byte]);
           NUbus_acknowledge=1;
 	  pS[I].spy_wrote_ireg = true;
@@ -2117,6 +2275,7 @@ void lambda_nubus_slave(int I){
       case 005: // LO IREG
 	if(NUbus_Request == VM_WRITE){
           pS[I].Iregister.word[0] = NUbus_Data.word;
+          decode_ireg(I);
           logmsgf(LT_LAMBDA,10,"RG: SPY: LO IREG Write, data 0x%X\n",NUbus_Data.word);
           NUbus_acknowledge = 1;
 	  pS[I].spy_wrote_ireg = true;
@@ -2124,6 +2283,7 @@ void lambda_nubus_slave(int I){
         }
         if(NUbus_Request == VM_BYTE_WRITE){
           pS[I].Iregister.byte[NUbus_Address.Byte] = NUbus_Data.byte[NUbus_Address.Byte];
+          decode_ireg(I);
           logmsgf(LT_LAMBDA,10,"RG: SPY: LO IREG Byte Write, data 0x%X\n",NUbus_Data.byte[NUbus_Address.Byte]);
           NUbus_acknowledge=1;
 	  pS[I].spy_wrote_ireg = true;
@@ -2150,6 +2310,7 @@ void lambda_nubus_slave(int I){
 	  paddr <<= 4;
 	  paddr |= (addr&0xF);
           pS[I].WCS[paddr].word[1] = NUbus_Data.word;
+          lambda_invalidate_wcs(I,paddr);
           logmsgf(LT_LAMBDA,10,"RG: SPY: HI CRAM Write, addr 0x%X, paddr 0x%X, data 0x%X\n",pS[I].loc_ctr_reg.raw,paddr,NUbus_Data.word);
           NUbus_acknowledge = 1;
           return;
@@ -2170,6 +2331,7 @@ void lambda_nubus_slave(int I){
           paddr <<= 4;
           paddr |= (addr&0xF);
           pS[I].WCS[paddr].byte[4+NUbus_Address.Byte] = NUbus_Data.byte[NUbus_Address.Byte];
+          lambda_invalidate_wcs(I,paddr);
           logmsgf(LT_LAMBDA,10,"RG: SPY: HI CRAM Byte Write, addr 0x%X, paddr 0x%X, data 0x%X\n",pS[I].loc_ctr_reg.raw,paddr,NUbus_Data.byte[NUbus_Address.Byte]);
           NUbus_acknowledge=1;
           return;
@@ -2193,6 +2355,7 @@ void lambda_nubus_slave(int I){
           paddr <<= 4;
           paddr |= (addr&0xF);
           pS[I].WCS[paddr].word[0] = NUbus_Data.word;
+          lambda_invalidate_wcs(I,paddr);
           logmsgf(LT_LAMBDA,10,"RG: SPY: LO CRAM Write, addr 0x%X, paddr 0x%X, data 0x%X\n",pS[I].loc_ctr_reg.raw,paddr,NUbus_Data.word);
           NUbus_acknowledge = 1;
           return;
@@ -2213,6 +2376,7 @@ void lambda_nubus_slave(int I){
           paddr <<= 4;
           paddr |= (addr&0xF);
           pS[I].WCS[paddr].byte[NUbus_Address.Byte] = NUbus_Data.byte[NUbus_Address.Byte];
+          lambda_invalidate_wcs(I,paddr);
           logmsgf(LT_LAMBDA,10,"RG: SPY: LO CRAM Byte Write, addr 0x%X, paddr 0x%X, data 0x%X\n",pS[I].loc_ctr_reg.raw,paddr,NUbus_Data.byte[NUbus_Address.Byte]);
           NUbus_acknowledge=1;
           return;
@@ -2606,6 +2770,7 @@ void lambda_nubus_slave(int I){
             Word |= Data;
           }
           pS[I].CRAM_map[map_addr] = Word;
+          lambda_flush_blocks(I);
           logmsgf(LT_LAMBDA,10,"RG: SPY: CRAM ADR MAP Write, addr 0x%X, data 0x%X\n",pS[I].loc_ctr_reg.raw,NUbus_Data.word);
           NUbus_acknowledge = 1;
           return;
@@ -2696,6 +2861,7 @@ void lambda_nubus_slave(int I){
 		// Patch microcode bug
 		logmsgf(LT_LAMBDA,10,"Patching loaded microcode...\r\n");
 		pS[I].WCS[016047].ASource = 01114;    // Fix to XGCD1+2 - Add1 to Rotate Field Sub1 from Length
+		lambda_invalidate_wcs(I,016047);
 		// At this point, we should capture Lisp's starting state
 		dump_lisp_start_state(I);
 	      }else{
@@ -2820,6 +2986,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 	  logmsgf(LT_LAMBDA,10,"UI: MAP 0x%X -> 0x%X\n",pS[I].loc_ctr_cnt&0xFFFF,paddr);
 	  }
 	  pS[I].Iregister.raw = pS[I].WCS[paddr].raw;
+	  decode_ireg(I);
 	  }else{
 	  pS[I].spy_wrote_ireg = false;
 	  }
@@ -2838,7 +3005,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 	// This is probably after the source read
 	logmsgf(LT_LAMBDA,10,"TREG %d: Operating ALU/Shifter\n",I);
 	// Switch opcode
-	switch(pS[I].Iregister.Opcode){
+	switch(pS[I].Idecode.Opcode){
 	case 0: // ALU-OP
 	  // Perform ALU operation
 	  operate_alu(I);
@@ -2871,13 +3038,13 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 		    
 	  // Handle condition
 	  pS[I].test_true = false;
-	  if(pS[I].Iregister.Jump.Test != 0){
+	  if(pS[I].Idecode.Jump.Test != 0){
 	    // Operate ALU
 	    alu_sub_stub(I,0); // Do M-A
 	    alu_cleanup_result(I);
 		      
 	    // Perform test      
-	    switch(pS[I].Iregister.Jump.Cond){
+	    switch(pS[I].Idecode.Jump.Cond){
 			
 	    case 01: // LAM-JUMP-COND-M<A
 	      if((0x80000000^pS[I].Mbus) < (0x80000000^pS[I].Abus)){
@@ -2959,15 +3126,15 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 	      break;
 			
 	    default:
-	      logmsgf(LT_LAMBDA,0,"Unknown jump cond %o\n",pS[I].Iregister.Jump.Cond);
+	      logmsgf(LT_LAMBDA,0,"Unknown jump cond %o\n",pS[I].Idecode.Jump.Cond);
 	      pS[I].cpu_die_rq = 1;
 	    }
 	  }else{
 	    // BIT-SET
-	    pS[I].test_true = left_rotate(pS[I].Mbus,pS[I].Iregister.Jump.Cond)&0x01;
+	    pS[I].test_true = left_rotate(pS[I].Mbus,pS[I].Idecode.Jump.Cond)&0x01;
 	  }
 	  // If the invert bit is set, reverse the condition
-	  if(pS[I].Iregister.Jump.Invert){
+	  if(pS[I].Idecode.Jump.Invert){
 	    pS[I].test_true ^= 1;
 	  }		    
 	  break;
@@ -2982,25 +3149,25 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 	    // DispatchWord disp_word;
 	    
 	    // Stop for investigation if...
-	    // if(pS[I].Iregister.Dispatch.Constant > 0){ logmsgf(LT_LAMBDA,10,"Constant "); pS[I].cpu_die_rq = 1; }
-	    // if(pS[I].Iregister.Dispatch.LPC > 0){ logmsgf(LT_LAMBDA,10,"LPC "); pS[I].cpu_die_rq = 1; }
-	    // if(pS[I].Iregister.Dispatch.Write_VMA > 0){ logmsgf(LT_LAMBDA,10,"WriteVMA "); pS[I].cpu_die_rq = 1; }
-	    // if(pS[I].Iregister.Dispatch.Enable_GC_Volatility_Meta > 0){ logmsgf(LT_LAMBDA,10,"EnableGCVMeta "); pS[I].cpu_die_rq = 1; }
-	    // if(pS[I].Iregister.Dispatch.Enable_Oldspace_Meta > 0){ logmsgf(LT_LAMBDA,10,"EnableOldspaceMeta "); pS[I].cpu_die_rq = 1; }
+	    // if(pS[I].Idecode.Dispatch.Constant > 0){ logmsgf(LT_LAMBDA,10,"Constant "); pS[I].cpu_die_rq = 1; }
+	    // if(pS[I].Idecode.Dispatch.LPC > 0){ logmsgf(LT_LAMBDA,10,"LPC "); pS[I].cpu_die_rq = 1; }
+	    // if(pS[I].Idecode.Dispatch.Write_VMA > 0){ logmsgf(LT_LAMBDA,10,"WriteVMA "); pS[I].cpu_die_rq = 1; }
+	    // if(pS[I].Idecode.Dispatch.Enable_GC_Volatility_Meta > 0){ logmsgf(LT_LAMBDA,10,"EnableGCVMeta "); pS[I].cpu_die_rq = 1; }
+	    // if(pS[I].Idecode.Dispatch.Enable_Oldspace_Meta > 0){ logmsgf(LT_LAMBDA,10,"EnableOldspaceMeta "); pS[I].cpu_die_rq = 1; }
 	    if(pS[I].Iregister.Dispatch.Spare > 0){ logmsgf(LT_LAMBDA,0,"DISP-SPARE "); pS[I].cpu_die_rq = 1; }
 	    // if(pS[I].popj_after_nxt != -1){ logmsgf(LT_LAMBDA,10,"DISPATCH with POPJ-AFTER-NEXT armed?\n"); pS[I].cpu_die_rq = 1; }
 	    
 	    // Load VMA from M source
-	    if(pS[I].Iregister.Dispatch.Write_VMA != 0){ pS[I].VMAregister.raw = pS[I].Mbus; }
+	    if(pS[I].Idecode.Dispatch.Write_VMA != 0){ pS[I].VMAregister.raw = pS[I].Mbus; }
 	    
 	    // Lambda doesn't have dispatch-source, so I assume it's always R-bus
-	    Mask = (1 << pS[I].Iregister.Dispatch.Len) - 1;      
+	    Mask = (1 << pS[I].Idecode.Dispatch.Len) - 1;      
 	    // Meta handling
-	    if(pS[I].Iregister.Dispatch.Enable_GC_Volatility_Meta || pS[I].Iregister.Dispatch.Enable_Oldspace_Meta){
+	    if(pS[I].Idecode.Dispatch.Enable_GC_Volatility_Meta || pS[I].Idecode.Dispatch.Enable_Oldspace_Meta){
 	      Mask = Mask & 0xfffffffe;	
 	    }
 	    // Investigation stop
-	    if(pS[I].Iregister.Dispatch.Enable_GC_Volatility_Meta && pS[I].Iregister.Dispatch.Enable_Oldspace_Meta){
+	    if(pS[I].Idecode.Dispatch.Enable_GC_Volatility_Meta && pS[I].Idecode.Dispatch.Enable_Oldspace_Meta){
 	      logmsgf(LT_LAMBDA,0,"DISPATCH: Enable GCV and Oldspace meta simultaneously?\n");
 	      pS[I].cpu_die_rq=10;
 	    }
@@ -3009,7 +3176,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 	    }
 	    
 	    // Lambda does not have a rotate direction flag.
-	    dispatch_source = left_rotate(pS[I].Mbus, pS[I].Iregister.Dispatch.Pos) & Mask;
+	    dispatch_source = left_rotate(pS[I].Mbus, pS[I].Idecode.Dispatch.Pos) & Mask;
 	    
 	    if(pS[I].microtrace){
 	      logmsgf(LT_LAMBDA,10,"DISPATCH: dispatch_source = 0x%X\n",dispatch_source);
@@ -3017,7 +3184,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 	    
 	    // More meta bits
 	    gc_volatilty_flag = 0;
-	    if(pS[I].Iregister.Dispatch.Enable_GC_Volatility_Meta != 0){
+	    if(pS[I].Idecode.Dispatch.Enable_GC_Volatility_Meta != 0){
 	      int present_gcv = 0;
 	      // IDENTIFYING GC VOLATILITY BIT
 	      // Bit 4?
@@ -3081,7 +3248,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 	      }
 	    }
 	    oldspace_flag = 0;
-	    if(pS[I].Iregister.Dispatch.Enable_Oldspace_Meta != 0){
+	    if(pS[I].Idecode.Dispatch.Enable_Oldspace_Meta != 0){
 	      // Do a map resolve for what's in MD
 	      pS[I].vm_lv2_index.raw = 0;
 	      pS[I].vm_lv2_index.VPage_Offset = pS[I].MDregister.VM.VPage_Offset;
@@ -3100,14 +3267,14 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 	    // Set dispatch address
 	    // Lambda uses the A source as the dispatch address!
 	    // disp_address = (mir_mask & MInst_Disp_Address) | dispatch_source | gc_volatilty_flag | oldspace_flag;
-	    disp_address = pS[I].Iregister.ASource|dispatch_source;
+	    disp_address = pS[I].Idecode.ASource|dispatch_source;
 	    // Handle oldspace/GCV meta
-	    if(pS[I].Iregister.Dispatch.Enable_Oldspace_Meta != 0 || pS[I].Iregister.Dispatch.Enable_GC_Volatility_Meta){
+	    if(pS[I].Idecode.Dispatch.Enable_Oldspace_Meta != 0 || pS[I].Idecode.Dispatch.Enable_GC_Volatility_Meta){
 	      // I think this is how this is supposed to work
 	      disp_address |= (oldspace_flag|gc_volatilty_flag);
 	    }
 	    // Load dispatch constant register
-	    pS[I].disp_constant_reg = pS[I].Iregister.Dispatch.Constant;
+	    pS[I].disp_constant_reg = pS[I].Idecode.Dispatch.Constant;
 	    // Lambda has no dispatch opcode field, so I assume it is always DISPATCH
 	    pS[I].disp_word.raw = pS[I].Amemory[(disp_address)]; // A-source is already offset // Dmemory[disp_address];
 	    if(pS[I].microtrace){
@@ -3156,8 +3323,8 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 	    if(pS[I].Iregister.Slow_Dest != 0){ pS[I].TRAM_PC |= 010; }
 	    if(pS[I].ConReg.nop != 0){ pS[I].TRAM_PC |= 040; }
 	    if(pS[I].Iregister.ILong != 0){ pS[I].TRAM_PC |= 0100; }
-	    if((pS[I].Iregister.Opcode&01) != 0){ pS[I].TRAM_PC |= 0200; }
-	    if((pS[I].Iregister.Opcode&02) != 0){ pS[I].TRAM_PC |= 0400; }
+	    if((pS[I].Idecode.Opcode&01) != 0){ pS[I].TRAM_PC |= 0200; }
+	    if((pS[I].Idecode.Opcode&02) != 0){ pS[I].TRAM_PC |= 0400; }
 	    if(pS[I].Iregister.Halt != 0){ pS[I].TRAM_PC |= 04000; }
 	    break;
 	  case 1: // JUMP
@@ -3219,6 +3386,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 	  logmsgf(LT_LAMBDA,10,"UI: MAP 0x%X -> 0x%X\n",pS[I].loc_ctr_cnt&0xFFFF,paddr);
 	  }
 	  pS[I].Iregister.raw = pS[I].WCS[paddr].raw;
+	  decode_ireg(I);
 	  }else{
 	  pS[I].spy_wrote_ireg = false;
 	  }
@@ -3259,12 +3427,12 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 	pS[I].loc_ctr_cnt = pS[I].loc_ctr_reg.raw;
 	// TRIGGER DEST WRITES / JUMPS
 	if(pS[I].ConReg.nop == 0){
-	  switch(pS[I].Iregister.Opcode){
+	  switch(pS[I].Idecode.Opcode){
 	  case 0: // ALU-OP		      
 	    // Handle destination selector
 	    handle_destination(I);
 	    // Process Q register
-	    if(pS[I].Iregister.ALU.QControl > 0){ logmsgf(LT_LAMBDA,10,"TREG: Q-CONTROL %o ALU-RESULT %lo\n",pS[I].Iregister.ALU.QControl,pS[I].ALU_Result); }
+	    if(pS[I].Idecode.ALU.QControl > 0){ logmsgf(LT_LAMBDA,10,"TREG: Q-CONTROL %o ALU-RESULT %lo\n",pS[I].Idecode.ALU.QControl,pS[I].ALU_Result); }
 	    handle_q_register(I);
 	    // Load MFO from O-bus
 	    pS[I].MFObus = pS[I].Obus;
@@ -3291,19 +3459,19 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 	    if(pS[I].test_true){
 	      pS[I].wrote_uPC = true; // We are writing the uPC, so don't advance it.
 	      // If we have a pending POPJ-AFTER-NEXT, cancel it
-	      if(pS[I].popj_after_nxt != -1 && (pS[I].Iregister.Jump.RPN != 2 && pS[I].Iregister.Jump.RPN != 3 && pS[I].Iregister.Jump.RPN != 5)){
-		logmsgf(LT_LAMBDA,0,"JUMP: Pending PJAN investigation stop: Not CALL or RETURN (Op %o)\n",pS[I].Iregister.Jump.RPN);
+	      if(pS[I].popj_after_nxt != -1 && (pS[I].Idecode.Jump.RPN != 2 && pS[I].Idecode.Jump.RPN != 3 && pS[I].Idecode.Jump.RPN != 5)){
+		logmsgf(LT_LAMBDA,0,"JUMP: Pending PJAN investigation stop: Not CALL or RETURN (Op %o)\n",pS[I].Idecode.Jump.RPN);
 		pS[I].cpu_die_rq = 1;
 	      }
 	      // Handle operation
-	      switch(pS[I].Iregister.Jump.RPN){
+	      switch(pS[I].Idecode.Jump.RPN){
 	      case 0: // Jump-Branch-Xct-Next
 		// Jump, but DO NOT inhibit the next instruction!
 		if(pS[I].loc_ctr_nxt != -1){
 		  logmsgf(LT_LAMBDA,0,"JUMP: Pending JUMP-After-Next collision investigation stop\n");
 		  pS[I].cpu_die_rq = 1;
 		}
-		pS[I].loc_ctr_nxt = pS[I].Iregister.Jump.Address;
+		pS[I].loc_ctr_nxt = pS[I].Idecode.Jump.Address;
 		break;
 			  
 	      case 1: // Jump-Branch
@@ -3311,7 +3479,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 		  logmsgf(LT_LAMBDA,10,"JUMP: Pending JUMP collision investigation marker\n");
 		  // pS[I].cpu_die_rq = 1;
 		}	
-		pS[I].loc_ctr_reg.raw = pS[I].Iregister.Jump.Address;
+		pS[I].loc_ctr_reg.raw = pS[I].Idecode.Jump.Address;
 		pS[I].NOP_Next = 1;
 		break;
 			  
@@ -3339,7 +3507,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 		  }
 		  logmsgf(LT_LAMBDA,10," (%o)\n",pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]);
 		}
-		pS[I].loc_ctr_nxt = pS[I].Iregister.Jump.Address;
+		pS[I].loc_ctr_nxt = pS[I].Idecode.Jump.Address;
 		if(pS[I].popj_after_nxt == 0){
 		  // PJAN is armed. We want this call to return to my caller instead of here.
 		  // So we'll pop this return address now.
@@ -3373,7 +3541,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 		  logmsgf(LT_LAMBDA,10," (%o)\n",pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]);
 		}
 		// Jump
-		pS[I].loc_ctr_reg.raw = pS[I].Iregister.Jump.Address;
+		pS[I].loc_ctr_reg.raw = pS[I].Idecode.Jump.Address;
 		pS[I].NOP_Next = 1;
 		if(pS[I].popj_after_nxt == 0){
 		  // PJAN is armed. We want this call to return to my caller instead of here.
@@ -3409,7 +3577,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 		break;
 			  
 	      default:
-		logmsgf(LT_LAMBDA,0,"Unknown jump RPN %o\n",pS[I].Iregister.Jump.RPN);
+		logmsgf(LT_LAMBDA,0,"Unknown jump RPN %o\n",pS[I].Idecode.Jump.RPN);
 		pS[I].cpu_die_rq=1;
 	      }
 	    }
@@ -3453,7 +3621,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 		  if(pS[I].RG_Mode.Main_Stat_Count_Control == 01){
 		    pS[I].stat_counter_main++;
 		  }
-		  nubus_io_request(VM_READ,pS[I].NUbus_ID,pS[I].vm_phys_addr.raw,0);
+		  lambda_mem_request(I,VM_READ,pS[I].vm_phys_addr.raw,0);
 		}
 	      }
 	      // Handle operation
@@ -3484,7 +3652,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 		}
 		pS[I].uPCS_ptr_reg++; pS[I].uPCS_ptr_reg &= 0xFF;
 		// Raven does not handle this, but should we? (Should Raven?)
-		if(pS[I].Iregister.Dispatch.LPC){
+		if(pS[I].Idecode.Dispatch.LPC){
 		  logmsgf(LT_LAMBDA,0,"DISPATCH: LPC set w/ call-xct-next?\n");
 		  pS[I].cpu_die_rq = 1;
 		}
@@ -3526,7 +3694,7 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
 		  pS[I].popj_after_nxt = -1;
 		}
 		pS[I].uPCS_ptr_reg++;  pS[I].uPCS_ptr_reg &= 0xFF;
-		if(pS[I].Iregister.Dispatch.LPC){
+		if(pS[I].Idecode.Dispatch.LPC){
 		  pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_cnt; // Stack-Own-Address
 		}else{
 		  pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw;
@@ -3623,119 +3791,1016 @@ void sm_clock_pulse(int I,int clock,Processor_Mode_Reg *oldPMR){
   }
 }
 
-// Normal Clock Pulse
-void lambda_clockpulse(int I){
-  pS[I].cycle_count++;
-  // Run one clock
+// ALU-OP
+LCORE void uinst_alu_op_core(int I,const bool trace){
+  // Perform ALU operation
+  operate_alu_core(I);
 
-  // NUbus interface operation
-  if(NUbus_master == pS[I].NUbus_ID && NUbus_Busy > 0){
-    if((NUbus_Request&0x01)==0){
-      // Since this is our read request, reload MD here.
-      // Since Lambda doesn't handle timeouts, I guess this happens regardless of acknowledge?
-      pS[I].MDregister.raw = NUbus_Data.word;
-    }
-    // Was it acknowledged?
-    if(NUbus_acknowledge == 1){
-      if(NUbus_trace == 1){
-	logmsgf(LT_NUBUS,10,"NUBUS: Cycle Complete: Request %o Addr 0x%X (0%o) w/ data 0x%X (0%o) Ack %o\n",
-	       NUbus_Request,NUbus_Address.raw,NUbus_Address.raw,NUbus_Data.word,NUbus_Data.word,NUbus_acknowledge);
+  // Operate O bus
+  handle_o_bus_core(I);
+
+  if((pS[I].Idecode.flags&UD_SPARE) != 0 && pS[I].Iregister.ALU.Misc > 0){ logmsgf(LT_LAMBDA,0,"ALU-MISC "); pS[I].cpu_die_rq = 1; }
+
+  // Handle destination selector
+  handle_destination_core(I,trace);
+
+  // Halt if spare bit set
+  if((pS[I].Idecode.flags&UD_SPARE) != 0 && pS[I].Iregister.ALU.Spare > 0){ logmsgf(LT_LAMBDA,0,"ALU-SPARE "); pS[I].cpu_die_rq = 1; }
+
+  // Process Q register
+  handle_q_register_core(I);
+
+  // Load MFO from O-bus
+  pS[I].MFObus = pS[I].Obus;
+}
+UINST_VARIANTS(uinst_alu_op)
+
+// BYTE-OP
+LCORE void uinst_byte_op_core(int I,const bool trace){
+  // Operate shifter. Result goes to O bus.
+  operate_shifter_core(I,trace);
+  // Load MFO from O-bus
+  pS[I].MFObus = pS[I].Obus;
+  // Store result
+  handle_destination_core(I,trace);
+
+  if((pS[I].Idecode.flags&UD_SPARE) != 0 && pS[I].Iregister.Byte.Misc > 0){ logmsgf(LT_LAMBDA,0,"Misc "); pS[I].cpu_die_rq = 1; }
+  if((pS[I].Idecode.flags&UD_SPARE) != 0 && pS[I].Iregister.Byte.Spare > 0){ logmsgf(LT_LAMBDA,0,"BYTE-SPARE "); pS[I].cpu_die_rq = 1; }
+}
+UINST_VARIANTS(uinst_byte_op)
+
+// JUMP-OP
+LCORE void uinst_jump_op_core(int I,const bool trace){
+  if((pS[I].Idecode.flags&UD_SPARE) != 0 && pS[I].Iregister.Jump.LC_Increment != 0){ logmsgf(LT_LAMBDA,0," LCINC"); pS[I].cpu_die_rq = 1; }
+  if((pS[I].Idecode.flags&UD_SPARE) != 0 && pS[I].Iregister.Jump.Spare != 0){ logmsgf(LT_LAMBDA,0," JUMP-SPARE"); pS[I].cpu_die_rq = 1; }
+  if((pS[I].Idecode.flags&UD_SPARE) != 0 && pS[I].Iregister.Jump.Spare2 != 0){ logmsgf(LT_LAMBDA,0," JUMP-SPARE2"); pS[I].cpu_die_rq = 1; }
+
+  // Handle condition
+  pS[I].test_true = false;
+  if(pS[I].Idecode.Jump.Test != 0){
+    // Operate ALU
+    alu_sub_stub_core(I,0); // Do M-A
+    alu_cleanup_result_core(I);
+
+    // Perform test      
+    switch(pS[I].Idecode.Jump.Cond){
+
+    case 01: // LAM-JUMP-COND-M<A
+      if((0x80000000^pS[I].Mbus) < (0x80000000^pS[I].Abus)){
+	pS[I].test_true = true;
       }
-      // We can release the bus
-      NUbus_Busy = 0;
+      break;
+
+    case 02: // LAM-JUMP-COND-M<=A
+      if((pS[I].Abus == 0 && pS[I].Mbus == 0x80000000) || ((pS[I].ALU_Result&0x80000000) != 0)){
+	pS[I].test_true = true;
+      }
+      break;
+
+    case 03: // M != A
+      if(pS[I].ALU_Result != 0xFFFFFFFF){
+	pS[I].test_true = true;
+      }
+      break;
+
+    case 04: // LAM-JUMP-COND-PAGE-FAULT (INVERTED!)
+      if(pS[I].Page_Fault == 0){
+	pS[I].test_true = 1;
+      }
+      break;
+
+    case 05: // LAM-JUMP-COND-PAGE-FAULT-OR-INTERRUPT
+      if(pS[I].Page_Fault != 0){
+	pS[I].test_true = 1;
+      }
+      // DETECT INTERRUPT
+      {
+	int x=0;
+	if(pS[I].InterruptPending != 0){
+	  while(x<0x100){
+	    if(pS[I].InterruptStatus[x] != 0){
+	      // We have an interrupt!
+	      // Stuff vector in interrupt-pointer and return true
+	      pS[I].InterruptVector = x;
+	      pS[I].test_true = 1;
+	      break;
+	    }
+	    x++;
+	  }
+	}
+      }
+      break;
+
+    case 06: // LAM-JUMP-COND-PAGE-FAULT-OR-INTERRUPT-OR-SEQUENCE-BREAK
+      // SEQUENCE BREAK BIT IS INVERTED
+      if(pS[I].Page_Fault != 0 || pS[I].RG_Mode.Sequence_Break == 0){
+	pS[I].test_true = 1;
+      }
+      // DETECT INTERRUPT
+      {
+        int x=0;
+	if(pS[I].InterruptPending != 0){
+	  while(x<0x100){
+	    if(pS[I].InterruptStatus[x] != 0){
+	      // We have an interrupt!
+	      // Stuff vector in interrupt-pointer and return true
+	      pS[I].InterruptVector = x;
+	      pS[I].test_true = 1;
+	      break;
+	    }
+	    x++;
+	  }
+	}
+      }
+      break;
+
+    case 07: // LAM-JUMP-COND-UNC
+      pS[I].test_true = true;
+      break;
+
+    case 011: // LAM-JUMP-COND-DATA-TYPE-NOT-EQUAL
+      if((pS[I].Mbus&0x3E000000) != (pS[I].Abus&0x3E000000)){
+	pS[I].test_true = true;
+      }
+      break;
+
+    default:
+      logmsgf(LT_LAMBDA,0,"Unknown jump cond %o\n",pS[I].Idecode.Jump.Cond);
+      pS[I].cpu_die_rq = 1;
     }
+  }else{
+    // BIT-SET
+    pS[I].test_true = left_rotate(pS[I].Mbus,pS[I].Idecode.Jump.Cond)&0x01;
   }
-  // NUbus slave operation (RG board's interface)
-  // Under some conditions the Lambda will talk to itself
-  if(NUbus_Busy == 2 && NUbus_acknowledge == 0 && NUbus_Address.Card == pS[I].NUbus_ID){
-    lambda_nubus_slave(I);
+  // If the invert bit is set, reverse the condition
+  if(pS[I].Idecode.Jump.Invert){
+    pS[I].test_true ^= 1;
   }
 
-  // If we are halted, we are done here.
-  if(pS[I].cpu_die_rq != 0){
-    return; 
-  }else{
-    /*
-    if(pS[I].PMR.Allow_UInst_Clocks != 0 && pS[I].ConReg.uinst_clock_l != 0){
-      logmsgf(LT_LAMBDA,10,"CONREG: UINST_CLOCK\n");
-      pS[I].ConReg.uinst_clock_l = 0;
-    }else{
-      pS[I].ConReg.uinst_clock_l = 1;
+  /* Handle RPN.
+     CODES ARE:
+       R P N  (RETURN, PUSH, INHIBIT)
+
+       0 0 0 = Branch-Xct-Next
+       0 0 1 = Branch
+       0 1 0 = Call-Xct-Next
+       0 1 1 = Call
+       1 0 0 = Return-Xct-Next
+       1 0 1 = Return
+       1 1 0 = NOP (JUMP2-XCT-NEXT) (UNDEFINED ON LAMBDA)
+       1 1 1 = SKIP (JUMP2) (UNDEFINED ON LAMBDA)
+  */
+
+  if(pS[I].test_true){
+    // If we have a pending POPJ-AFTER-NEXT, cancel it
+    if(pS[I].popj_after_nxt != -1 && (pS[I].Idecode.Jump.RPN != 2 && pS[I].Idecode.Jump.RPN != 3 && pS[I].Idecode.Jump.RPN != 5)){
+      logmsgf(LT_LAMBDA,0,"JUMP: Pending PJAN investigation stop: Not CALL or RETURN (Op %o)\n",pS[I].Idecode.Jump.RPN);
+      pS[I].cpu_die_rq = 1;
     }
-    */
-  }
+    // Handle operation
+    switch(pS[I].Idecode.Jump.RPN){
+    case 0: // Jump-Branch-Xct-Next
+      // Jump, but DO NOT inhibit the next instruction!
+      if(pS[I].loc_ctr_nxt != -1){
+	logmsgf(LT_LAMBDA,0,"JUMP: Pending JUMP-After-Next collision investigation stop\n");
+	pS[I].cpu_die_rq = 1;
+      }
+      pS[I].loc_ctr_nxt = pS[I].Idecode.Jump.Address;
+      break;
 
-  // If we are not holding...
-  if(pS[I].exec_hold == false && pS[I].PMR.Force_T_Hold == 0){
-    if(pS[I].ConReg.t_hold_l != 1){
-      pS[I].ConReg.t_hold_l = 1; // Not holding
-      if(pS[I].microtrace){
-	logmsgf(LT_LAMBDA,10,"CONREG: Hold Cleared\n");
+    case 1: // Jump-Branch
+      if(UTRACE && pS[I].loc_ctr_reg.raw != (pS[I].loc_ctr_cnt + 1)){
+	logmsgf(LT_LAMBDA,10,"JUMP: Pending JUMP collision investigation marker\n");
+	// pS[I].cpu_die_rq = 1;
+      }	
+      pS[I].loc_ctr_reg.raw = pS[I].Idecode.Jump.Address;
+      pS[I].NOP_Next = 1;
+      break;
+
+    case 2: // Jump-Call-Xct-Next
+      // Call, but DO NOT inhibit the next instruction!
+      pS[I].uPCS_ptr_reg++; pS[I].uPCS_ptr_reg &= 0xFF;
+      pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw+1; // Pushes the address of the next instruction
+      if(UTRACE){
+        char *location;
+        char symloc[100];
+        int offset;
+
+        logmsgf(LT_LAMBDA,10,"uStack[%o] = ",pS[I].uPCS_ptr_reg);
+
+        location = "";
+        offset = 0;
+        location = sym_find_last(1, pS[I].uPCS_stack[pS[I].uPCS_ptr_reg], &offset);
+	if(location != 0){
+	  if(offset != 0){
+	    sprintf(symloc, "%s+%o", location, offset);
+	  }else{
+	    sprintf(symloc, "%s", location);
+	  }
+	  logmsgf(LT_LAMBDA,10,"%s",symloc);
+	}
+        logmsgf(LT_LAMBDA,10," (%o)\n",pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]);
       }
-    }
-    // Decrement POPJ-After-Next flag if set
-    if(pS[I].popj_after_nxt > -1){
+      pS[I].loc_ctr_nxt = pS[I].Idecode.Jump.Address;
       if(pS[I].popj_after_nxt == 0){
-	// Time for popj
-	pS[I].loc_ctr_reg.raw = pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]&0xFFFFF;
+	// PJAN is armed. We want this call to return to my caller instead of here.
+	// So we'll pop this return address now.
 	pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
-	if(pS[I].microtrace){
-	  logmsgf(LT_LAMBDA,10,"PJAN FIRED: GOING TO %o\n",pS[I].loc_ctr_reg.raw);
+	pS[I].popj_after_nxt = -1;
+      }
+      break;
+
+    case 3: // Jump-Call
+      // PUSH ADDRESS
+      pS[I].uPCS_ptr_reg++;  pS[I].uPCS_ptr_reg &= 0xFF;
+      pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw;
+      if(UTRACE){
+        char *location;
+        char symloc[100];
+        int offset;
+
+        logmsgf(LT_LAMBDA,10,"uStack[%o] = ",pS[I].uPCS_ptr_reg);
+
+        location = "";
+        offset = 0;
+        location = sym_find_last(1, pS[I].uPCS_stack[pS[I].uPCS_ptr_reg], &offset);
+	if(location != 0){
+	  if(offset != 0){
+	    sprintf(symloc, "%s+%o", location, offset);
+	  }else{
+	    sprintf(symloc, "%s", location);
+	  }
+	  logmsgf(LT_LAMBDA,10,"%s",symloc);
 	}
-	// pS[I].cpu_die_rq = 1; 
+        logmsgf(LT_LAMBDA,10," (%o)\n",pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]);
       }
-      pS[I].popj_after_nxt--;
-    }
-    
-    if(pS[I].slow_dest == true){
-      // Slow destination. Waste a cycle.
-      pS[I].stall_count++;
-      pS[I].slow_dest = false;
-      if(pS[I].microtrace){
-	logmsgf(LT_LAMBDA,10,"SLOW-DEST cycle used\n");
+      // Jump
+      pS[I].loc_ctr_reg.raw = pS[I].Idecode.Jump.Address;
+      pS[I].NOP_Next = 1;
+      if(pS[I].popj_after_nxt == 0){
+	// PJAN is armed. We want this call to return to my caller instead of here.
+	// So we'll pop this return address now.
+	pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
+	pS[I].popj_after_nxt = -1;
       }
-      return;
-    } 
+      break;
 
-    if(pS[I].long_inst == true){
-      // Long instruction. Waste a cycle.
-      pS[I].stall_count++;
-      pS[I].long_inst = false;
-      if(pS[I].microtrace){
-	logmsgf(LT_LAMBDA,10,"LONG-INST cycle used\n");
+    case 4: // Jump-Return-XCT-Next
+      if(pS[I].popj_after_nxt != -1){
+	// PJAN is armed. Do not double!
+	logmsgf(LT_LAMBDA,0,"RETURN-XCT-NEXT with PJAN armed!\n");
+	pS[I].cpu_die_rq=1;
       }
-      return;
-    } 
+      // POP ADDRESS
+      pS[I].loc_ctr_nxt = pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]&0xFFFFF;
+      pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
+      break;
 
-    if(pS[I].NOP_Next == true){
-      // Inhibit bit set. Waste a cycle.
-      pS[I].ConReg.nop = 0;
-      pS[I].stall_count++;
-      pS[I].NOP_Next = false;
-      if(pS[I].microtrace){
-	logmsgf(LT_LAMBDA,10,"NOP-NEXT cycle used\n");
+    case 5: // Jump-Return
+      if(pS[I].popj_after_nxt != -1){
+	// PJAN is armed. Do not double!
+	// logmsgf(LT_LAMBDA,10,"RETURN with PJAN armed!\n");
+	// pS[I].cpu_die_rq=1;
+	// All we are doing is making the return immediate, so just disable PJAN.
+	pS[I].popj_after_nxt = -1;
       }
-      return;
-    }else{
-      pS[I].ConReg.nop = 1;
+      // POP ADDRESS
+      pS[I].loc_ctr_reg.raw = pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]&0xFFFFF;
+      pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
+      pS[I].NOP_Next = 1;
+      break;
+
+    default:
+      logmsgf(LT_LAMBDA,0,"Unknown jump RPN %o\n",pS[I].Idecode.Jump.RPN);
+      pS[I].cpu_die_rq=1;
     }
+  }
+}
+UINST_VARIANTS(uinst_jump_op)
+
+// DISP-OP
+LCORE void uinst_disp_op_core(int I,const bool trace){
+  // Dispatch items
+  uint32_t Mask=0;
+  uint32_t dispatch_source=0;
+  int gc_volatilty_flag;
+  int oldspace_flag;
+  int disp_address=0;
+  DispatchWord disp_word;
+
+  // Stop for investigation if...
+  // if(pS[I].Idecode.Dispatch.Constant > 0){ logmsgf(LT_LAMBDA,10,"Constant "); pS[I].cpu_die_rq = 1; }
+  // if(pS[I].Idecode.Dispatch.LPC > 0){ logmsgf(LT_LAMBDA,10,"LPC "); pS[I].cpu_die_rq = 1; }
+  // if(pS[I].Idecode.Dispatch.Write_VMA > 0){ logmsgf(LT_LAMBDA,10,"WriteVMA "); pS[I].cpu_die_rq = 1; }
+  // if(pS[I].Idecode.Dispatch.Enable_GC_Volatility_Meta > 0){ logmsgf(LT_LAMBDA,10,"EnableGCVMeta "); pS[I].cpu_die_rq = 1; }
+  // if(pS[I].Idecode.Dispatch.Enable_Oldspace_Meta > 0){ logmsgf(LT_LAMBDA,10,"EnableOldspaceMeta "); pS[I].cpu_die_rq = 1; }
+  if((pS[I].Idecode.flags&UD_SPARE) != 0 && pS[I].Iregister.Dispatch.Spare > 0){ logmsgf(LT_LAMBDA,0,"DISP-SPARE "); pS[I].cpu_die_rq = 1; }
+  // if(pS[I].popj_after_nxt != -1){ logmsgf(LT_LAMBDA,10,"DISPATCH with POPJ-AFTER-NEXT armed?\n"); pS[I].cpu_die_rq = 1; }
+
+  // Load VMA from M source
+  if(pS[I].Idecode.Dispatch.Write_VMA != 0){ pS[I].VMAregister.raw = pS[I].Mbus; }
+
+  // Lambda doesn't have dispatch-source, so I assume it's always R-bus
+  Mask = (1 << pS[I].Idecode.Dispatch.Len) - 1;      
+  // Meta handling
+  if(pS[I].Idecode.Dispatch.Enable_GC_Volatility_Meta || pS[I].Idecode.Dispatch.Enable_Oldspace_Meta){
+    Mask = Mask & 0xfffffffe;	
+  }
+  // Investigation stop
+  if(pS[I].Idecode.Dispatch.Enable_GC_Volatility_Meta && pS[I].Idecode.Dispatch.Enable_Oldspace_Meta){
+    logmsgf(LT_LAMBDA,0,"DISPATCH: Enable GCV and Oldspace meta simultaneously?\n");
+    pS[I].cpu_die_rq=10;
+  }
+  if(UTRACE){
+    logmsgf(LT_LAMBDA,10,"DISPATCH: GENERATED MASK 0x%X\n",Mask);
+  }
 
-    if(pS[I].cram_write_cyc == true){
-      // CRAM or map write. Waste a cycle.
-      pS[I].stall_count++;
-      pS[I].cram_write_cyc = false;
-      if(pS[I].microtrace){
-	logmsgf(LT_LAMBDA,10,"CRAM WRITE cycle used\n");
+  // Lambda does not have a rotate direction flag.
+  dispatch_source = left_rotate(pS[I].Mbus, pS[I].Idecode.Dispatch.Pos) & Mask;
+
+  if(UTRACE){
+    logmsgf(LT_LAMBDA,10,"DISPATCH: dispatch_source = 0x%X\n",dispatch_source);
+  }
+
+  // More meta bits
+  gc_volatilty_flag = 0;
+  if(pS[I].Idecode.Dispatch.Enable_GC_Volatility_Meta != 0){
+    int present_gcv = 0;
+    // IDENTIFYING GC VOLATILITY BIT
+    // Bit 4?
+    // "MAP2C-4 IS REALLY FROM THE GC-WRITE-LOGIC, NOT DIRECTLY THE L2MAP, THESE DAYS."
+    // GCV happens when a NEWER object is written into an OLDER memory.
+
+    // Do a map resolve for what's in MD
+    pS[I].vm_lv2_index.raw = 0;
+    pS[I].vm_lv2_index.VPage_Offset = pS[I].MDregister.VM.VPage_Offset;
+    pS[I].vm_lv2_index.LV2_Block = pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].LV2_Block;
+    // Extract the present LV1 GC volatility
+    // present_gcv = pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB;
+    present_gcv = (~pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB) & 03;
+    // Raven's CACHED GCV is (lv2_control & 0x1800) >> 11;
+    // GCV FLAG is (cached_gcv + 4 > (map_1_volatility ^ 7)) ? 0 : 1;
+
+    // Our CACHED GCV is the lv2 meta bits of the last reference.
+
+    // LV1 Meta Bits:
+    // 2 bits!
+    // "For hardware convenience, all three L1 map meta bits are stored in COMPLEMENTED form."
+    // S  H    What
+    // 0 (3) = Static Region (OLDEST)
+    // 1 (2) = Dynamic Region
+    // 2 (1) = Active Consing Region
+    // 3 (0) = Extra PDL Region (NEWEST)
+
+    // LV2 Meta Bits:
+    // 6 bits! But the bottom 2 bits are the same as the LV1 bits.
+    // 040 = Oldspace
+    // 020 = GCV-Flag
+    // 003 = LV1 GC Volatility
+
+    // So, if CACHED GCV is less than PRESENT GCV we wrote a newer item into an older page.
+    // The trap is taken if the flag is 0, so we want the inverse.
+    // What do I do if the MB validity bit isn't set?
+
+    // Meta bits are un-inverted now.
+    // gc_volatilty_flag 1 == don't trap
+    // So we want to set it 0 if we should trap.
+    // if(pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB_Valid != 0){ logmsgf(LT_LAMBDA,10,"GCV: LV1 invalid?\n"); pS[I].cpu_die_rq=1; } // Investigate
+    // if((pS[I].cached_gcv&03) <= present_gcv && pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB_Valid == 0){ gc_volatilty_flag = 1; }else{ pS[I].cpu_die_rq=0; } // ILLOP at PHTDEL6+11
+
+    // This comparison is correct for non-inverted meta.
+    // For the moment, LV1 invalidity forces a trap. This isn't conclusively proven correct, and may change.
+    // if((pS[I].cached_gcv&03) > present_gcv && pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB_Valid == 0){ gc_volatilty_flag = 1; }
+    if(pS[I].cached_gcv <= present_gcv && pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB_Valid == 0){
+      gc_volatilty_flag = 1;
+    }
+
+    if(UTRACE){
+      logmsgf(LT_LAMBDA,10,"DISPATCH: GCV: CACHED (LV2) GCV 0x%X\n",pS[I].cached_gcv&03);
+      logmsgf(LT_LAMBDA,10,"DISPATCH: GCV: PRESENT (LV1) GCV 0x%X\n",present_gcv);
+      logmsgf(LT_LAMBDA,10,"DISPATCH: GCV: LV1 ENT 0x%X = 0x%X (Meta 0x%X Validity %o)\n",
+	     pS[I].MDregister.VM.VPage_Block,pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].raw,
+	     pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB,
+	     pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB_Valid);
+      logmsgf(LT_LAMBDA,10,"DISPATCH: GCV: LV2 ENT 0x%X = 0x%X (Meta 0x%X)\n",
+	     pS[I].vm_lv2_index.raw,pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].raw,
+	     pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Meta);
+    }
+  }
+  oldspace_flag = 0;
+  if(pS[I].Idecode.Dispatch.Enable_Oldspace_Meta != 0){
+    // Do a map resolve for what's in MD
+    pS[I].vm_lv2_index.raw = 0;
+    pS[I].vm_lv2_index.VPage_Offset = pS[I].MDregister.VM.VPage_Offset;
+    pS[I].vm_lv2_index.LV2_Block = pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].LV2_Block;
+    // Extract the oldspace bit (5?)
+    // oldspace_flag 0 means trap (oldspace)
+    // oldspace_flag 1 means don't trap (newspace)
+    // Reversing this causes infinite loop (GCV never tested), so this has to be right.
+    if((pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Meta&0x20) == 0x20){ oldspace_flag = 1; } // Not oldspace, don't trap
+    if(UTRACE){
+      logmsgf(LT_LAMBDA,10,"DISPATCH: META: LV2 ENT 0x%X = 0x%X (Meta 0x%X)\n",
+	     pS[I].vm_lv2_index.raw,pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].raw,
+	     pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Meta);
+    }
+  }
+  // Set dispatch address
+  // Lambda uses the A source as the dispatch address!
+  // disp_address = (mir_mask & MInst_Disp_Address) | dispatch_source | gc_volatilty_flag | oldspace_flag;
+  disp_address = pS[I].Idecode.ASource|dispatch_source;
+  // Handle oldspace/GCV meta
+  if(pS[I].Idecode.Dispatch.Enable_Oldspace_Meta != 0 || pS[I].Idecode.Dispatch.Enable_GC_Volatility_Meta){
+    // I think this is how this is supposed to work
+    disp_address |= (oldspace_flag|gc_volatilty_flag);
+  }
+  // Load dispatch constant register
+  pS[I].disp_constant_reg = pS[I].Idecode.Dispatch.Constant;
+  // Lambda has no dispatch opcode field, so I assume it is always DISPATCH
+  disp_word.raw = pS[I].Amemory[(disp_address)]; // A-source is already offset // Dmemory[disp_address];
+  if(UTRACE){
+    logmsgf(LT_LAMBDA,10,"DISPATCH: GENERATED ADDRESS 0x%X AND FETCHED WORD 0x%X\n",disp_address,disp_word.raw);
+  }
+  // Handle dispatch word
+  if(UTRACE){
+    char *location;
+    char symloc[100];
+    int offset;
+
+    logmsgf(LT_LAMBDA,10,"DISPATCH: OP %s DEST ",jump_op_str[disp_word.Operation]);
+    location = "";
+    offset = 0;
+    location = sym_find_last(1, disp_word.PC, &offset);
+    if(location != 0){
+      if(offset != 0){
+	sprintf(symloc, "%s+%o", location, offset);
+      }else{
+	sprintf(symloc, "%s", location);
       }
-      return;
+      logmsgf(LT_LAMBDA,10,"%s",symloc);
+    }
+    logmsgf(LT_LAMBDA,10," (%o)\n",disp_word.PC);
+  }
+  // Handle operation of Start-Memory-Read
+  if(disp_word.StartRead){
+    if(UTRACE != 0){
+      logmsgf(LT_LAMBDA,10," START-MEMORY-READ");
+    }
+    // Load VMA from pS[I].Obus and initiate a read.
+    pS[I].VMAregister.raw = pS[I].Mbus; // Load VMA
+    VM_resolve_address_core(I,VM_READ,0,trace);
+    if(pS[I].Page_Fault == 0 && pS[I].ConReg.Enable_NU_Master == 1){
+      // Do it
+      if(pS[I].RG_Mode.Aux_Stat_Count_Control == 01){
+	pS[I].stat_counter_aux++;
+      }
+      if(pS[I].RG_Mode.Main_Stat_Count_Control == 01){
+	pS[I].stat_counter_main++;
+      }
+      lambda_mem_request(I,VM_READ,pS[I].vm_phys_addr.raw,0);
+    }
+  }
+  // Handle operation
+  switch(disp_word.Operation){
+  case 0: // Jump-Branch-Xct-Next
+    // Jump, but DO NOT inhibit the next instruction!
+    if(pS[I].loc_ctr_nxt != -1){
+      logmsgf(LT_LAMBDA,0,"DISPATCH: Pending JUMP-After-Next collision investigation stop\n");
+      pS[I].cpu_die_rq = 1;
     }
+    pS[I].loc_ctr_nxt = disp_word.PC;
+    break;
 
-    // MACRO INSTRUCTION DISPATCH
-    if(pS[I].macro_dispatch_inst > -1){
-      pS[I].macro_dispatch_inst--;
-      if(pS[I].macro_dispatch_inst == 0){
-	DispatchWord disp_word;
-	if(pS[I].microtrace){
+  case 1: // Jump-Branch
+    if(pS[I].loc_ctr_reg.raw != (pS[I].loc_ctr_cnt + 1)){
+      logmsgf(LT_LAMBDA,0,"DISPATCH: Pending JUMP collision investigation stop\n");
+      pS[I].cpu_die_rq = 1;
+    }
+    pS[I].loc_ctr_reg.raw = disp_word.PC;
+    pS[I].NOP_Next = 1;
+    break;
+
+  case 2: // Jump-Call-Xct-Next
+    // Call, but DO NOT inhibit the next instruction!
+    if(pS[I].popj_after_nxt != -1){
+      // PJAN is armed. Do not double!
+      pS[I].popj_after_nxt = -1;
+    }
+    pS[I].uPCS_ptr_reg++; pS[I].uPCS_ptr_reg &= 0xFF;
+    // Raven does not handle this, but should we? (Should Raven?)
+    if(pS[I].Idecode.Dispatch.LPC){
+      logmsgf(LT_LAMBDA,0,"DISPATCH: LPC set w/ call-xct-next?\n");
+      pS[I].cpu_die_rq = 1;
+    }
+    pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw+1; // Pushes the address of the next instruction	
+    if(UTRACE){
+      char *location;
+      char symloc[100];
+      int offset;
+
+      logmsgf(LT_LAMBDA,10,"uStack[%o] = ",pS[I].uPCS_ptr_reg);
+
+      location = "";
+      offset = 0;
+      location = sym_find_last(1, pS[I].uPCS_stack[pS[I].uPCS_ptr_reg], &offset);
+      if(location != 0){
+	if(offset != 0){
+	  sprintf(symloc, "%s+%o", location, offset);
+	}else{
+	  sprintf(symloc, "%s", location);
+	}
+	logmsgf(LT_LAMBDA,10,"%s",symloc);
+      }
+      logmsgf(LT_LAMBDA,10," (%o)\n",pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]);
+    }
+    pS[I].loc_ctr_nxt = disp_word.PC;
+    if(pS[I].popj_after_nxt == 0){
+      // PJAN is armed. We want this call to return to my caller instead of here.
+      // So we'll pop this return address now.
+      pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
+      pS[I].popj_after_nxt = -1;
+    }
+    break;
+
+  case 3: // Jump-Call
+    // PUSH ADDRESS
+    if(pS[I].popj_after_nxt != -1){
+      // PJAN is armed. Do not double!
+      //logmsgf(LT_LAMBDA,10,"RETURN-XCT-NEXT with PJAN armed!\n");
+      pS[I].popj_after_nxt = -1;
+    }
+    pS[I].uPCS_ptr_reg++;  pS[I].uPCS_ptr_reg &= 0xFF;
+    if(pS[I].Idecode.Dispatch.LPC){
+      pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_cnt; // Stack-Own-Address
+    }else{
+      pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw;
+    }
+    if(UTRACE){
+      char *location;
+      char symloc[100];
+      int offset;
+
+      logmsgf(LT_LAMBDA,10,"uStack[%o] = ",pS[I].uPCS_ptr_reg);
+
+      location = "";
+      offset = 0;
+      location = sym_find_last(1, pS[I].uPCS_stack[pS[I].uPCS_ptr_reg], &offset);
+      if(location != 0){
+	if(offset != 0){
+	  sprintf(symloc, "%s+%o", location, offset);
+	}else{
+	  sprintf(symloc, "%s", location);
+	}	  
+	logmsgf(LT_LAMBDA,10,"%s",symloc);
+      }
+      logmsgf(LT_LAMBDA,10," (%o)\n",pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]);
+    }
+    // Jump
+    pS[I].loc_ctr_reg.raw = disp_word.PC;
+    pS[I].NOP_Next = 1;
+    if(pS[I].popj_after_nxt == 0){
+      // PJAN is armed. We want this call to return to my caller instead of here.
+      // So we'll pop this return address now.
+      pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
+      pS[I].popj_after_nxt = -1;
+    }
+    break;
+
+  case 4: // Jump-Return-XCT-Next
+    // POP ADDRESS
+    pS[I].loc_ctr_nxt = pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]&0xFFFFF;
+    pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
+    break;
+
+    // Used in d-swap-quantum-map-dispatch, should return
+  case 5: // Jump-Return
+    // POP ADDRESS
+    pS[I].loc_ctr_reg.raw = pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]&0xFFFFF;
+    pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
+    pS[I].NOP_Next = 1;
+    break;
+
+  case 6: // Undefined-NOP
+    /*
+    // PUSH ADDRESS
+    pS[I].uPCS_ptr_reg++;  pS[I].uPCS_ptr_reg &= 0xFF;
+    pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw;
+    // POP ADDRESS
+    pS[I].loc_ctr_nxt = pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]&0xFFFFF;
+    pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
+    */
+    break;
+
+  case 7: // Undefined-NOP (Raven SKIP)
+    pS[I].loc_ctr_reg.raw++;
+    pS[I].NOP_Next = 1;
+    break;
+
+  default:
+    logmsgf(LT_LAMBDA,0,"Unknown dispatch RPN %o\n",disp_word.Operation);
+    pS[I].cpu_die_rq=1;
+  }
+}
+UINST_VARIANTS(uinst_disp_op)
+
+// Opcode handlers, by core variant
+static void (* const uinst_handler[LAMBDA_VARIANTS][4])(int I) = {
+  { uinst_alu_op_trace, uinst_byte_op_trace, uinst_jump_op_trace, uinst_disp_op_trace },
+  { uinst_alu_op_lean0, uinst_byte_op_lean0, uinst_jump_op_lean0, uinst_disp_op_lean0 },
+  { uinst_alu_op_lean1, uinst_byte_op_lean1, uinst_jump_op_lean1, uinst_disp_op_lean1 }
+};
+
+// Predecode a microinstruction
+void decode_uinst(UInst ui,DecodedUInst *ent){
+  int x;
+  for(x=0; x<LAMBDA_VARIANTS; x++){
+    ent->handler[x] = uinst_handler[x][ui.Opcode];
+  }
+  ent->Opcode = ui.Opcode;
+  ent->MSource = ui.MSource;
+  ent->ASource = ui.ASource;
+  ent->Jump.Address = ui.Jump.Address;
+  ent->Jump.Cond = ui.Jump.Cond;
+  ent->Jump.Test = ui.Jump.Test;
+  ent->Jump.Invert = ui.Jump.Invert;
+  ent->Jump.RPN = ui.Jump.RPN;
+  ent->ALU.Operation = ui.ALU.Operation;
+  ent->ALU.Output = ui.ALU.Output;
+  ent->ALU.QControl = ui.ALU.QControl;
+  ent->ALU.Carry = ui.ALU.Carry;
+  ent->ALU.Mask = ui.ALU.Mask;
+  ent->Byte.Pos = ui.Byte.Pos;
+  ent->Byte.Len = ui.Byte.Len;
+  ent->Byte.Rotate_Source = ui.Byte.Rotate_Source;
+  ent->Byte.Rotate_Mask = ui.Byte.Rotate_Mask;
+  ent->Dispatch.Constant = ui.Dispatch.Constant;
+  ent->Dispatch.Pos = ui.Dispatch.Pos;
+  ent->Dispatch.Len = ui.Dispatch.Len;
+  ent->Dispatch.LPC = ui.Dispatch.LPC;
+  ent->Dispatch.Write_VMA = ui.Dispatch.Write_VMA;
+  ent->Dispatch.Enable_GC_Volatility_Meta = ui.Dispatch.Enable_GC_Volatility_Meta;
+  ent->Dispatch.Enable_Oldspace_Meta = ui.Dispatch.Enable_Oldspace_Meta;
+  ent->Destination.A.Addr = ui.Destination.A.Addr;
+  ent->Destination.A.Flag = ui.Destination.A.Flag;
+  ent->Destination.M.Addr = ui.Destination.M.Addr;
+  ent->Destination.F.Dest = ui.Destination.F.Dest;
+  ent->flags = 0;
+  if(ui.Clobbers_Mem_Subr_Bit != 0){ ent->flags |= UD_CMSB; }
+  if(ui.MSource == 0161){ ent->flags |= UD_MD_SRC; }
+  if(ui.Macro_Stream_Advance != 0){ ent->flags |= UD_MSA; }
+  if(ui.Stat_Bit != 0 || ui.PopJ_After_Next != 0 || ui.Slow_Dest != 0 || ui.ILong != 0){ ent->flags |= UD_SEQ; }
+  if(ui.Src_to_Macro_IR != 0 || ui.Macro_IR_Disp != 0){ ent->flags |= UD_MIR; }
+  if(ui.Halt != 0){ ent->flags |= UD_HALT; }
+  switch(ui.Opcode){
+  case 0: // ALU
+    if(ui.ALU.Misc != 0 || ui.ALU.Spare != 0){ ent->flags |= UD_SPARE; }
+    break;
+  case 1: // BYTE
+    if(ui.Byte.Misc != 0 || ui.Byte.Spare != 0){ ent->flags |= UD_SPARE; }
+    break;
+  case 2: // JUMP
+    if(ui.Jump.LC_Increment != 0 || ui.Jump.Spare != 0 || ui.Jump.Spare2 != 0){ ent->flags |= UD_SPARE; }
+    break;
+  case 3: // DISPATCH
+    if(ui.Dispatch.Spare != 0){ ent->flags |= UD_SPARE; }
+    break;
+  }
+  ent->valid = true;
+}
+
+// Redecode the IR after something other than a fetch loaded it
+void decode_ireg(int I){
+  decode_uinst(pS[I].Iregister,&pS[I].Idecode);
+}
+
+// Discard predecoded WCS after a write. An address of -1 discards all of it.
+// CRAM map writes need nothing here, the cache is indexed by physical address.
+void lambda_invalidate_wcs(int I,int addr){
+  if(addr < 0){
+    bzero((uint8_t *)pC[I].WCS_decode,sizeof(pC[I].WCS_decode));
+  }else{
+    pC[I].WCS_decode[addr&0xFFFF].valid = false;
+  }
+  lambda_flush_blocks(I);
+}
+
+// Idle detection, called by the main loop once per slice.
+// Lisp waiting for something to do runs its idle loop and a small set of other microcode
+// over and over. If the set of micro-PCs in the history RAM is exactly the same for several
+// checks in a row and includes the idle loop, the processor is parked for a few slices.
+// It wakes early for interrupts, for bus writes or requests addressed to it, and for
+// writes to its memory that don't use the bus, so anything that could end the wait is seen.
+// Busy code can repeat itself too, so without the idle loop's address nothing is parked.
+void lambda_idle_check(int I){
+  uint64_t set[0x10000/64];
+  bool saw_idle = false;
+  int x = 0;
+  if(idle_detect == 0){ return; }
+  if(idle_addr == 0){
+    if(idle_symbol[0] == 0){
+      logmsgf(LT_LAMBDA,0,"idle_detect needs idle_symbol, the idle loop's microcode symbol; idle detection is off\n");
+      idle_detect = 0;
+      return;
+    }
+    if(sym_find(1,idle_symbol,(int *)&idle_addr) != 0){
+      logmsgf(LT_LAMBDA,0,"can't find idle loop %s in microcode symbols; idle detection is off\n",idle_symbol);
+      idle_addr = 0;
+      idle_detect = 0;
+      return;
+    }
+    logmsgf(LT_LAMBDA,10,"found idle loop %s at %#o\n",idle_symbol,idle_addr);
+  }
+  if(pS[I].cpu_die_rq != 0 || pS[I].idle_park != 0){ return; }
+  bzero(set,sizeof(set));
+  while(x < 0x1000){
+    uint16_t pc = pS[I].History_RAM[x];
+    set[pc>>6] |= 1ULL<<(pc&0x3F);
+    if(pc == (idle_addr&0xFFFF)){ saw_idle = true; }
+    x++;
+  }
+  if(saw_idle && memcmp(set,idle_set[I],sizeof(set)) == 0){
+    pS[I].idle_stable++;
+  }else{
+    pS[I].idle_stable = 0;
+  }
+  memcpy(idle_set[I],set,sizeof(set));
+  if(pS[I].idle_stable >= idle_checks && pS[I].InterruptPending == 0 && pS[I].exec_hold == false &&
+     pS[I].ublock_cycles == 0 && pS[I].mem_wait == 0 &&
+     !(NUbus_Busy > 0 && NUbus_master == pS[I].NUbus_ID)){
+    pS[I].idle_park = idle_slices*IDLE_SLICE_CYCLES;
+    idle_parked = 1;
+    // The history will not change while parked, so one more quiet slice after the
+    // park runs out is enough to park again.
+    pS[I].idle_stable = idle_checks-1;
+  }
+}
+
+// Wake parked processors. Called through IDLE_WAKE() when another master writes
+// processor-visible memory without using the bus. The history is left alone: if
+// the write was not what the processor waited for, it is still idle and can park
+// again at the next check.
+void lambda_idle_wake(){
+  pS[0].idle_park = 0;
+  pS[1].idle_park = 0;
+  idle_parked = 0;
+}
+
+// Discard all straight-line blocks. Used for WCS and CRAM map writes.
+void lambda_flush_blocks(int I){
+  pC[I].ublock_generation++;
+}
+
+// Can this instruction be part of a straight-line block?
+// It must not branch, stall, start a bus cycle, or touch state that other
+// devices or the next fetch depend on.
+static bool ublock_eligible(UInst ui,DecodedUInst *ent){
+  if(ent->flags != 0){ return(false); }
+  switch(ui.Opcode){
+  case 0: // ALU-OP
+    if(ui.ALU.Misc != 0 || ui.ALU.Spare != 0){ return(false); }
+    break;
+  case 1: // BYTE-OP
+    if(ui.Byte.Misc != 0 || ui.Byte.Spare != 0){ return(false); }
+    break;
+  default: // JUMP and DISPATCH end the block
+    return(false);
+  }
+  // M source
+  switch(ui.MSource){
+  case 0 ... 077:  // M-memory
+  case 0106: // MULTIPLIER-FT
+  case 0110: // DISP-CONST
+  case 0111: // MICRO-STACK
+  case 0112: // MICRO-STACK-POP
+  case 0122: // VMA
+  case 0130: // PDL-BUFFER-INDEX
+  case 0131: // Q
+  case 0132: // PDL-BUFFER-POINTER
+  case 0135: // DP-MODE
+  case 0136: // C-PDL-BUFFER-POINTER-POP
+  case 0137: // C-PDL-BUFFER-INDEX
+  case 0146: // MULTIPLIER
+  case 0176: // C-PDL-BUFFER-POINTER
+    break;
+  default:
+    return(false);
+  }
+  // Destination
+  if(ui.Destination.A.Flag != 0){ return(true); }
+  switch(ui.Destination.F.Dest){
+  case 000: // None
+  case 002: // DP-MODE
+  case 010: // C-PDL-BUFFER-POINTER
+  case 011: // C-PDL-BUFFER-POINTER-PUSH
+  case 012: // C-PDL-BUFFER-INDEX
+  case 013: // PDL-BUFFER-POINTER
+  case 015: // MICRO-STACK-PUSH
+  case 020: // VMA
+  case 033: // C-PDL-INDEX-INC
+  case 035: // MICRO-STACK-POINTER-IF-POP
+  case 036: // C-PDL-INDEX-DEC
+  case 037: // MULTIPLIER
+  case 053: // PDL-BUFFER-INDEX
+    return(true);
+  }
+  return(false);
+}
+
+// Find or build the block starting at addr
+static UBlock *ublock_lookup(int I,int addr){
+  UBlock *blk = &pC[I].ublock[addr&(UBLOCK_CACHE-1)];
+  if(blk->generation == pC[I].ublock_generation && blk->start == addr){
+    return(blk);
+  }
+  blk->generation = pC[I].ublock_generation;
+  blk->start = addr;
+  blk->len = 0;
+  while(blk->len < UBLOCK_MAX && addr <= 0xFFFF){
+    int paddr = pS[I].CRAM_map[addr>>4] & 03777;
+    paddr <<= 4;
+    paddr |= (addr&0xF);
+    if(pC[I].WCS_decode[paddr].valid == false){
+      decode_uinst(pS[I].WCS[paddr],&pC[I].WCS_decode[paddr]);
+    }
+    if(!ublock_eligible(pS[I].WCS[paddr],&pC[I].WCS_decode[paddr])){ break; }
+    blk->paddr[blk->len] = paddr;
+    blk->handler[blk->len] = pC[I].WCS_decode[paddr].handler[LAMBDA_LEAN0+I];
+    blk->len++;
+    addr++;
+  }
+  return(blk);
+}
+
+// Run the straight-line block at the PC, if there is one. Lean cores only.
+// Each instruction still costs a cycle; the cycles after the first are
+// retired by the following calls to lambda_clockpulse.
+// Returns the number of instructions executed.
+LCORE int ublock_run(int I,const bool trace){
+  UBlock *blk = ublock_lookup(I,pS[I].loc_ctr_reg.raw);
+  int x = 0;
+  if(blk->len < 2){ return(0); }
+  pS[I].ConReg.halt_request = 0;
+  pS[I].ConReg.any_parity_error_synced_l = 1;
+  pS[I].ConReg.nop_next = 1;
+  pS[I].exec_hold = false;
+  while(x < blk->len && pS[I].cpu_die_rq == 0){
+    int paddr = blk->paddr[x];
+    // Stat counter hi.c. The cycle that runs the block counts the first
+    // instruction when it ends, so only the others are counted here.
+    if(x > 0){
+      if(pS[I].RG_Mode.Aux_Stat_Count_Control == 07){
+	pS[I].stat_counter_aux++;
+      }
+      if(pS[I].RG_Mode.Main_Stat_Count_Control == 07){
+	pS[I].stat_counter_main++;
+      }
+    }
+    // Update PC
+    pS[I].loc_ctr_cnt = pS[I].loc_ctr_reg.raw;
+    pS[I].loc_ctr_reg.raw = pS[I].loc_ctr_cnt + 1;
+    pS[I].last_loc_ctr = pS[I].loc_ctr_reg.raw;
+    // History maintenance
+    pS[I].History_RAM[pS[I].History_Pointer&0xFFF] = pS[I].loc_ctr_cnt;
+    pS[I].History_Pointer++;
+    if(pS[I].History_Pointer > 0xFFF){ pS[I].History_Pointer = 0; }
+    // Fetch and execute
+    pS[I].Iregister.raw = pS[I].WCS[paddr].raw;
+    pS[I].Idecode = pC[I].WCS_decode[paddr];
+    handle_source_core(I,0,trace);
+    blk->handler[x](I);
+    x++;
+  }
+  pS[I].ublock_cycles = x-1;
+  return(x);
+}
+
+// Normal Clock Pulse
+LCORE void lambda_clockpulse_core(int I,const bool trace,const int variant){
+  pS[I].cycle_count++;
+  // Run one clock
+
+  // NUbus interface operation
+  if(NUbus_master == pS[I].NUbus_ID && NUbus_Busy > 0){
+    if((NUbus_Request&0x01)==0){
+      // Since this is our read request, reload MD here.
+      // Since Lambda doesn't handle timeouts, I guess this happens regardless of acknowledge?
+      pS[I].MDregister.raw = NUbus_Data.word;
+    }
+    // Was it acknowledged?
+    if(NUbus_acknowledge == 1){
+      if(NTRACE == 1){
+	logmsgf(LT_NUBUS,10,"NUBUS: Cycle Complete: Request %o Addr 0x%X (0%o) w/ data 0x%X (0%o) Ack %o\n",
+	       NUbus_Request,NUbus_Address.raw,NUbus_Address.raw,NUbus_Data.word,NUbus_Data.word,NUbus_acknowledge);
+      }
+      // We can release the bus
+      NUbus_Busy = 0;
+    }
+  }else if(pS[I].mem_wait > 0){
+    // Fast memory cycle. MD loads as it would from the bus: the request's
+    // data lines until the cycle completes, then the result.
+    pS[I].mem_wait--;
+    if(pS[I].mem_wait_read){
+      pS[I].MDregister.raw = (pS[I].mem_wait == 0 ? pS[I].mem_wait_data : 0);
+    }
+  }
+  // If we are halted, we are done here.
+  if(pS[I].cpu_die_rq != 0){
+    pS[I].ublock_cycles = 0;
+    return; 
+  }else{
+    /*
+    if(pS[I].PMR.Allow_UInst_Clocks != 0 && pS[I].ConReg.uinst_clock_l != 0){
+      logmsgf(LT_LAMBDA,10,"CONREG: UINST_CLOCK\n");
+      pS[I].ConReg.uinst_clock_l = 0;
+    }else{
+      pS[I].ConReg.uinst_clock_l = 1;
+    }
+    */
+  }
+
+  // Retire cycles of a straight-line block. Its instructions have all run, so the
+  // PC, IR and registers are ahead of the hardware by the cycles left. A forced hold
+  // or a halt request gives up the rest, as does a spy access (see lambda_nubus_slave),
+  // so the SDU sees the state at the end of the block at once rather than after it.
+  // That it sees the end of the block at all is a known limit of running blocks.
+  if(pS[I].ublock_cycles > 0){
+    if(pS[I].PMR.Force_T_Hold == 0 && pS[I].ConReg.halt_request == 0){
+      pS[I].ublock_cycles--;
+      return;
+    }
+    pS[I].ublock_cycles = 0;
+  }
+
+  // If we are not holding...
+  if(pS[I].exec_hold == false && pS[I].PMR.Force_T_Hold == 0){
+    if(pS[I].ConReg.t_hold_l != 1){
+      pS[I].ConReg.t_hold_l = 1; // Not holding
+      if(UTRACE){
+	logmsgf(LT_LAMBDA,10,"CONREG: Hold Cleared\n");
+      }
+    }
+    // Decrement POPJ-After-Next flag if set
+    if(pS[I].popj_after_nxt > -1){
+      if(pS[I].popj_after_nxt == 0){
+	// Time for popj
+	pS[I].loc_ctr_reg.raw = pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]&0xFFFFF;
+	pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
+	if(UTRACE){
+	  logmsgf(LT_LAMBDA,10,"PJAN FIRED: GOING TO %o\n",pS[I].loc_ctr_reg.raw);
+	}
+	// pS[I].cpu_die_rq = 1; 
+      }
+      pS[I].popj_after_nxt--;
+    }
+    
+    if(pS[I].slow_dest == true){
+      // Slow destination. Waste a cycle.
+      pS[I].stall_count++;
+      pS[I].slow_dest = false;
+      if(UTRACE){
+	logmsgf(LT_LAMBDA,10,"SLOW-DEST cycle used\n");
+      }
+      return;
+    } 
+
+    if(pS[I].long_inst == true){
+      // Long instruction. Waste a cycle.
+      pS[I].stall_count++;
+      pS[I].long_inst = false;
+      if(UTRACE){
+	logmsgf(LT_LAMBDA,10,"LONG-INST cycle used\n");
+      }
+      return;
+    } 
+
+    if(pS[I].NOP_Next == true){
+      // Inhibit bit set. Waste a cycle.
+      pS[I].ConReg.nop = 0;
+      pS[I].stall_count++;
+      pS[I].NOP_Next = false;
+      if(UTRACE){
+	logmsgf(LT_LAMBDA,10,"NOP-NEXT cycle used\n");
+      }
+      return;
+    }else{
+      pS[I].ConReg.nop = 1;
+    }
+
+    if(pS[I].cram_write_cyc == true){
+      // CRAM or map write. Waste a cycle.
+      pS[I].stall_count++;
+      pS[I].cram_write_cyc = false;
+      if(UTRACE){
+	logmsgf(LT_LAMBDA,10,"CRAM WRITE cycle used\n");
+      }
+      return;
+    }
+
+    // MACRO INSTRUCTION DISPATCH
+    if(pS[I].macro_dispatch_inst > -1){
+      pS[I].macro_dispatch_inst--;
+      if(pS[I].macro_dispatch_inst == 0){
+	DispatchWord disp_word;
+	if(UTRACE){
 	  logmsgf(LT_LAMBDA,10,"MI: MACRO DISPATCH CYCLE\n");
 	}
 	// Stop conditions
@@ -3755,7 +4820,7 @@ void lambda_clockpulse(int I){
 	// Obtain dispatch word
 	disp_word.raw = pS[I].MIDmemory[pS[I].MIDAddr.raw];
 	// Log it
-        if(pS[I].microtrace){
+        if(UTRACE){
 	  logmsgf(LT_LAMBDA,10,"MISC/MISC1 INSTRUCTION!\n");
 	  logmsgf(LT_LAMBDA,10,"MI: MACRO DISPATCH\n");
           logmsgf(LT_LAMBDA,10,"MID: MIR = 0x%X LC = 0x%X RG.Hi = %o RG.Enable_Misc_MID = %o Opcode %o: GENERATED ADDR %o DATA = 0x%X\n",
@@ -3806,12 +4871,12 @@ void lambda_clockpulse(int I){
 	  // Call, but DO NOT inhibit the next instruction!
 	  pS[I].uPCS_ptr_reg++; pS[I].uPCS_ptr_reg &= 0xFF;
 	  // Raven does not handle this, but should we? (Should Raven?)
-	  if(pS[I].Iregister.Dispatch.LPC){
+	  if(pS[I].Idecode.Dispatch.LPC){
 	    logmsgf(LT_LAMBDA,0,"DISPATCH: LPC set w/ call-xct-next?\n");
 	    pS[I].cpu_die_rq = 1;
 	  }
 	  pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw+1; // Pushes the address of the next instruction
-	  if(pS[I].microtrace){
+	  if(UTRACE){
 	    char *location;
 	    char symloc[100];
 	    int offset;
@@ -3834,12 +4899,12 @@ void lambda_clockpulse(int I){
 	case 3: // Jump-Call
 	  // PUSH ADDRESS
 	  pS[I].uPCS_ptr_reg++;  pS[I].uPCS_ptr_reg &= 0xFF;
-	  if(pS[I].Iregister.Dispatch.LPC){
+	  if(pS[I].Idecode.Dispatch.LPC){
 	    pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_cnt; // Stack-Own-Address
 	  }else{
 	    pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw;
 	  }
-	  if(pS[I].microtrace){
+	  if(UTRACE){
 	    char *location;
 	    char symloc[100];
 	    int offset;
@@ -3893,13 +4958,25 @@ void lambda_clockpulse(int I){
 	}
 	// pS[I].cpu_die_rq = 1;
 	// This uses up a cycle
-	if(pS[I].microtrace){
+	if(UTRACE){
 	  logmsgf(LT_LAMBDA,10,"MI: MACRO DISPATCH cycle completed\n");
 	}
 	return;
       }
     }
 
+#ifndef LAMBDA_DEBUGTRACE
+    // Straight-line block, if nothing is pending that needs the full path
+    if(trace == false && pS[I].loc_ctr_nxt == -1 && pS[I].popj_after_nxt == -1 && pS[I].spy_wrote_ireg == false &&
+       pS[I].imod_en == 0 && UTRACE == false && MTRACE == false &&
+       pS[I].ConReg.Enable_SM_Clock == 1 && pS[I].PMR.Advance_UInst_Request == 0 &&
+       pS[I].loc_ctr_reg.raw <= 0xFFFF){
+      if(ublock_run(I,trace) != 0){
+	goto ublock_done;
+      }
+    }
+#endif
+
     // Update PC.
     pS[I].loc_ctr_cnt = pS[I].loc_ctr_reg.raw; // Prepare to fetch next.
     
@@ -3930,13 +5007,18 @@ void lambda_clockpulse(int I){
       int paddr = pS[I].CRAM_map[addr>>4] & 03777;
       paddr <<= 4;
       paddr |= (addr&0xF);
-      if(pS[I].microtrace){
+      if(UTRACE){
 	logmsgf(LT_LAMBDA,10,"UI: MAP 0x%X -> 0x%X\n",pS[I].loc_ctr_cnt&0xFFFF,paddr);
       }
       pS[I].Iregister.raw = pS[I].WCS[paddr].raw;
+      if(pC[I].WCS_decode[paddr].valid == false){
+	decode_uinst(pS[I].WCS[paddr],&pC[I].WCS_decode[paddr]);
+      }
+      pS[I].Idecode = pC[I].WCS_decode[paddr];
     }else{
       pS[I].spy_wrote_ireg = false;
-      if(pS[I].microtrace){
+      decode_ireg(I);
+      if(UTRACE){
 	logmsgf(LT_LAMBDA,10,"UI: Execute from modified IReg\n");
       }
     }
@@ -3947,6 +5029,7 @@ void lambda_clockpulse(int I){
       pS[I].imod_en = 0;
       pS[I].imod_hi = 0;
       pS[I].imod_lo = 0;
+      decode_ireg(I);
     }  
 
     // Handle STAT bit
@@ -3958,13 +5041,13 @@ void lambda_clockpulse(int I){
     }
     
     // Handle HALT bit
-    if((pS[I].Iregister.Halt)){
+    if(pS[I].Idecode.flags&UD_HALT){
       logmsgf(LT_LAMBDA,1,"**MInst-HALT** #%d\n",I);
       pS[I].cpu_die_rq = 1;
     }
   }else{
     // We are holding
-    if(pS[I].microtrace != 0){
+    if(UTRACE != 0){
       logmsgf(LT_LAMBDA,10,"CONREG: ");
       if(pS[I].PMR.Force_T_Hold != 0){ logmsgf(LT_LAMBDA,10,"Forced "); }
       logmsgf(LT_LAMBDA,10,"Hold\n");
@@ -3979,13 +5062,13 @@ void lambda_clockpulse(int I){
   }
 
   // Handle global fields
-  if(pS[I].Iregister.Clobbers_Mem_Subr_Bit != 0 && pS[I].ConReg.Enable_NU_Master == 1){
+  if((pS[I].Idecode.flags&UD_CMSB) && pS[I].ConReg.Enable_NU_Master == 1){
     // "Avoid clobbering mem-subr in progress"
     // Seems to be lit whenever Raven would do a stall for IO completion.
     // Maybe that's what we're supposed to do with it?
     // For timing purposes we do this by holding execution.
-    if(NUbus_Busy > 0){
-      if(pS[I].microtrace != 0){
+    if(NUbus_Busy > 0 || pS[I].mem_wait > 0){
+      if(UTRACE != 0){
 	logmsgf(LT_LAMBDA,10,"LAMBDA: CMSB: Awaiting bus...\n");
       }
       pS[I].stall_count++; // Track ticks burned
@@ -3994,9 +5077,10 @@ void lambda_clockpulse(int I){
     }
   }
   // MD source stall handling
-  if(pS[I].Iregister.MSource == 0161 && NUbus_Busy > 0 && NUbus_master == pS[I].NUbus_ID &&
-     !(NUbus_acknowledge != 0 || NUbus_error != 0)){
-    if(pS[I].microtrace != 0){
+  if((pS[I].Idecode.flags&UD_MD_SRC) &&
+     ((NUbus_Busy > 0 && NUbus_master == pS[I].NUbus_ID && !(NUbus_acknowledge != 0 || NUbus_error != 0)) ||
+      pS[I].mem_wait > 0)){
+    if(UTRACE != 0){
       logmsgf(LT_LAMBDA,10,"LAMBDA: M-SRC-MD: Awaiting cycle completion...\n");
     }
     pS[I].stall_count++; // Track ticks burned
@@ -4006,7 +5090,7 @@ void lambda_clockpulse(int I){
   // Handle top-level flag (Raven's PJ14)
   if((pS[I].loc_ctr_nxt != -1 && (pS[I].loc_ctr_nxt&0x40000) != 0) ||
      (pS[I].loc_ctr_reg.raw&0x40000) != 0){
-    if(pS[I].microtrace != 0){
+    if(UTRACE != 0){
       logmsgf(LT_LAMBDA,10,"TOPLEVEL FLAG SET! NOP-NEXT %o LOC-CTR-REG = 0x%X LOC-CTR-NXT = 0x%X\n",
 	     pS[I].NOP_Next,pS[I].loc_ctr_reg.raw,pS[I].loc_ctr_nxt);
     }
@@ -4014,7 +5098,7 @@ void lambda_clockpulse(int I){
 #ifdef ISTREAM
     if(((pS[I].LCregister.raw>>1)&0x01) == 0x0){
       pS[I].RG_Mode.Need_Macro_Inst_Fetch = 1;
-      if(pS[I].microtrace != 0){
+      if(UTRACE != 0){
 	logmsgf(LT_LAMBDA,10,"ODD PHASE LIGHTS NEEDS FETCH\n");
       }
     }else{
@@ -4027,23 +5111,24 @@ void lambda_clockpulse(int I){
     // If needfetch is set, do it
     if(pS[I].RG_Mode.Need_Macro_Inst_Fetch){
       // Raven saves the VMA, but Lambda doesn't?
-      if(pS[I].microtrace != 0){
+      if(UTRACE != 0){
 	logmsgf(LT_LAMBDA,10,"NEED-FETCH IS LIT\n");
       }
 #endif
       // We will need the memory bus. Can we have it?
-      if(NUbus_Busy > 0 && pS[I].ConReg.Enable_NU_Master == 1){
-	if(pS[I].microtrace != 0){
+      if((NUbus_Busy > 0 || pS[I].mem_wait > 0) && pS[I].ConReg.Enable_NU_Master == 1){
+	if(UTRACE != 0){
 	  logmsgf(LT_LAMBDA,10,"AWAITING MEMORY BUS...\n");
 	}
 	// No, burn a cycle and come back
 	pS[I].stall_count++; // Track ticks burned
 	pS[I].exec_hold = true;
+	nubus_wait(pS[I].NUbus_ID);
 	return;
       }
       // We can has bus
       pS[I].VMAregister.raw = (pS[I].LCregister.raw >> 2) & 0x1ffffff;
-      VM_resolve_address(I,VM_READ,0);
+      VM_resolve_address_core(I,VM_READ,0,trace);
       if(pS[I].Page_Fault == 0 && pS[I].ConReg.Enable_NU_Master == 1){
 	if(pS[I].RG_Mode.Aux_Stat_Count_Control == 01){
 	  pS[I].stat_counter_aux++;
@@ -4051,14 +5136,14 @@ void lambda_clockpulse(int I){
 	if(pS[I].RG_Mode.Main_Stat_Count_Control == 01){
 	  pS[I].stat_counter_main++;
 	}
-	nubus_io_request(VM_READ,pS[I].NUbus_ID,pS[I].vm_phys_addr.raw,0);
+	lambda_mem_request(I,VM_READ,pS[I].vm_phys_addr.raw,0);
       }
 #ifdef ISTREAM
       // Clear needfetch
       pS[I].RG_Mode.Need_Macro_Inst_Fetch = 0;
       pS[I].mirInvalid = 1;
     }else{
-      if(pS[I].microtrace != 0){
+      if(UTRACE != 0){
 	logmsgf(LT_LAMBDA,10,"NO NEED FOR FETCHING\n");
       }
     }
@@ -4075,7 +5160,7 @@ void lambda_clockpulse(int I){
       pS[I].stat_counter_main++;
     }
 
-    if(pS[I].microtrace != 0){
+    if(UTRACE != 0){
       logmsgf(LT_LAMBDA,10,"MI: LC ADVANCE: NEW LC = 0x%X (0%o)\n",pS[I].LCregister.raw,pS[I].LCregister.raw);
     }
     // All done, clear the flags
@@ -4085,9 +5170,9 @@ void lambda_clockpulse(int I){
     // pS[I].cpu_die_rq = 1;
   }
   // Handle Macro-Stream-Advance
-  if(pS[I].Iregister.Macro_Stream_Advance != 0){     
+  if(pS[I].Idecode.flags&UD_MSA){
     // Is this the expected scenario?
-    if(!(pS[I].Iregister.Opcode == 3 && pS[I].Iregister.MSource == 0107 && pS[I].Iregister.Dispatch.Pos == 020)){ // && pS[I].RG_Mode.Need_Macro_Inst_Fetch != 1)){
+    if(!(pS[I].Idecode.Opcode == 3 && pS[I].Idecode.MSource == 0107 && pS[I].Idecode.Dispatch.Pos == 020)){ // && pS[I].RG_Mode.Need_Macro_Inst_Fetch != 1)){
       logmsgf(LT_LAMBDA,0,"USE OF MACRO-STREAM-ADVANCE DOES NOT FIT EXPECTED SCENARIO - INVESTIGATE!\n");
       pS[I].cpu_die_rq = 1;
     }
@@ -4096,13 +5181,14 @@ void lambda_clockpulse(int I){
     if(((pS[I].LCregister.raw>>1)&0x01) == 0x0){
       // We will need the memory bus. Can we have it?
 #endif
-      if(NUbus_Busy > 0 && pS[I].ConReg.Enable_NU_Master == 1){
-	if(pS[I].microtrace){
+      if((NUbus_Busy > 0 || pS[I].mem_wait > 0) && pS[I].ConReg.Enable_NU_Master == 1){
+	if(UTRACE){
 	  logmsgf(LT_LAMBDA,10,"MACRO-STREAM-ADVANCE: AWAITING MEMORY BUS...\n");
 	}
 	// No, burn a cycle and come back
 	pS[I].stall_count++; // Track ticks burned
 	pS[I].exec_hold = true;
+	nubus_wait(pS[I].NUbus_ID);
 	return;
       }
 #ifdef ISTREAM
@@ -4115,11 +5201,11 @@ void lambda_clockpulse(int I){
 
     if(((pS[I].LCregister.raw>>1)&0x01) == 0x0){
 #endif
-      if(pS[I].microtrace){
+      if(UTRACE){
 	logmsgf(LT_LAMBDA,10,"MACRO-STREAM-ADVANCE: INITIATING MEMORY READ...\n");
       }
       pS[I].VMAregister.raw = (pS[I].LCregister.raw >> 2) & 0x1ffffff;
-      VM_resolve_address(I,VM_READ,0);
+      VM_resolve_address_core(I,VM_READ,0,trace);
       if(pS[I].Page_Fault == 0 && pS[I].ConReg.Enable_NU_Master == 1){
 	if(pS[I].RG_Mode.Aux_Stat_Count_Control == 01){
 	  pS[I].stat_counter_aux++;
@@ -4127,7 +5213,7 @@ void lambda_clockpulse(int I){
 	if(pS[I].RG_Mode.Main_Stat_Count_Control == 01){
 	  pS[I].stat_counter_main++;
 	}
-	nubus_io_request(pS[I].vm_byte_mode|VM_READ,pS[I].NUbus_ID,pS[I].vm_phys_addr.raw,0);
+	lambda_mem_request(I,pS[I].vm_byte_mode|VM_READ,pS[I].vm_phys_addr.raw,0);
       }   
 #ifdef ISTREAM
     }
@@ -4140,7 +5226,7 @@ void lambda_clockpulse(int I){
     if(pS[I].RG_Mode.Main_Stat_Count_Control == 03){
       pS[I].stat_counter_main++;
     }
-    if(pS[I].microtrace){
+    if(UTRACE){
       logmsgf(LT_LAMBDA,10,"MACRO-STREAM-ADVANCE: ");
       logmsgf(LT_LAMBDA,10,"NEW LC = 0x%X (0%o)\n",pS[I].LCregister.raw,pS[I].LCregister.raw);
     }
@@ -4153,674 +5239,73 @@ void lambda_clockpulse(int I){
   }
 
   pS[I].exec_hold = false; // Release hold
-  if(pS[I].Iregister.Stat_Bit != 0){ logmsgf(LT_LAMBDA,0,"\nSTAT\n"); pS[I].cpu_die_rq = 1; }
-  // if(pS[I].Iregister.ILong != 0){ logmsgf(LT_LAMBDA,10,"\nILong\n"); pS[I].cpu_die_rq = 1; }
-  // if(pS[I].Iregister.Macro_IR_Disp != 0){ logmsgf(LT_LAMBDA,10,"\nMIR-DISP\n"); pS[I].cpu_die_rq = 1; }
-  if(pS[I].Iregister.PopJ_After_Next != 0){ 
-    // If we are using SLOW-DEST we add another instruction
-    if(pS[I].Iregister.Slow_Dest != 0){
-      pS[I].popj_after_nxt = 2;
-    }else{
-      pS[I].popj_after_nxt = 1;
+  if(pS[I].Idecode.flags&UD_SEQ){
+    if(pS[I].Iregister.Stat_Bit != 0){ logmsgf(LT_LAMBDA,0,"\nSTAT\n"); pS[I].cpu_die_rq = 1; }
+    // if(pS[I].Iregister.ILong != 0){ logmsgf(LT_LAMBDA,10,"\nILong\n"); pS[I].cpu_die_rq = 1; }
+    // if(pS[I].Iregister.Macro_IR_Disp != 0){ logmsgf(LT_LAMBDA,10,"\nMIR-DISP\n"); pS[I].cpu_die_rq = 1; }
+    if(pS[I].Iregister.PopJ_After_Next != 0){ 
+      // If we are using SLOW-DEST we add another instruction
+      if(pS[I].Iregister.Slow_Dest != 0){
+        pS[I].popj_after_nxt = 2;
+      }else{
+        pS[I].popj_after_nxt = 1;
+      }
     }
-  }
 
-  // If SLOW-DEST is set, we burn an extra cycle after this instruction to allow
-  // writes to complete.
-  if(pS[I].Iregister.Slow_Dest != 0){ pS[I].slow_dest = true; } // Burn the next cycle
-  // ILONG works the same way
-  if(pS[I].Iregister.ILong != 0){ pS[I].long_inst = true; } // Burn the next cycle
+    // If SLOW-DEST is set, we burn an extra cycle after this instruction to allow
+    // writes to complete.
+    if(pS[I].Iregister.Slow_Dest != 0){ pS[I].slow_dest = true; } // Burn the next cycle
+    // ILONG works the same way
+    if(pS[I].Iregister.ILong != 0){ pS[I].long_inst = true; } // Burn the next cycle
+  }
   // Fetch sources
-  handle_source(I,0);
+  handle_source_core(I,0,trace);
   
-  // Source-To-Macro-IR.
-  // Load the Macro IR from the pS[I].Mbus
-  if(pS[I].Iregister.Src_to_Macro_IR != 0){ 
-#ifdef ISTREAM
-    if(((pS[I].LCregister.raw>>1)&0x01) == 0x01){
-#endif
-      if(pS[I].microtrace){
-	logmsgf(LT_LAMBDA,10,"S2MIR: Loaded MIR\n");
-      }
-      pS[I].MIregister.raw = pS[I].Mbus;
+  if(pS[I].Idecode.flags&UD_MIR){
+    // Source-To-Macro-IR.
+    // Load the Macro IR from the pS[I].Mbus
+    if(pS[I].Iregister.Src_to_Macro_IR != 0){ 
 #ifdef ISTREAM
-      pS[I].mirInvalid = 0;
-    }else{
-      if(pS[I].microtrace){
-	logmsgf(LT_LAMBDA,10,"S2MIR: Suppressed Loading MIR\n");
-      }
-      if(pS[I].mirInvalid == 1 || pS[I].loc_ctr_reg.raw > 036000){
-	pS[I].MIregister.raw = pS[I].Mbus;
-	//pS[I].MIregister.raw &= 0xFFFF0000;
-	//pS[I].MIregister.raw |= (pS[I].Mbus & 0xFFFF0000);
-	pS[I].mirInvalid = 0;
-	if(pS[I].microtrace){
-	  logmsgf(LT_LAMBDA,10,"S2MIR: mirInvalid override suppress of MIR\n");
-	  logmsgf(LT_LAMBDA,10,"MID: MIR = %o %o LC = %o\n",
-		 pS[I].MIregister.mi[0].raw,pS[I].MIregister.mi[1].raw,
-		 pS[I].LCregister.raw);
-	}
-      }
-    }
+      if(((pS[I].LCregister.raw>>1)&0x01) == 0x01){
 #endif
-  }
-
-  // MIR-DISP
-  if(pS[I].Iregister.Macro_IR_Disp != 0){
-    if(pS[I].microtrace){
-      logmsgf(LT_LAMBDA,10,"MIR-DISP: Flag Set\n"); 
-    }
-    pS[I].macro_dispatch_inst = 1; // Next instruction will be a macro dispatch
-  }
-
-  // Switch opcode
-  switch(pS[I].Iregister.Opcode){
-  case 0: // ALU-OP
-    // Perform ALU operation
-    operate_alu(I);
-
-    // Operate O bus
-    handle_o_bus(I);
-
-    if(pS[I].Iregister.ALU.Misc > 0){ logmsgf(LT_LAMBDA,0,"ALU-MISC "); pS[I].cpu_die_rq = 1; }
-
-    // Handle destination selector
-    handle_destination(I);
-
-    // Halt if spare bit set
-    if(pS[I].Iregister.ALU.Spare > 0){ logmsgf(LT_LAMBDA,0,"ALU-SPARE "); pS[I].cpu_die_rq = 1; }
-    
-    // Process Q register
-    handle_q_register(I);
-
-    // Load MFO from O-bus
-    pS[I].MFObus = pS[I].Obus;
-    break;
-
-  case 1: // BYTE-OP
-    // Operate shifter. Result goes to O bus.
-    operate_shifter(I);
-    // Load MFO from O-bus
-    pS[I].MFObus = pS[I].Obus;
-    // Store result
-    handle_destination(I);
-
-    if(pS[I].Iregister.Byte.Misc > 0){ logmsgf(LT_LAMBDA,0,"Misc "); pS[I].cpu_die_rq = 1; }
-    if(pS[I].Iregister.Byte.Spare > 0){ logmsgf(LT_LAMBDA,0,"BYTE-SPARE "); pS[I].cpu_die_rq = 1; }
-    break;
-
-  case 2: // JUMP-OP    
-    if(pS[I].Iregister.Jump.LC_Increment != 0){ logmsgf(LT_LAMBDA,0," LCINC"); pS[I].cpu_die_rq = 1; }
-    if(pS[I].Iregister.Jump.Spare != 0){ logmsgf(LT_LAMBDA,0," JUMP-SPARE"); pS[I].cpu_die_rq = 1; }
-    if(pS[I].Iregister.Jump.Spare2 != 0){ logmsgf(LT_LAMBDA,0," JUMP-SPARE2"); pS[I].cpu_die_rq = 1; }
-
-    // Handle condition
-    pS[I].test_true = false;
-    if(pS[I].Iregister.Jump.Test != 0){
-      // Operate ALU
-      alu_sub_stub(I,0); // Do M-A
-      alu_cleanup_result(I);
-
-      // Perform test      
-      switch(pS[I].Iregister.Jump.Cond){
-
-      case 01: // LAM-JUMP-COND-M<A
-	if((0x80000000^pS[I].Mbus) < (0x80000000^pS[I].Abus)){
-	  pS[I].test_true = true;
-	}
-	break;
-
-      case 02: // LAM-JUMP-COND-M<=A
-	if((pS[I].Abus == 0 && pS[I].Mbus == 0x80000000) || ((pS[I].ALU_Result&0x80000000) != 0)){
-	  pS[I].test_true = true;
-	}
-	break;
-
-      case 03: // M != A
-	if(pS[I].ALU_Result != 0xFFFFFFFF){
-	  pS[I].test_true = true;
-	}
-	break;
-
-      case 04: // LAM-JUMP-COND-PAGE-FAULT (INVERTED!)
-	if(pS[I].Page_Fault == 0){
-	  pS[I].test_true = 1;
-	}
-	break;
-
-      case 05: // LAM-JUMP-COND-PAGE-FAULT-OR-INTERRUPT
-	if(pS[I].Page_Fault != 0){
-	  pS[I].test_true = 1;
-	}
-	// DETECT INTERRUPT
-	{
-	  int x=0;
-	  if(pS[I].InterruptPending != 0){
-	    while(x<0x100){
-	      if(pS[I].InterruptStatus[x] != 0){
-		// We have an interrupt!
-		// Stuff vector in interrupt-pointer and return true
-		pS[I].InterruptVector = x;
-		pS[I].test_true = 1;
-		break;
-	      }
-	      x++;
-	    }
-	  }
-	}
-	break;
-
-      case 06: // LAM-JUMP-COND-PAGE-FAULT-OR-INTERRUPT-OR-SEQUENCE-BREAK
-	// SEQUENCE BREAK BIT IS INVERTED
-	if(pS[I].Page_Fault != 0 || pS[I].RG_Mode.Sequence_Break == 0){
-	  pS[I].test_true = 1;
-	}
-	// DETECT INTERRUPT
-	{
-          int x=0;
-	  if(pS[I].InterruptPending != 0){
-	    while(x<0x100){
-	      if(pS[I].InterruptStatus[x] != 0){
-		// We have an interrupt!
-		// Stuff vector in interrupt-pointer and return true
-		pS[I].InterruptVector = x;
-		pS[I].test_true = 1;
-		break;
-	      }
-	      x++;
-	    }
-	  }
+        if(UTRACE){
+	  logmsgf(LT_LAMBDA,10,"S2MIR: Loaded MIR\n");
         }
-	break;
-
-      case 07: // LAM-JUMP-COND-UNC
-	pS[I].test_true = true;
-	break;
-
-      case 011: // LAM-JUMP-COND-DATA-TYPE-NOT-EQUAL
-	if((pS[I].Mbus&0x3E000000) != (pS[I].Abus&0x3E000000)){
-	  pS[I].test_true = true;
-	}
-	break;
-
-      default:
-	logmsgf(LT_LAMBDA,0,"Unknown jump cond %o\n",pS[I].Iregister.Jump.Cond);
-	pS[I].cpu_die_rq = 1;
-      }
-    }else{
-      // BIT-SET
-      pS[I].test_true = left_rotate(pS[I].Mbus,pS[I].Iregister.Jump.Cond)&0x01;
-    }
-    // If the invert bit is set, reverse the condition
-    if(pS[I].Iregister.Jump.Invert){
-      pS[I].test_true ^= 1;
-    }
-
-    /* Handle RPN.
-       CODES ARE:
-         R P N  (RETURN, PUSH, INHIBIT)
-
-         0 0 0 = Branch-Xct-Next
-         0 0 1 = Branch
-         0 1 0 = Call-Xct-Next
-         0 1 1 = Call
-         1 0 0 = Return-Xct-Next
-         1 0 1 = Return
-         1 1 0 = NOP (JUMP2-XCT-NEXT) (UNDEFINED ON LAMBDA)
-         1 1 1 = SKIP (JUMP2) (UNDEFINED ON LAMBDA)
-    */
-
-    if(pS[I].test_true){
-      // If we have a pending POPJ-AFTER-NEXT, cancel it
-      if(pS[I].popj_after_nxt != -1 && (pS[I].Iregister.Jump.RPN != 2 && pS[I].Iregister.Jump.RPN != 3 && pS[I].Iregister.Jump.RPN != 5)){
-	logmsgf(LT_LAMBDA,0,"JUMP: Pending PJAN investigation stop: Not CALL or RETURN (Op %o)\n",pS[I].Iregister.Jump.RPN);
-	pS[I].cpu_die_rq = 1;
-      }
-      // Handle operation
-      switch(pS[I].Iregister.Jump.RPN){
-      case 0: // Jump-Branch-Xct-Next
-        // Jump, but DO NOT inhibit the next instruction!
-	if(pS[I].loc_ctr_nxt != -1){
-	  logmsgf(LT_LAMBDA,0,"JUMP: Pending JUMP-After-Next collision investigation stop\n");
-	  pS[I].cpu_die_rq = 1;
-	}
-        pS[I].loc_ctr_nxt = pS[I].Iregister.Jump.Address;
-        break;
-	
-      case 1: // Jump-Branch
-	if(pS[I].microtrace && pS[I].loc_ctr_reg.raw != (pS[I].loc_ctr_cnt + 1)){
-	  logmsgf(LT_LAMBDA,10,"JUMP: Pending JUMP collision investigation marker\n");
-	  // pS[I].cpu_die_rq = 1;
-	}	
-        pS[I].loc_ctr_reg.raw = pS[I].Iregister.Jump.Address;
-        pS[I].NOP_Next = 1;
-        break;
-
-      case 2: // Jump-Call-Xct-Next
-        // Call, but DO NOT inhibit the next instruction!
-        pS[I].uPCS_ptr_reg++; pS[I].uPCS_ptr_reg &= 0xFF;
-        pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw+1; // Pushes the address of the next instruction
-        if(pS[I].microtrace){
-          char *location;
-          char symloc[100];
-          int offset;
-
-          logmsgf(LT_LAMBDA,10,"uStack[%o] = ",pS[I].uPCS_ptr_reg);
-
-          location = "";
-          offset = 0;
-          location = sym_find_last(1, pS[I].uPCS_stack[pS[I].uPCS_ptr_reg], &offset);
-	  if(location != 0){
-	    if(offset != 0){
-	      sprintf(symloc, "%s+%o", location, offset);
-	    }else{
-	      sprintf(symloc, "%s", location);
-	    }
-	    logmsgf(LT_LAMBDA,10,"%s",symloc);
-	  }
-          logmsgf(LT_LAMBDA,10," (%o)\n",pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]);
+        pS[I].MIregister.raw = pS[I].Mbus;
+#ifdef ISTREAM
+        pS[I].mirInvalid = 0;
+      }else{
+        if(UTRACE){
+	  logmsgf(LT_LAMBDA,10,"S2MIR: Suppressed Loading MIR\n");
         }
-        pS[I].loc_ctr_nxt = pS[I].Iregister.Jump.Address;
-	if(pS[I].popj_after_nxt == 0){
-	  // PJAN is armed. We want this call to return to my caller instead of here.
-	  // So we'll pop this return address now.
-	  pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
-	  pS[I].popj_after_nxt = -1;
-	}
-        break;
-
-      case 3: // Jump-Call
-        // PUSH ADDRESS
-        pS[I].uPCS_ptr_reg++;  pS[I].uPCS_ptr_reg &= 0xFF;
-        pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw;
-        if(pS[I].microtrace){
-          char *location;
-          char symloc[100];
-          int offset;
-
-          logmsgf(LT_LAMBDA,10,"uStack[%o] = ",pS[I].uPCS_ptr_reg);
-
-          location = "";
-          offset = 0;
-          location = sym_find_last(1, pS[I].uPCS_stack[pS[I].uPCS_ptr_reg], &offset);
-	  if(location != 0){
-	    if(offset != 0){
-	      sprintf(symloc, "%s+%o", location, offset);
-	    }else{
-	      sprintf(symloc, "%s", location);
-	    }
-	    logmsgf(LT_LAMBDA,10,"%s",symloc);
+        if(pS[I].mirInvalid == 1 || pS[I].loc_ctr_reg.raw > 036000){
+	  pS[I].MIregister.raw = pS[I].Mbus;
+	  //pS[I].MIregister.raw &= 0xFFFF0000;
+	  //pS[I].MIregister.raw |= (pS[I].Mbus & 0xFFFF0000);
+	  pS[I].mirInvalid = 0;
+	  if(UTRACE){
+	    logmsgf(LT_LAMBDA,10,"S2MIR: mirInvalid override suppress of MIR\n");
+	    logmsgf(LT_LAMBDA,10,"MID: MIR = %o %o LC = %o\n",
+		   pS[I].MIregister.mi[0].raw,pS[I].MIregister.mi[1].raw,
+		   pS[I].LCregister.raw);
 	  }
-          logmsgf(LT_LAMBDA,10," (%o)\n",pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]);
         }
-        // Jump
-        pS[I].loc_ctr_reg.raw = pS[I].Iregister.Jump.Address;
-        pS[I].NOP_Next = 1;
-	if(pS[I].popj_after_nxt == 0){
-	  // PJAN is armed. We want this call to return to my caller instead of here.
-	  // So we'll pop this return address now.
-	  pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
-	  pS[I].popj_after_nxt = -1;
-	}
-        break;
-
-      case 4: // Jump-Return-XCT-Next
-	if(pS[I].popj_after_nxt != -1){
-	  // PJAN is armed. Do not double!
-	  logmsgf(LT_LAMBDA,0,"RETURN-XCT-NEXT with PJAN armed!\n");
-	  pS[I].cpu_die_rq=1;
-	}
-        // POP ADDRESS
-        pS[I].loc_ctr_nxt = pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]&0xFFFFF;
-        pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
-        break;
-
-      case 5: // Jump-Return
-	if(pS[I].popj_after_nxt != -1){
-	  // PJAN is armed. Do not double!
-	  // logmsgf(LT_LAMBDA,10,"RETURN with PJAN armed!\n");
-	  // pS[I].cpu_die_rq=1;
-	  // All we are doing is making the return immediate, so just disable PJAN.
-	  pS[I].popj_after_nxt = -1;
-	}
-        // POP ADDRESS
-        pS[I].loc_ctr_reg.raw = pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]&0xFFFFF;
-        pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
-        pS[I].NOP_Next = 1;
-        break;
-
-      default:
-	logmsgf(LT_LAMBDA,0,"Unknown jump RPN %o\n",pS[I].Iregister.Jump.RPN);
-	pS[I].cpu_die_rq=1;
       }
+#endif
     }
 
-    break;
-  case 3: // DISP-OP
-    {
-      // Dispatch items
-      uint32_t Mask=0;
-      uint32_t dispatch_source=0;
-      int gc_volatilty_flag;
-      int oldspace_flag;
-      int disp_address=0;
-      DispatchWord disp_word;
-
-      // Stop for investigation if...
-      // if(pS[I].Iregister.Dispatch.Constant > 0){ logmsgf(LT_LAMBDA,10,"Constant "); pS[I].cpu_die_rq = 1; }
-      // if(pS[I].Iregister.Dispatch.LPC > 0){ logmsgf(LT_LAMBDA,10,"LPC "); pS[I].cpu_die_rq = 1; }
-      // if(pS[I].Iregister.Dispatch.Write_VMA > 0){ logmsgf(LT_LAMBDA,10,"WriteVMA "); pS[I].cpu_die_rq = 1; }
-      // if(pS[I].Iregister.Dispatch.Enable_GC_Volatility_Meta > 0){ logmsgf(LT_LAMBDA,10,"EnableGCVMeta "); pS[I].cpu_die_rq = 1; }
-      // if(pS[I].Iregister.Dispatch.Enable_Oldspace_Meta > 0){ logmsgf(LT_LAMBDA,10,"EnableOldspaceMeta "); pS[I].cpu_die_rq = 1; }
-      if(pS[I].Iregister.Dispatch.Spare > 0){ logmsgf(LT_LAMBDA,0,"DISP-SPARE "); pS[I].cpu_die_rq = 1; }
-      // if(pS[I].popj_after_nxt != -1){ logmsgf(LT_LAMBDA,10,"DISPATCH with POPJ-AFTER-NEXT armed?\n"); pS[I].cpu_die_rq = 1; }
-
-      // Load VMA from M source
-      if(pS[I].Iregister.Dispatch.Write_VMA != 0){ pS[I].VMAregister.raw = pS[I].Mbus; }
-      
-      // Lambda doesn't have dispatch-source, so I assume it's always R-bus
-      Mask = (1 << pS[I].Iregister.Dispatch.Len) - 1;      
-      // Meta handling
-      if(pS[I].Iregister.Dispatch.Enable_GC_Volatility_Meta || pS[I].Iregister.Dispatch.Enable_Oldspace_Meta){
-	Mask = Mask & 0xfffffffe;	
-      }
-      // Investigation stop
-      if(pS[I].Iregister.Dispatch.Enable_GC_Volatility_Meta && pS[I].Iregister.Dispatch.Enable_Oldspace_Meta){
-	logmsgf(LT_LAMBDA,0,"DISPATCH: Enable GCV and Oldspace meta simultaneously?\n");
-	pS[I].cpu_die_rq=10;
+    // MIR-DISP
+    if(pS[I].Iregister.Macro_IR_Disp != 0){
+      if(UTRACE){
+        logmsgf(LT_LAMBDA,10,"MIR-DISP: Flag Set\n"); 
       }
-      if(pS[I].microtrace){
-	logmsgf(LT_LAMBDA,10,"DISPATCH: GENERATED MASK 0x%X\n",Mask);
-      }
-
-      // Lambda does not have a rotate direction flag.
-      dispatch_source = left_rotate(pS[I].Mbus, pS[I].Iregister.Dispatch.Pos) & Mask;
-
-      if(pS[I].microtrace){
-	logmsgf(LT_LAMBDA,10,"DISPATCH: dispatch_source = 0x%X\n",dispatch_source);
-      }
-
-      // More meta bits
-      gc_volatilty_flag = 0;
-      if(pS[I].Iregister.Dispatch.Enable_GC_Volatility_Meta != 0){
-	int present_gcv = 0;
-	// IDENTIFYING GC VOLATILITY BIT
-	// Bit 4?
-	// "MAP2C-4 IS REALLY FROM THE GC-WRITE-LOGIC, NOT DIRECTLY THE L2MAP, THESE DAYS."
-	// GCV happens when a NEWER object is written into an OLDER memory.
-
-	// Do a map resolve for what's in MD
-	pS[I].vm_lv2_index.raw = 0;
-	pS[I].vm_lv2_index.VPage_Offset = pS[I].MDregister.VM.VPage_Offset;
-	pS[I].vm_lv2_index.LV2_Block = pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].LV2_Block;
-	// Extract the present LV1 GC volatility
-	// present_gcv = pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB;
-	present_gcv = (~pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB) & 03;
-	// Raven's CACHED GCV is (lv2_control & 0x1800) >> 11;
-	// GCV FLAG is (cached_gcv + 4 > (map_1_volatility ^ 7)) ? 0 : 1;
-
-	// Our CACHED GCV is the lv2 meta bits of the last reference.
-	
-	// LV1 Meta Bits:
-	// 2 bits!
-	// "For hardware convenience, all three L1 map meta bits are stored in COMPLEMENTED form."
-	// S  H    What
-	// 0 (3) = Static Region (OLDEST)
-	// 1 (2) = Dynamic Region
-	// 2 (1) = Active Consing Region
-	// 3 (0) = Extra PDL Region (NEWEST)
-
-	// LV2 Meta Bits:
-	// 6 bits! But the bottom 2 bits are the same as the LV1 bits.
-	// 040 = Oldspace
-	// 020 = GCV-Flag
-	// 003 = LV1 GC Volatility
-
-	// So, if CACHED GCV is less than PRESENT GCV we wrote a newer item into an older page.
-	// The trap is taken if the flag is 0, so we want the inverse.
-	// What do I do if the MB validity bit isn't set?
-
-	// Meta bits are un-inverted now.
-	// gc_volatilty_flag 1 == don't trap
-	// So we want to set it 0 if we should trap.
-	// if(pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB_Valid != 0){ logmsgf(LT_LAMBDA,10,"GCV: LV1 invalid?\n"); pS[I].cpu_die_rq=1; } // Investigate
-	// if((pS[I].cached_gcv&03) <= present_gcv && pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB_Valid == 0){ gc_volatilty_flag = 1; }else{ pS[I].cpu_die_rq=0; } // ILLOP at PHTDEL6+11
-
-	// This comparison is correct for non-inverted meta.
-	// For the moment, LV1 invalidity forces a trap. This isn't conclusively proven correct, and may change.
-	// if((pS[I].cached_gcv&03) > present_gcv && pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB_Valid == 0){ gc_volatilty_flag = 1; }
-	if(pS[I].cached_gcv <= present_gcv && pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB_Valid == 0){
-	  gc_volatilty_flag = 1;
-	}
-
-	if(pS[I].microtrace){
-	  logmsgf(LT_LAMBDA,10,"DISPATCH: GCV: CACHED (LV2) GCV 0x%X\n",pS[I].cached_gcv&03);
-	  logmsgf(LT_LAMBDA,10,"DISPATCH: GCV: PRESENT (LV1) GCV 0x%X\n",present_gcv);
-	  logmsgf(LT_LAMBDA,10,"DISPATCH: GCV: LV1 ENT 0x%X = 0x%X (Meta 0x%X Validity %o)\n",
-		 pS[I].MDregister.VM.VPage_Block,pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].raw,
-		 pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB,
-		 pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].MB_Valid);
-	  logmsgf(LT_LAMBDA,10,"DISPATCH: GCV: LV2 ENT 0x%X = 0x%X (Meta 0x%X)\n",
-		 pS[I].vm_lv2_index.raw,pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].raw,
-		 pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Meta);
-	}
-      }
-      oldspace_flag = 0;
-      if(pS[I].Iregister.Dispatch.Enable_Oldspace_Meta != 0){
-	// Do a map resolve for what's in MD
-	pS[I].vm_lv2_index.raw = 0;
-	pS[I].vm_lv2_index.VPage_Offset = pS[I].MDregister.VM.VPage_Offset;
-	pS[I].vm_lv2_index.LV2_Block = pS[I].vm_lv1_map[pS[I].MDregister.VM.VPage_Block].LV2_Block;
-	// Extract the oldspace bit (5?)
-	// oldspace_flag 0 means trap (oldspace)
-	// oldspace_flag 1 means don't trap (newspace)
-	// Reversing this causes infinite loop (GCV never tested), so this has to be right.
-	if((pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Meta&0x20) == 0x20){ oldspace_flag = 1; } // Not oldspace, don't trap
-	if(pS[I].microtrace){
-	  logmsgf(LT_LAMBDA,10,"DISPATCH: META: LV2 ENT 0x%X = 0x%X (Meta 0x%X)\n",
-		 pS[I].vm_lv2_index.raw,pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].raw,
-		 pS[I].vm_lv2_ctl[pS[I].vm_lv2_index.raw].Meta);
-	}
-      }
-      // Set dispatch address
-      // Lambda uses the A source as the dispatch address!
-      // disp_address = (mir_mask & MInst_Disp_Address) | dispatch_source | gc_volatilty_flag | oldspace_flag;
-      disp_address = pS[I].Iregister.ASource|dispatch_source;
-      // Handle oldspace/GCV meta
-      if(pS[I].Iregister.Dispatch.Enable_Oldspace_Meta != 0 || pS[I].Iregister.Dispatch.Enable_GC_Volatility_Meta){
-	// I think this is how this is supposed to work
-	disp_address |= (oldspace_flag|gc_volatilty_flag);
-      }
-      // Load dispatch constant register
-      pS[I].disp_constant_reg = pS[I].Iregister.Dispatch.Constant;
-      // Lambda has no dispatch opcode field, so I assume it is always DISPATCH
-      disp_word.raw = pS[I].Amemory[(disp_address)]; // A-source is already offset // Dmemory[disp_address];
-      if(pS[I].microtrace){
-	logmsgf(LT_LAMBDA,10,"DISPATCH: GENERATED ADDRESS 0x%X AND FETCHED WORD 0x%X\n",disp_address,disp_word.raw);
-      }
-      // Handle dispatch word
-      if(pS[I].microtrace){
-	char *location;
-	char symloc[100];
-	int offset;
-
-	logmsgf(LT_LAMBDA,10,"DISPATCH: OP %s DEST ",jump_op_str[disp_word.Operation]);
-	location = "";
-	offset = 0;
-	location = sym_find_last(1, disp_word.PC, &offset);
-	if(location != 0){
-	  if(offset != 0){
-	    sprintf(symloc, "%s+%o", location, offset);
-	  }else{
-	    sprintf(symloc, "%s", location);
-	  }
-	  logmsgf(LT_LAMBDA,10,"%s",symloc);
-	}
-	logmsgf(LT_LAMBDA,10," (%o)\n",disp_word.PC);
-      }
-      // Handle operation of Start-Memory-Read
-      if(disp_word.StartRead){
-	if(pS[I].microtrace != 0){
-	  logmsgf(LT_LAMBDA,10," START-MEMORY-READ");
-	}
-	// Load VMA from pS[I].Obus and initiate a read.
-	pS[I].VMAregister.raw = pS[I].Mbus; // Load VMA
-	VM_resolve_address(I,VM_READ,0);
-	if(pS[I].Page_Fault == 0 && pS[I].ConReg.Enable_NU_Master == 1){
-	  // Do it
-	  if(pS[I].RG_Mode.Aux_Stat_Count_Control == 01){
-	    pS[I].stat_counter_aux++;
-	  }
-	  if(pS[I].RG_Mode.Main_Stat_Count_Control == 01){
-	    pS[I].stat_counter_main++;
-	  }
-	  nubus_io_request(VM_READ,pS[I].NUbus_ID,pS[I].vm_phys_addr.raw,0);
-	}
-      }
-      // Handle operation
-      switch(disp_word.Operation){
-      case 0: // Jump-Branch-Xct-Next
-        // Jump, but DO NOT inhibit the next instruction!
-	if(pS[I].loc_ctr_nxt != -1){
-	  logmsgf(LT_LAMBDA,0,"DISPATCH: Pending JUMP-After-Next collision investigation stop\n");
-	  pS[I].cpu_die_rq = 1;
-	}
-        pS[I].loc_ctr_nxt = disp_word.PC;
-        break;
-	
-      case 1: // Jump-Branch
-	if(pS[I].loc_ctr_reg.raw != (pS[I].loc_ctr_cnt + 1)){
-	  logmsgf(LT_LAMBDA,0,"DISPATCH: Pending JUMP collision investigation stop\n");
-	  pS[I].cpu_die_rq = 1;
-	}
-        pS[I].loc_ctr_reg.raw = disp_word.PC;
-        pS[I].NOP_Next = 1;
-        break;
-
-      case 2: // Jump-Call-Xct-Next
-        // Call, but DO NOT inhibit the next instruction!
-        if(pS[I].popj_after_nxt != -1){
-          // PJAN is armed. Do not double!
-          pS[I].popj_after_nxt = -1;
-        }
-        pS[I].uPCS_ptr_reg++; pS[I].uPCS_ptr_reg &= 0xFF;
-	// Raven does not handle this, but should we? (Should Raven?)
-	if(pS[I].Iregister.Dispatch.LPC){
-	  logmsgf(LT_LAMBDA,0,"DISPATCH: LPC set w/ call-xct-next?\n");
-	  pS[I].cpu_die_rq = 1;
-	}
-	pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw+1; // Pushes the address of the next instruction	
-        if(pS[I].microtrace){
-          char *location;
-          char symloc[100];
-          int offset;
-
-          logmsgf(LT_LAMBDA,10,"uStack[%o] = ",pS[I].uPCS_ptr_reg);
-
-          location = "";
-          offset = 0;
-          location = sym_find_last(1, pS[I].uPCS_stack[pS[I].uPCS_ptr_reg], &offset);
-	  if(location != 0){
-	    if(offset != 0){
-	      sprintf(symloc, "%s+%o", location, offset);
-	    }else{
-	      sprintf(symloc, "%s", location);
-	    }
-	    logmsgf(LT_LAMBDA,10,"%s",symloc);
-	  }
-          logmsgf(LT_LAMBDA,10," (%o)\n",pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]);
-        }
-        pS[I].loc_ctr_nxt = disp_word.PC;
-        if(pS[I].popj_after_nxt == 0){
-          // PJAN is armed. We want this call to return to my caller instead of here.
-          // So we'll pop this return address now.
-          pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
-          pS[I].popj_after_nxt = -1;
-        }
-        break;
-
-      case 3: // Jump-Call
-        // PUSH ADDRESS
-        if(pS[I].popj_after_nxt != -1){
-          // PJAN is armed. Do not double!
-          //logmsgf(LT_LAMBDA,10,"RETURN-XCT-NEXT with PJAN armed!\n");
-          pS[I].popj_after_nxt = -1;
-        }
-        pS[I].uPCS_ptr_reg++;  pS[I].uPCS_ptr_reg &= 0xFF;
-	if(pS[I].Iregister.Dispatch.LPC){
-	  pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_cnt; // Stack-Own-Address
-	}else{
-	  pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw;
-	}
-        if(pS[I].microtrace){
-          char *location;
-          char symloc[100];
-          int offset;
-
-          logmsgf(LT_LAMBDA,10,"uStack[%o] = ",pS[I].uPCS_ptr_reg);
-
-          location = "";
-          offset = 0;
-          location = sym_find_last(1, pS[I].uPCS_stack[pS[I].uPCS_ptr_reg], &offset);
-	  if(location != 0){
-	    if(offset != 0){
-	      sprintf(symloc, "%s+%o", location, offset);
-	    }else{
-	      sprintf(symloc, "%s", location);
-	    }	  
-	    logmsgf(LT_LAMBDA,10,"%s",symloc);
-	  }
-          logmsgf(LT_LAMBDA,10," (%o)\n",pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]);
-        }
-        // Jump
-        pS[I].loc_ctr_reg.raw = disp_word.PC;
-        pS[I].NOP_Next = 1;
-        if(pS[I].popj_after_nxt == 0){
-          // PJAN is armed. We want this call to return to my caller instead of here.
-          // So we'll pop this return address now.
-          pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
-          pS[I].popj_after_nxt = -1;
-        }
-        break;
-
-      case 4: // Jump-Return-XCT-Next
-        // POP ADDRESS
-        pS[I].loc_ctr_nxt = pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]&0xFFFFF;
-        pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
-        break;
-
-	// Used in d-swap-quantum-map-dispatch, should return
-      case 5: // Jump-Return
-        // POP ADDRESS
-        pS[I].loc_ctr_reg.raw = pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]&0xFFFFF;
-        pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
-        pS[I].NOP_Next = 1;
-        break;
-
-      case 6: // Undefined-NOP
-	/*
-        // PUSH ADDRESS
-        pS[I].uPCS_ptr_reg++;  pS[I].uPCS_ptr_reg &= 0xFF;
-	pS[I].uPCS_stack[pS[I].uPCS_ptr_reg] = pS[I].loc_ctr_reg.raw;
-        // POP ADDRESS
-        pS[I].loc_ctr_nxt = pS[I].uPCS_stack[pS[I].uPCS_ptr_reg]&0xFFFFF;
-        pS[I].uPCS_ptr_reg--;  pS[I].uPCS_ptr_reg &= 0xFF;
-	*/
-	break;
-
-      case 7: // Undefined-NOP (Raven SKIP)
-	pS[I].loc_ctr_reg.raw++;
-        pS[I].NOP_Next = 1;
-        break;
-
-      default:
-	logmsgf(LT_LAMBDA,0,"Unknown dispatch RPN %o\n",disp_word.Operation);
-	pS[I].cpu_die_rq=1;
-      }
-    }    
-    break;
+      pS[I].macro_dispatch_inst = 1; // Next instruction will be a macro dispatch
+    }
   }
 
+  // Execute opcode
+  pS[I].Idecode.handler[variant](I);
+
   // Done with instruction
   if(pS[I].NOP_Next != 0){
     pS[I].ConReg.nop_next = 0;
@@ -4830,7 +5315,7 @@ void lambda_clockpulse(int I){
 
   // If we are doing a single step, stop
   if(pS[I].ConReg.Enable_SM_Clock != 1 || pS[I].PMR.Advance_UInst_Request == 1){
-    if(pS[I].microtrace){
+    if(UTRACE){
       logmsgf(LT_LAMBDA,10,"LAMBDA %d: Single Step completed\n",I);
     }
     pS[I].cpu_die_rq=1;
@@ -4840,7 +5325,7 @@ void lambda_clockpulse(int I){
 
   // Debug stuff
 #ifdef LAMBDA_DEBUGTRACE
-  if(!pS[I].microtrace){
+  if(!UTRACE){
     debugtrace_ir[I][debugtrace_ptr[I]] = pS[I].Iregister.raw;
     debugtrace_reg[I][debugtrace_ptr[I]][0] = pS[I].loc_ctr_cnt;
     debugtrace_reg[I][debugtrace_ptr[I]][1] = pS[I].loc_ctr_reg.raw;
@@ -4858,7 +5343,10 @@ void lambda_clockpulse(int I){
   }
 #endif
 
-  if(pS[I].microtrace || pS[I].Iregister.Halt || pS[I].cpu_die_rq){
+#ifndef LAMBDA_DEBUGTRACE
+ ublock_done:
+#endif
+  if(UTRACE || pS[I].Iregister.Halt || pS[I].cpu_die_rq){
     debug_disassemble_IR(I);
   }
 
@@ -4873,8 +5361,8 @@ void lambda_clockpulse(int I){
   // Enable microtracing
   /*
   if(pS[I].loc_ctr_reg.raw == 036521){
-    pS[I].microtrace = true;
-    NUbus_trace = 1;
+    UTRACE = true;
+    NTRACE = 1;
   }
   */
 
@@ -4890,7 +5378,7 @@ void lambda_clockpulse(int I){
     //disassemble_IR();
     //disassemble_MIR();
 #ifdef LAMBDA_DEBUGTRACE
-    if(!pS[I].microtrace && pS[I].loc_ctr_reg.raw != 036004){
+    if(!UTRACE && pS[I].loc_ctr_reg.raw != 036004){
       int x=debugtrace_ptr[I];
       logmsgf(LT_LAMBDA,1,"Writing debug log...\n");
       write_debugtrace_ent(I,x);
@@ -4906,3 +5394,53 @@ void lambda_clockpulse(int I){
 #endif
   }
 }
+
+// Select the core variant. The instrumented core runs while any trace flag
+// is on, so turning tracing on or off takes effect on the next cycle.
+void lambda_clockpulse(int I){
+  // Parked by the idle detector?
+  if(pS[I].idle_park > 0){
+    if(pS[I].InterruptPending == 0 && pS[I].cpu_die_rq == 0 &&
+       !(NUbus_Busy > 0 && NUbus_master != pS[I].NUbus_ID &&
+	 ((NUbus_Request&0x01) != 0 || NUbus_Address.Card == pS[I].NUbus_ID))){
+      pS[I].idle_park--;
+      pS[I].cycle_count++;
+      pS[I].idle_count++;
+      if(pS[I].idle_park == 0){
+	idle_parked = (pS[I^1].idle_park != 0);
+      }
+      return;
+    }
+    // Wake up
+    pS[I].idle_park = 0;
+    pS[I].idle_stable = 0;
+    idle_parked = (pS[I^1].idle_park != 0);
+  }
+  if(pS[I].microtrace || pS[I].macrotrace || NUbus_trace){
+    lambda_clockpulse_core(I,true,LAMBDA_TRACE);
+  }else if(I == 0){
+    lambda_clockpulse_core(0,false,LAMBDA_LEAN0);
+  }else{
+    lambda_clockpulse_core(1,false,LAMBDA_LEAN1);
+  }
+}
+
+// Snapshot support
+void lambda_snapshot(int op){
+  int I = 0;
+  SNAP_ITEM(pS);
+#ifdef SHADOW
+  SNAP_ITEM(ShadowMemory);
+  SNAP_ITEM(ShadowMemoryPageMap);
+#endif
+  if(op != SNAP_LOAD){ return; }
+  // The host-side caches are not saved, and what they hold is for the old state.
+  // The decoded IR holds host function pointers, which are only good for this run.
+  while(I < 2){
+    lambda_invalidate_wcs(I,-1);
+    decode_ireg(I);
+    bzero((uint8_t *)pC[I].vm_tlb,sizeof(pC[I].vm_tlb));
+    I++;
+  }
+  idle_parked = (pS[0].idle_park != 0 || pS[1].idle_park != 0);
+}
@@ -303,6 +303,106 @@ typedef union ShadowMemoryPageEnt {
   } __attribute__((packed));
 } ShadowMemoryPageEnt;
 
+/* Predecoded microinstruction */
+// The fields of a microinstruction the interpreter uses, unpacked from the
+// instruction's bitfields into plain integers, and a summary of the
+// rarely-set bits, so the interpreter can skip the checks for them with a
+// single test. Field names follow UInst; every half is decoded whatever
+// the opcode.
+#define UD_CMSB   0x01 // Clobbers-Mem-Subr bit
+#define UD_MD_SRC 0x02 // M source is MD, may stall on the bus
+#define UD_MSA    0x04 // Macro-Stream-Advance
+#define UD_SEQ    0x08 // Stat, PopJ-After-Next, Slow-Dest or ILong
+#define UD_MIR    0x10 // Src-To-Macro-IR or Macro-IR-Disp
+#define UD_HALT   0x20 // Halt bit
+#define UD_SPARE  0x40 // Misc, spare or LC-increment bits of the opcode's half
+
+#define LAMBDA_TRACE 0          // Instrumented core
+#define LAMBDA_LEAN0 1          // Lean core for processor 0
+#define LAMBDA_LEAN1 2          // Lean core for processor 1
+#define LAMBDA_VARIANTS 3
+
+typedef struct rDecodedUInst {
+  void (*handler[LAMBDA_VARIANTS])(int I); // Opcode handler for each core variant
+  struct {
+    uint32_t Address;
+    uint8_t  Cond;
+    uint8_t  Test;
+    uint8_t  Invert;
+    uint8_t  RPN;
+  } Jump;
+  struct {
+    uint16_t Constant;
+    uint8_t  Pos;
+    uint8_t  Len;
+    uint8_t  LPC;
+    uint8_t  Write_VMA;
+    uint8_t  Enable_GC_Volatility_Meta;
+    uint8_t  Enable_Oldspace_Meta;
+  } Dispatch;
+  struct {
+    struct {
+      uint16_t Addr;
+      uint8_t  Flag;
+    } A;
+    struct {
+      uint8_t  Addr;
+    } M;
+    struct {
+      uint8_t  Dest;
+    } F;
+  } Destination;
+  uint16_t ASource;
+  uint8_t  MSource;
+  uint8_t  Opcode;
+  struct {
+    uint8_t  Operation;
+    uint8_t  Output;
+    uint8_t  QControl;
+    uint8_t  Carry;
+    uint8_t  Mask;
+  } ALU;
+  struct {
+    uint8_t  Pos;
+    uint8_t  Len;
+    uint8_t  Rotate_Source;
+    uint8_t  Rotate_Mask;
+  } Byte;
+  uint8_t flags;                // UD_* flags
+  bool valid;                   // Entry is current with WCS
+} DecodedUInst;
+
+/* Straight-line microcode block */
+// A run of ALU and BYTE instructions that touch nothing outside the processor,
+// executed back to back with the remaining cycles retired afterwards.
+#define UBLOCK_MAX 32
+#define UBLOCK_CACHE 4096
+
+typedef struct rUBlock {
+  uint32_t generation;          // Block generation this entry was built in
+  uint16_t start;               // Virtual address of the first instruction
+  uint8_t  len;                 // Instruction count, 0 if no block starts here
+  uint16_t paddr[UBLOCK_MAX];   // Physical WCS address of each instruction
+  void (*handler[UBLOCK_MAX])(int I); // Opcode handler of each instruction
+} UBlock;
+
+/* Translation cache entry */
+// Remembers the outcome of VM_resolve_address for a virtual page and access kind.
+// An entry is stale once the LV1 or LV2 map entry it was built from is rewritten.
+#define VM_TLB_SIZE 4096
+
+typedef struct rVMTLBEnt {
+  uint32_t key;                 // Virtual page, write flag, force flag
+  uint32_t lv1_gen;             // vm_lv1_gen of the LV1 entry at fill time
+  uint32_t lv2_gen;             // vm_lv2_gen of the LV2 entry at fill time
+  PhysAddr phys_addr;           // Resulting PPN and byte, offset comes from the VMA
+  uint16_t lv2_index;           // Resulting LV2 index
+  uint8_t  byte_mode;           // Resulting vm_byte_mode
+  uint8_t  gcv;                 // Resulting cached GCV
+  bool     fault;               // Page fault
+  bool     valid;               // Entry in use
+} VMTLBEnt;
+
 /* Processor State Structure */
 struct lambdaState {
   /* Buses */
@@ -315,6 +415,7 @@ struct lambdaState {
   int cpu_die_rq;
   // Memories
   UInst WCS[64*1024];          // Writable Control Store (16KW on Raven)
+  uint32_t ublock_cycles;       // Cycles left to retire for the last block
   uint32_t Amemory[1024*4];    // A-memory (1KW on Raven)
   uint32_t Mmemory[1024*4];    // M-memory and PDLmemory (see DP_Mode)
   uint32_t MIDmemory[1024*4];  // Macro-Instruction-Dispatch-memory
@@ -373,6 +474,7 @@ struct lambdaState {
   Q        VMAregister;               // Virtual Memory Address
   Q        LCregister;                // Macro Location Counter register
   UInst    Iregister;                 // 56b Instruction register
+  DecodedUInst Idecode;               // Predecode of the instruction register
   uint32_t Qregister;                 // Q register
   uint32_t uPCS_stack[255];           // Microcode counter stack memory
   int64_t  ALU_Result;                // Result of ALU operation
@@ -408,12 +510,41 @@ struct lambdaState {
   // Performance monitoring
   volatile unsigned long cycle_count;
   volatile unsigned long stall_count;
+
+  // Idle detection
+  int idle_stable;                  // Checks in a row with an unchanged set of micro-PCs
+  uint32_t idle_park;               // Cycles left parked, 0 if not parked
+  volatile unsigned long idle_count; // Cycles spent parked
+  // Fast memory
+  uint8_t mem_wait;                 // Cycles left until a fast memory cycle completes
+  bool mem_wait_read;               // It was a read
+  uint32_t mem_wait_data;           // Data it read
+};
+
+/* Host-side caches */
+// Derived from the processor state and rebuilt from it when it changes,
+// so they are kept apart from lambdaState and out of snapshots.
+struct lambdaCache {
+  DecodedUInst WCS_decode[64*1024]; // Predecoded WCS, rebuilt on fetch after a write
+  UBlock ublock[UBLOCK_CACHE];  // Straight-line block cache, indexed by start address
+  uint32_t ublock_generation;   // Bumped to discard all blocks
+  VMTLBEnt vm_tlb[VM_TLB_SIZE]; // VM translation cache
+  uint32_t vm_lv1_gen[4096];    // LV1 map write generations, for the translation cache
+  uint32_t vm_lv2_gen[4096];    // LV2 map write generations, for the translation cache
 };
 
 /* Functions */
 
 void lambda_initialize(int I,int ID);
 void lambda_clockpulse(int I);
+void lambda_nubus_slave(int I);
+void lambda_invalidate_wcs(int I,int addr);
+void lambda_flush_blocks(int I);
+void lambda_idle_check(int I);
+void lambda_idle_wake();
+extern int idle_parked;
+// Writes to processor memory that don't use the bus call this, as they may be what a parked processor waits for
+#define IDLE_WAKE() do{ if(idle_parked != 0){ lambda_idle_wake(); } }while(0)
 void shadow_write(uint32_t addr,Q data);
 Q shadow_read(uint32_t addr);
 
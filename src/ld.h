@@ -35,6 +35,7 @@ void framebuffer_update_word(int vn,uint32_t addr,uint32_t data);
 void framebuffer_update_hword(int vn,uint32_t addr,uint16_t data);
 void framebuffer_update_byte(int vn,uint32_t addr,uint8_t data);
 void set_bow_mode(int vn,int mode);
+void framebuffer_redraw();
 
 #ifdef SDL2
 // xbeep
@@ -53,10 +54,15 @@ uint32_t ether_rx_pkt();
 void warp_mouse_callback(int cp);
 
 // Logging stuff
-int logmsgf(int type, int level, const char *format, ...);
+// logmsgf() checks the level first, so the arguments of a message that is
+// turned off are never evaluated. Unknown types are always logged.
+extern uint8_t loglevel[];
+int logmsgf_out(int type, int level, const char *format, ...);
+#define logmsgf(type,level,...)						\
+  (((unsigned int)(type) >= MAX_LOGTYPE || loglevel[(type)] >= (level)) ? logmsgf_out((type),(level),__VA_ARGS__) : 0)
 
 // Type numbers
-// Make sure these stay in sync with the array logtype_name in kernel.c
+// Make sure these stay in sync with the array logtype_name in log.c
 // I can't initialize that here because gcc whines about it (sigh)
 #define LT_SYSTEM 0
 #define LT_SDU 1
@@ -0,0 +1,325 @@
+/* Copyright 2016-2017
+   Daniel Seagraves <dseagrav@lunar-tokyo.net>
+
+   This file is part of LambdaDelta.
+
+   LambdaDelta is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   LambdaDelta is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LambdaDelta.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Log output
+
+   logmsgf() is a macro in ld.h that checks the level before anything else
+   happens, so disabled messages cost a compare. Enabled messages come here.
+   Normally they are printed at once. In async mode they go into a ring that
+   a writer thread empties, so the emulator never waits on the terminal.
+   Any thread may log; slots are claimed with a compare-and-swap on the head
+   and handed over with a sequence number, so nothing takes a lock. If the
+   ring fills, the logging thread yields until the writer makes room; no
+   messages are dropped.
+
+   In binary mode the ring holds the format string pointer and the raw
+   arguments instead of text, and the writer stores them as records that
+   tools/logdecode turns back into text. Formatting then happens offline. */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "ld.h"
+#include "log.h"
+
+// Levels and names
+uint8_t loglevel[MAX_LOGTYPE];
+// Make sure this stays in sync with the #defines in ld.h, or you're gonna have a bad time
+const char *logtype_name[] = { "SYSTEM",
+			       "SDU",
+			       "LAMBDA",
+			       "NUBUS",
+			       "MULTIBUS",
+			       "RTC",
+			       "VCMEM",
+			       "3COM",
+			       "SMD",
+			       "TAPEMASTER",
+			       "MEM",
+			       "LISP" };
+
+// Configuration
+int log_async = 0;
+char log_binary_fn[128] = "";
+
+// The ring
+#define LOG_RING_SIZE 4096 // Must be a power of two
+typedef struct rLogSlot {
+  uint64_t seq;                   // Slot is full when this is its position+1
+  LogRecord rec;
+  const char *format;
+  uint64_t arg[LOG_MAX_ARGS];
+  char text[LOG_TEXT_MAX];        // Message text, or string data in binary mode
+} LogSlot;
+
+static LogSlot *log_ring = NULL;
+static uint64_t log_head = 0;     // Next position to claim
+static uint64_t log_tail = 0;     // Next position the writer takes
+static volatile int log_running = 0;
+static int log_stopping = 0;
+static pthread_t log_thread;
+static FILE *log_bin = NULL;
+static struct timespec log_epoch;
+static unsigned long log_waits = 0; // Times a producer found the ring full
+
+// Format strings the writer has given numbers to, binary mode only.
+// A hash of the string's address; formats are string constants.
+#define LOG_FORMATS 4096 // Must be a power of two
+static struct {
+  const char *ptr;
+  uint32_t id;
+} log_format_hash[LOG_FORMATS*2];
+static uint32_t log_format_count = 0;
+
+static uint64_t log_now(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return(((uint64_t)(ts.tv_sec-log_epoch.tv_sec)*1000000000ULL)+ts.tv_nsec-log_epoch.tv_nsec);
+}
+
+// Capture the arguments of a message in binary mode
+static void log_capture(LogSlot *slot,const char *format,va_list args){
+  const char *p = format;
+  const char *spec;
+  int cls,stars;
+  int n = 0;
+  int strings = 0;
+  while((p = log_next_conv(p,&spec,&cls,&stars)) != NULL && n < LOG_MAX_ARGS){
+    while(stars > 0 && n < LOG_MAX_ARGS){
+      slot->arg[n++] = (int64_t)va_arg(args,int);
+      stars--;
+    }
+    if(n == LOG_MAX_ARGS){ break; }
+    switch(cls){
+    case LOG_ARG_NONE:
+      break;
+    case LOG_ARG_INT:
+      slot->arg[n++] = (int64_t)va_arg(args,int);
+      break;
+    case LOG_ARG_LONG:
+      slot->arg[n++] = (int64_t)va_arg(args,long);
+      break;
+    case LOG_ARG_LLONG:
+      slot->arg[n++] = (int64_t)va_arg(args,long long);
+      break;
+    case LOG_ARG_SIZE:
+      slot->arg[n++] = (uint64_t)va_arg(args,size_t);
+      break;
+    case LOG_ARG_DOUBLE:
+      {
+	double d = va_arg(args,double);
+	memcpy(&slot->arg[n++],&d,8);
+      }
+      break;
+    case LOG_ARG_STRING:
+      {
+	const char *s = va_arg(args,const char *);
+	int len = (s != NULL ? strlen(s) : 0);
+	if(len > LOG_TEXT_MAX-1-strings){ len = LOG_TEXT_MAX-1-strings; }
+	slot->arg[n++] = strings;
+	if(len > 0){ memcpy(slot->text+strings,s,len); }
+	strings += len;
+	slot->text[strings++] = 0;
+      }
+      break;
+    case LOG_ARG_POINTER:
+      slot->arg[n++] = (uintptr_t)va_arg(args,void *);
+      break;
+    }
+  }
+  slot->rec.args = n;
+  slot->rec.length = (n*8)+strings;
+}
+
+int logmsgf_out(int type, int level, const char *format, ...){
+  va_list args;
+  int rv = 0;
+  uint64_t pos;
+  LogSlot *slot;
+  if(log_running == 0){
+    va_start(args, format);
+    rv = vprintf(format, args);
+    va_end(args);
+    return(rv);
+  }
+  // Claim a slot
+  pos = __atomic_load_n(&log_head,__ATOMIC_RELAXED);
+  while(1){
+    uint64_t seq;
+    slot = &log_ring[pos&(LOG_RING_SIZE-1)];
+    seq = __atomic_load_n(&slot->seq,__ATOMIC_ACQUIRE);
+    if(seq == pos){
+      if(__atomic_compare_exchange_n(&log_head,&pos,pos+1,0,__ATOMIC_RELAXED,__ATOMIC_RELAXED)){
+	break;
+      }
+    }else if((int64_t)(seq-pos) < 0){
+      // Full, wait for the writer
+      __atomic_add_fetch(&log_waits,1,__ATOMIC_RELAXED);
+      sched_yield();
+      pos = __atomic_load_n(&log_head,__ATOMIC_RELAXED);
+    }else{
+      pos = __atomic_load_n(&log_head,__ATOMIC_RELAXED);
+    }
+  }
+  // Fill it
+  slot->rec.kind = LOG_REC_MESSAGE;
+  slot->rec.type = type;
+  slot->rec.level = level;
+  slot->format = format;
+  va_start(args, format);
+  if(log_bin != NULL){
+    slot->rec.time = log_now();
+    log_capture(slot,format,args);
+  }else{
+    rv = vsnprintf(slot->text,LOG_TEXT_MAX,format,args);
+  }
+  va_end(args);
+  // Hand it over
+  __atomic_store_n(&slot->seq,pos+1,__ATOMIC_RELEASE);
+  return(rv);
+}
+
+// Writer side, binary mode
+static uint32_t log_format_id(const char *format){
+  uint32_t x = ((uintptr_t)format>>3)&((LOG_FORMATS*2)-1);
+  LogRecord rec;
+  while(log_format_hash[x].ptr != NULL){
+    if(log_format_hash[x].ptr == format){
+      return(log_format_hash[x].id);
+    }
+    x = (x+1)&((LOG_FORMATS*2)-1);
+  }
+  if(log_format_count == LOG_FORMATS){
+    // Out of room. Starting over is safe, the decoder keeps the last text given a number.
+    bzero(log_format_hash,sizeof(log_format_hash));
+    log_format_count = 0;
+    x = ((uintptr_t)format>>3)&((LOG_FORMATS*2)-1);
+  }
+  log_format_hash[x].ptr = format;
+  log_format_hash[x].id = log_format_count;
+  bzero(&rec,sizeof(rec));
+  rec.kind = LOG_REC_FORMAT;
+  rec.format = log_format_count;
+  rec.length = strlen(format)+1;
+  fwrite(&rec,sizeof(rec),1,log_bin);
+  fwrite(format,rec.length,1,log_bin);
+  return(log_format_count++);
+}
+
+static void log_write_slot(LogSlot *slot){
+  if(log_bin == NULL){
+    fputs(slot->text,stdout);
+    return;
+  }
+  slot->rec.format = log_format_id(slot->format);
+  fwrite(&slot->rec,sizeof(LogRecord),1,log_bin);
+  fwrite(slot->arg,8,slot->rec.args,log_bin);
+  fwrite(slot->text,slot->rec.length-(slot->rec.args*8),1,log_bin);
+}
+
+static void *log_writer(void *arg __attribute__ ((unused))){
+  struct timespec idle = { 0, 1000000 }; // 1ms
+  while(1){
+    LogSlot *slot = &log_ring[log_tail&(LOG_RING_SIZE-1)];
+    if(__atomic_load_n(&slot->seq,__ATOMIC_ACQUIRE) == log_tail+1){
+      log_write_slot(slot);
+      __atomic_store_n(&slot->seq,log_tail+LOG_RING_SIZE,__ATOMIC_RELEASE);
+      log_tail++;
+      continue;
+    }
+    // Empty
+    fflush(log_bin != NULL ? log_bin : stdout);
+    if(__atomic_load_n(&log_stopping,__ATOMIC_ACQUIRE) != 0){ break; }
+    nanosleep(&idle,NULL);
+  }
+  return(NULL);
+}
+
+// Start async logging, if it's configured
+int log_start(){
+  uint64_t x = 0;
+  if(log_binary_fn[0] != 0){
+    log_async = 1;
+  }
+  if(log_async == 0){ return(0); }
+  log_ring = calloc(LOG_RING_SIZE,sizeof(LogSlot));
+  if(log_ring == NULL){
+    printf("log: Unable to allocate log ring\n");
+    return(-1);
+  }
+  while(x < LOG_RING_SIZE){
+    log_ring[x].seq = x;
+    x++;
+  }
+  clock_gettime(CLOCK_MONOTONIC,&log_epoch);
+  if(log_binary_fn[0] != 0){
+    LogRecord rec;
+    log_bin = fopen(log_binary_fn,"wb");
+    if(log_bin == NULL){
+      printf("log: Unable to open %s: %s\n",log_binary_fn,strerror(errno));
+      return(-1);
+    }
+    fwrite(LOG_MAGIC,8,1,log_bin);
+    // Name the types, so the decoder doesn't need to know them
+    x = 0;
+    while(x < MAX_LOGTYPE){
+      bzero(&rec,sizeof(rec));
+      rec.kind = LOG_REC_TYPE;
+      rec.type = x;
+      rec.length = strlen(logtype_name[x])+1;
+      fwrite(&rec,sizeof(rec),1,log_bin);
+      fwrite(logtype_name[x],rec.length,1,log_bin);
+      x++;
+    }
+    printf("Logging to %s\n",log_binary_fn);
+  }
+  if(pthread_create(&log_thread,NULL,log_writer,NULL) != 0){
+    printf("log: Unable to start writer thread\n");
+    return(-1);
+  }
+  log_running = 1;
+  atexit(log_stop);
+  return(0);
+}
+
+// Drain the ring and go back to printing directly
+void log_stop(){
+  if(log_running == 0){ return; }
+  // Anything logged from here on is printed directly
+  log_running = 0;
+  __atomic_store_n(&log_stopping,1,__ATOMIC_RELEASE);
+  pthread_join(log_thread,NULL);
+  if(log_bin != NULL){
+    fclose(log_bin);
+    log_bin = NULL;
+  }
+  if(log_waits > 0){
+    printf("log: Ring was full %lu times\n",log_waits);
+  }
+}
@@ -0,0 +1,110 @@
+/* Copyright 2016-2017
+   Daniel Seagraves <dseagrav@lunar-tokyo.net>
+
+   This file is part of LambdaDelta.
+
+   LambdaDelta is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   LambdaDelta is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LambdaDelta.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Log output */
+
+// Binary log file format. The file starts with LOG_MAGIC, then records.
+// Each record is a LogRecord followed by 'length' bytes:
+//  LOG_REC_TYPE:    the name of log type 'type' (NUL included)
+//  LOG_REC_FORMAT:  the text of format string 'format' (NUL included)
+//  LOG_REC_MESSAGE: 'args' 64-bit arguments for format 'format', then the
+//                   string data; a %s argument is an offset into it.
+#define LOG_MAGIC "LDLOG001"
+#define LOG_REC_TYPE 1
+#define LOG_REC_FORMAT 2
+#define LOG_REC_MESSAGE 3
+#define LOG_MAX_ARGS 16
+#define LOG_TEXT_MAX 256 // Text of one message, or string data of one record
+
+typedef struct rLogRecord {
+  uint8_t kind;     // LOG_REC_xxx
+  uint8_t type;     // Log type
+  uint8_t level;    // Log level
+  uint8_t args;     // Arguments in a message
+  uint32_t format;  // Format string number
+  uint32_t length;  // Bytes that follow
+  uint32_t spare;
+  uint64_t time;    // Nanoseconds since logging started
+} __attribute__((packed)) LogRecord;
+
+// Argument classes of printf conversions
+#define LOG_ARG_NONE 0    // %%, takes no argument
+#define LOG_ARG_INT 1     // int and smaller, and char
+#define LOG_ARG_LONG 2
+#define LOG_ARG_LLONG 3
+#define LOG_ARG_SIZE 4    // size_t, ptrdiff_t, intmax_t
+#define LOG_ARG_DOUBLE 5
+#define LOG_ARG_STRING 6
+#define LOG_ARG_POINTER 7
+
+// Find the next conversion in a printf format. Returns a pointer just past
+// it, or NULL if there are no more. Sets *spec to its start, *cls to the
+// class of its argument and *stars to the number of * fields before it.
+static inline const char *log_next_conv(const char *fmt,const char **spec,int *cls,int *stars){
+  int mod = 0;
+  while(*fmt != 0 && *fmt != '%'){ fmt++; }
+  if(*fmt == 0){ return(NULL); }
+  *spec = fmt;
+  *stars = 0;
+  fmt++;
+  while(*fmt == '-' || *fmt == '+' || *fmt == ' ' || *fmt == '#' || *fmt == '0'){ fmt++; }
+  if(*fmt == '*'){ (*stars)++; fmt++; }
+  while(*fmt >= '0' && *fmt <= '9'){ fmt++; }
+  if(*fmt == '.'){
+    fmt++;
+    if(*fmt == '*'){ (*stars)++; fmt++; }
+    while(*fmt >= '0' && *fmt <= '9'){ fmt++; }
+  }
+  while(*fmt == 'h' || *fmt == 'l' || *fmt == 'z' || *fmt == 'j' || *fmt == 't' || *fmt == 'L' || *fmt == 'q'){
+    if(*fmt == 'l' || *fmt == 'q'){ mod++; }
+    if(*fmt == 'z' || *fmt == 'j' || *fmt == 't'){ mod = 3; }
+    fmt++;
+  }
+  switch(*fmt){
+  case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+    *cls = (mod == 0 ? LOG_ARG_INT : mod == 1 ? LOG_ARG_LONG : mod == 2 ? LOG_ARG_LLONG : LOG_ARG_SIZE);
+    break;
+  case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+    *cls = LOG_ARG_DOUBLE;
+    break;
+  case 's':
+    *cls = LOG_ARG_STRING;
+    break;
+  case 'p':
+    *cls = LOG_ARG_POINTER;
+    break;
+  case 0:
+    *cls = LOG_ARG_NONE;
+    return(fmt);
+  default: // %% and anything we don't know
+    *cls = LOG_ARG_NONE;
+    break;
+  }
+  return(fmt+1);
+}
+
+// Log type names, for the log section of the configuration
+extern const char *logtype_name[];
+
+// Output modes
+extern int log_async;            // Messages go through the ring to a writer thread
+extern char log_binary_fn[128];  // Write binary records to this file instead of text
+
+int log_start();
+void log_stop();
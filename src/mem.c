@@ -18,171 +18,407 @@
    along with LambdaDelta.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include "config.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef HAVE_YAML_H
+#include <yaml.h>
+#endif
 
 #include "ld.h"
 #include "nubus.h"
+#include "mem.h"
+#include "lambda_cpu.h"
+#include "snapshot.h"
 
 // Board is 16MB
 // WAIT A MINUTE! 16MB IS THE ENTIRE SLOT SPACE! WHAT GIVES?
 // Easy - The board isn't really 16MB! The top 4K is omitted!
-#define RAM_TOP   0xFFF000 // "16MB"
+#define RAM_TOP   MEM_BOARD_SIZE // "16MB"
 
-// Memory
-#ifdef CONFIG_2X2
-uint8_t MEM_RAM[2][RAM_TOP];
-#else
-uint8_t MEM_RAM[1][RAM_TOP];
-#endif
+// Memory, all boards one after another
+uint8_t *MEM_RAM = NULL;
+uint8_t *MEM_Dirty = NULL;
+int mem_boards = 0;                  // Number of boards, 0 until configured
+int mem_board_slot[MEM_MAX_BOARDS];  // NUbus slot of each board
+int mem_hugepages = 0;               // Try to back RAM with huge pages
+char mem_file[128] = "";             // Map RAM from this file instead
+#define MEM_HUGE_PAGE 0x200000       // Mapping is rounded up to this
 static uint8_t rom_string[0x1B] = "LMI 16-MEGABYTE MEMORY V1.0";
 // Don't use the ROM image anymore, no longer needed.
 // uint8_t MEM_ROM[2048]; // TI ROMs are 2KB
 // uint8_t MEM_ROM[512]; // LMI ROMs are 512 bytes
 
+int fast_memory = 0; // Processor RAM accesses bypass the bus
+
 // Externals
 extern int ld_die_rq;
 
 // Functions
-void mem_init(){
-  bzero(MEM_RAM[0],RAM_TOP);
+// Map the memory boards. Called once at startup, after the configuration is read.
+int mem_alloc(){
+  size_t len;
+  int fd = -1;
+  int flags = MAP_PRIVATE|MAP_ANONYMOUS;
+  if(mem_boards == 0){
+    // One board for each processor
+    mem_board_slot[mem_boards++] = 0xF9;
 #ifdef CONFIG_2X2
-  bzero(MEM_RAM[1],RAM_TOP);
+    mem_board_slot[mem_boards++] = 0xFC;
 #endif
+  }
+  len = (size_t)mem_boards*RAM_TOP;
+  len = (len+(MEM_HUGE_PAGE-1))&~((size_t)MEM_HUGE_PAGE-1);
+  if(mem_file[0] != 0){
+    fd = open(mem_file,O_RDWR|O_CREAT,0660);
+    if(fd < 0){
+      logmsgf(LT_MEM,0,"MEM: Unable to open %s: %s\n",mem_file,strerror(errno));
+      return(-1);
+    }
+    if(ftruncate(fd,len) < 0){
+      logmsgf(LT_MEM,0,"MEM: Unable to size %s: %s\n",mem_file,strerror(errno));
+      close(fd);
+      return(-1);
+    }
+    flags = MAP_SHARED;
+  }
+#ifdef MAP_HUGETLB
+  if(mem_hugepages != 0 && fd < 0){
+    MEM_RAM = mmap(NULL,len,PROT_READ|PROT_WRITE,flags|MAP_HUGETLB,-1,0);
+    if(MEM_RAM == MAP_FAILED){
+      logmsgf(LT_MEM,0,"MEM: No huge pages available (%s), using normal pages\n",strerror(errno));
+      MEM_RAM = NULL;
+    }
+  }
+#endif
+  if(MEM_RAM == NULL){
+    MEM_RAM = mmap(NULL,len,PROT_READ|PROT_WRITE,flags,fd,0);
+    if(MEM_RAM == MAP_FAILED){
+      logmsgf(LT_MEM,0,"MEM: Unable to map %d memory boards: %s\n",mem_boards,strerror(errno));
+      MEM_RAM = NULL;
+      if(fd >= 0){ close(fd); }
+      return(-1);
+    }
+#ifdef MADV_HUGEPAGE
+    // Ask for transparent huge pages instead
+    if(mem_hugepages != 0){
+      madvise(MEM_RAM,len,MADV_HUGEPAGE);
+    }
+#endif
+  }
+  if(fd >= 0){ close(fd); }
+  MEM_Dirty = calloc(mem_boards,MEM_BOARD_PAGES);
+  if(MEM_Dirty == NULL){
+    logmsgf(LT_MEM,0,"MEM: Unable to allocate dirty map\n");
+    return(-1);
+  }
+  logmsgf(LT_MEM,1,"MEM: %d memory boards, %d MB\n",mem_boards,(int)(((size_t)mem_boards*RAM_TOP)>>20));
+  return(0);
+}
+
+void mem_init(){
+  int x = 0;
+  while(x < mem_boards){
+    bzero(MEM_BOARD(x),RAM_TOP);
+    nubus_register_slave(mem_board_slot[x],mem_nubus_slave,x,1);
+    x++;
+  }
+}
+
+void mem_snapshot(int op __attribute__ ((unused))){
+  snapshot_item("MEM_RAM",MEM_RAM,(size_t)mem_boards*RAM_TOP,MEM_Dirty);
+}
+
+// RAM of the board in a slot, NULL if there isn't one
+uint8_t *mem_slot_ram(int card){
+  card &= 0xFF;
+  if(nubus_slave[card].fn != mem_nubus_slave){ return(NULL); }
+  return(MEM_BOARD(nubus_slave[card].arg));
+}
+
+// Dirty map entry for an address on the board in a slot, NULL if there isn't one
+uint8_t *mem_slot_dirty(int card,uint32_t addr){
+  card &= 0xFF;
+  if(nubus_slave[card].fn != mem_nubus_slave || addr >= RAM_TOP){ return(NULL); }
+  return(&MEM_Dirty[(nubus_slave[card].arg*MEM_BOARD_PAGES)+(addr>>MEM_PAGE_SHIFT)]);
 }
 
 uint8_t debug_mem_read(uint32_t addr){
-  return(MEM_RAM[0][addr]);
+  return(MEM_BOARD(0)[addr]);
 };
 
 void debug_mem_write(uint32_t addr, uint8_t data){
-  MEM_RAM[0][addr] = data;
+  MEM_BOARD(0)[addr] = data;
+  MEM_DIRTY(0,addr);
 };
 
-void mem_clock_pulse(){
-  // If the bus is busy and not acknowledged...
-  if(NUbus_Busy == 2 && NUbus_acknowledge == 0){
-    // Is it us?
-    if(NUbus_Address.Card == 0xF9
-#ifdef CONFIG_2X2
-       || NUbus_Address.Card == 0xFC
-#endif
-       ){
-      int Card = 0;
-      switch(NUbus_Address.Card){
-      case 0xF9:
-	Card = 0; break;
-#ifdef CONFIG_2X2
-      case 0xFC:
-	Card = 1; break;
-#endif
+// Make sure a block transfer has a valid length and fits in RAM
+static inline int mem_block_check(nuAddr Addr){
+  int words = nubus_block_words(Addr.raw);
+  if(words == 0 || nubus_block_start(Addr.Addr)+(words*4) > RAM_TOP){
+    logmsgf(LT_MEM,0,"MEM8: BAD BLOCK TRANSFER: Addr 0x%X\n",Addr.raw);
+    return(0);
+  }
+  return(1);
+}
+
+// RAM access for a request to one of our cards. Returns 1 if it was done.
+static inline int mem_ram_access(int Card,int Request,nuAddr Addr,nuData *Data){
+  if(Request == VM_READ){ // Read four bytes
+    switch(Addr.Byte){
+    case 1: // Read Low Half
+      Data->hword[0] = *(uint16_t *)(MEM_BOARD(Card)+(Addr.Addr-1));
+      break;
+
+    case 2: // Block Transfer
+      if(mem_block_check(Addr) == 0){ return(0); }
+      memcpy(NUbus_Block,MEM_BOARD(Card)+nubus_block_start(Addr.Addr),nubus_block_words(Addr.raw)*4);
+      Data->word = NUbus_Block[0];
+      break;
+
+    case 3: // Read High Half
+      Data->hword[1] = *(uint16_t *)(MEM_BOARD(Card)+(Addr.Addr-1));
+      break;
+
+    case 0:
+      // Full word read
+      Data->word = *(uint32_t *)(MEM_BOARD(Card)+Addr.Addr);
+      break;
+    }
+    return(1);
+  }
+  if(Request == VM_WRITE){
+    MEM_DIRTY(Card,Addr.Addr);
+    switch(Addr.Byte){
+    case 1: // Write low half
+      *(uint16_t *)(MEM_BOARD(Card)+(Addr.Addr-1)) = Data->hword[0];
+      break;
+
+    case 2: // Block Transfer
+      if(mem_block_check(Addr) == 0){ return(0); }
+      // A block never crosses a page, so the dirty mark above covers it
+      memcpy(MEM_BOARD(Card)+nubus_block_start(Addr.Addr),NUbus_Block,nubus_block_words(Addr.raw)*4);
+      break;
+
+    case 3: // Write high half
+      *(uint16_t *)(MEM_BOARD(Card)+(Addr.Addr-1)) = Data->hword[1];
+      break;
+
+    case 0: // Full Word
+      *(uint32_t *)(MEM_BOARD(Card)+Addr.Addr) = Data->word;
+      break;
+    }
+    return(1);
+  }
+  if(Request == VM_BYTE_READ){
+    // BYTE READ
+    Data->byte[Addr.Byte] = MEM_BOARD(Card)[Addr.Addr];
+    return(1);
+  }
+  if(Request == VM_BYTE_WRITE){
+    MEM_BOARD(Card)[Addr.Addr] = Data->byte[Addr.Byte];
+    MEM_DIRTY(Card,Addr.Addr);
+    return(1);
+  }
+  return(0);
+}
+
+// Fast memory: do a processor's RAM access at once instead of putting it on
+// the bus. Anything that isn't plain RAM on an idle bus returns 0 and takes
+// the normal path, so timeouts, the configuration space, block transfers and
+// tracing are unchanged. On success *data holds what the bus data lines would.
+int mem_fast_request(int access,uint32_t address,uint32_t *data){
+  nuAddr Addr;
+  nuData Data;
+  Addr.raw = address;
+  if(NUbus_Busy != 0 || NUbus_trace != 0 || nubus_slave[Addr.Card].fn != mem_nubus_slave ||
+     Addr.Addr >= RAM_TOP || ((access == VM_READ || access == VM_WRITE) && Addr.Byte == 2)){
+    return(0);
+  }
+  Data.word = *data;
+  if(mem_ram_access(nubus_slave[Addr.Card].arg,access,Addr,&Data) == 0){
+    return(0);
+  }
+  // The other processor may be parked waiting for this write
+  if((access&0x01) != 0){ IDLE_WAKE(); }
+  *data = Data.word;
+  return(1);
+}
+
+// NUbus slave, called when a request is addressed to one of our cards
+void mem_nubus_slave(int Card){
+  switch(NUbus_Address.Addr){
+  case 0x000000 ... RAM_TOP-1:
+    {
+      nuAddr Addr;
+      nuData Data;
+      Addr.raw = NUbus_Address.raw;
+      Data.word = NUbus_Data.word;
+      if(mem_ram_access(Card,NUbus_Request,Addr,&Data) != 0){
+	NUbus_Data.word = Data.word;
+	NUbus_acknowledge=1;
+	return;
       }
-      // Yes, answer
-      switch(NUbus_Address.Addr){
-      case 0x000000 ... RAM_TOP:
-	if(NUbus_Request == VM_READ){ // Read four bytes
-	  switch(NUbus_Address.Byte){
-	  case 1: // Read Low Half
-	    NUbus_Data.hword[0] = *(uint16_t *)(MEM_RAM[Card]+(NUbus_Address.Addr-1));
-	    break;
-
-	  case 2: // Block Transfer (ILLEGAL)
-	    logmsgf(LT_MEM,0,"MEM8: BLOCK WRITE REQUESTED\n");
-	    exit(-1);
-	    break;
-
-	  case 3: // Read High Half
-	    NUbus_Data.hword[1] = *(uint16_t *)(MEM_RAM[Card]+(NUbus_Address.Addr-1));
-	    break;
-
-	  case 0:
-	    // Full word read
-	    NUbus_Data.word = *(uint32_t *)(MEM_RAM[Card]+NUbus_Address.Addr);
-	    break;
+    }
+    break;
+
+    // Some kind of configuration register
+  case 0xFFF7FC ... 0xFFF7FF:
+    if((NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ)){
+      NUbus_Data.word = 0;
+      NUbus_acknowledge=1;
+      return;
+    }
+    if((NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE)){
+      // Bit 0x08 is LED?
+      if(!(NUbus_Data.word == 0x08 && NUbus_Address.Byte == 0) && NUbus_Data.word != 0x00){
+	logmsgf(LT_MEM,0,"MEM: CONF REG WRITE: DATA = 0x%X\n",NUbus_Data.word);
+      }
+      NUbus_acknowledge=1;
+      return;
+    }
+    break;
+
+    // Configuration ROM
+  case 0xFFF800 ... 0xFFFFFF:
+    if((NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ)
+       && NUbus_Address.Byte == 0){
+      uint32_t rom_addr = (NUbus_Address.Addr-0xfff800)/4;
+      if(rom_addr <= 0x1B){
+	NUbus_Data.word = rom_string[rom_addr];
+      }else{
+	NUbus_Data.word = 0;
+      }
+      NUbus_acknowledge=1;
+      return;
+    }
+    break;
+
+  // Uhoh!
+  default:
+    logmsgf(LT_MEM,0,"RAM: Unimplemented address 0x%X (0x%X), op %X\n",
+	    NUbus_Address.Addr,NUbus_Address.raw,NUbus_Request);
+    // lambda_dump(DUMP_ALL);
+    ld_die_rq=1;
+    break;
+  }
+}
+
+#ifdef HAVE_YAML_H
+// Configuration
+int yaml_memory_mapping_loop(yaml_parser_t *parser){
+  char key[128];
+  char value[128];
+  yaml_event_t event;
+  int mapping_done = 0;
+  int boards_given = 0;
+  key[0] = 0;
+  value[0] = 0;
+  while(mapping_done == 0){
+    if(!yaml_parser_parse(parser, &event)){
+      if(parser->context != NULL){
+        logmsgf(LT_MEM,0,"YAML: Parser error %d: %s %s\n", parser->error,parser->problem,parser->context);
+      }else{
+        logmsgf(LT_MEM,0,"YAML: Parser error %d: %s\n", parser->error,parser->problem);
+      }
+      return(-1);
+    }
+    switch(event.type){
+    case YAML_NO_EVENT:
+      logmsgf(LT_MEM,0,"No event?\n");
+      break;
+    case YAML_STREAM_START_EVENT:
+    case YAML_DOCUMENT_START_EVENT:
+      logmsgf(LT_MEM,0,"Unexpected stream/document start\n");
+      break;
+    case YAML_STREAM_END_EVENT:
+    case YAML_DOCUMENT_END_EVENT:
+      logmsgf(LT_MEM,0,"Unexpected stream/document end\n");
+      break;
+    case YAML_SEQUENCE_START_EVENT:
+      logmsgf(LT_MEM,0,"Unexpected sequence key: %s\n",key);
+      return(-1);
+    case YAML_MAPPING_START_EVENT:
+      logmsgf(LT_MEM,0,"Unexpected mapping start\n");
+      return(-1);
+      break;
+    case YAML_SEQUENCE_END_EVENT:
+      logmsgf(LT_MEM,0,"Unexpected sequence end\n");
+      return(-1);
+      break;
+    case YAML_MAPPING_END_EVENT:
+      mapping_done = 1;
+      break;
+    case YAML_ALIAS_EVENT:
+      logmsgf(LT_MEM,0,"Unexpected alias (anchor %s)\n", event.data.alias.anchor);
+      return(-1);
+      break;
+    case YAML_SCALAR_EVENT:
+      if(key[0] == 0){
+        strncpy(key,(const char *)event.data.scalar.value,128);
+      }else{
+        strncpy(value,(const char *)event.data.scalar.value,128);
+        if(strcmp(key,"board") == 0){
+	  char *end = NULL;
+	  long slot = strtol(value,&end,16);
+	  int x = 0;
+	  if(end == value || *end != 0 || slot < 0 || slot > 0xFF){
+	    logmsgf(LT_MEM,0,"memory: Invalid board slot %s\n",value);
+	    return(-1);
 	  }
-	  NUbus_acknowledge=1;
-          return;
-	}
-	if(NUbus_Request == VM_WRITE){
-	  switch(NUbus_Address.Byte){
-	  case 1: // Write low half
-	    *(uint16_t *)(MEM_RAM[Card]+(NUbus_Address.Addr-1)) = NUbus_Data.hword[0];
-	    break;
-
-	  case 2: // BLOCK TRANSFER (ILLEGAL)
-	    logmsgf(LT_MEM,0,"MEM8: BLOCK WRITE REQUESTED\n");
-	    exit(-1);
-	    break;
-
-	  case 3: // Write high half
-	    *(uint16_t *)(MEM_RAM[Card]+(NUbus_Address.Addr-1)) = NUbus_Data.hword[1];
-	    break;
-
-	  case 0: // Full Word
-	    *(uint32_t *)(MEM_RAM[Card]+NUbus_Address.Addr) = NUbus_Data.word;
-	    break;
+	  // The first board given replaces the default set
+	  if(boards_given == 0){ mem_boards = 0; }
+	  boards_given = 1;
+	  while(x < mem_boards){
+	    if(mem_board_slot[x] == slot){
+	      logmsgf(LT_MEM,0,"memory: Slot %s has two boards\n",value);
+	      return(-1);
+	    }
+	    x++;
 	  }
-	  NUbus_acknowledge=1;
-          return;
-	}
-	if(NUbus_Request == VM_BYTE_READ){
-	  // BYTE READ
-	  NUbus_Data.byte[NUbus_Address.Byte] = MEM_RAM[Card][NUbus_Address.Addr];
-	  NUbus_acknowledge=1;
-	  return;
-	}
-	if(NUbus_Request == VM_BYTE_WRITE){
-	  MEM_RAM[Card][NUbus_Address.Addr] = NUbus_Data.byte[NUbus_Address.Byte];
-	  NUbus_acknowledge=1;
-          return;
-	}
-	break;
-
-	// Some kind of configuration register
-      case 0xFFF7FC ... 0xFFF7FF:
-        if((NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ)){
-	  NUbus_Data.word = 0;
-	  NUbus_acknowledge=1;
-	  return;
-	}
-	if((NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE)){
-	  // Bit 0x08 is LED?
-	  if(!(NUbus_Data.word == 0x08 && NUbus_Address.Byte == 0) && NUbus_Data.word != 0x00){
-	    logmsgf(LT_MEM,0,"MEM: CONF REG WRITE: DATA = 0x%X\n",NUbus_Data.word);
+	  if(mem_boards == MEM_MAX_BOARDS){
+	    logmsgf(LT_MEM,0,"memory: Too many boards (at most %d)\n",MEM_MAX_BOARDS);
+	    return(-1);
 	  }
-	  NUbus_acknowledge=1;
-	  return;
+	  mem_board_slot[mem_boards++] = slot;
+	  goto value_done;
 	}
-	break;
-
-	// Configuration ROM
-      case 0xFFF800 ... 0xFFFFFF:
-        if((NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ)
-	   && NUbus_Address.Byte == 0){
-          uint32_t rom_addr = (NUbus_Address.Addr-0xfff800)/4;
-	  if(rom_addr <= 0x1B){
-	    NUbus_Data.word = rom_string[rom_addr];
+        if(strcmp(key,"hugepages") == 0){
+	  if((strcasecmp(value,"on") == 0) || (strcasecmp(value,"yes") == 0) || (strcasecmp(value,"true") == 0)){
+	    mem_hugepages = 1;
+	  }else if((strcasecmp(value,"off") == 0) || (strcasecmp(value,"no") == 0) || (strcasecmp(value,"false") == 0)){
+	    mem_hugepages = 0;
 	  }else{
-	    NUbus_Data.word = 0;
+	    logmsgf(LT_MEM,0,"memory: hugepages: unrecognized value '%s' (expecting on/true/yes or off/false/no)\n",value);
+	    return(-1);
 	  }
-          NUbus_acknowledge=1;
-          return;
-        }
+	  goto value_done;
+	}
+        if(strcmp(key,"file") == 0){
+	  strncpy(mem_file,value,127);
+	  mem_file[127] = 0;
+	  goto value_done;
+	}
+        logmsgf(LT_MEM,0,"memory: Unknown key %s (value %s)\n",key,value);
+        return(-1);
+        // Done
+      value_done:
+        key[0] = 0;
         break;
-
-      // Uhoh!
-      default:
-	logmsgf(LT_MEM,0,"RAM: Unimplemented address 0x%X (0x%X), op %X\n",
-		NUbus_Address.Addr,NUbus_Address.raw,NUbus_Request);
-	// lambda_dump(DUMP_ALL);
-	ld_die_rq=1;
-	break;
       }
+      break;
     }
-    // Request finished or not ours
+    yaml_event_delete(&event);
   }
+  return(0);
 }
+#endif
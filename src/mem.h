@@ -17,7 +17,29 @@
    along with LambdaDelta.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+// Memory boards. MEM_RAM holds all of them, one after another.
+#define MEM_BOARD_SIZE 0xFFF000
+#define MEM_MAX_BOARDS 8
+extern uint8_t *MEM_RAM;
+#define MEM_BOARD(b) (MEM_RAM+((size_t)(b)*MEM_BOARD_SIZE))
+
+// Page dirty map, for checkpoints. Anything writing MEM_RAM without going
+// through mem_nubus_slave() must mark the page.
+#define MEM_PAGE_SHIFT 12
+#define MEM_BOARD_PAGES (MEM_BOARD_SIZE>>MEM_PAGE_SHIFT)
+extern uint8_t *MEM_Dirty;
+#define MEM_DIRTY(card,addr) (MEM_Dirty[((card)*MEM_BOARD_PAGES)+((addr)>>MEM_PAGE_SHIFT)] = 1)
+
+int mem_alloc();
 void mem_init();
-void mem_clock_pulse();
+uint8_t *mem_slot_ram(int card);
+uint8_t *mem_slot_dirty(int card,uint32_t addr);
+void mem_nubus_slave(int Card);
+int mem_fast_request(int access,uint32_t address,uint32_t *data);
 void debug_mem_write(uint32_t addr,uint8_t data);
 uint8_t debug_mem_read(uint32_t addr);
+
+extern int fast_memory;
+#ifdef HAVE_YAML_H
+int yaml_memory_mapping_loop(yaml_parser_t *parser);
+#endif
@@ -22,10 +22,16 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 
 #include "ld.h"
 #include "nubus.h"
+#include "snapshot.h"
 
 /* NUbus Interface */
 volatile int NUbus_Busy;
@@ -36,10 +42,108 @@ volatile int NUbus_trace;
 volatile int NUbus_Request;
 volatile nuAddr NUbus_Address;
 volatile nuData NUbus_Data;
+uint32_t NUbus_Block[NUBUS_BLOCK_MAX];
+NUbus_Slave nubus_slave[256];
+uint64_t NUbus_cycles = 0;   // Bus cycles run, for the trace
+
+/* Binary trace */
+NUbusTraceHeader *nubus_trace_map = NULL;
+char nubus_trace_fn[128] = "";
+uint64_t nubus_trace_size = 1048576; // Records
+static NUbusTraceRecord *nubus_trace_ring = NULL;
+static uint64_t nubus_trace_cycle = 0; // Cycle the master of the request on the bus wanted it
+static uint64_t nubus_trace_grant = 0; // Cycle that request was put on the bus
+uint64_t nubus_wait_first[256];        // First cycle of each master's current wait for the bus
+uint64_t nubus_wait_last[256];         // Last cycle it was seen waiting, 0 once it has the bus
+
+void nubus_snapshot(int op __attribute__ ((unused))){
+  SNAP_ITEM(NUbus_Busy);
+  SNAP_ITEM(NUbus_error);
+  SNAP_ITEM(NUbus_acknowledge);
+  SNAP_ITEM(NUbus_master);
+  SNAP_ITEM(NUbus_Request);
+  SNAP_ITEM(NUbus_Address);
+  SNAP_ITEM(NUbus_Data);
+}
+
+// Map the trace file, if one is configured
+int nubus_trace_start(){
+  size_t len;
+  int fd;
+  if(nubus_trace_fn[0] == 0){ return(0); }
+  if(nubus_trace_size == 0){
+    logmsgf(LT_NUBUS,0,"NUBUS: Trace size must be at least one record\n");
+    return(-1);
+  }
+  len = sizeof(NUbusTraceHeader)+(nubus_trace_size*sizeof(NUbusTraceRecord));
+  fd = open(nubus_trace_fn,O_RDWR|O_CREAT|O_TRUNC,0660);
+  if(fd < 0){
+    logmsgf(LT_NUBUS,0,"NUBUS: Unable to open %s: %s\n",nubus_trace_fn,strerror(errno));
+    return(-1);
+  }
+  if(ftruncate(fd,len) < 0){
+    logmsgf(LT_NUBUS,0,"NUBUS: Unable to size %s: %s\n",nubus_trace_fn,strerror(errno));
+    close(fd);
+    return(-1);
+  }
+  nubus_trace_map = mmap(NULL,len,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  close(fd);
+  if(nubus_trace_map == MAP_FAILED){
+    logmsgf(LT_NUBUS,0,"NUBUS: Unable to map %s: %s\n",nubus_trace_fn,strerror(errno));
+    nubus_trace_map = NULL;
+    return(-1);
+  }
+  memcpy(nubus_trace_map->magic,NUBUS_TRACE_MAGIC,8);
+  nubus_trace_map->version = NUBUS_TRACE_VERSION;
+  nubus_trace_map->rate = 5000000;
+  nubus_trace_map->size = nubus_trace_size;
+  nubus_trace_map->head = 0;
+  nubus_trace_ring = (NUbusTraceRecord *)(nubus_trace_map+1);
+  logmsgf(LT_NUBUS,0,"NUBUS: Tracing to %s, %llu records\n",nubus_trace_fn,(unsigned long long)nubus_trace_size);
+  return(0);
+}
+
+// Add a transaction to the trace
+void nubus_trace_record(int master, int access, uint32_t address, uint32_t data, int flags, uint64_t cycle, int wait, int latency){
+  NUbusTraceRecord *rec = &nubus_trace_ring[nubus_trace_map->head%nubus_trace_map->size];
+  rec->cycle = cycle;
+  rec->address = address;
+  rec->data = data;
+  rec->latency = (latency < 0xFFFF ? latency : 0xFFFF);
+  rec->master = master;
+  rec->request = access;
+  rec->flags = flags;
+  rec->words = 0;
+  if((access&0x02) == 0 && (address&0x03) == 2){
+    rec->words = nubus_block_words(address);
+  }
+  rec->wait = (wait < 0xFFFF ? wait : 0xFFFF);
+  nubus_trace_map->head++;
+}
+
+// The cycle a master's request really began: the first cycle of the wait for
+// the bus it was still in, or this one if it did not have to wait.
+uint64_t nubus_trace_begin(int master){
+  master &= 0xFF;
+  if(nubus_wait_last[master] != 0 && NUbus_cycles-nubus_wait_last[master] <= 1){
+    nubus_wait_last[master] = 0;
+    return(nubus_wait_first[master]);
+  }
+  nubus_wait_last[master] = 0;
+  return(NUbus_cycles);
+}
 
 void nubus_clock_pulse(){
+  NUbus_cycles++;
   if(NUbus_Busy > 0){
     NUbus_Busy--;
+    // Anyone answering has done so by now
+    if(NUbus_Busy == 1 && nubus_trace_map != NULL){
+      nubus_trace_record(NUbus_master,NUbus_Request,NUbus_Address.raw,NUbus_Data.word,
+			 NUbus_acknowledge != 0 ? NUBUS_TR_ACK : NUBUS_TR_TIMEOUT,
+			 nubus_trace_cycle,nubus_trace_grant-nubus_trace_cycle,
+			 NUbus_cycles-nubus_trace_cycle);
+    }
     // Anyone take this request?
     if(NUbus_Busy == 1 && NUbus_acknowledge == 0){
       // No. Light the error bit for at least one cycle. 
@@ -55,6 +159,17 @@ void nubus_clock_pulse(){
   }
 }
 
+// Claim a card slot
+void nubus_register_slave(int card, nubus_slave_fn fn, int arg, int blocks){
+  card &= 0xFF;
+  if(nubus_slave[card].fn != NULL && (nubus_slave[card].fn != fn || nubus_slave[card].arg != arg)){
+    logmsgf(LT_NUBUS,0,"NUBUS: Card 0x%X claimed twice, last claim wins\n",card);
+  }
+  nubus_slave[card].fn = fn;
+  nubus_slave[card].arg = arg;
+  nubus_slave[card].blocks = blocks;
+}
+
 // Put a request on the bus
 void nubus_io_request(int access, int master, uint32_t address, uint32_t data){
   // Clear flags
@@ -67,6 +182,10 @@ void nubus_io_request(int access, int master, uint32_t address, uint32_t data){
   }
   // During the PROM run, it expects to read MD one instruction after the read request.
   NUbus_Busy = 3;
+  if(nubus_trace_map != NULL){
+    nubus_trace_cycle = nubus_trace_begin(master);
+    nubus_trace_grant = NUbus_cycles;
+  }
   NUbus_Address.raw = address;
   NUbus_master = master;
   NUbus_Request = access;
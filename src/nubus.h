@@ -59,6 +59,61 @@ typedef union rnuData {
 #define NB_BYTE_READ  0x12
 #define NB_BYTE_WRITE 0x13
 
+/* Block transfers */
+// A word request with Byte = 2 is a block transfer. Address bits 2-5 give the
+// length: xxx1 = 2 words, xx10 = 4, x100 = 8, 1000 = 16. The block starts at
+// the address aligned to its length. The data moves through NUbus_Block.
+#define NUBUS_BLOCK_MAX 16
+
+static inline int nubus_block_words(uint32_t addr){
+  if(addr&0x04){ return(2); }
+  if(addr&0x08){ return(4); }
+  if(addr&0x10){ return(8); }
+  if(addr&0x20){ return(16); }
+  return(0); // Not a valid length
+}
+
+// Address of the first word of a block
+static inline uint32_t nubus_block_start(uint32_t addr){
+  return(addr&~((uint32_t)(nubus_block_words(addr)*4)-1)&~0x03);
+}
+
+// Address to put on the bus for a block of the given length
+static inline uint32_t nubus_block_addr(uint32_t start,int words){
+  return((start&~((uint32_t)(words*4)-1))|(words*2)|2);
+}
+
+/* Binary trace */
+// The trace file is a NUbusTraceHeader followed by a ring of 'size'
+// records. Record N goes in slot N % size; 'head' counts every record
+// written, so the oldest one still in the ring is at head-size.
+#define NUBUS_TRACE_MAGIC "LDNUTR01"
+#define NUBUS_TRACE_VERSION 1
+
+typedef struct rNUbusTraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t rate;     // Bus cycles per second
+  uint64_t size;     // Records in the ring
+  uint64_t head;     // Records written
+} __attribute__((packed)) NUbusTraceHeader;
+
+typedef struct rNUbusTraceRecord {
+  uint64_t cycle;    // Bus cycle the master first wanted the bus for it
+  uint32_t address;
+  uint32_t data;     // Data written, or data read back
+  uint16_t latency;  // Bus cycles from then until it was acknowledged or timed out
+  uint8_t master;
+  uint8_t request;   // VM_xxx or NB_xxx
+  uint8_t flags;     // See NUBUS_TR_xxx
+  uint8_t words;     // Words moved by a block transfer, otherwise 0
+  uint16_t wait;     // Bus cycles of the latency spent waiting for the bus
+} __attribute__((packed)) NUbusTraceRecord;
+
+#define NUBUS_TR_ACK 0x01      // Acknowledged
+#define NUBUS_TR_TIMEOUT 0x02  // Timed out
+#define NUBUS_TR_FAST 0x04     // Fast memory access, never on the bus
+
 /* NuBus card IDs */
 
 /* NUbus Interface */
@@ -70,7 +125,49 @@ extern volatile nuAddr NUbus_Address;
 extern volatile nuData NUbus_Data;
 extern volatile int NUbus_Request;
 extern volatile int NUbus_trace;
+extern uint32_t NUbus_Block[NUBUS_BLOCK_MAX];
+extern uint64_t NUbus_cycles;
+extern NUbusTraceHeader *nubus_trace_map;
+extern char nubus_trace_fn[128];
+extern uint64_t nubus_trace_size;
+extern uint64_t nubus_wait_first[256];
+extern uint64_t nubus_wait_last[256];
+/* Slave dispatch */
+// Each card slot can be claimed by one slave. Its function is called with
+// the registered argument on the cycle a request to that slot is answered.
+typedef void (*nubus_slave_fn)(int arg);
+typedef struct rNUbus_Slave {
+  nubus_slave_fn fn;
+  int arg;
+  int blocks; // Answers block transfers
+} NUbus_Slave;
+extern NUbus_Slave nubus_slave[256];
+
 /* Functions */
 void nubus_clock_pulse();
+void nubus_register_slave(int card, nubus_slave_fn fn, int arg, int blocks);
+// Call the slave owning the addressed card, if any, when a request is due
+static inline void nubus_slave_cycle(){
+  if(NUbus_Busy == 2 && NUbus_acknowledge == 0){
+    NUbus_Slave *s = &nubus_slave[NUbus_Address.Card];
+    if(s->fn != NULL){
+      s->fn(s->arg);
+    }
+  }
+}
 void nubus_io_request(int access, int master, uint32_t address, uint32_t data);
+int nubus_trace_start();
+void nubus_trace_record(int master, int access, uint32_t address, uint32_t data, int flags, uint64_t cycle, int wait, int latency);
+uint64_t nubus_trace_begin(int master);
+// A master calls this on each cycle it holds off a request because the bus
+// is busy, so the trace can tell how long it waited.
+static inline void nubus_wait(int master){
+  if(nubus_trace_map != NULL){
+    master &= 0xFF;
+    if(nubus_wait_last[master] == 0 || NUbus_cycles-nubus_wait_last[master] > 1){
+      nubus_wait_first[master] = NUbus_cycles;
+    }
+    nubus_wait_last[master] = NUbus_cycles;
+  }
+}
 
@@ -0,0 +1,168 @@
+/* Copyright 2016-2017
+   Daniel Seagraves <dseagrav@lunar-tokyo.net>
+
+   This file is part of LambdaDelta.
+
+   LambdaDelta is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   LambdaDelta is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LambdaDelta.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Real time pacing
+
+   The main loop hands us the bus cycles it ran every pace_slice microseconds of
+   emulated time. Emulated time is those cycles at 5 MHz, counted from when pacing
+   started. If that is ahead of the host's monotonic clock, we sleep until the
+   host catches up, using an absolute deadline so the sleeps don't accumulate error.
+
+   If we are behind (a slow host, or the emulator was stopped for a while) we run
+   flat out until we catch up. pace_catchup limits how far behind we try to catch up;
+   anything past that is written off by moving the start time forward, so the guest
+   loses that time instead of running fast for as long as it takes to make it up.
+
+   In turbo mode we never sleep, and the start time follows along so that leaving
+   turbo mode doesn't mean waiting for real time to catch up. Instead the guest
+   timers are slowed down: each check works out how many timer ticks real time
+   says are owed and spreads them over the next slice by setting timer_step.
+*/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+
+#include "ld.h"
+#include "pace.h"
+
+int pace_slice = 1000;                  // 1ms
+int pace_catchup = PACE_CATCHUP_ALL;
+int pace_turbo = 0;
+
+uint32_t timer_step = TIMER_STEP_ONE;
+uint32_t timer_acc = 0;
+int timer_tick = 1;
+uint64_t timer_ticks = 0;               // Timer ticks so far
+
+static int64_t pace_start = 0;          // Host time at emulated time 0, in ns
+static int64_t pace_emu = 0;            // Emulated time, in ns
+static int64_t pace_lost = 0;           // Time written off, in ns
+static int turbo_on = 0;                // Last check was in turbo mode
+static int64_t turbo_start = 0;         // Host time turbo mode started, in ns
+static uint64_t turbo_ticks = 0;        // timer_ticks when it started
+static int64_t speed_emu = 0;           // pace_emu at the last speed check
+static int64_t speed_time = 0;          // Host time at the last speed check
+
+static int64_t pace_now(){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return(((int64_t)ts.tv_sec*1000000000)+ts.tv_nsec);
+}
+
+// Start the clock
+void pace_init(){
+  pace_start = pace_now();
+  pace_emu = 0;
+  pace_lost = 0;
+  speed_time = pace_start;
+  speed_emu = 0;
+  if(pace_catchup == PACE_CATCHUP_ALL){
+    logmsgf(LT_SYSTEM,1,"PACE: %d usec slices, catching up on all lost time\n",pace_slice);
+  }else{
+    logmsgf(LT_SYSTEM,1,"PACE: %d usec slices, catching up on at most %d ms\n",pace_slice,pace_catchup);
+  }
+}
+
+// Bus cycles between calls to pace_run
+int pace_slice_cycles(){
+  return((pace_slice*1000)/PACE_CYCLE_NS);
+}
+
+// Slow the guest timers down to wall clock speed
+static void pace_turbo_timers(int64_t now){
+  int64_t owed;
+  if(turbo_on == 0){
+    turbo_on = 1;
+    turbo_start = now;
+    turbo_ticks = timer_ticks;
+  }
+  owed = ((now-turbo_start)/PACE_CYCLE_NS)-(int64_t)(timer_ticks-turbo_ticks);
+  if(pace_catchup != PACE_CATCHUP_ALL && owed > (int64_t)pace_catchup*(1000000/PACE_CYCLE_NS)){
+    // Too far behind, write off the rest
+    int64_t lost = owed-((int64_t)pace_catchup*(1000000/PACE_CYCLE_NS));
+    turbo_ticks -= lost;
+    owed -= lost;
+  }
+  if(owed <= 0){
+    timer_step = 0;
+  }else if(owed >= pace_slice_cycles()){
+    timer_step = TIMER_STEP_ONE; // Can't go faster than the bus
+  }else{
+    timer_step = (owed*TIMER_STEP_ONE)/pace_slice_cycles();
+  }
+}
+
+// Account for cycles run, and sleep if we are ahead
+void pace_run(int cycles,int turbo){
+  int64_t now = pace_now()-pace_start;
+  pace_emu += (int64_t)cycles*PACE_CYCLE_NS;
+  if(turbo){
+    // Don't sleep, don't get ahead of real time either
+    pace_turbo_timers(now+pace_start);
+    if(pace_emu > now){
+      pace_start += pace_emu-now;
+    }
+    return;
+  }
+  if(turbo_on){
+    // Back to normal
+    turbo_on = 0;
+    timer_step = TIMER_STEP_ONE;
+  }
+  if(pace_emu > now){
+    // Ahead, sleep until real time catches up
+    struct timespec ts;
+    int64_t wake = pace_start+pace_emu;
+    ts.tv_sec = wake/1000000000;
+    ts.tv_nsec = wake%1000000000;
+    while(clock_nanosleep(CLOCK_MONOTONIC,TIMER_ABSTIME,&ts,NULL) == EINTR){
+      // Interrupted by a timer signal, go back to sleep
+    }
+    return;
+  }
+  // Behind. Write off whatever is past the catch-up limit.
+  if(pace_catchup != PACE_CATCHUP_ALL && now-pace_emu > (int64_t)pace_catchup*1000000){
+    int64_t lost = (now-pace_emu)-((int64_t)pace_catchup*1000000);
+    pace_start += lost;
+    pace_lost += lost;
+    logmsgf(LT_SYSTEM,5,"PACE: Wrote off %lld ms (%lld ms total)\n",
+	    (long long)(lost/1000000),(long long)(pace_lost/1000000));
+  }
+}
+
+// Milliseconds emulated time is ahead (positive) or behind (negative) real time
+int64_t pace_drift(){
+  return((pace_emu-(pace_now()-pace_start))/1000000);
+}
+
+// Emulated speed as a percentage of real time, since the last call
+int pace_speed(){
+  int64_t now = pace_now();
+  int speed = 0;
+  if(now > speed_time){
+    speed = ((pace_emu-speed_emu)*100)/(now-speed_time);
+  }
+  speed_time = now;
+  speed_emu = pace_emu;
+  return(speed);
+}
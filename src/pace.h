@@ -0,0 +1,42 @@
+/* Copyright 2016-2017
+   Daniel Seagraves <dseagrav@lunar-tokyo.net>
+
+   This file is part of LambdaDelta.
+
+   LambdaDelta is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   LambdaDelta is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LambdaDelta.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Real time pacing */
+
+#define PACE_CYCLE_NS 200   // One bus cycle at 5 MHz
+#define PACE_CATCHUP_ALL -1 // Catch up on all lost time
+
+extern int pace_slice;      // Microseconds of emulated time between checks
+extern int pace_catchup;    // Milliseconds of lost time to catch up on, or PACE_CATCHUP_ALL
+extern int pace_turbo;      // Run as fast as possible
+
+// Guest timers (vblank, microsecond counter, PIT, RTC) advance by timer_tick each
+// bus cycle. That is always 1, except in turbo mode, where it is 0 often enough
+// to keep the timers at wall clock speed.
+#define TIMER_STEP_ONE 0x10000 // timer_step is 16.16 fixed point
+extern uint32_t timer_step;
+extern uint32_t timer_acc;
+extern int timer_tick;
+extern uint64_t timer_ticks;
+
+void pace_init();
+int pace_slice_cycles();
+void pace_run(int cycles,int turbo);
+int64_t pace_drift();
+int pace_speed();
@@ -37,10 +37,13 @@
 #include "nubus.h"
 #include "lambda_cpu.h"
 #include "sdu.h"
+#include "mem.h"
 #include "sdu_hw.h"
 #include "tapemaster.h"
 #include "3com.h"
 #include "smd.h"
+#include "snapshot.h"
+#include "pace.h"
 
 #define RAM_TOP 1024*64
 
@@ -132,9 +135,24 @@ uint8_t SDU_ROM[1024*64];
 uint8_t CMOS_RAM[2048]; // 2K
 MNAMap_Ent MNA_MAP[1024];
 
+// Multibus page table, one entry per 1K page of the 1MB multibus space.
+// Pages that are plain memory are read and written through these pointers
+// instead of the device switch or the NUbus; NULL means go the long way.
+// SDU RAM and ROM are always here. Pages the MNA map points at a memory
+// board are here in fast memory mode, since they then skip the bus.
+// The write generation of a page counts writes to it and changes to its
+// entry, so the 8088 can tell when code it decoded there may have changed.
+uint8_t *mb_read_page[MB_PAGES];
+static uint8_t *mb_write_page[MB_PAGES];
+static uint8_t *mb_dirty_page[MB_PAGES]; // Checkpoint dirty map entry, if any
+uint32_t mb_page_gen[MB_PAGES];
+
 // 8088 stuff
 i8259 PIC[3];
 i8253 PIT[2];
+uint64_t pit_ticks = 0;                       // Timer ticks seen by the PITs
+static uint64_t pit_next_event = UINT64_MAX;  // Earliest Next or Drop of a running counter
+static void pit_schedule();
 extern volatile uint8_t sdu_rx_ptr;
 extern volatile uint8_t sdu_rx_bot;
 extern volatile uint8_t sdu_rx_buf[64];
@@ -377,9 +395,95 @@ rtc_update_localtime(int force_p)
 }
 
 // Functions
+// Point a multibus page at whatever backs it
+static void multibus_page_update(int page){
+  mb_page_gen[page]++;
+  mb_read_page[page] = NULL;
+  mb_write_page[page] = NULL;
+  mb_dirty_page[page] = NULL;
+  if(MNA_MAP[page].Enable != 0){
+    nuAddr MNB_Addr;
+    uint8_t *board;
+    MNB_Addr.raw = 0;
+    MNB_Addr.Page = MNA_MAP[page].NUbus_Page;
+    board = mem_slot_ram(MNB_Addr.Card);
+    if(fast_memory != 0 && nubus_trace_map == NULL && board != NULL &&
+       MNB_Addr.Addr+1024 <= MEM_BOARD_SIZE){
+      mb_read_page[page] = board+MNB_Addr.Addr;
+      mb_write_page[page] = board+MNB_Addr.Addr;
+      mb_dirty_page[page] = mem_slot_dirty(MNB_Addr.Card,MNB_Addr.Addr);
+    }
+    return;
+  }
+  if(page < (RAM_TOP>>10)){
+    // SDU RAM
+    mb_read_page[page] = SDU_RAM+(page<<10);
+    mb_write_page[page] = SDU_RAM+(page<<10);
+  }else if(page >= (0x0F0000>>10)){
+    // SDU ROM
+    mb_read_page[page] = SDU_ROM+((page<<10)-0x0F0000);
+  }
+}
+
+void multibus_page_table_init(){
+  int page = 0;
+  while(page < MB_PAGES){
+    multibus_page_update(page);
+    page++;
+  }
+}
+
+// Snapshot support
+void sdu_snapshot(int op){
+  SNAP_ITEM(SDU_state);
+  SNAP_ITEM(SDU_RAM);
+  SNAP_ITEM(CMOS_RAM);
+  SNAP_ITEM(MNA_MAP);
+  SNAP_ITEM(PIC);
+  SNAP_ITEM(PIT);
+  SNAP_ITEM(pit_ticks);
+  SNAP_ITEM(pit_cycle_counter);
+  SNAP_ITEM(rtc_cycle_count);
+  SNAP_ITEM(rtc_addr);
+  SNAP_ITEM(RTC_Counter);
+  SNAP_ITEM(RTC_REGA);
+  SNAP_ITEM(RTC_REGB);
+  SNAP_ITEM(RTC_REGC);
+  SNAP_ITEM(RTC_REGD);
+  SNAP_ITEM(RTC_RAM);
+#ifdef BURR_BROWN
+  SNAP_ITEM(BB_Remote_Addr);
+  SNAP_ITEM(BB_Remote_Data);
+  SNAP_ITEM(BB_Remote_Result);
+  SNAP_ITEM(BB_Data);
+  SNAP_ITEM(BB_Drive_Data_Lines);
+  SNAP_ITEM(BB_Reg);
+  SNAP_ITEM(BB_Mode_Reg);
+#endif
+  SNAP_ITEM(sducons_tx_buf);
+  SNAP_ITEM(sducons_tx_top);
+  SNAP_ITEM(sducons_tx_bot);
+  SNAP_ITEM(sdu_nubus_enable);
+  SNAP_ITEM(sdu_multibus_enable);
+  SNAP_ITEM(nubus_timeout_reg);
+  SNAP_ITEM(sysconf_base);
+  SNAP_ITEM(proc0_conf_base);
+  SNAP_ITEM(proc1_conf_base);
+  SNAP_ITEM(chaos_share_base);
+  SNAP_ITEM(share_struct_base);
+  if(op == SNAP_LOAD){
+    // The clock stopped while we were saved
+    rtc_update_localtime(1);
+    multibus_page_table_init();
+    pit_schedule();
+  }
+}
+
 void sdu_init(){
   // Clobber RAM
   bzero(SDU_RAM,RAM_TOP);
+  nubus_register_slave(0xFF,sdu_nubus_slave,0,0);
+  multibus_page_table_init();
   // Initialize RTC
   RTC_REGA.Rate_Select = 2; // 32 KHz
   RTC_REGA.Divider_Select = 2; 
@@ -440,6 +544,8 @@ void sdu_ram_write(uint32_t addr, uint32_t wd){
   SDU_RAM[addr+1] = data.byte[1];
   SDU_RAM[addr+2] = data.byte[2];
   SDU_RAM[addr+3] = data.byte[3];
+  mb_page_gen[(addr>>10)&(MB_PAGES-1)]++;
+  mb_page_gen[((addr+3)>>10)&(MB_PAGES-1)]++;
 }
 
 uint32_t sdu_ram_read(uint32_t addr){
@@ -460,6 +566,7 @@ void boot_lambda(int cp,int step){
     pS[cp].PMR.Fast_Clock_Enable = 1;
     // Clear WCS
     bzero(pS[cp].WCS,16384*sizeof(uint64_t));
+    lambda_invalidate_wcs(cp,-1);
     // Initialize WCS map
     {
       int i;
@@ -489,6 +596,7 @@ void boot_lambda(int cp,int step){
     /* *********  Patches to Microcode go here ********* */
     logmsgf(LT_SYSTEM,1,"Patching loaded microcode...\n");
     pS[cp].WCS[016047].ASource = 01114;    // Fix to XGCD1+2 - Add1 to Rotate Field Sub1 from Length
+    lambda_invalidate_wcs(cp,016047);
     // All done, continue
     logmsgf(LT_SYSTEM,1,"Starting loaded microcode...\n");
     // Write conf pointer to Qreg
@@ -807,6 +915,20 @@ uint16_t evaluate_pic(int pic){
   return(status);
 }
 
+// Could pic_chk() find an interrupt? A PIC only does anything when its
+// request lines differ from what it saw last time or an EOI left an ISR to
+// reservice, and PIC0's slave lines follow the slaves' ISRs. If none of that
+// changed since the last check, neither did the answer.
+int pic_pending(){
+  int x = 0;
+  if((PIC[0].IRQ&0xC0) != ((PIC[1].ISR != 0 ? 0x80 : 0)|(PIC[2].ISR != 0 ? 0x40 : 0))){ return(1); }
+  while(x < 3){
+    if(PIC[x].State == 4 && (PIC[x].IRQ != PIC[x].Last_IRQ || PIC[x].Pending_ISR != 0)){ return(1); }
+    x++;
+  }
+  return(0);
+}
+
 uint16_t pic_chk(){
   uint16_t status = 0;
   uint16_t pic_status[3] = { 0,0,0 };
@@ -891,132 +1013,164 @@ uint16_t pic_chk(){
 }
 
 // 8253 PIT
-uint8_t pit_read(int pit,int adr){
-  switch(adr){
-  default:
-    logmsgf(LT_SDU,10,"SDU: PIT %d REG %d READ\n",pit,adr);
-    ld_die_rq = 1;
-    return(0xFF);
-    break;
+// The PIT clock is nominally 1.2288 MHz, 768/3125 of the 5 MHz bus clock.
+#define PIT_CLOCK_MUL 768
+#define PIT_CLOCK_DIV 3125
+// Timer ticks a rate generator holds its interrupt after terminal count
+#define PIT_PULSE_TICKS 5
+
+// The counters are not stepped. A running counter remembers the tick it
+// started on, and the tick of its next output change is worked out from its
+// count. Nothing is done until the earliest of those comes around, and a
+// count that is read is worked out from the time the counter has run.
+
+// Initial count, where 0 is 65536
+static uint64_t pit_iv(int pit,int ctr){
+  return(PIT[pit].IV[ctr] == 0 ? 0x10000 : PIT[pit].IV[ctr]);
+}
+
+// PIT clocks from the start of the count to its nth output change
+static uint64_t pit_change_clocks(int pit,int ctr,uint64_t n){
+  if(PIT[pit].Mode[ctr] == 3){
+    // Square wave, the output toggles every half count
+    return(((n*pit_iv(pit,ctr))+1)/2);
   }
-  return(0x00);
+  // Rate generator, a pulse at each terminal count
+  return(n*pit_iv(pit,ctr));
 }
 
-// PIT_RATE is nominally 1.2288 MHz
-#define PIT_RATE (1.2288/5)
+// First tick on which the counter has run this many PIT clocks
+static uint64_t pit_clock_tick(int pit,int ctr,uint64_t clocks){
+  return(PIT[pit].Start[ctr]+(((clocks*PIT_CLOCK_DIV)+PIT_CLOCK_MUL-1)/PIT_CLOCK_MUL));
+}
+
+// Count of a counter right now
+static uint16_t pit_count(int pit,int ctr){
+  uint64_t clocks,iv = pit_iv(pit,ctr);
+  if(PIT[pit].State[ctr] != 1){ return(PIT[pit].Counter[ctr]); }
+  clocks = ((pit_ticks-PIT[pit].Start[ctr])*PIT_CLOCK_MUL)/PIT_CLOCK_DIV;
+  if(PIT[pit].Mode[ctr] == 3){
+    // Counts down by two, twice per count
+    return((iv-((clocks*2)%iv))&0xFFFF);
+  }
+  return((iv-(clocks%iv))&0xFFFF);
+}
+
+// Set the output of a counter. PIT 1's outputs are interrupts.
+static void pit_output(int pit,int ctr,uint8_t out){
+  uint8_t IRQ = 0x10<<ctr;
+  PIT[pit].Output[ctr] = out;
+  if(pit != 1){ return; }
+  if(out != 0){
+    PIC[1].IRQ |= IRQ;
+  }else{
+    PIC[1].IRQ &= ~IRQ;
+  }
+}
 
-void pit_clockpulse(){
+// Find the next time anything happens
+static void pit_schedule(){
   int x = 0;
+  pit_next_event = UINT64_MAX;
   while(x < 2){
     int y = 0;
     while(y < 3){
       if(PIT[x].State[y] == 1){
-	// Track ticks in state
-	if(PIT[x].Output_Ticks[y] < 5){ PIT[x].Output_Ticks[y]++; }
-	// Clock running
-	switch(PIT[x].Mode[y]){
-	case 2: // Rate Generator
-	  PIT[x].RCounter[y] -= PIT_RATE;
-	  if(PIT[x].RCounter[y] <= 0){ PIT[x].Counter[y] = 0; }else{ PIT[x].Counter[y] = PIT[x].RCounter[y]; }
-	  if(PIT[x].Counter[y] == 0){
-	    PIT[x].Output[y] = 1;
-	    // Interrupt
-	    if(x == 1){
-	      uint8_t IRQ = 0x10;
-	      IRQ <<= y;
-	      if((PIC[1].IRQ&IRQ) == 0){
-		PIC[1].IRQ |= IRQ;
-		PIT[x].Output_Ticks[y] = 0;
-	      }else{
-		logmsgf(LT_SDU,9,"PIT: CTR %d FIRED WHILE IRQ ALREADY SET\n",y);
-	      }
-	      /*
-	      if(x == 1 && y == 2){
-		extern uint8_t dotrace;
-		logmsgf(,,"PIT: DEBUG TRIGGER FIRED\n");
-		dotrace = 1;
-	      }
-	      */
-	    }
-	    // Reload
-	    PIT[x].RCounter[y] = PIT[x].Counter[y] = PIT[x].IV[y];
+	if(PIT[x].Next[y] < pit_next_event){ pit_next_event = PIT[x].Next[y]; }
+	if(PIT[x].Drop[y] != 0 && PIT[x].Drop[y] < pit_next_event){ pit_next_event = PIT[x].Drop[y]; }
+      }
+      y++;
+    }
+    x++;
+  }
+}
+
+// Start a counter on its initial count
+static void pit_start(int pit,int ctr){
+  if(PIT[pit].Mode[ctr] != 2 && PIT[pit].Mode[ctr] != 3){
+    logmsgf(LT_SDU,9,"pit_start(): Unknown mode %d\n",PIT[pit].Mode[ctr]);
+    ld_die_rq = 1;
+  }
+  PIT[pit].IV[ctr] = PIT[pit].Counter[ctr];
+  PIT[pit].Start[ctr] = pit_ticks;
+  PIT[pit].Changes[ctr] = 0;
+  PIT[pit].Next[ctr] = pit_clock_tick(pit,ctr,pit_change_clocks(pit,ctr,1));
+  if(PIT[pit].Mode[ctr] == 3){ PIT[pit].Drop[ctr] = 0; }
+  PIT[pit].State[ctr] = 1; // Run
+  pit_schedule();
+}
+
+// Make the output changes that are due
+static void pit_event(){
+  int x = 0;
+  while(x < 2){
+    int y = 0;
+    while(y < 3){
+      if(PIT[x].State[y] == 1){
+	// End of a rate generator's pulse. Hold it until the PIC has seen it;
+	// the 8088 checks between slices.
+	if(PIT[x].Drop[y] != 0 && PIT[x].Drop[y] <= pit_ticks){
+	  if(x == 1 && PIC[1].State == 4 && (PIC[1].Last_IRQ&(0x10<<y)) == 0){
+	    PIT[x].Drop[y] = pit_ticks+PIT_PULSE_TICKS;
 	  }else{
-	    PIT[x].Output[y] = 0;
-	    // Don't Interrupt
-	    if(x == 1){
-	      uint8_t IRQ = 0x10;
-	      IRQ <<= y;
-	      if((PIC[1].IRQ&IRQ) == IRQ && PIT[x].Output_Ticks[y] > 4){
-		PIC[1].IRQ ^= IRQ;
-		/*
-		if(x == 1 && y == 2){
-		  // extern uint8_t dotrace;
-		  logmsgf(,,"PIT: DEBUG TRIGGER UN-FIRED\n");
-		  // dotrace = 1;
-		}
-		*/
-	      }
-	    }
+	    PIT[x].Drop[y] = 0;
+	    pit_output(x,y,0);
 	  }
-	  break;
-
-	case 3: // Square Wave
-	  // Accumulate real time
-	  PIT[x].RCounter[y] += PIT_RATE;
-	  // If we have enough for a pulse
-	  while(PIT[x].RCounter[y] > 1){ 
-	    // Decrement counter at twice the normal rate.
-	    // See the datasheet for how/why.
-	    if(PIT[x].Counter[y]&0x01){
-	      if(PIT[x].Output[y] == 1){
-		PIT[x].Output[y]--;
-	      }else{
-		PIT[x].Output[y] -= 3;
-	      }
-	    }else{
-	      PIT[x].Counter[y] -= 2;
-	    }
-	    // When count runs out
-	    if(PIT[x].Counter[y] == 0){
-	      // Toggle output
-	      PIT[x].Output[y] ^= 1;
-	      // Reload
-	      PIT[x].Counter[y] = PIT[x].IV[y];
+	}
+	while(PIT[x].Next[y] <= pit_ticks){
+	  PIT[x].Changes[y]++;
+	  if(PIT[x].Mode[y] == 3){
+	    pit_output(x,y,PIT[x].Output[y]^1);
+	  }else{
+	    if(x == 1 && (PIC[1].IRQ&(0x10<<y)) != 0){
+	      logmsgf(LT_SDU,9,"PIT: CTR %d FIRED WHILE IRQ ALREADY SET\n",y);
 	    }
-	    // Use up real time
-	    PIT[x].RCounter[y] -= 1;
+	    pit_output(x,y,1);
+	    PIT[x].Drop[y] = PIT[x].Next[y]+PIT_PULSE_TICKS;
 	  }
-	  // Set/Unset IRQ
-	  if(PIT[x].Output[y] == 1){
-            // Interrupt
-            if(x == 1){
-              uint8_t IRQ = 0x10;
-              IRQ <<= y;
-              if((PIC[1].IRQ&IRQ) == 0){
-                PIC[1].IRQ |= IRQ;
-              }
-            }
-          }else{
-            // Don't Interrupt
-            if(x == 1){
-              uint8_t IRQ = 0x10;
-              IRQ <<= y;
-              if((PIC[1].IRQ&IRQ) == IRQ){
-                PIC[1].IRQ ^= IRQ;
-              }
-            }
-          }
-          break;
-	  
-	default:
-	  logmsgf(LT_SDU,9,"pit_clockpulse(): Unknown mode %d\n",PIT[x].Mode[y]);
-	  ld_die_rq = 1;
+	  PIT[x].Next[y] = pit_clock_tick(x,y,pit_change_clocks(x,y,PIT[x].Changes[y]+1));
 	}
       }
       y++;
     }
     x++;
   }
+  pit_schedule();
+}
+
+uint8_t pit_read(int pit,int adr){
+  switch(adr){
+  case 0: // COUNTER 0
+  case 1: // COUNTER 1
+  case 2: // COUNTER 2
+    {
+      uint16_t count = pit_count(pit,adr);
+      uint8_t hi;
+      if(PIT[pit].Latched[adr] != 0){
+	count = PIT[pit].Latch[adr];
+	PIT[pit].Latched[adr]--;
+      }
+      switch(PIT[pit].Format[adr]){
+      case 1: // LOW
+	hi = 0; break;
+      case 2: // HI
+	hi = 1; break;
+      default: // LOW/HI
+	hi = PIT[pit].ReadHW[adr];
+	PIT[pit].ReadHW[adr] ^= 1;
+	break;
+      }
+      logmsgf(LT_SDU,10,"SDU: PIT #%d Counter %d Read = 0x%X\n",pit,adr,count);
+      return(hi != 0 ? count>>8 : count&0xFF);
+    }
+    break;
+  default:
+    logmsgf(LT_SDU,10,"SDU: PIT %d REG %d READ\n",pit,adr);
+    ld_die_rq = 1;
+    return(0xFF);
+    break;
+  }
+  return(0x00);
 }
 
 void pit_write(int pit, int adr, uint8_t data){
@@ -1032,9 +1186,7 @@ void pit_write(int pit, int adr, uint8_t data){
       if(PIT[pit].Format[adr] == 3){
 	PIT[pit].LoadHW[adr]++;
       }else{
-	PIT[pit].RCounter[adr] = PIT[pit].Counter[adr];
-	PIT[pit].IV[adr] = PIT[pit].Counter[adr];
-	PIT[pit].State[adr] = 1; // Run
+	pit_start(pit,adr);
       }
       break;
     }
@@ -1045,9 +1197,7 @@ void pit_write(int pit, int adr, uint8_t data){
       if(PIT[pit].Format[adr] == 3){
 	PIT[pit].LoadHW[adr] = 0;
       }
-      PIT[pit].RCounter[adr] = PIT[pit].Counter[adr];
-      PIT[pit].IV[adr] = PIT[pit].Counter[adr];
-      PIT[pit].State[adr] = 1; // Run
+      pit_start(pit,adr);
       break;
     }
     break;
@@ -1057,21 +1207,35 @@ void pit_write(int pit, int adr, uint8_t data){
       uint8_t ctr = ((data&0xC0)>>6);
       uint8_t fmt = ((data&0x30)>>4);
       uint8_t mod = ((data&0x0E)>>1);
+      if(ctr == 3){
+	logmsgf(LT_SDU,10,"SDU: PIT #%d bad control word 0x%X\n",pit,data);
+	break;
+      }
+      if(fmt == 0){
+	// LATCH, the mode doesn't change
+	logmsgf(LT_SDU,10,"SDU: PIT #%d LATCH CTR %d\n",pit,ctr);
+	PIT[pit].Latch[ctr] = pit_count(pit,ctr);
+	PIT[pit].Latched[ctr] = (PIT[pit].Format[ctr] == 3 ? 2 : 1);
+	break;
+      }
       logmsgf(LT_SDU,10,"SDU: PIT #%d MODE: CTR %d FMT %d MODE %d\n",pit,ctr,fmt,mod);
+      // Modes 6 and 7 are 2 and 3
+      if(mod > 5){ mod -= 4; }
       // Make it so
       PIT[pit].Format[ctr] = fmt;
       PIT[pit].Mode[ctr] = mod;
       PIT[pit].Control[ctr] = (data&0x3F);
       PIT[pit].State[ctr] = 0; // Load
+      PIT[pit].Latched[ctr] = 0;
+      PIT[pit].ReadHW[ctr] = 0;
       switch(fmt){
-      case 0: // LATCH
-	logmsgf(LT_SDU,0,"LATCH NI\n"); ld_die_rq=1; break;
       case 1: // LOW
       case 3: // LOW/HI
 	PIT[pit].LoadHW[ctr] = 0; break;
       case 2: // HI
 	PIT[pit].LoadHW[ctr] = 1; break;
       }
+      pit_schedule();
     }
     break;
 
@@ -1101,6 +1265,11 @@ void sducons_rx_int(){
 
 // Peripherals use this. The 8088's 8-bit BIU cannot generate 16-bit bus cycles.
 uint16_t multibus_word_read(mbAddr addr){
+  // Plain memory?
+  if(addr.raw < 0x100000 && (addr.raw&1) == 0 && mb_read_page[addr.Page] != NULL){
+    if(MNA_MAP[addr.Page].Enable != 0){ nubus_timeout_reg = 0; }
+    return(*(uint16_t *)(mb_read_page[addr.Page]+addr.Offset));
+  }
   // HANDLE NUBUS MAP
   if(MNA_MAP[addr.Page].Enable != 0){
     nuAddr MNB_Addr;
@@ -1112,6 +1281,7 @@ uint16_t multibus_word_read(mbAddr addr){
     }
     // Obtain bus if we don't already have it
     while(NUbus_Busy != 0 && NUbus_master != 0xFF){
+      nubus_wait(0xFF);
       nubus_cycle(1);
     }
     // Place request on bus, lighting the low bit to indicate halfword-ness
@@ -1154,6 +1324,11 @@ uint16_t multibus_word_read(mbAddr addr){
 }
 
 uint8_t multibus_read(mbAddr addr){
+  // Plain memory?
+  if(addr.raw < 0x100000 && mb_read_page[addr.Page] != NULL){
+    if(MNA_MAP[addr.Page].Enable != 0){ nubus_timeout_reg = 0; }
+    return(mb_read_page[addr.Page][addr.Offset]);
+  }
   // HANDLE NUBUS MAP
   if(MNA_MAP[addr.Page].Enable != 0){
     nuAddr MNB_Addr;
@@ -1165,6 +1340,7 @@ uint8_t multibus_read(mbAddr addr){
     }
     // Obtain bus if we don't already have it
     while(NUbus_Busy != 0 && NUbus_master != 0xFF){
+      nubus_wait(0xFF);
       nubus_cycle(1);
     }
     // Place request on bus
@@ -1342,6 +1518,19 @@ uint8_t multibus_read(mbAddr addr){
     }
     break;
     
+  case 0x1c160: // PIT #1 Counter 0 register (Console Baud Rate Generator)
+    return(pit_read(1,0));
+    break;
+  case 0x1c164: // PIT #1 Counter 1 register (Aux Baud Rate Generator)
+    return(pit_read(1,1));
+    break;
+  case 0x1c168: // PIT #1 Counter 2 register
+    return(pit_read(1,2));
+    break;
+  case 0x1c170: // PIT #0 counter #0
+    return(pit_read(0,0));
+    break;
+
   case 0x1c180: // nubus timeout registeer
     logmsgf(LT_NUBUS,10,"i8088: NUBUS TIMEOUT REG READ\n");
     return(nubus_timeout_reg);
@@ -1432,6 +1621,15 @@ uint8_t multibus_read(mbAddr addr){
 
 // Peripherals use this. The 8088's 8-bit BIU cannot generate 16-bit bus cycles.
 void multibus_word_write(mbAddr addr,uint16_t data){
+  // Plain memory?
+  if(addr.raw < 0x100000 && (addr.raw&1) == 0 && mb_write_page[addr.Page] != NULL){
+    // A memory board page; a parked processor may be waiting for this write
+    if(MNA_MAP[addr.Page].Enable != 0){ nubus_timeout_reg = 0; IDLE_WAKE(); }
+    if(mb_dirty_page[addr.Page] != NULL){ *mb_dirty_page[addr.Page] = 1; }
+    mb_page_gen[addr.Page]++;
+    *(uint16_t *)(mb_write_page[addr.Page]+addr.Offset) = data;
+    return;
+  }
   // HANDLE NUBUS MAP
   if(MNA_MAP[addr.Page].Enable != 0){
     nuAddr MNB_Addr;
@@ -1444,6 +1642,7 @@ void multibus_word_write(mbAddr addr,uint16_t data){
     }
     // Obtain bus if we don't already have it
     while(NUbus_Busy != 0 && NUbus_master != 0xFF){
+      nubus_wait(0xFF);
       nubus_cycle(1);
     }
     // Place request on bus
@@ -1476,7 +1675,134 @@ void multibus_word_write(mbAddr addr,uint16_t data){
   }
 }
 
+// Block transfers through the NUbus map. These move the largest NUbus block
+// that fits at the address, in one bus transaction, and return the number of
+// bytes moved. They return 0 if the transfer can't be done as a block
+// (unmapped, unaligned, too short, or the card doesn't do blocks), and the
+// caller should use the byte and word functions instead.
+// Pages in the page table are simply copied, up to the whole length.
+static int multibus_block_setup(mbAddr addr,int len,nuAddr *MNB_Addr){
+  int words = NUBUS_BLOCK_MAX;
+  if(MNA_MAP[addr.Page].Enable == 0 || (addr.raw&0x03) != 0){
+    return(0);
+  }
+  MNB_Addr->raw = 0;
+  MNB_Addr->Page = MNA_MAP[addr.Page].NUbus_Page;
+  MNB_Addr->Offset = addr.Offset;
+  if(nubus_slave[MNB_Addr->Card].blocks == 0){
+    return(0);
+  }
+  // Blocks are aligned to their length, which also keeps them inside the map page
+  while(words >= 2 && ((MNB_Addr->raw&((words*4)-1)) != 0 || len < (words*4))){
+    words >>= 1;
+  }
+  if(words < 2){
+    return(0);
+  }
+  return(words);
+}
+
+static void multibus_block_cycle(int access,nuAddr MNB_Addr,int words,uint8_t *buf){
+  // Obtain bus if we don't already have it
+  while(NUbus_Busy != 0 && NUbus_master != 0xFF){
+    nubus_wait(0xFF);
+    nubus_cycle(1);
+  }
+  if(access == VM_WRITE){
+    memcpy(NUbus_Block,buf,words*4);
+  }
+  // Place request on bus
+  nubus_io_request(access,0xFF,nubus_block_addr(MNB_Addr.raw,words),0);
+  // Await completion or error
+  while(NUbus_Busy != 0 && NUbus_error == 0 && NUbus_acknowledge == 0){
+    nubus_cycle(1);
+  }
+  // What did we get?
+  if(NUbus_error != 0){
+    // Light bus error reg
+    nubus_timeout_reg = 0xFF;
+    // Fire interrupt
+    PIC[0].IRQ |= 0x02;
+  }else{
+    nubus_timeout_reg = 0;
+  }
+  if(access == VM_READ){
+    if(NUbus_acknowledge != 0){
+      memcpy(buf,NUbus_Block,words*4);
+    }else{
+      memset(buf,0xFF,words*4);
+    }
+  }
+}
+
+// Copy to or from pages that are in the page table, a page at a time.
+// Returns the bytes moved, which stop at the first page that isn't.
+static int multibus_direct_copy(mbAddr addr,uint8_t *buf,int len,int write){
+  int done = 0;
+  while(done < len){
+    mbAddr at;
+    int count;
+    at.raw = addr.raw+done;
+    if(at.raw >= 0x100000){ break; }
+    count = 1024-at.Offset;
+    if(count > len-done){ count = len-done; }
+    if(write != 0){
+      if(mb_write_page[at.Page] == NULL){ break; }
+      if(mb_dirty_page[at.Page] != NULL){ *mb_dirty_page[at.Page] = 1; }
+      mb_page_gen[at.Page]++;
+      memcpy(mb_write_page[at.Page]+at.Offset,buf+done,count);
+      // As for a single write to a memory board page
+      if(MNA_MAP[at.Page].Enable != 0){ IDLE_WAKE(); }
+    }else{
+      if(mb_read_page[at.Page] == NULL){ break; }
+      memcpy(buf+done,mb_read_page[at.Page]+at.Offset,count);
+    }
+    if(MNA_MAP[at.Page].Enable != 0){ nubus_timeout_reg = 0; }
+    done += count;
+  }
+  return(done);
+}
+
+int multibus_block_read(mbAddr addr,uint8_t *buf,int len){
+  nuAddr MNB_Addr;
+  int words;
+  int moved = multibus_direct_copy(addr,buf,len,0);
+  if(moved > 0){
+    return(moved);
+  }
+  words = multibus_block_setup(addr,len,&MNB_Addr);
+  if(words == 0){
+    return(0);
+  }
+  multibus_block_cycle(VM_READ,MNB_Addr,words,buf);
+  return(words*4);
+}
+
+int multibus_block_write(mbAddr addr,uint8_t *buf,int len){
+  nuAddr MNB_Addr;
+  int words;
+  int moved = multibus_direct_copy(addr,buf,len,1);
+  if(moved > 0){
+    return(moved);
+  }
+  words = multibus_block_setup(addr,len,&MNB_Addr);
+  if(words == 0){
+    return(0);
+  }
+  multibus_block_cycle(VM_WRITE,MNB_Addr,words,buf);
+  return(words*4);
+}
+
 void multibus_write(mbAddr addr,uint8_t data){
+  // Plain memory?
+  if(addr.raw < 0x100000 && mb_write_page[addr.Page] != NULL){
+    // A memory board page; a parked processor may be waiting for this write
+    if(MNA_MAP[addr.Page].Enable != 0){ nubus_timeout_reg = 0; IDLE_WAKE(); }
+    if(mb_dirty_page[addr.Page] != NULL){ *mb_dirty_page[addr.Page] = 1; }
+    mb_page_gen[addr.Page]++;
+    mb_write_page[addr.Page][addr.Offset] = data;
+    return;
+  }
   // HANDLE NUBUS MAP
   if(MNA_MAP[addr.Page].Enable != 0){
     nuAddr MNB_Addr;
@@ -1490,6 +1816,7 @@ void multibus_write(mbAddr addr,uint8_t data){
     }
     // Obtain bus if we don't already have it
     while(NUbus_Busy != 0 && NUbus_master != 0xFF){
+      nubus_wait(0xFF);
       if(NUbus_trace == 1){
 	logmsgf(LT_NUBUS,10,"SDU: Awaiting NUBUS: %d\n",NUbus_Busy);
       }
@@ -1739,6 +2066,7 @@ void multibus_write(mbAddr addr,uint8_t data){
       int MAP_Addr = ((addr.raw-0x18000)>>2);
       int byte = addr.raw&0x03;
       MNA_MAP[MAP_Addr].byte[byte] = data;
+      multibus_page_update(MAP_Addr);
     }
     break;
 
@@ -1881,8 +2209,10 @@ void i8088_port_write(uint32_t addr,uint8_t data){
 
 void sdu_clock_pulse(){
   // Step 8088 PITs
-  // The SDU PIT clock is 1.2288 MHz
-  pit_clockpulse();
+  pit_ticks += timer_tick;
+  if(pit_ticks >= pit_next_event){
+    pit_event();
+  }
   // Drive console (HACK HACK)
   // PIT doesn't work properly yet so this fakes the approximate rate.
   pit_cycle_counter++;
@@ -1900,7 +2230,7 @@ void sdu_clock_pulse(){
   // RTC updation
   if(RTC_REGB.Set == 0){
     // We are enabled
-    rtc_cycle_count++;
+    rtc_cycle_count += timer_tick;
     // Lambda has a 5MHz clock.
     // At 32 KHz, it takes 1984 microseconds to update the clock.
     if(rtc_cycle_count >= 5000000){
@@ -1972,1105 +2302,1102 @@ void sdu_clock_pulse(){
       RTC_REGA.Update_In_Progress = 0;      
     }
   }
+}
 
-  // SDU nubus interface
-  // If the bus is busy and not acknowledged...
-  if(NUbus_Busy == 2 && NUbus_acknowledge == 0){
-    // Is it us?
-    if(NUbus_Address.Card == 0xFF){
-      // Yes, answer.
-
-      // THIS IS THE SDU ADDRESS SPACE LAYOUT (AS SEEN FROM THE NUBUS)
-      // 0x000000 - 0x00FFFF = SDU RAM
-      // 0x018000 - 0x018FFF = Multibus -> NUbus map control registers
-      // 0x01C000 - 0x01C3FF = SDU register page (serial ports, etc)
-      // 0x01E000 - 0x01FFFF = CMOS RAM
-      // 0x02F800 - 0x02FBFF = Second burr-brown
-      // 0x02FC00 - 0x02FFFF = First burr-brown
-      // 0x030000 - 0x031FFF = 3Com ethernet
-      // 0x040000 - 0x0EFFFF = DYNAMICALLY ALLOCATED MAPPED AREA (MAPPED TO NUBUS!)
-      // 0x0F0000 - 0x0FFFFF = SDU ROM
-
-      switch(NUbus_Address.Addr){
-      case 0x000000 ... 0x00FFFF: // SDU RAM
-	{
-	  uint32_t MEM_Addr = NUbus_Address.Addr;
-	  if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	    if(NUbus_Request == VM_READ){ // Read four bytes
-	      switch(NUbus_Address.Byte){
-	      case 1: // Read Low Half
-		NUbus_Data.byte[1] = SDU_RAM[MEM_Addr];
-		NUbus_Data.byte[0] = SDU_RAM[MEM_Addr-1];
-		break;
+// NUbus slave, called when a request is addressed to our card
+void sdu_nubus_slave(int arg __attribute__ ((unused))){
+  // THIS IS THE SDU ADDRESS SPACE LAYOUT (AS SEEN FROM THE NUBUS)
+  // 0x000000 - 0x00FFFF = SDU RAM
+  // 0x018000 - 0x018FFF = Multibus -> NUbus map control registers
+  // 0x01C000 - 0x01C3FF = SDU register page (serial ports, etc)
+  // 0x01E000 - 0x01FFFF = CMOS RAM
+  // 0x02F800 - 0x02FBFF = Second burr-brown
+  // 0x02FC00 - 0x02FFFF = First burr-brown
+  // 0x030000 - 0x031FFF = 3Com ethernet
+  // 0x040000 - 0x0EFFFF = DYNAMICALLY ALLOCATED MAPPED AREA (MAPPED TO NUBUS!)
+  // 0x0F0000 - 0x0FFFFF = SDU ROM
+
+  switch(NUbus_Address.Addr){
+  case 0x000000 ... 0x00FFFF: // SDU RAM
+    {
+      uint32_t MEM_Addr = NUbus_Address.Addr;
+      if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+	if(NUbus_Request == VM_READ){ // Read four bytes
+	  switch(NUbus_Address.Byte){
+	  case 1: // Read Low Half
+	    NUbus_Data.byte[1] = SDU_RAM[MEM_Addr];
+	    NUbus_Data.byte[0] = SDU_RAM[MEM_Addr-1];
+	    break;
 		
-	      case 2: // Block Transfer
-		logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
-		ld_die_rq=1;
-		break;
+	  case 2: // Block Transfer
+	    logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
+	    ld_die_rq=1;
+	    break;
 		
-	      case 3: // Read High Half
-		NUbus_Data.byte[3] = SDU_RAM[MEM_Addr];
-		NUbus_Data.byte[2] = SDU_RAM[MEM_Addr-1];
-		break;
+	  case 3: // Read High Half
+	    NUbus_Data.byte[3] = SDU_RAM[MEM_Addr];
+	    NUbus_Data.byte[2] = SDU_RAM[MEM_Addr-1];
+	    break;
 		
-	      case 0:
-		// Full word read
-		NUbus_Data.byte[3] = SDU_RAM[MEM_Addr+3];
-		NUbus_Data.byte[2] = SDU_RAM[MEM_Addr+2];
-		NUbus_Data.byte[1] = SDU_RAM[MEM_Addr+1];
-		NUbus_Data.byte[0] = SDU_RAM[MEM_Addr];
-		break;
-	      }
-	    }else{
-	      // BYTE READ
-	      NUbus_Data.byte[NUbus_Address.Byte] = SDU_RAM[MEM_Addr];
-	    }
-	    if(SDU_RAM_trace){
-	      logmsgf(LT_SDU,10,"SDU: RAM Read: Request %o Addr 0x%X (0x%X",NUbus_Request,NUbus_Address.raw,MEM_Addr);
-	      if(MEM_Addr >= sysconf_base && MEM_Addr <= (sysconf_base+sizeof(system_configuration_qs))){
-		uint32_t Offset = (MEM_Addr-sysconf_base)/4;
-		logmsgf(LT_SDU,10,", sysconf %s",sysconf_q_names[Offset]);
-	      }
-	      if(MEM_Addr >= proc0_conf_base && MEM_Addr <= (proc0_conf_base+sizeof(processor_configuration_qs))){
-		uint32_t Offset = (MEM_Addr-proc0_conf_base)/4;
-		logmsgf(LT_SDU,10,", proc0_conf %s",proc_conf_q_names[Offset]);
-	      }
-	      if(MEM_Addr >= proc1_conf_base && MEM_Addr <= (proc1_conf_base+sizeof(processor_configuration_qs))){
-		uint32_t Offset = (MEM_Addr-proc1_conf_base)/4;
-		logmsgf(LT_SDU,10,", proc1_conf %s",proc_conf_q_names[Offset]);
-	      }
-	      logmsgf(LT_SDU,10,")");
-	      if(NUbus_Data.word == 0){
-		logmsgf(LT_SDU,10," returned zeroes");
-	      }else{
-		logmsgf(LT_SDU,10," returned 0x%X",NUbus_Data.word);
-	      }
-	      logmsgf(LT_SDU,10,"\n"); 
-	    }
-	    NUbus_acknowledge=1;
-	    return;
+	  case 0:
+	    // Full word read
+	    NUbus_Data.byte[3] = SDU_RAM[MEM_Addr+3];
+	    NUbus_Data.byte[2] = SDU_RAM[MEM_Addr+2];
+	    NUbus_Data.byte[1] = SDU_RAM[MEM_Addr+1];
+	    NUbus_Data.byte[0] = SDU_RAM[MEM_Addr];
+	    break;
 	  }
-	  // Write
-	  if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
-	    if(NUbus_Request == VM_BYTE_WRITE){
-	      SDU_RAM[MEM_Addr] = NUbus_Data.byte[NUbus_Address.Byte];               // Store data
-	    }else{
-	      // WORD WRITE
-	      switch(NUbus_Address.Byte){
-	      case 1: // Write low half
-		SDU_RAM[MEM_Addr-1] = NUbus_Data.byte[0];
-		SDU_RAM[MEM_Addr] = NUbus_Data.byte[1];
-		break;
-		
-	      case 2: // BLOCK TRANSFER
-		logmsgf(LT_SDU,0,"SDU: BLOCK TRANSFER REQUESTED\n");
-		ld_die_rq=1;
-		break;
-		
-	      case 3: // Write high half
-		SDU_RAM[MEM_Addr-1] = NUbus_Data.byte[2];
-		SDU_RAM[MEM_Addr] = NUbus_Data.byte[3];
-		break;
-		
-	      case 0: // Full Word
-		SDU_RAM[MEM_Addr] = NUbus_Data.byte[0];
-		SDU_RAM[MEM_Addr+1] = NUbus_Data.byte[1];
-		SDU_RAM[MEM_Addr+2] = NUbus_Data.byte[2];
-		SDU_RAM[MEM_Addr+3] = NUbus_Data.byte[3];
-		break;
-	      }
-	    }
-	    if(SDU_RAM_trace){
-	      logmsgf(LT_SDU,10,"SDU: RAM Write: Request %o Addr 0x%X (0x%X",NUbus_Request,NUbus_Address.raw,MEM_Addr);
-	      if(MEM_Addr >= sysconf_base && MEM_Addr <= (sysconf_base+sizeof(system_configuration_qs))){
-		uint32_t Offset = (MEM_Addr-sysconf_base)/4;
-		logmsgf(LT_SDU,10,", sysconf %s",sysconf_q_names[Offset]);
-	      }
-	      if(MEM_Addr >= proc0_conf_base && MEM_Addr <= (proc0_conf_base+sizeof(processor_configuration_qs))){
-		uint32_t Offset = (MEM_Addr-proc0_conf_base)/4;
-		logmsgf(LT_SDU,10,", proc0_conf %s",proc_conf_q_names[Offset]);
-	      }
-	      if(MEM_Addr >= proc1_conf_base && MEM_Addr <= (proc1_conf_base+sizeof(processor_configuration_qs))){
-		uint32_t Offset = (MEM_Addr-proc1_conf_base)/4;
-		logmsgf(LT_SDU,10,", proc1_conf %s",proc_conf_q_names[Offset]);
-	      }
-	      logmsgf(LT_SDU,10,") data 0x%X\n",NUbus_Data.word);
-	    }
-	    NUbus_acknowledge=1;
-	    return;
+	}else{
+	  // BYTE READ
+	  NUbus_Data.byte[NUbus_Address.Byte] = SDU_RAM[MEM_Addr];
+	}
+	if(SDU_RAM_trace){
+	  logmsgf(LT_SDU,10,"SDU: RAM Read: Request %o Addr 0x%X (0x%X",NUbus_Request,NUbus_Address.raw,MEM_Addr);
+	  if(MEM_Addr >= sysconf_base && MEM_Addr <= (sysconf_base+sizeof(system_configuration_qs))){
+	    uint32_t Offset = (MEM_Addr-sysconf_base)/4;
+	    logmsgf(LT_SDU,10,", sysconf %s",sysconf_q_names[Offset]);
 	  }
+	  if(MEM_Addr >= proc0_conf_base && MEM_Addr <= (proc0_conf_base+sizeof(processor_configuration_qs))){
+	    uint32_t Offset = (MEM_Addr-proc0_conf_base)/4;
+	    logmsgf(LT_SDU,10,", proc0_conf %s",proc_conf_q_names[Offset]);
+	  }
+	  if(MEM_Addr >= proc1_conf_base && MEM_Addr <= (proc1_conf_base+sizeof(processor_configuration_qs))){
+	    uint32_t Offset = (MEM_Addr-proc1_conf_base)/4;
+	    logmsgf(LT_SDU,10,", proc1_conf %s",proc_conf_q_names[Offset]);
+	  }
+	  logmsgf(LT_SDU,10,")");
+	  if(NUbus_Data.word == 0){
+	    logmsgf(LT_SDU,10," returned zeroes");
+	  }else{
+	    logmsgf(LT_SDU,10," returned 0x%X",NUbus_Data.word);
+	  }
+	  logmsgf(LT_SDU,10,"\n"); 
 	}
-	break;
-
-      case 0x0F0000 ... 0x0FFFFF: // SDU ROM
-	{
-	  uint32_t MEM_Addr = NUbus_Address.Addr-0x0F0000;
-	  if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	    if(NUbus_Request == VM_READ){ // Read four bytes
-	      switch(NUbus_Address.Byte){
-	      case 1: // Read Low Half
-		NUbus_Data.byte[1] = SDU_ROM[MEM_Addr];
-		NUbus_Data.byte[0] = SDU_ROM[MEM_Addr-1];
-		break;
+	NUbus_acknowledge=1;
+	return;
+      }
+      // Write
+      if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
+	if(NUbus_Request == VM_BYTE_WRITE){
+	  SDU_RAM[MEM_Addr] = NUbus_Data.byte[NUbus_Address.Byte];               // Store data
+	}else{
+	  // WORD WRITE
+	  switch(NUbus_Address.Byte){
+	  case 1: // Write low half
+	    SDU_RAM[MEM_Addr-1] = NUbus_Data.byte[0];
+	    SDU_RAM[MEM_Addr] = NUbus_Data.byte[1];
+	    break;
 		
-	      case 2: // Block Transfer
-		logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
-		ld_die_rq=1;
-		break;
+	  case 2: // BLOCK TRANSFER
+	    logmsgf(LT_SDU,0,"SDU: BLOCK TRANSFER REQUESTED\n");
+	    ld_die_rq=1;
+	    break;
 		
-	      case 3: // Read High Half
-		NUbus_Data.byte[3] = SDU_ROM[MEM_Addr];
-		NUbus_Data.byte[2] = SDU_ROM[MEM_Addr-1];
-		break;
+	  case 3: // Write high half
+	    SDU_RAM[MEM_Addr-1] = NUbus_Data.byte[2];
+	    SDU_RAM[MEM_Addr] = NUbus_Data.byte[3];
+	    break;
 		
-	      case 0:
-		// Full word read
-		NUbus_Data.byte[3] = SDU_ROM[MEM_Addr+3];
-		NUbus_Data.byte[2] = SDU_ROM[MEM_Addr+2];
-		NUbus_Data.byte[1] = SDU_ROM[MEM_Addr+1];
-		NUbus_Data.byte[0] = SDU_ROM[MEM_Addr];
-		break;
-	      }
-	    }else{
-	      // BYTE READ
-	      NUbus_Data.byte[NUbus_Address.Byte] = SDU_ROM[MEM_Addr];
-	    }
-	    NUbus_acknowledge=1;
-	    return;
+	  case 0: // Full Word
+	    SDU_RAM[MEM_Addr] = NUbus_Data.byte[0];
+	    SDU_RAM[MEM_Addr+1] = NUbus_Data.byte[1];
+	    SDU_RAM[MEM_Addr+2] = NUbus_Data.byte[2];
+	    SDU_RAM[MEM_Addr+3] = NUbus_Data.byte[3];
+	    break;
 	  }
-	  logmsgf(LT_SDU,0,"SDU: Write to ROM?\n");
 	}
-	break;
-
-      case 0x1E000 ... 0x1FFFF: // CMOS
-	{
-	  uint32_t CMOS_Addr = ((NUbus_Address.Addr-0x1E000)>>2);
-	  // Handle it
-	  if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	    if(NUbus_Request == VM_READ){ // Read four bytes
-	      switch(NUbus_Address.Byte){
-	      case 1: // Read Low Half
-		NUbus_Data.byte[1] = 0;
-		NUbus_Data.byte[0] = CMOS_RAM[CMOS_Addr];
-		break;
-		
-	      case 2: // Block Transfer
-		logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
-		ld_die_rq=1;
-		break;
-		
-	      case 3: // Read High Half
-		NUbus_Data.byte[3] = 0;
-		NUbus_Data.byte[2] = CMOS_RAM[CMOS_Addr];
-		break;
-		
-	      case 0:
-		// Full word read
-		NUbus_Data.byte[3] = NUbus_Data.byte[2] = NUbus_Data.byte[1] = 0;
-		NUbus_Data.byte[0] = CMOS_RAM[CMOS_Addr];
-		break;
-	      }
-	    }else{
-	      NUbus_Data.byte[NUbus_Address.Byte] = CMOS_RAM[CMOS_Addr];
-	    }
-	    NUbus_acknowledge=1;
-	    return;
+	// The 8088 may have code here
+	mb_page_gen[((MEM_Addr-1)>>10)&(MB_PAGES-1)]++;
+	mb_page_gen[((MEM_Addr+3)>>10)&(MB_PAGES-1)]++;
+	if(SDU_RAM_trace){
+	  logmsgf(LT_SDU,10,"SDU: RAM Write: Request %o Addr 0x%X (0x%X",NUbus_Request,NUbus_Address.raw,MEM_Addr);
+	  if(MEM_Addr >= sysconf_base && MEM_Addr <= (sysconf_base+sizeof(system_configuration_qs))){
+	    uint32_t Offset = (MEM_Addr-sysconf_base)/4;
+	    logmsgf(LT_SDU,10,", sysconf %s",sysconf_q_names[Offset]);
 	  }
-	  if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
-	    ld_die_rq = 1;
+	  if(MEM_Addr >= proc0_conf_base && MEM_Addr <= (proc0_conf_base+sizeof(processor_configuration_qs))){
+	    uint32_t Offset = (MEM_Addr-proc0_conf_base)/4;
+	    logmsgf(LT_SDU,10,", proc0_conf %s",proc_conf_q_names[Offset]);
 	  }
+	  if(MEM_Addr >= proc1_conf_base && MEM_Addr <= (proc1_conf_base+sizeof(processor_configuration_qs))){
+	    uint32_t Offset = (MEM_Addr-proc1_conf_base)/4;
+	    logmsgf(LT_SDU,10,", proc1_conf %s",proc_conf_q_names[Offset]);
+	  }
+	  logmsgf(LT_SDU,10,") data 0x%X\n",NUbus_Data.word);
 	}
-	break;
+	NUbus_acknowledge=1;
+	return;
+      }
+    }
+    break;
 
-      case 0x18000 ... 0x18FFF: // multibus -> nubus map
-	{
-	  int MAP_Addr = ((NUbus_Address.Addr-0x18000)>>2);
-	  /*      
-		  1024 registers
-		  each 32 bits, of which 24 are present.
-		  1 bit enable, 1 bit unused, 22 bits hi NUBUS adr.
-		  divide 20 bit multibus into 2 10 bit pieces:
-		  each register maps a 1K byte segment to a 1K nubus page.	  
-	  */
-	  /* THEY ONLY WORK IF REFERENCED ON SINGLE BYTE TRANSFERS. (???) */
-	  if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	    if(NUbus_Request == VM_READ){ // Read four bytes
-	      switch(NUbus_Address.Byte){
-	      case 1: // Read Low Half
-		NUbus_Data.byte[1] = MNA_MAP[MAP_Addr].byte[1];
-		NUbus_Data.byte[0] = MNA_MAP[MAP_Addr].byte[0];
-		break;
-		
-	      case 2: // Block Transfer
-		logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
-		ld_die_rq=1;
-		break;
-		
-	      case 3: // Read High Half
-		NUbus_Data.byte[3] = MNA_MAP[MAP_Addr].byte[3];
-		NUbus_Data.byte[2] = MNA_MAP[MAP_Addr].byte[2];
-		break;
-		
-	      case 0:
-		// Full word read, supposedly does not work
-		NUbus_Data.word = MNA_MAP[MAP_Addr].word;
-		break;
-	      }
-	    }else{
-	      // BYTE READ
-	      NUbus_Data.byte[NUbus_Address.Byte] = MNA_MAP[MAP_Addr].byte[NUbus_Address.Byte]; 
-	    }
-	    NUbus_acknowledge=1;
-	    return;
-	  }
-	  // Write
-	  if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
-	    if(NUbus_Request == VM_BYTE_WRITE){
-	      MNA_MAP[MAP_Addr].byte[NUbus_Address.Byte] = NUbus_Data.byte[NUbus_Address.Byte];
-	    }else{
-	      // WORD WRITE
-	      switch(NUbus_Address.Byte){
-	      case 1: // Write low half
-		MNA_MAP[MAP_Addr].byte[0] = NUbus_Data.byte[0];
-		MNA_MAP[MAP_Addr].byte[1] = NUbus_Data.byte[1];
-		break;
+  case 0x0F0000 ... 0x0FFFFF: // SDU ROM
+    {
+      uint32_t MEM_Addr = NUbus_Address.Addr-0x0F0000;
+      if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+	if(NUbus_Request == VM_READ){ // Read four bytes
+	  switch(NUbus_Address.Byte){
+	  case 1: // Read Low Half
+	    NUbus_Data.byte[1] = SDU_ROM[MEM_Addr];
+	    NUbus_Data.byte[0] = SDU_ROM[MEM_Addr-1];
+	    break;
 		
-	      case 2: // BLOCK TRANSFER
-		logmsgf(LT_SDU,0,"SDU: BLOCK TRANSFER REQUESTED\n");
-		ld_die_rq=1;
-		break;
+	  case 2: // Block Transfer
+	    logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
+	    ld_die_rq=1;
+	    break;
 		
-	      case 3: // Write high half
-		MNA_MAP[MAP_Addr].byte[2] = NUbus_Data.byte[2];
-		MNA_MAP[MAP_Addr].byte[3] = NUbus_Data.byte[3];
-		break;
+	  case 3: // Read High Half
+	    NUbus_Data.byte[3] = SDU_ROM[MEM_Addr];
+	    NUbus_Data.byte[2] = SDU_ROM[MEM_Addr-1];
+	    break;
 		
-	      case 0: // Full Word, supposedly does not work
-		MNA_MAP[MAP_Addr].word = NUbus_Data.word;
-		break;
-	      }
-	    }
-	    NUbus_acknowledge=1;
-	    // Debug log
-	    if(NUbus_trace || SDU_RAM_trace){
-	      logmsgf(LT_MULTIBUS,0,"SDU: MNA MAP ent 0x%X wrote: Enable %X Spare %X NB-Page 0x%X (0x%X)\n",
-		     MAP_Addr,MNA_MAP[MAP_Addr].Enable,MNA_MAP[MAP_Addr].Spare,
-		     MNA_MAP[MAP_Addr].NUbus_Page,(MNA_MAP[MAP_Addr].NUbus_Page<<10));
-	    }
-	    return;
+	  case 0:
+	    // Full word read
+	    NUbus_Data.byte[3] = SDU_ROM[MEM_Addr+3];
+	    NUbus_Data.byte[2] = SDU_ROM[MEM_Addr+2];
+	    NUbus_Data.byte[1] = SDU_ROM[MEM_Addr+1];
+	    NUbus_Data.byte[0] = SDU_ROM[MEM_Addr];
+	    break;
 	  }
-	}
-	break;	
-
-      // Multibus IO space.
-      /*
-      case 0x19000 ... 0x80000: 
-	// What are these?
-	if(NUbus_Request == VM_READ){
-	  // Let's see where this goes!
-	  NUbus_Data.word = 0x0; // DEADBEEF;
-	  NUbus_acknowledge=1;	  
 	}else{
-	  logmsgf(,,"SDU: Unimplemented address ");
-	  writeH32(NUbus_Address.Addr);
-	  logmsgf(,," (");
-	  writeH32(NUbus_Address.raw);
-	  logmsgf(,,")\n");
-	  ld_die_rq=1;	  
+	  // BYTE READ
+	  NUbus_Data.byte[NUbus_Address.Byte] = SDU_ROM[MEM_Addr];
 	}
+	NUbus_acknowledge=1;
 	return;
-        break;
-      */
-
-      // 0x1c000 - 0x1c3FF: SDU register space
+      }
+      logmsgf(LT_SDU,0,"SDU: Write to ROM?\n");
+    }
+    break;
 
-      case 0x1c120: // RTC Data Register
-	{
-	  nuData RTC_Data;
-	  RTC_Data.word = 0;
-	  switch(rtc_addr){
-	  case 0x00 ... 0x09:
-	    if(RTC_REGA.Update_In_Progress == 0){
-	      if (rtc_addr == RTC_SECONDS) // the first index being read (see time:read-rtc-chip)
-		// maybe update RTC data from localtime
-		rtc_update_localtime(0);
-	      RTC_Data.word = RTC_Counter[rtc_addr];
-	      if (RTC_REGB.Format == 0 && rtc_addr == RTC_HOURS) {
-		// 12h format (but never, normally - see time:set-correct-rtc-modes)
-		if (RTC_Data.word > 13)
-		  RTC_Data.word = (RTC_Data.word-12) & 0x80;
-	      }
-	    }else{
-	      RTC_Data.word = 0;
-	    }
-	    break;
-	  case 0x0A:
-	    RTC_Data.word = RTC_REGA.byte;
-	    break;
-	  case 0x0B:
-	    RTC_Data.word = RTC_REGB.byte;
+  case 0x1E000 ... 0x1FFFF: // CMOS
+    {
+      uint32_t CMOS_Addr = ((NUbus_Address.Addr-0x1E000)>>2);
+      // Handle it
+      if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+	if(NUbus_Request == VM_READ){ // Read four bytes
+	  switch(NUbus_Address.Byte){
+	  case 1: // Read Low Half
+	    NUbus_Data.byte[1] = 0;
+	    NUbus_Data.byte[0] = CMOS_RAM[CMOS_Addr];
 	    break;
-	  case 0x0C:
-	    RTC_Data.word = RTC_REGC.byte;
+		
+	  case 2: // Block Transfer
+	    logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
+	    ld_die_rq=1;
 	    break;
-	  case 0x0D:
-	    RTC_Data.word = RTC_REGD.byte;
-	    RTC_REGD.Valid_RAM = 1; // Reading Reg D sets this bit
+		
+	  case 3: // Read High Half
+	    NUbus_Data.byte[3] = 0;
+	    NUbus_Data.byte[2] = CMOS_RAM[CMOS_Addr];
 	    break;
-	  case 0x0E ... 0x3F:
-	    RTC_Data.word = RTC_RAM[rtc_addr-0x0E];
+		
+	  case 0:
+	    // Full word read
+	    NUbus_Data.byte[3] = NUbus_Data.byte[2] = NUbus_Data.byte[1] = 0;
+	    NUbus_Data.byte[0] = CMOS_RAM[CMOS_Addr];
 	    break;
-	  default:
-	    RTC_Data.word = 0;	    
 	  }
-	  if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	    if(NUbus_Request == VM_READ){
-	      switch(NUbus_Address.Byte){
-	      case 1: // Read Low Half
-		NUbus_Data.byte[1] = RTC_Data.byte[1];
-		NUbus_Data.byte[0] = RTC_Data.byte[0];
-		break;
-		
-	      case 2: // Block Transfer
-		logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
-		ld_die_rq=1;
-		break;
-		
-	      case 3: // Read High Half
-		NUbus_Data.byte[3] = RTC_Data.byte[3];
-		NUbus_Data.byte[2] = RTC_Data.byte[2];
-		break;
+	}else{
+	  NUbus_Data.byte[NUbus_Address.Byte] = CMOS_RAM[CMOS_Addr];
+	}
+	NUbus_acknowledge=1;
+	return;
+      }
+      if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
+	ld_die_rq = 1;
+      }
+    }
+    break;
+
+  case 0x18000 ... 0x18FFF: // multibus -> nubus map
+    {
+      int MAP_Addr = ((NUbus_Address.Addr-0x18000)>>2);
+      /*      
+	      1024 registers
+	      each 32 bits, of which 24 are present.
+	      1 bit enable, 1 bit unused, 22 bits hi NUBUS adr.
+	      divide 20 bit multibus into 2 10 bit pieces:
+	      each register maps a 1K byte segment to a 1K nubus page.	  
+      */
+      /* THEY ONLY WORK IF REFERENCED ON SINGLE BYTE TRANSFERS. (???) */
+      if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+	if(NUbus_Request == VM_READ){ // Read four bytes
+	  switch(NUbus_Address.Byte){
+	  case 1: // Read Low Half
+	    NUbus_Data.byte[1] = MNA_MAP[MAP_Addr].byte[1];
+	    NUbus_Data.byte[0] = MNA_MAP[MAP_Addr].byte[0];
+	    break;
 		
-	      case 0:
-		// Full word read
-		NUbus_Data.word = RTC_Data.word;
-		break;
-	      }
-	    }else{
-	      // BYTE READ
-	      NUbus_Data.byte[NUbus_Address.Byte] = RTC_Data.byte[NUbus_Address.Byte];	    
-	    }
-	    logmsgf(LT_RTC,10,"RTC: Data Read, returned 0x%X for addr 0x%X and request %o\n",
-		   NUbus_Data.word,NUbus_Address.raw,NUbus_Request);
-	    NUbus_acknowledge=1;
-	    return;
-	  }
-	  if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
-	    if(NUbus_Request == VM_WRITE){
-	      switch(NUbus_Address.Byte){
-	      case 1: // Write Low Half
-		RTC_Data.byte[1] = NUbus_Data.byte[1];	      
-		RTC_Data.byte[0] = NUbus_Data.byte[0];	      
-		break;
-	      
-	      case 2: // Block Transfer
-		logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
-		ld_die_rq=1;
-		break;
+	  case 2: // Block Transfer
+	    logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
+	    ld_die_rq=1;
+	    break;
 		
-	      case 3: // Write High Half
-		RTC_Data.byte[3] = NUbus_Data.byte[3];	      
-		RTC_Data.byte[2] = NUbus_Data.byte[2];	      
-		break;
+	  case 3: // Read High Half
+	    NUbus_Data.byte[3] = MNA_MAP[MAP_Addr].byte[3];
+	    NUbus_Data.byte[2] = MNA_MAP[MAP_Addr].byte[2];
+	    break;
 		
-	      case 0:
-		// Full word write
-		RTC_Data.word = NUbus_Data.word;
-		break;
-	      }
-	    }else{
-	      // BYTE WRITE
-	      RTC_Data.byte[NUbus_Address.Byte] = NUbus_Data.byte[NUbus_Address.Byte];
-	    }
-	    // Process bits
-	    switch(rtc_addr){
-	    case 0x00 ... 0x09:
-	      if(RTC_REGA.Update_In_Progress == 0){
-		RTC_Counter[rtc_addr] = RTC_Data.byte[0];
-		if (RTC_REGB.Format == 0 && rtc_addr == RTC_HOURS) { // 12h format
-		  if (RTC_Data.byte[0] & 0x80)  // PM
-		    RTC_Counter[rtc_addr] = (RTC_Data.byte[0] & ~0x80)+12; // make it 24h
-		}
-	      }
-	      break;
-	    case 0x0A:
-	      // UIP bit is read only
-	      RTC_REGA.byte &= 0x80;
-	      RTC_REGA.byte |= (RTC_Data.byte[0]&0x7F);
-	      break;
-	    case 0x0B:
-	      RTC_REGB.byte = RTC_Data.byte[0];
-	      break;
-	    case 0x0C:
-	      // Read Only
-	      break;
-	    case 0x0D:
-	      // Read Only
-	      break;
-	    case 0x0E ... 0x3F:
-	      RTC_RAM[rtc_addr-0x0E] = RTC_Data.byte[0];
-	      break;
-	    }
-	    logmsgf(LT_RTC,10,"RTC: Data Write, data 0x%X\n",NUbus_Data.word);
-	    NUbus_acknowledge=1;
-	    return;
+	  case 0:
+	    // Full word read, supposedly does not work
+	    NUbus_Data.word = MNA_MAP[MAP_Addr].word;
+	    break;
 	  }
+	}else{
+	  // BYTE READ
+	  NUbus_Data.byte[NUbus_Address.Byte] = MNA_MAP[MAP_Addr].byte[NUbus_Address.Byte]; 
 	}
-	break;
-      case 0x1c124: // RTC Address Register
-	// Lisp will write an address here
-	if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	  if(NUbus_Request == VM_READ){
-	    switch(NUbus_Address.Byte){
-	    case 1: // Read Low Half
-	      NUbus_Data.byte[1] = 0;
-	      NUbus_Data.byte[0] = rtc_addr;
-	      break;
-	      
-	    case 2: // Block Transfer
-	      logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
-	      ld_die_rq=1;
-	      break;
+	NUbus_acknowledge=1;
+	return;
+      }
+      // Write
+      if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
+	if(NUbus_Request == VM_BYTE_WRITE){
+	  MNA_MAP[MAP_Addr].byte[NUbus_Address.Byte] = NUbus_Data.byte[NUbus_Address.Byte];
+	}else{
+	  // WORD WRITE
+	  switch(NUbus_Address.Byte){
+	  case 1: // Write low half
+	    MNA_MAP[MAP_Addr].byte[0] = NUbus_Data.byte[0];
+	    MNA_MAP[MAP_Addr].byte[1] = NUbus_Data.byte[1];
+	    break;
 		
-	    case 3: // Read High Half
-	      NUbus_Data.byte[3] = 0;
-	      NUbus_Data.byte[2] = 0;
-	      break;
-	      
-	    case 0:
-	      // Full word read
-	      NUbus_Data.word = rtc_addr;
-	      break;
-	    }
-	  }else{
-	    // BYTE READ
-	    if(NUbus_Address.Byte == 0){
-	      NUbus_Data.byte[NUbus_Address.Byte] = rtc_addr;
-	    }else{
-	      NUbus_Data.byte[NUbus_Address.Byte] = 0;
-	    }
+	  case 2: // BLOCK TRANSFER
+	    logmsgf(LT_SDU,0,"SDU: BLOCK TRANSFER REQUESTED\n");
+	    ld_die_rq=1;
+	    break;
+		
+	  case 3: // Write high half
+	    MNA_MAP[MAP_Addr].byte[2] = NUbus_Data.byte[2];
+	    MNA_MAP[MAP_Addr].byte[3] = NUbus_Data.byte[3];
+	    break;
+		
+	  case 0: // Full Word, supposedly does not work
+	    MNA_MAP[MAP_Addr].word = NUbus_Data.word;
+	    break;
 	  }
-	  logmsgf(LT_RTC,10,"RTC: Address Read, returned 0x%X for addr 0x%X and request %o\n",
-		 NUbus_Data.word,NUbus_Address.raw,NUbus_Request);
-	  NUbus_acknowledge=1;
-	  return;
 	}
-	if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
-	  if(NUbus_Request == VM_WRITE){
-	    switch(NUbus_Address.Byte){
-	    case 1: // Write Low Half
-	      rtc_addr = NUbus_Data.byte[0];	      
-	      break;
+	NUbus_acknowledge=1;
+	multibus_page_update(MAP_Addr);
+	// Debug log
+	if(NUbus_trace || SDU_RAM_trace){
+	  logmsgf(LT_MULTIBUS,0,"SDU: MNA MAP ent 0x%X wrote: Enable %X Spare %X NB-Page 0x%X (0x%X)\n",
+		 MAP_Addr,MNA_MAP[MAP_Addr].Enable,MNA_MAP[MAP_Addr].Spare,
+		 MNA_MAP[MAP_Addr].NUbus_Page,(MNA_MAP[MAP_Addr].NUbus_Page<<10));
+	}
+	return;
+      }
+    }
+    break;	
 
-	    case 2: // Block Transfer
-	      logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
-	      ld_die_rq=1;
-	      break;
+  // Multibus IO space.
+  /*
+  case 0x19000 ... 0x80000: 
+    // What are these?
+    if(NUbus_Request == VM_READ){
+      // Let's see where this goes!
+      NUbus_Data.word = 0x0; // DEADBEEF;
+      NUbus_acknowledge=1;	  
+    }else{
+      logmsgf(,,"SDU: Unimplemented address ");
+      writeH32(NUbus_Address.Addr);
+      logmsgf(,," (");
+      writeH32(NUbus_Address.raw);
+      logmsgf(,,")\n");
+      ld_die_rq=1;	  
+    }
+    return;
+    break;
+  */
 
-	    case 3: // Write High Half
-	      break;
+  // 0x1c000 - 0x1c3FF: SDU register space
 
-	    case 0:
-	      // Full word write
-	      rtc_addr = NUbus_Data.word;
-	      break;
-	    }
-	  }else{
-	    // BYTE WRITE
-	    if(NUbus_Address.Byte == 0){ rtc_addr = NUbus_Data.byte[NUbus_Address.Byte]; }
+  case 0x1c120: // RTC Data Register
+    {
+      nuData RTC_Data;
+      RTC_Data.word = 0;
+      switch(rtc_addr){
+      case 0x00 ... 0x09:
+	if(RTC_REGA.Update_In_Progress == 0){
+	  if (rtc_addr == RTC_SECONDS) // the first index being read (see time:read-rtc-chip)
+	    // maybe update RTC data from localtime
+	    rtc_update_localtime(0);
+	  RTC_Data.word = RTC_Counter[rtc_addr];
+	  if (RTC_REGB.Format == 0 && rtc_addr == RTC_HOURS) {
+	    // 12h format (but never, normally - see time:set-correct-rtc-modes)
+	    if (RTC_Data.word > 13)
+	      RTC_Data.word = (RTC_Data.word-12) & 0x80;
 	  }
-	  // Process bits
-	  logmsgf(LT_RTC,10,"RTC: Address Write, data 0x%X\n",NUbus_Data.word);
-	  NUbus_acknowledge=1;
-	  return;
+	}else{
+	  RTC_Data.word = 0;
 	}
 	break;
-
-      case 0x01c1fc: // Multibus Interrupt 7
-	if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
-	  // extern int SMD_Controller_State;
-	  extern int SDU_disk_trace;
-	  if(NUbus_Data.byte[0] != 0){
-	    if(SDU_disk_trace){
-	      logmsgf(LT_MULTIBUS,10,"SDU: Set Interrupt 7\n");
-	    }
-	    multibus_interrupt(7);
-	    /*
-	      if(SMD_Controller_State == 0){
-	        // Start operations
-		SMD_Controller_State = 93;
-	      }
-	    */
-	  }else{
-	    if(SDU_disk_trace){
-	      logmsgf(LT_MULTIBUS,10,"SDU: Clear Interrupt 7\n");
-	    }
-	    clear_multibus_interrupt(7);
+      case 0x0A:
+	RTC_Data.word = RTC_REGA.byte;
+	break;
+      case 0x0B:
+	RTC_Data.word = RTC_REGB.byte;
+	break;
+      case 0x0C:
+	RTC_Data.word = RTC_REGC.byte;
+	break;
+      case 0x0D:
+	RTC_Data.word = RTC_REGD.byte;
+	RTC_REGD.Valid_RAM = 1; // Reading Reg D sets this bit
+	break;
+      case 0x0E ... 0x3F:
+	RTC_Data.word = RTC_RAM[rtc_addr-0x0E];
+	break;
+      default:
+	RTC_Data.word = 0;	    
+      }
+      if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+	if(NUbus_Request == VM_READ){
+	  switch(NUbus_Address.Byte){
+	  case 1: // Read Low Half
+	    NUbus_Data.byte[1] = RTC_Data.byte[1];
+	    NUbus_Data.byte[0] = RTC_Data.byte[0];
+	    break;
+		
+	  case 2: // Block Transfer
+	    logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
+	    ld_die_rq=1;
+	    break;
+		
+	  case 3: // Read High Half
+	    NUbus_Data.byte[3] = RTC_Data.byte[3];
+	    NUbus_Data.byte[2] = RTC_Data.byte[2];
+	    break;
+		
+	  case 0:
+	    // Full word read
+	    NUbus_Data.word = RTC_Data.word;
+	    break;
 	  }
-	  NUbus_acknowledge=1;
-	  return;
+	}else{
+	  // BYTE READ
+	  NUbus_Data.byte[NUbus_Address.Byte] = RTC_Data.byte[NUbus_Address.Byte];	    
 	}
-	break;
-
-#ifdef BURR_BROWN
-	// BURR-BROWN DEBUGGING MASTER
-	/*
-      case 0x02ff02: // CSR (when read), 
-      case 0x02ff04: // LO DATA (0x000000FF)
-      case 0x02ff05: // HI DATA (0x0000FF00)
-	*/
-      case 0x02ff02: // CSR
-	// Writing 7 = DRIVE DATA LINES
-	// Writing 4 = DON'T DRIVE DATA LINES
-        if(NUbus_Request == VM_BYTE_WRITE && NUbus_Data.byte[2] == 07){
-	  BB_Drive_Data_Lines = 1;
-          NUbus_acknowledge=1;
+	logmsgf(LT_RTC,10,"RTC: Data Read, returned 0x%X for addr 0x%X and request %o\n",
+	       NUbus_Data.word,NUbus_Address.raw,NUbus_Request);
+	NUbus_acknowledge=1;
+	return;
+      }
+      if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
+	if(NUbus_Request == VM_WRITE){
+	  switch(NUbus_Address.Byte){
+	  case 1: // Write Low Half
+	    RTC_Data.byte[1] = NUbus_Data.byte[1];	      
+	    RTC_Data.byte[0] = NUbus_Data.byte[0];	      
+	    break;
+	      
+	  case 2: // Block Transfer
+	    logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
+	    ld_die_rq=1;
+	    break;
+		
+	  case 3: // Write High Half
+	    RTC_Data.byte[3] = NUbus_Data.byte[3];	      
+	    RTC_Data.byte[2] = NUbus_Data.byte[2];	      
+	    break;
+		
+	  case 0:
+	    // Full word write
+	    RTC_Data.word = NUbus_Data.word;
+	    break;
+	  }
+	}else{
+	  // BYTE WRITE
+	  RTC_Data.byte[NUbus_Address.Byte] = NUbus_Data.byte[NUbus_Address.Byte];
+	}
+	// Process bits
+	switch(rtc_addr){
+	case 0x00 ... 0x09:
+	  if(RTC_REGA.Update_In_Progress == 0){
+	    RTC_Counter[rtc_addr] = RTC_Data.byte[0];
+	    if (RTC_REGB.Format == 0 && rtc_addr == RTC_HOURS) { // 12h format
+	      if (RTC_Data.byte[0] & 0x80)  // PM
+		RTC_Counter[rtc_addr] = (RTC_Data.byte[0] & ~0x80)+12; // make it 24h
+	    }
+	  }
 	  break;
-        }
-        if(NUbus_Request == VM_BYTE_WRITE && NUbus_Data.byte[2] == 04){
-	  BB_Drive_Data_Lines = 0;
-          NUbus_acknowledge=1;
+	case 0x0A:
+	  // UIP bit is read only
+	  RTC_REGA.byte &= 0x80;
+	  RTC_REGA.byte |= (RTC_Data.byte[0]&0x7F);
 	  break;
-        }
-	logmsgf(LT_SDU,0,"BURR-BROWN: Unimplemented Request %o Addr 0x%X Data 0x%X\n",
-	       NUbus_Request,NUbus_Address.raw,NUbus_Data.word);
-	ld_die_rq = 1;
-	break;
-
-      case 0x02ff04: // DATA / LO DATA
-	if(NUbus_Request == VM_WRITE){
-	  BB_Data.hword[0] = NUbus_Data.hword[0];
-	  NUbus_acknowledge=1;
+	case 0x0B:
+	  RTC_REGB.byte = RTC_Data.byte[0];
 	  break;
-	}
-	if(NUbus_Request == VM_BYTE_WRITE){
-	  BB_Data.byte[0] = NUbus_Data.byte[0];
-	  NUbus_acknowledge=1;
+	case 0x0C:
+	  // Read Only
+	  break;
+	case 0x0D:
+	  // Read Only
+	  break;
+	case 0x0E ... 0x3F:
+	  RTC_RAM[rtc_addr-0x0E] = RTC_Data.byte[0];
 	  break;
 	}
-	if(NUbus_Request == VM_READ){
-	  NUbus_Data.hword[0] = BB_Data.hword[0];
-	  NUbus_Data.hword[1] = 0;
-	  NUbus_acknowledge=1;
+	logmsgf(LT_RTC,10,"RTC: Data Write, data 0x%X\n",NUbus_Data.word);
+	NUbus_acknowledge=1;
+	return;
+      }
+    }
+    break;
+  case 0x1c124: // RTC Address Register
+    // Lisp will write an address here
+    if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+      if(NUbus_Request == VM_READ){
+	switch(NUbus_Address.Byte){
+	case 1: // Read Low Half
+	  NUbus_Data.byte[1] = 0;
+	  NUbus_Data.byte[0] = rtc_addr;
+	  break;
+	      
+	case 2: // Block Transfer
+	  logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
+	  ld_die_rq=1;
+	  break;
+		
+	case 3: // Read High Half
+	  NUbus_Data.byte[3] = 0;
+	  NUbus_Data.byte[2] = 0;
+	  break;
+	      
+	case 0:
+	  // Full word read
+	  NUbus_Data.word = rtc_addr;
 	  break;
 	}
-        logmsgf(LT_SDU,0,"BURR-BROWN: Unimplemented Request %o Addr 0x%X Data 0x%X\n",
-               NUbus_Request,NUbus_Address.raw,NUbus_Data.word);
-	ld_die_rq = 1;
-	break;
+      }else{
+	// BYTE READ
+	if(NUbus_Address.Byte == 0){
+	  NUbus_Data.byte[NUbus_Address.Byte] = rtc_addr;
+	}else{
+	  NUbus_Data.byte[NUbus_Address.Byte] = 0;
+	}
+      }
+      logmsgf(LT_RTC,10,"RTC: Address Read, returned 0x%X for addr 0x%X and request %o\n",
+	     NUbus_Data.word,NUbus_Address.raw,NUbus_Request);
+      NUbus_acknowledge=1;
+      return;
+    }
+    if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
+      if(NUbus_Request == VM_WRITE){
+	switch(NUbus_Address.Byte){
+	case 1: // Write Low Half
+	  rtc_addr = NUbus_Data.byte[0];	      
+	  break;
 
-      case 0x02ff05: // HI DATA
-	if(NUbus_Request == VM_BYTE_WRITE){
-	  BB_Data.byte[1] = NUbus_Data.byte[1];
-	  NUbus_acknowledge=1;
+	case 2: // Block Transfer
+	  logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
+	  ld_die_rq=1;
+	  break;
+
+	case 3: // Write High Half
+	  break;
+
+	case 0:
+	  // Full word write
+	  rtc_addr = NUbus_Data.word;
 	  break;
 	}
-        logmsgf(LT_SDU,0,"BURR-BROWN: Unimplemented Request %o Addr 0x%X Data 0x%X\n",
-               NUbus_Request,NUbus_Address.raw,NUbus_Data.word);
-	ld_die_rq = 1;
-	break;
+      }else{
+	// BYTE WRITE
+	if(NUbus_Address.Byte == 0){ rtc_addr = NUbus_Data.byte[NUbus_Address.Byte]; }
+      }
+      // Process bits
+      logmsgf(LT_RTC,10,"RTC: Address Write, data 0x%X\n",NUbus_Data.word);
+      NUbus_acknowledge=1;
+      return;
+    }
+    break;
+
+  case 0x01c1fc: // Multibus Interrupt 7
+    if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
+      // extern int SMD_Controller_State;
+      extern int SDU_disk_trace;
+      if(NUbus_Data.byte[0] != 0){
+	if(SDU_disk_trace){
+	  logmsgf(LT_MULTIBUS,10,"SDU: Set Interrupt 7\n");
+	}
+	multibus_interrupt(7);
+	/*
+	  if(SMD_Controller_State == 0){
+	    // Start operations
+	    SMD_Controller_State = 93;
+	  }
+	*/
+      }else{
+	if(SDU_disk_trace){
+	  logmsgf(LT_MULTIBUS,10,"SDU: Clear Interrupt 7\n");
+	}
+	clear_multibus_interrupt(7);
+      }
+      NUbus_acknowledge=1;
+      return;
+    }
+    break;
 
-      case 0x02ff06: // Control
-	if(NUbus_Request == VM_BYTE_WRITE){	  
-	  BB_Reg = (~NUbus_Data.byte[2])&0x03;
+#ifdef BURR_BROWN
+    // BURR-BROWN DEBUGGING MASTER
+    /*
+  case 0x02ff02: // CSR (when read), 
+  case 0x02ff04: // LO DATA (0x000000FF)
+  case 0x02ff05: // HI DATA (0x0000FF00)
+    */
+  case 0x02ff02: // CSR
+    // Writing 7 = DRIVE DATA LINES
+    // Writing 4 = DON'T DRIVE DATA LINES
+    if(NUbus_Request == VM_BYTE_WRITE && NUbus_Data.byte[2] == 07){
+      BB_Drive_Data_Lines = 1;
+      NUbus_acknowledge=1;
+      break;
+    }
+    if(NUbus_Request == VM_BYTE_WRITE && NUbus_Data.byte[2] == 04){
+      BB_Drive_Data_Lines = 0;
+      NUbus_acknowledge=1;
+      break;
+    }
+    logmsgf(LT_SDU,0,"BURR-BROWN: Unimplemented Request %o Addr 0x%X Data 0x%X\n",
+	   NUbus_Request,NUbus_Address.raw,NUbus_Data.word);
+    ld_die_rq = 1;
+    break;
+
+  case 0x02ff04: // DATA / LO DATA
+    if(NUbus_Request == VM_WRITE){
+      BB_Data.hword[0] = NUbus_Data.hword[0];
+      NUbus_acknowledge=1;
+      break;
+    }
+    if(NUbus_Request == VM_BYTE_WRITE){
+      BB_Data.byte[0] = NUbus_Data.byte[0];
+      NUbus_acknowledge=1;
+      break;
+    }
+    if(NUbus_Request == VM_READ){
+      NUbus_Data.hword[0] = BB_Data.hword[0];
+      NUbus_Data.hword[1] = 0;
+      NUbus_acknowledge=1;
+      break;
+    }
+    logmsgf(LT_SDU,0,"BURR-BROWN: Unimplemented Request %o Addr 0x%X Data 0x%X\n",
+	   NUbus_Request,NUbus_Address.raw,NUbus_Data.word);
+    ld_die_rq = 1;
+    break;
+
+  case 0x02ff05: // HI DATA
+    if(NUbus_Request == VM_BYTE_WRITE){
+      BB_Data.byte[1] = NUbus_Data.byte[1];
+      NUbus_acknowledge=1;
+      break;
+    }
+    logmsgf(LT_SDU,0,"BURR-BROWN: Unimplemented Request %o Addr 0x%X Data 0x%X\n",
+	   NUbus_Request,NUbus_Address.raw,NUbus_Data.word);
+    ld_die_rq = 1;
+    break;
+
+  case 0x02ff06: // Control
+    if(NUbus_Request == VM_BYTE_WRITE){	  
+      BB_Reg = (~NUbus_Data.byte[2])&0x03;
 	    
-	  // 0x08 = REQ.L (Strobe)
-	  // 0x04 = READ DATA
-	  // 0x03 = REG (inverted)
-	  if(NUbus_Data.byte[2]&0x08){
-	    logmsgf(LT_SDU,10,"BURR-BROWN: ");
-	    if(NUbus_Data.byte[2]&0x04){
-	      logmsgf(LT_SDU,10,"READ ");
-	    }else{
-	      logmsgf(LT_SDU,10,"WRITE ");
+      // 0x08 = REQ.L (Strobe)
+      // 0x04 = READ DATA
+      // 0x03 = REG (inverted)
+      if(NUbus_Data.byte[2]&0x08){
+	logmsgf(LT_SDU,10,"BURR-BROWN: ");
+	if(NUbus_Data.byte[2]&0x04){
+	  logmsgf(LT_SDU,10,"READ ");
+	}else{
+	  logmsgf(LT_SDU,10,"WRITE ");
+	}
+	logmsgf(LT_SDU,10,"REG %X",BB_Reg);
+	if(!(NUbus_Data.byte[2]&0x04)){
+	  logmsgf(LT_SDU,10," DATA 0x%X",BB_Data.word);
+	  // WRITE EXECUTION
+	  // WRITE REG 0 DATA 0x2
+	  switch(BB_Reg){
+	  case 0: // MODE REG
+	    BB_Mode_Reg = BB_Data.byte[0];
+	    if(BB_Mode_Reg&0x02){
+	      // RESET
+	      extern uint8_t debug_master_mode;
+	      logmsgf(LT_SDU,10," (RESET)");
+	      // Does what?
+	      debug_master_mode = 1;
+	      debug_connect();
 	    }
-	    logmsgf(LT_SDU,10,"REG %X",BB_Reg);
-	    if(!(NUbus_Data.byte[2]&0x04)){
-	      logmsgf(LT_SDU,10," DATA 0x%X",BB_Data.word);
-	      // WRITE EXECUTION
-	      // WRITE REG 0 DATA 0x2
-	      switch(BB_Reg){
-	      case 0: // MODE REG
-		BB_Mode_Reg = BB_Data.byte[0];
-		if(BB_Mode_Reg&0x02){
-		  // RESET
-		  extern uint8_t debug_master_mode;
-		  logmsgf(LT_SDU,10," (RESET)");
-		  // Does what?
-		  debug_master_mode = 1;
-		  debug_connect();
-		}
-		break;
-	      case 1:
-		if(BB_Mode_Reg&0x01){
-		  // START WRITE
-		  logmsgf(LT_SDU,10," (START WRITE: ADDR 0x%X DATA 0x%X)",BB_Remote_Addr.raw,BB_Remote_Data.word);
-		  if(BB_Drive_Data_Lines != 1){ logmsgf(LT_SDU,10," !!DDL!!"); }
-		  if(!(BB_Mode_Reg&0x04)){
-		    debug_tx_rq(VM_BYTE_WRITE,BB_Remote_Addr.raw,BB_Remote_Data.word);
-		  }else{
-		    debug_tx_rq(VM_WRITE,BB_Remote_Addr.raw,BB_Remote_Data.word);
-		  }
-		}else{
-		  // Low Data Load
-		  BB_Remote_Data.hword[0] = BB_Data.hword[0];
-		}
-		break;
-	      case 2:
-		if(BB_Mode_Reg&0x01){
-		  // Low Addr Load
-		  BB_Remote_Addr.hword[0] = BB_Data.hword[0];
-		}else{
-		  // Hi Data Load
-		  BB_Remote_Data.hword[1] = BB_Data.hword[0];
-		}
-		break;
-	      case 3:
-		if(BB_Mode_Reg&0x01){
-		  // Hi Addr Load
-		  BB_Remote_Addr.hword[1] = BB_Data.hword[0];
-		}else{
-		  // NC
-		}
-		break;
+	    break;
+	  case 1:
+	    if(BB_Mode_Reg&0x01){
+	      // START WRITE
+	      logmsgf(LT_SDU,10," (START WRITE: ADDR 0x%X DATA 0x%X)",BB_Remote_Addr.raw,BB_Remote_Data.word);
+	      if(BB_Drive_Data_Lines != 1){ logmsgf(LT_SDU,10," !!DDL!!"); }
+	      if(!(BB_Mode_Reg&0x04)){
+		debug_tx_rq(VM_BYTE_WRITE,BB_Remote_Addr.raw,BB_Remote_Data.word);
+	      }else{
+		debug_tx_rq(VM_WRITE,BB_Remote_Addr.raw,BB_Remote_Data.word);
 	      }
 	    }else{
-	      // READ EXECUTION
-	      switch(BB_Reg){
-	      case 0: // MODE REG
-		// 0x300 = RESPONSE BITS
-		// Let's try this
-		while(BB_Remote_Result == 1){
-		  debug_clockpulse(); // Hang for IO
-		}
-		if(BB_Remote_Result == 2){
-		  // Success
-		  BB_Data.word = 0x0300|BB_Mode_Reg;
-		}
-		if(BB_Remote_Result == 3){
-		  // Error
-		  BB_Data.word = 0x0100|BB_Mode_Reg;
-		}
-		break;
-	      case 1:
-		if(BB_Mode_Reg&0x01){
-		  // START READ
-		  logmsgf(LT_SDU,10," (START READ: ADDR 0x%X)",BB_Remote_Addr.raw);
-		  if(!(BB_Mode_Reg&0x04)){
-		    debug_tx_rq(VM_BYTE_READ,BB_Remote_Addr.raw,BB_Remote_Data.word);
-		  }else{
-		    debug_tx_rq(VM_READ,BB_Remote_Addr.raw,BB_Remote_Data.word);
-		  }
-		}else{
-		  // NC
-		}
-		break;
-	      case 2:
-		if(BB_Mode_Reg&0x01){
-		  // Lo Data Read
-		  BB_Data.hword[0] = BB_Remote_Data.hword[0];
-		}else{
-		  // NC
-		}
-		break;
-	      case 3:
-		if(BB_Mode_Reg&0x01){
-		  // Hi Data Read
-		  BB_Data.hword[0] = BB_Remote_Data.hword[1];		  
-		}else{
-		  // NC
-		}
-		break;
-
-	      default:
-		logmsgf(LT_SDU,0," (BADREG)");
-		ld_die_rq = 1;
-	      }
+	      // Low Data Load
+	      BB_Remote_Data.hword[0] = BB_Data.hword[0];
+	    }
+	    break;
+	  case 2:
+	    if(BB_Mode_Reg&0x01){
+	      // Low Addr Load
+	      BB_Remote_Addr.hword[0] = BB_Data.hword[0];
+	    }else{
+	      // Hi Data Load
+	      BB_Remote_Data.hword[1] = BB_Data.hword[0];
+	    }
+	    break;
+	  case 3:
+	    if(BB_Mode_Reg&0x01){
+	      // Hi Addr Load
+	      BB_Remote_Addr.hword[1] = BB_Data.hword[0];
+	    }else{
+	      // NC
 	    }
-	    logmsgf(LT_SDU,10,"\n");
+	    break;
 	  }
-	  NUbus_acknowledge=1;
-	  break;
-	}
-	logmsgf(LT_SDU,0,"BURR-BROWN: Unimplemented Request %o Addr 0x%X Data 0x%X\n",
-	       NUbus_Request,NUbus_Address.raw,NUbus_Data.word);
-	ld_die_rq = 1;
-	break;
-#endif
-
-      case 0x030000 ... 0x31FFF: // 3com Ethernet
-	{
-	  uint16_t enet_addr = (NUbus_Address.raw&0xFFFF);
-	  if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	    if(NUbus_Request == VM_READ){
-	      switch(NUbus_Address.Byte){
-	      case 1: // Read Low Half
-		NUbus_Data.byte[0] = enet_read(enet_addr-1);
-		NUbus_Data.byte[1] = enet_read(enet_addr);
-		break;
-		
-	      case 2: // Block Transfer
-		logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
-		ld_die_rq=1;
-		break;
-		
-	      case 3: // Read High Half
-		NUbus_Data.byte[2] = enet_read(enet_addr-1);
-		NUbus_Data.byte[3] = enet_read(enet_addr);
-		break;
-		
-	      case 0:
-		// Full word read
-		NUbus_Data.byte[0] = enet_read(enet_addr);
-		NUbus_Data.byte[1] = enet_read(enet_addr+1);
-		NUbus_Data.byte[2] = enet_read(enet_addr+2);
-		NUbus_Data.byte[3] = enet_read(enet_addr+3);
-		break;
+	}else{
+	  // READ EXECUTION
+	  switch(BB_Reg){
+	  case 0: // MODE REG
+	    // 0x300 = RESPONSE BITS
+	    // Let's try this
+	    while(BB_Remote_Result == 1){
+	      debug_clockpulse(); // Hang for IO
+	    }
+	    if(BB_Remote_Result == 2){
+	      // Success
+	      BB_Data.word = 0x0300|BB_Mode_Reg;
+	    }
+	    if(BB_Remote_Result == 3){
+	      // Error
+	      BB_Data.word = 0x0100|BB_Mode_Reg;
+	    }
+	    break;
+	  case 1:
+	    if(BB_Mode_Reg&0x01){
+	      // START READ
+	      logmsgf(LT_SDU,10," (START READ: ADDR 0x%X)",BB_Remote_Addr.raw);
+	      if(!(BB_Mode_Reg&0x04)){
+		debug_tx_rq(VM_BYTE_READ,BB_Remote_Addr.raw,BB_Remote_Data.word);
+	      }else{
+		debug_tx_rq(VM_READ,BB_Remote_Addr.raw,BB_Remote_Data.word);
 	      }
 	    }else{
-	      // BYTE READ
-	      NUbus_Data.byte[NUbus_Address.Byte] = enet_read(enet_addr);
+	      // NC
 	    }
-	    if(NUbus_trace == 1){
-	      logmsgf(LT_MULTIBUS,10,"3COM: CSR Read, returned 0x%X for addr 0x%X and request %o\n",
-		     NUbus_Data.word,NUbus_Address.raw,NUbus_Request);
+	    break;
+	  case 2:
+	    if(BB_Mode_Reg&0x01){
+	      // Lo Data Read
+	      BB_Data.hword[0] = BB_Remote_Data.hword[0];
+	    }else{
+	      // NC
 	    }
-	    NUbus_acknowledge=1;
-	    return;
-	  }	
-	  if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
-            if(NUbus_Request == VM_WRITE){
-              switch(NUbus_Address.Byte){
-              case 1: // Write Low Half
-		enet_write(enet_addr-1,NUbus_Data.byte[0]);
-		enet_write(enet_addr,NUbus_Data.byte[1]);
-                break;
-
-              case 2: // Block Transfer
-                logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
-                ld_die_rq=1;
-                break;
-
-              case 3: // Write High Half
-		enet_write(enet_addr-1,NUbus_Data.byte[2]);
-		enet_write(enet_addr,NUbus_Data.byte[3]);
-                break;
-
-              case 0:
-                // Full word write
-		enet_write(enet_addr,NUbus_Data.byte[0]);
-		enet_write(enet_addr+1,NUbus_Data.byte[1]);
-		enet_write(enet_addr+2,NUbus_Data.byte[2]);
-		enet_write(enet_addr+3,NUbus_Data.byte[3]);
-                break;
-              }
-            }else{
-              // BYTE WRITE
-	      enet_write(enet_addr,NUbus_Data.byte[NUbus_Address.Byte]);
-            }
-	    NUbus_acknowledge=1;
-	    return;
+	    break;
+	  case 3:
+	    if(BB_Mode_Reg&0x01){
+	      // Hi Data Read
+	      BB_Data.hword[0] = BB_Remote_Data.hword[1];		  
+	    }else{
+	      // NC
+	    }
+	    break;
+
+	  default:
+	    logmsgf(LT_SDU,0," (BADREG)");
+	    ld_die_rq = 1;
 	  }
 	}
-	break;
+	logmsgf(LT_SDU,10,"\n");
+      }
+      NUbus_acknowledge=1;
+      break;
+    }
+    logmsgf(LT_SDU,0,"BURR-BROWN: Unimplemented Request %o Addr 0x%X Data 0x%X\n",
+	   NUbus_Request,NUbus_Address.raw,NUbus_Data.word);
+    ld_die_rq = 1;
+    break;
+#endif
 
-      case 0x100100: // SMD controller status/command registers
-	{
-	  if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	    // On read, it's the status register
-	    if(NUbus_Request == VM_READ){ 
-	      switch(NUbus_Address.Byte){
-	      case 1: // Read Low Half
-		NUbus_Data.byte[1] = 0;
-		NUbus_Data.byte[0] = smd_read(0);
-		break;
-
-	      case 2: // Block Transfer
-		logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
-		ld_die_rq=1;
-		break;
-
-	      case 3: // Read High Half
-		NUbus_Data.byte[3] = 0;
-		NUbus_Data.byte[2] = smd_read(0);
-		break;
-
-	      case 0:
-		// Full word read
-		NUbus_Data.word = smd_read(0);
-		break;
-	      }
-	    }else{
-	      // BYTE READ
-	      NUbus_Data.byte[NUbus_Address.Byte] = smd_read(0);
-	    }
-	    NUbus_acknowledge=1;
-	    return;
-	  }	  
-	  if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
-	    // On write, it's the command register
-	    // SMD_RCmd
-	    if(NUbus_Request == VM_WRITE){
-	      switch(NUbus_Address.Byte){
-	      case 1: // Write Low Half
-		smd_write(0,NUbus_Data.byte[0]);
-		break;
+  case 0x030000 ... 0x31FFF: // 3com Ethernet
+    {
+      uint16_t enet_addr = (NUbus_Address.raw&0xFFFF);
+      if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+	if(NUbus_Request == VM_READ){
+	  switch(NUbus_Address.Byte){
+	  case 1: // Read Low Half
+	    NUbus_Data.byte[0] = enet_read(enet_addr-1);
+	    NUbus_Data.byte[1] = enet_read(enet_addr);
+	    break;
 		
-	      case 2: // Block Transfer
-		logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
-		ld_die_rq=1;
-		break;
+	  case 2: // Block Transfer
+	    logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
+	    ld_die_rq=1;
+	    break;
 		
-	      case 3: // Write High Half
-		smd_write(0,NUbus_Data.byte[2]);
-		break;
+	  case 3: // Read High Half
+	    NUbus_Data.byte[2] = enet_read(enet_addr-1);
+	    NUbus_Data.byte[3] = enet_read(enet_addr);
+	    break;
 		
-	      case 0:
-		// Full word write
-		smd_write(0,NUbus_Data.word);
-		break;
-	      }
-	    }else{
-	      // BYTE WRITE
-	      smd_write(0,NUbus_Data.byte[NUbus_Address.Byte]);
-	    }
-	    NUbus_acknowledge=1;
-	    return;
-	  }	    
+	  case 0:
+	    // Full word read
+	    NUbus_Data.byte[0] = enet_read(enet_addr);
+	    NUbus_Data.byte[1] = enet_read(enet_addr+1);
+	    NUbus_Data.byte[2] = enet_read(enet_addr+2);
+	    NUbus_Data.byte[3] = enet_read(enet_addr+3);
+	    break;
+	  }
+	}else{
+	  // BYTE READ
+	  NUbus_Data.byte[NUbus_Address.Byte] = enet_read(enet_addr);
 	}
-	break;
-      case 0x100104: // SMD controller IOPB base (hi)
-	if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	  ld_die_rq = 1;
+	if(NUbus_trace == 1){
+	  logmsgf(LT_MULTIBUS,10,"3COM: CSR Read, returned 0x%X for addr 0x%X and request %o\n",
+		 NUbus_Data.word,NUbus_Address.raw,NUbus_Request);
 	}
-	if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
-	  if(NUbus_Request == VM_WRITE){
-	    switch(NUbus_Address.Byte){
-	    case 1: // Write Low Half
-	      smd_write(1,NUbus_Data.byte[0]);
-	      break;
+	NUbus_acknowledge=1;
+	return;
+      }	
+      if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
+	if(NUbus_Request == VM_WRITE){
+	  switch(NUbus_Address.Byte){
+	  case 1: // Write Low Half
+	    enet_write(enet_addr-1,NUbus_Data.byte[0]);
+	    enet_write(enet_addr,NUbus_Data.byte[1]);
+	    break;
 
-	    case 2: // Block Transfer
-	      logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
-	      ld_die_rq=1;
-	      break;
+	  case 2: // Block Transfer
+	    logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
+	    ld_die_rq=1;
+	    break;
 
-	    case 3: // Write High Half
-	      smd_write(1,NUbus_Data.byte[2]);
-	      break;
+	  case 3: // Write High Half
+	    enet_write(enet_addr-1,NUbus_Data.byte[2]);
+	    enet_write(enet_addr,NUbus_Data.byte[3]);
+	    break;
 
-	    case 0:
-	      // Full word write
-	      smd_write(1,NUbus_Data.word);
-	      break;
-	    }
-	  }else{
-	    // BYTE WRITE
-	    smd_write(1,NUbus_Data.byte[NUbus_Address.Byte]);
+	  case 0:
+	    // Full word write
+	    enet_write(enet_addr,NUbus_Data.byte[0]);
+	    enet_write(enet_addr+1,NUbus_Data.byte[1]);
+	    enet_write(enet_addr+2,NUbus_Data.byte[2]);
+	    enet_write(enet_addr+3,NUbus_Data.byte[3]);
+	    break;
 	  }
-	  NUbus_acknowledge=1;
-	  return;
-	}	
-	break;
-      case 0x100108: // SMD controller IOPB base (middle)
-	if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	  ld_die_rq = 1;
+	}else{
+	  // BYTE WRITE
+	  enet_write(enet_addr,NUbus_Data.byte[NUbus_Address.Byte]);
 	}
-	if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
-	  if(NUbus_Request == VM_WRITE){
-	    switch(NUbus_Address.Byte){
-	    case 1: // Write Low Half
-	      smd_write(2,NUbus_Data.byte[0]);
-	      break;
-
-	    case 2: // Block Transfer
-	      logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
-	      ld_die_rq=1;
-	      break;
-
-	    case 3: // Write High Half
-	      smd_write(2,NUbus_Data.byte[2]);
-	      break;
+	NUbus_acknowledge=1;
+	return;
+      }
+    }
+    break;
 
-	    case 0:
-	      // Full word write
-	      smd_write(2,NUbus_Data.word);
-	      break;
-	    }
-	  }else{
-	    // BYTE WRITE
-	    smd_write(2,NUbus_Data.byte[NUbus_Address.Byte]);
-	  }
-	  NUbus_acknowledge=1;
-	  return;
-	}	
-	break;
-      case 0x10010c: // SMD controller IOPB base (low)
-	if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	  ld_die_rq = 1;
-	}
-	if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
-	  if(NUbus_Request == VM_WRITE){
-	    switch(NUbus_Address.Byte){
-	    case 1: // Write Low Half
-	      smd_write(3,NUbus_Data.byte[0]);
-	      break;
+  case 0x100100: // SMD controller status/command registers
+    {
+      if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+	// On read, it's the status register
+	if(NUbus_Request == VM_READ){ 
+	  switch(NUbus_Address.Byte){
+	  case 1: // Read Low Half
+	    NUbus_Data.byte[1] = 0;
+	    NUbus_Data.byte[0] = smd_read(0);
+	    break;
 
-	    case 2: // Block Transfer
-	      logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
-	      ld_die_rq=1;
-	      break;
+	  case 2: // Block Transfer
+	    logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
+	    ld_die_rq=1;
+	    break;
 
-	    case 3: // Write High Half
-	      smd_write(3,NUbus_Data.byte[2]);
-	      break;
+	  case 3: // Read High Half
+	    NUbus_Data.byte[3] = 0;
+	    NUbus_Data.byte[2] = smd_read(0);
+	    break;
 
-	    case 0:
-	      // Full word write
-	      smd_write(3,NUbus_Data.word);
-	      break;
-	    }
-	  }else{
-	    // BYTE WRITE
-	    smd_write(3,NUbus_Data.byte[NUbus_Address.Byte]);
+	  case 0:
+	    // Full word read
+	    NUbus_Data.word = smd_read(0);
+	    break;
 	  }
-	  NUbus_acknowledge=1;
-	  return;
-	}	
-	break;
-      case 0x100110: // SMD controller IOPB base (lower)
-	// Lisp does this deliberately. Why?
+	}else{
+	  // BYTE READ
+	  NUbus_Data.byte[NUbus_Address.Byte] = smd_read(0);
+	}
+	NUbus_acknowledge=1;
+	return;
+      }	  
+      if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
+	// On write, it's the command register
+	// SMD_RCmd
 	if(NUbus_Request == VM_WRITE){
 	  switch(NUbus_Address.Byte){
 	  case 1: // Write Low Half
-	    smd_write(4,NUbus_Data.byte[0]);
+	    smd_write(0,NUbus_Data.byte[0]);
 	    break;
-	    
+		
 	  case 2: // Block Transfer
 	    logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
 	    ld_die_rq=1;
 	    break;
-	    
+		
 	  case 3: // Write High Half
-	    smd_write(4,NUbus_Data.byte[2]);
+	    smd_write(0,NUbus_Data.byte[2]);
 	    break;
-	    
+		
 	  case 0:
 	    // Full word write
-	    smd_write(4,NUbus_Data.word);
+	    smd_write(0,NUbus_Data.word);
 	    break;
 	  }
-	  NUbus_acknowledge=1;
+	}else{
+	  // BYTE WRITE
+	  smd_write(0,NUbus_Data.byte[NUbus_Address.Byte]);
+	}
+	NUbus_acknowledge=1;
+	return;
+      }	    
+    }
+    break;
+  case 0x100104: // SMD controller IOPB base (hi)
+    if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+      ld_die_rq = 1;
+    }
+    if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
+      if(NUbus_Request == VM_WRITE){
+	switch(NUbus_Address.Byte){
+	case 1: // Write Low Half
+	  smd_write(1,NUbus_Data.byte[0]);
+	  break;
+
+	case 2: // Block Transfer
+	  logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
+	  ld_die_rq=1;
+	  break;
+
+	case 3: // Write High Half
+	  smd_write(1,NUbus_Data.byte[2]);
+	  break;
+
+	case 0:
+	  // Full word write
+	  smd_write(1,NUbus_Data.word);
 	  break;
 	}
-	// Otherwise...
-	logmsgf(LT_SDU,0,"SDU: Unimplemented address 0x%X (0x%X)\n",
-	       NUbus_Address.Addr,NUbus_Address.raw);
-	lambda_dump(DUMP_ALL);
-	ld_die_rq=1;
-	break;
-	
-	// Tapemaster controller
-      case 0x100180:
-	// Channel Attention
-	if(NUbus_Request == VM_WRITE){
-	  tapemaster_attn();
-	  NUbus_acknowledge=1;
-	  return;
+      }else{
+	// BYTE WRITE
+	smd_write(1,NUbus_Data.byte[NUbus_Address.Byte]);
+      }
+      NUbus_acknowledge=1;
+      return;
+    }	
+    break;
+  case 0x100108: // SMD controller IOPB base (middle)
+    if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+      ld_die_rq = 1;
+    }
+    if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
+      if(NUbus_Request == VM_WRITE){
+	switch(NUbus_Address.Byte){
+	case 1: // Write Low Half
+	  smd_write(2,NUbus_Data.byte[0]);
+	  break;
+
+	case 2: // Block Transfer
+	  logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
+	  ld_die_rq=1;
+	  break;
+
+	case 3: // Write High Half
+	  smd_write(2,NUbus_Data.byte[2]);
+	  break;
+
+	case 0:
+	  // Full word write
+	  smd_write(2,NUbus_Data.word);
+	  break;
 	}
-	// Fall thru
-      case 0x100184:
-	// Reset CPU
-	if(NUbus_Request == VM_WRITE){
-	  tapemaster_reset();
-          NUbus_acknowledge=1;
-          return;
-        }
-	// Die if we ended up here
-        logmsgf(LT_SDU,0,"SDU: Unimplemented address 0x%X (0x%X)\n",
-               NUbus_Address.Addr,NUbus_Address.raw);
-	lambda_dump(DUMP_ALL);
+      }else{
+	// BYTE WRITE
+	smd_write(2,NUbus_Data.byte[NUbus_Address.Byte]);
+      }
+      NUbus_acknowledge=1;
+      return;
+    }	
+    break;
+  case 0x10010c: // SMD controller IOPB base (low)
+    if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+      ld_die_rq = 1;
+    }
+    if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
+      if(NUbus_Request == VM_WRITE){
+	switch(NUbus_Address.Byte){
+	case 1: // Write Low Half
+	  smd_write(3,NUbus_Data.byte[0]);
+	  break;
+
+	case 2: // Block Transfer
+	  logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
+	  ld_die_rq=1;
+	  break;
+
+	case 3: // Write High Half
+	  smd_write(3,NUbus_Data.byte[2]);
+	  break;
+
+	case 0:
+	  // Full word write
+	  smd_write(3,NUbus_Data.word);
+	  break;
+	}
+      }else{
+	// BYTE WRITE
+	smd_write(3,NUbus_Data.byte[NUbus_Address.Byte]);
+      }
+      NUbus_acknowledge=1;
+      return;
+    }	
+    break;
+  case 0x100110: // SMD controller IOPB base (lower)
+    // Lisp does this deliberately. Why?
+    if(NUbus_Request == VM_WRITE){
+      switch(NUbus_Address.Byte){
+      case 1: // Write Low Half
+	smd_write(4,NUbus_Data.byte[0]);
+	break;
+	    
+      case 2: // Block Transfer
+	logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
 	ld_die_rq=1;
 	break;
-
-	// Excelan (we don't have one)
-      case 0x100280 ... 0x1002E0:
-	if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	  if(NUbus_Request == VM_READ){ 	    
-	    switch(NUbus_Address.Byte){
-	    case 1: // Read Low Half
-	      NUbus_Data.byte[0] = 0xFF;
-	      NUbus_Data.byte[1] = 0;
-	      break;
+	    
+      case 3: // Write High Half
+	smd_write(4,NUbus_Data.byte[2]);
+	break;
+	    
+      case 0:
+	// Full word write
+	smd_write(4,NUbus_Data.word);
+	break;
+      }
+      NUbus_acknowledge=1;
+      break;
+    }
+    // Otherwise...
+    logmsgf(LT_SDU,0,"SDU: Unimplemented address 0x%X (0x%X)\n",
+	   NUbus_Address.Addr,NUbus_Address.raw);
+    lambda_dump(DUMP_ALL);
+    ld_die_rq=1;
+    break;
+	
+    // Tapemaster controller
+  case 0x100180:
+    // Channel Attention
+    if(NUbus_Request == VM_WRITE){
+      tapemaster_attn();
+      NUbus_acknowledge=1;
+      return;
+    }
+    // Fall thru
+  case 0x100184:
+    // Reset CPU
+    if(NUbus_Request == VM_WRITE){
+      tapemaster_reset();
+      NUbus_acknowledge=1;
+      return;
+    }
+    // Die if we ended up here
+    logmsgf(LT_SDU,0,"SDU: Unimplemented address 0x%X (0x%X)\n",
+	   NUbus_Address.Addr,NUbus_Address.raw);
+    lambda_dump(DUMP_ALL);
+    ld_die_rq=1;
+    break;
+
+    // Excelan (we don't have one)
+  case 0x100280 ... 0x1002E0:
+    if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+      if(NUbus_Request == VM_READ){ 	    
+	switch(NUbus_Address.Byte){
+	case 1: // Read Low Half
+	  NUbus_Data.byte[0] = 0xFF;
+	  NUbus_Data.byte[1] = 0;
+	  break;
 	      
-	    case 2: // Block Transfer
-	      logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
-	      ld_die_rq=1;
-	      break;
+	case 2: // Block Transfer
+	  logmsgf(LT_SDU,0,"SDU: BLOCK READ REQUESTED\n");
+	  ld_die_rq=1;
+	  break;
 	      
-	    case 3: // Read High Half
-	      NUbus_Data.byte[2] = 0xFF;
-	      NUbus_Data.byte[3] = 0;
-	      break;
+	case 3: // Read High Half
+	  NUbus_Data.byte[2] = 0xFF;
+	  NUbus_Data.byte[3] = 0;
+	  break;
 	      
-	    case 0:
-	      // Full word read
-	      NUbus_Data.byte[0] = 0xFF;
-	      NUbus_Data.byte[1] = 0;
-	      NUbus_Data.byte[2] = 0;
-	      NUbus_Data.byte[3] = 0;
-	      break;
-	    }
-	  }else{
-	    // BYTE READ
-	    NUbus_Data.byte[NUbus_Address.Byte] = 0xFF;
-	  }
-	  NUbus_acknowledge=1;
-	  return;
+	case 0:
+	  // Full word read
+	  NUbus_Data.byte[0] = 0xFF;
+	  NUbus_Data.byte[1] = 0;
+	  NUbus_Data.byte[2] = 0;
+	  NUbus_Data.byte[3] = 0;
+	  break;
 	}
-	if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
-	  if(NUbus_Request == VM_WRITE){
-	    switch(NUbus_Address.Byte){
-	    case 1: // Write Low Half
-	      break;
+      }else{
+	// BYTE READ
+	NUbus_Data.byte[NUbus_Address.Byte] = 0xFF;
+      }
+      NUbus_acknowledge=1;
+      return;
+    }
+    if(NUbus_Request == VM_WRITE || NUbus_Request == VM_BYTE_WRITE){
+      if(NUbus_Request == VM_WRITE){
+	switch(NUbus_Address.Byte){
+	case 1: // Write Low Half
+	  break;
 
-	    case 2: // Block Transfer
-	      logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
-	      ld_die_rq=1;
-	      break;
+	case 2: // Block Transfer
+	  logmsgf(LT_SDU,0,"SDU: BLOCK WRITE REQUESTED\n");
+	  ld_die_rq=1;
+	  break;
 
-	    case 3: // Write High Half
-	      break;
+	case 3: // Write High Half
+	  break;
 
-	    case 0:
-	      // Full word write
-	      break;
-	    }
-	  }else{
-	    // BYTE WRITE
-	  }
-	  NUbus_acknowledge=1;
-	  return;
-	}
-	break;
-	  
-	// SDU does not have a config prom
-      case 0xFFF800 ... 0xFFF8FF: 
-      case 0xFFFF64 ... 0xFFFFFF:
-	if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
-	  NUbus_Data.word = 0;
-	  NUbus_acknowledge=1;
+	case 0:
+	  // Full word write
+	  break;
 	}
-	return;
-
-      default:
-        logmsgf(LT_SDU,0,"SDU: Unimplemented address 0x%X (0x%X)\n",
-               NUbus_Address.Addr,NUbus_Address.raw);
-	lambda_dump(DUMP_ALL);
-	ld_die_rq=1;
+      }else{
+	// BYTE WRITE
       }
+      NUbus_acknowledge=1;
+      return;
+    }
+    break;
+	  
+    // SDU does not have a config prom
+  case 0xFFF800 ... 0xFFF8FF: 
+  case 0xFFFF64 ... 0xFFFFFF:
+    if(NUbus_Request == VM_READ || NUbus_Request == VM_BYTE_READ){
+      NUbus_Data.word = 0;
+      NUbus_acknowledge=1;
     }
-    // Request finished or not ours
+    return;
+
+  default:
+    logmsgf(LT_SDU,0,"SDU: Unimplemented address 0x%X (0x%X)\n",
+	   NUbus_Address.Addr,NUbus_Address.raw);
+    lambda_dump(DUMP_ALL);
+    ld_die_rq=1;
   }
 }
 
@@ -3080,27 +3407,23 @@ void dump_lisp_start_state(int I){
   system_configuration_qs *sys_conf = 0;
   processor_configuration_qs *proc_conf = 0;
   int x;
-  extern unsigned char MEM_RAM[2][0x800000];
+  uint8_t *ram;
   // Obtain proc conf base from Q
   proc_conf_base = pS[I].Qregister;
   logmsgf(LT_LISP,2,"LISP: PROC %d CONF BASE = 0x%X\n",I,proc_conf_base);
   // This is in nubus RAM, not SDU RAM!
-  if((proc_conf_base&0xFF000000) == 0xF9000000){
-    proc_conf = (processor_configuration_qs *)&MEM_RAM[0][proc_conf_base&0x7FFFFF];
-  }
-  if((proc_conf_base&0xFF000000) == 0xFA000000){
-    proc_conf = (processor_configuration_qs *)&MEM_RAM[1][proc_conf_base&0x7FFFFF];
+  ram = mem_slot_ram(proc_conf_base>>24);
+  if(ram != NULL){
+    proc_conf = (processor_configuration_qs *)&ram[proc_conf_base&0x7FFFFF];
   }
   if((proc_conf_base&0xFF000000) == 0xFF000000){
     proc_conf = (processor_configuration_qs *)&SDU_RAM[proc_conf_base&0xFFFF];
   }
   if(proc_conf != 0){
     logmsgf(LT_LISP,2,"LISP: SYS CONF BASE = 0x%X\n",proc_conf->sys_conf_ptr);
-    if((proc_conf->sys_conf_ptr&0xFF000000) == 0xF9000000){
-      sys_conf = (system_configuration_qs *)&MEM_RAM[0][proc_conf->sys_conf_ptr&0x7FFFFF];
-    }
-    if((proc_conf->sys_conf_ptr&0xFF000000) == 0xFA000000){
-      sys_conf = (system_configuration_qs *)&MEM_RAM[1][proc_conf->sys_conf_ptr&0x7FFFFF];
+    ram = mem_slot_ram(proc_conf->sys_conf_ptr>>24);
+    if(ram != NULL){
+      sys_conf = (system_configuration_qs *)&ram[proc_conf->sys_conf_ptr&0x7FFFFF];
     }
     if((proc_conf->sys_conf_ptr&0xFF000000) == 0xFF000000){
       sys_conf = (system_configuration_qs *)&SDU_RAM[proc_conf->sys_conf_ptr&0xFFFF];
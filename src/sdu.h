@@ -19,6 +19,7 @@
 
 void sdu_init();
 void sdu_clock_pulse();
+void sdu_nubus_slave(int arg);
 #ifdef HAVE_YAML_H
 int yaml_sdu_mapping_loop(yaml_parser_t *parser);
 #endif
@@ -57,16 +58,26 @@ typedef union rMNAMap_Ent {
   } __attribute__((packed));
 } MNAMap_Ent;
 
+// Multibus page table, see sdu.c
+#define MB_PAGES 1024
+extern uint8_t *mb_read_page[MB_PAGES];
+extern uint32_t mb_page_gen[MB_PAGES];
+extern MNAMap_Ent MNA_MAP[MB_PAGES];
+
 // interfaces to things
 uint8_t multibus_read(mbAddr addr);
 uint16_t multibus_word_read(mbAddr addr);
 void multibus_write(mbAddr addr,uint8_t data);
 void multibus_word_write(mbAddr addr,uint16_t data);
+void multibus_page_table_init();
+int multibus_block_read(mbAddr addr,uint8_t *buf,int len);
+int multibus_block_write(mbAddr addr,uint8_t *buf,int len);
 void multibus_interrupt(int irq);
 void clear_multibus_interrupt(int irq);
 uint8_t i8088_port_read(uint32_t addr);
 void i8088_port_write(uint32_t addr,uint8_t data);
 uint16_t pic_chk();
+int pic_pending();
 void sducons_rx_int();
 
 typedef struct tagsystem_configuration_qs {
@@ -26,6 +26,7 @@
 #include "ld.h"
 #include "sdu.h"
 #include "sdu_hw.h"
+#include "snapshot.h"
 
 uint8_t byteregtable[8] = { regal, regcl, regdl, regbl, regah, regch, regdh, regbh };
 
@@ -40,6 +41,36 @@ static const uint8_t parity[0x100] = {
   0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 0, 1, 1, 0, 1, 0, 0, 1
 };
 
+// Opcodes that have a ModRM byte
+static const uint8_t has_modrm[0x100] = {
+  1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0,
+  1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 1, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1, 1, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 1, 1
+};
+
+// 8088 clocks per opcode, register forms, from the Intel timing tables
+// (80186 timings for the 80186 opcodes).
+// A memory operand adds I86_MEM_CLOCKS, a taken branch I86_BRANCH_CLOCKS.
+// Multiply, divide and shift by CL are worked out when they run.
+static const uint8_t i86_clocks[0x100] = {
+  3, 3, 3, 3, 4, 4,14,12, 3, 3, 3, 3, 4, 4,14,12, 3, 3, 3, 3, 4, 4,14,12, 3, 3, 3, 3, 4, 4,14,12,
+  3, 3, 3, 3, 4, 4, 2, 4, 3, 3, 3, 3, 4, 4, 2, 4, 3, 3, 3, 3, 4, 4, 2, 8, 3, 3, 3, 3, 4, 4, 2, 8,
+  3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,15,15,15,15,15,15,15,15,12,12,12,12,12,12,12,12,
+36,51,33, 4, 4, 4, 4, 4,10,22,10,22,14,14,14,14, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  4, 4, 4, 4, 3, 3, 4, 4, 2, 2, 2, 2, 2, 2, 2,12, 3, 3, 3, 3, 3, 3, 3, 3, 2, 5,36, 4,14,12, 4, 4,
+ 14,14,14,14,18,26,22,30, 4, 4,11,15,12,16,15,19, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+  5, 5,24,20,24,24, 4, 4,15, 8,33,34,72,71, 4,44, 2, 2, 8, 8,83,60, 4,11, 2, 2, 2, 2, 2, 2, 2, 2,
+  5, 6, 5, 6,10,14,10,14,23,15,15,15, 8,12, 8,12, 2, 2, 2, 2, 2, 2, 5, 5, 2, 2, 2, 2, 2, 2, 3,11
+};
+#define I86_MEM_CLOCKS 16    // Address calculation and the bus cycles for the operand
+#define I86_BRANCH_CLOCKS 12 // Refilling the queue
+#define I86_INTR_CLOCKS 61   // Taking a hardware interrupt
+
 // uint8_t RAM[0x100000], readonly[0x100000];
 uint8_t dotrace = 0;
 uint8_t opcode, segoverride, reptype, bootdrive = 0, hdcount = 0, hltstate = 0;
@@ -53,8 +84,31 @@ uint64_t totalexec;
 
 union _bytewordregs_ regs;
 
+// Clocks taken by the instruction just run
+static int i86_instr_clocks(){
+  int clocks = i86_clocks[opcode];
+  if(has_modrm[opcode] != 0 && mode != 3){ clocks += I86_MEM_CLOCKS; }
+  switch(opcode){
+  case 0x70 ... 0x7F: // Jcc
+  case 0xE0 ... 0xE3: // LOOP, JCXZ
+    if(ip != (uint16_t)(saveip+2)){ clocks += I86_BRANCH_CLOCKS; }
+    break;
+  case 0xD2: case 0xD3: // Shift by CL
+    clocks += 4*regs.byteregs[regcl];
+    break;
+  case 0xF6: // MUL, IMUL, DIV, IDIV byte
+    if(reg >= 4){ clocks += (reg == 4 ? 70 : reg == 5 ? 80 : reg == 6 ? 80 : 100); }
+    break;
+  case 0xF7: // MUL, IMUL, DIV, IDIV word
+    if(reg >= 4){ clocks += (reg == 4 ? 118 : reg == 5 ? 128 : reg == 6 ? 144 : 165); }
+    break;
+  }
+  return(clocks);
+}
+
 // LD ITEMS
 extern int ld_die_rq;
+extern int icount;
 
 void intcall86 (uint8_t intnum);
 
@@ -1220,9 +1274,81 @@ void intcall86 (uint8_t intnum) {
 
 
 static uint16_t trap_toggle = 0;
+int sdu_clock = SDU_CLOCK_KHZ;   // 8088 clock rate in KHz
+static int64_t i86_credit = 0;   // Time the 8088 may run for, in 1/NUBUS_KHZ clocks
+static int i86_spent = 0;        // Clocks used by the last step
 uint8_t docontinue;
 static uint16_t firstip;
 
+// Decoded instruction cache. The prefixes, opcode, ModRM byte and
+// displacement of an instruction in SDU RAM or ROM are decoded once, straight
+// from memory, and kept by linear address. An entry is good until its page's
+// write generation changes. Instructions that cross a page are not cached.
+#define I86_DCACHE_SIZE 4096 // Must be a power of two
+static i86Decoded i86_dcache[I86_DCACHE_SIZE];
+i86Decoded *i86_modrm = NULL; // ModRM of the instruction being run, if decoded
+
+static i86Decoded *i86_decode(uint32_t addr){
+  i86Decoded *d = &i86_dcache[addr&(I86_DCACHE_SIZE-1)];
+  uint32_t page = addr>>10;
+  uint32_t off = addr&0x3FF;
+  uint8_t *mem;
+  int n = 0;
+  if(d->valid != 0 && d->addr == addr && d->gen == mb_page_gen[page]){
+    return(d);
+  }
+  mem = mb_read_page[page];
+  if(mem == NULL || MNA_MAP[page].Enable != 0){ return(NULL); }
+  d->valid = 0;
+  d->reptype = 0;
+  d->segment = -1;
+  while(1){
+    uint8_t byte;
+    if(off+n >= 1024 || n >= 15){ return(NULL); }
+    byte = mem[off+n];
+    n++;
+    switch(byte){
+    case 0x2E: d->segment = regcs; continue;
+    case 0x3E: d->segment = regds; continue;
+    case 0x26: d->segment = reges; continue;
+    case 0x36: d->segment = regss; continue;
+    case 0xF3: d->reptype = 1; continue;
+    case 0xF2: d->reptype = 2; continue;
+    }
+    d->opcode = byte;
+    break;
+  }
+  d->length = n;
+  d->modrm_length = 0;
+  d->disp16 = 0;
+  if(has_modrm[d->opcode] != 0){
+    if(off+n >= 1024){ return(NULL); }
+    d->addrbyte = mem[off+n];
+    d->modrm_length = 1;
+    switch(d->addrbyte>>6){
+    case 0:
+      if((d->addrbyte&7) == 6){ d->modrm_length = 3; }
+      break;
+    case 1:
+      d->modrm_length = 2;
+      break;
+    case 2:
+      d->modrm_length = 3;
+      break;
+    }
+    if(off+n+d->modrm_length > 1024){ return(NULL); }
+    if(d->modrm_length == 2){
+      d->disp16 = signext(mem[off+n+1]);
+    }else if(d->modrm_length == 3){
+      d->disp16 = mem[off+n+1]|(mem[off+n+2]<<8);
+    }
+  }
+  d->addr = addr;
+  d->gen = mb_page_gen[page];
+  d->valid = 1;
+  return(d);
+}
+
 void i8086_clockpulse(){
   if (trap_toggle) {
     intcall86 (1);
@@ -1239,11 +1365,12 @@ void i8086_clockpulse(){
     trap_toggle = 0;
   }
 
-  if (!trap_toggle && (ifl)){ // && (i8259.irr & (~i8259.imr) ) ) ) {
+  if (!trap_toggle && (ifl) && pic_pending()){ // && (i8259.irr & (~i8259.imr) ) ) ) {
     uint16_t status = pic_chk();
     if(status&0x8000){
       hltstate = 0;
       intcall86(status&0x7FFF);
+      i86_spent += I86_INTR_CLOCKS;
     }
     // intcall86 (nextintr() );        /* get next interrupt from the i8259, if any */
   }
@@ -1255,6 +1382,28 @@ void i8086_clockpulse(){
   useseg = segregs[regds];
   docontinue = 0;
   firstip = ip;
+  i86_modrm = NULL;
+
+  // Already decoded?
+  if(dotrace == 0){
+    i86Decoded *d;
+    segregs[regcs] = segregs[regcs] & 0xFFFF;
+    d = i86_decode((segbase(segregs[regcs])+ip)&0xFFFFF);
+    // (An instruction that wraps around the end of the segment is fetched the long way)
+    if(d != NULL && (uint32_t)ip+d->length+d->modrm_length <= 0x10000){
+      if(d->segment >= 0){
+	useseg = segregs[d->segment];
+	segoverride = 1;
+      }
+      reptype = d->reptype;
+      opcode = d->opcode;
+      savecs = segregs[regcs];
+      saveip = ip+d->length-1;
+      StepIP(d->length);
+      if(d->modrm_length != 0){ i86_modrm = d; }
+      docontinue = 1;
+    }
+  }
 
   while (!docontinue) {
     segregs[regcs] = segregs[regcs] & 0xFFFF;
@@ -3453,5 +3602,49 @@ void i8086_clockpulse(){
     // }
     break;
   }
+  i86_spent += i86_instr_clocks();
+}
+
+// Run the 8088 for some NUbus cycles worth of time. The time is turned into
+// 8088 clocks at sdu_clock, and instructions run until they have used it up.
+// Time spent inside an instruction waiting on the bus is charged to it too.
+// What an instruction overruns by is taken from the next call.
+void i8086_run(int cycles){
+  i86_credit += (int64_t)cycles*sdu_clock;
+  while(i86_credit > 0){
+    int start = icount;
+    // A halted 8088 has nothing to do until an interrupt can be taken
+    if(hltstate != 0 && trap_toggle == 0 && tf == 0 && (ifl == 0 || pic_pending() == 0)){
+      i86_credit = 0;
+      return;
+    }
+    i86_spent = 0;
+    i8086_clockpulse();
+    i86_credit -= (int64_t)i86_spent*NUBUS_KHZ;
+    i86_credit -= (int64_t)(icount-start)*sdu_clock;
+    if(hltstate != 0){
+      i86_credit = 0;
+      return;
+    }
+  }
+}
 
+// Snapshot support
+void i8086_snapshot(int op __attribute__ ((unused))){
+  SNAP_ITEM(regs);
+  SNAP_ITEM(segregs);
+  SNAP_ITEM(ip);
+  SNAP_ITEM(cf);
+  SNAP_ITEM(pf);
+  SNAP_ITEM(af);
+  SNAP_ITEM(zf);
+  SNAP_ITEM(sf);
+  SNAP_ITEM(tf);
+  SNAP_ITEM(ifl);
+  SNAP_ITEM(df);
+  SNAP_ITEM(of);
+  SNAP_ITEM(hltstate);
+  SNAP_ITEM(trap_toggle);
+  SNAP_ITEM(didintr);
+  SNAP_ITEM(totalexec);
 }
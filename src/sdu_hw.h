@@ -21,6 +21,13 @@
 
 void reset86();
 void i8086_clockpulse();
+void i8086_run(int cycles);
+
+// Clock rates. The 8088 is run in NUbus cycles worth of time.
+#define NUBUS_KHZ 5000
+#define SDU_CLOCK_KHZ 10000
+#define SDU_SLICE 50       // NUbus cycles between runs of the 8088
+extern int sdu_clock;
 
 #define regax 0
 #define regcx 1
@@ -74,6 +81,21 @@ struct addrmodecache_s {
 };
 #endif
 
+// Decoded instruction, see i86_decode()
+typedef struct ri86Decoded {
+  uint32_t addr;        // Linear address of the first prefix byte
+  uint32_t gen;         // Write generation of its page when it was decoded
+  uint8_t valid;
+  uint8_t opcode;
+  uint8_t length;       // Prefixes and opcode
+  uint8_t reptype;
+  int8_t segment;       // Segment override register, -1 if none
+  uint8_t addrbyte;     // ModRM byte
+  uint8_t modrm_length; // ModRM byte and displacement, 0 if the opcode has none
+  uint16_t disp16;
+} i86Decoded;
+extern i86Decoded *i86_modrm;
+
 #define StepIP(x)       ip += x
 #define getmem8(x, y)   read86(segbase(x) + y)
 #define getmem16(x, y)  readw86(segbase(x) + y)
@@ -108,35 +130,47 @@ struct addrmodecache_s {
   of = (temp16 >> 11) & 1; \
   }
 
+// The ModRM byte and displacement may have been decoded with the opcode
 #define modregrm() {			  \
-    addrbyte = getmem8(segregs[regcs], ip);	\
-    StepIP(1);					\
-    mode = addrbyte >> 6;			\
-    reg = (addrbyte >> 3) & 7;			\
-    rm = addrbyte & 7;				\
-    switch(mode)				\
-      {						\
-      case 0:					\
-	if(rm == 6) {				\
+    if(i86_modrm != NULL){				\
+      addrbyte = i86_modrm->addrbyte;			\
+      disp16 = i86_modrm->disp16;			\
+      StepIP(i86_modrm->modrm_length);			\
+      i86_modrm = NULL;					\
+    }else{						\
+      addrbyte = getmem8(segregs[regcs], ip);		\
+      StepIP(1);					\
+      switch(addrbyte >> 6)				\
+	{						\
+	case 0:						\
+	  if((addrbyte & 7) == 6) {			\
+	    disp16 = getmem16(segregs[regcs], ip);	\
+	    StepIP(2);					\
+	  }						\
+	  break;					\
+	case 1:						\
+	  disp16 = signext(getmem8(segregs[regcs], ip));	\
+	  StepIP(1);					\
+	  break;					\
+	case 2:						\
 	  disp16 = getmem16(segregs[regcs], ip);	\
 	  StepIP(2);					\
+	  break;					\
 	}						\
+    }							\
+    mode = addrbyte >> 6;				\
+    reg = (addrbyte >> 3) & 7;				\
+    rm = addrbyte & 7;					\
+    switch(mode)					\
+      {							\
+      case 0:						\
 	if(((rm == 2) || (rm == 3)) && !segoverride) {	\
 	  useseg = segregs[regss];			\
 	}						\
 	break;						\
 							\
       case 1:						\
-	disp16 = signext(getmem8(segregs[regcs], ip));	\
-	StepIP(1);					     \
-	if(((rm == 2) || (rm == 3) || (rm == 6)) && !segoverride) {	\
-	  useseg = segregs[regss];					\
-	}								\
-	break;								\
-									\
-      case 2:								\
-	disp16 = getmem16(segregs[regcs], ip);				\
-	StepIP(2);							\
+      case 2:						\
 	if(((rm == 2) || (rm == 3) || (rm == 6)) && !segoverride) {	\
 	  useseg = segregs[regss];					\
 	}								\
@@ -165,12 +199,18 @@ typedef struct tag_i8259 {
 } i8259;
 
 // 8253 PIT
+// Counters are not stepped; see pit_event() in sdu.c.
 typedef struct tag_i8253 {
-  uint16_t Counter[3];     // Binary counter
-  double RCounter[3];      // Real Counter
+  uint16_t Counter[3];     // Count being loaded
+  uint64_t Start[3];       // pit_ticks when the count started
+  uint64_t Changes[3];     // Output changes since then
+  uint64_t Next[3];        // pit_ticks of the next output change
+  uint64_t Drop[3];        // pit_ticks to drop the pulse of a rate generator, or 0
   uint8_t Output[3];       // Output line
-  uint8_t Output_Ticks[3]; // Count since last change
   uint16_t IV[3];          // Initial value
+  uint16_t Latch[3];       // Latched count
+  uint8_t Latched[3];      // Bytes of the latched count left to read
+  uint8_t ReadHW[3];       // Next read is of the high byte
   uint8_t LoadHW[3];       // Load Halfword
   uint8_t Format[3];       // Format of count
   uint8_t Mode[3];         // Mode byte
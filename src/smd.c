@@ -23,16 +23,19 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <strings.h>
+#include <pthread.h>
 #ifdef HAVE_YAML_H
 #include <yaml.h>
 #endif
@@ -40,6 +43,7 @@
 #include "ld.h"
 #include "nubus.h"
 #include "sdu.h"
+#include "snapshot.h"
 
 // SMD controller command register
 typedef union rSMD_RCmd_Reg {
@@ -126,6 +130,14 @@ typedef union rSMD_UIB {
 } SMD_UIB_U;
 
 uint8_t SMD_BUFFER_RAM[1024];
+uint8_t *SMD_Sector_Data = SMD_BUFFER_RAM; // Sector being sent to memory
+// Sectors of the current IOPB, read from the disk or to be written to it
+// in one go. Sectors still pass through SMD_BUFFER_RAM one at a time, so
+// the controller takes as long as it always did.
+#define SMD_XFER_SECTORS 64
+uint8_t SMD_XFER_RAM[SMD_XFER_SECTORS*1024];
+uint32_t SMD_Xfer_First = 0; // Sector in the start of SMD_XFER_RAM
+int SMD_Xfer_Sectors = 0;    // Sectors in SMD_XFER_RAM
 SMD_RStatus_Reg SMD_RStatus;
 SMD_RCmd_Reg SMD_RCmd;
 SMD_IOPB_Base_Reg SMD_IOPB_Base;
@@ -156,9 +168,46 @@ int SMD_Share_Interrupt = 0;
 // Disk storage interface
 int disk_fd[4] = { -1,-1,-1,-1 }; // fd of disk file
 SMD_UIB_U SMD_UIB[4];
-off_t seek_res; // Result of seek operations
 ssize_t io_res; // Result of read/write operations
 int SMD_Retries; // Retry counter
+int SMD_IO_Count = 0; // Sectors of the host read or write in progress
+int SMD_IO_Busy = 0;  // Host I/O is queued and hasn't been collected yet
+
+// Host I/O. Synchronous I/O is done by the controller as it goes. With
+// asynchronous I/O one thread does it instead, so a slow host disk holds up
+// the controller, which stays busy until its request is done, but not the
+// emulation thread. The controller has one request in flight at a time.
+// With mapped I/O the images are mapped into memory; sectors are sent to
+// memory straight from the mapping, and written by copying them into it.
+#define SMD_IO_SYNC 0
+#define SMD_IO_ASYNC 1
+#define SMD_IO_MMAP 2
+int smd_io_mode = SMD_IO_SYNC;
+
+// When writes to a mapped image go to the host disk
+#define SMD_MSYNC_NONE 0  // Whenever the host gets around to it
+#define SMD_MSYNC_ASYNC 1 // Started at the end of each write
+#define SMD_MSYNC_SYNC 2  // Finished before each write completes
+int smd_msync = SMD_MSYNC_NONE;
+uint8_t *disk_map[4] = { NULL,NULL,NULL,NULL };
+size_t disk_map_len[4];
+
+typedef struct rSMD_IO_Req {
+  int unit;
+  int write_op;
+  uint8_t *buf;
+  uint32_t sector;
+  int count;
+  ssize_t result;
+} SMD_IO_Req;
+
+static SMD_IO_Req smd_io_req;
+static int smd_io_queued = 0;   // smd_io_req is waiting for or in the thread
+static int smd_io_running = 0;
+static int smd_io_stopping = 0;
+static pthread_t smd_io_thread;
+static pthread_mutex_t smd_io_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t smd_io_cond = PTHREAD_COND_INITIALIZER;
 
 // Externals
 extern int ld_die_rq;
@@ -167,24 +216,338 @@ extern int ld_die_rq;
 
 // Filenames
 char disk_fn[4][64] = { "disks/disk.img",{0},{0},{0} };
+char disk_ovl_fn[4][64] = { {0},{0},{0},{0} };
+
+// Copy-on-write overlays. A unit with an overlay opens its image read only
+// and keeps the sectors written to it in the overlay file. The file is a
+// header, an index with an entry for each sector of the image, and the
+// sectors themselves in the order they were first written. An index entry
+// is 0 if the sector is in the image, or its position in the overlay plus
+// one. Sectors written to the overlay are never freed.
+#define SMD_OVERLAY_MAGIC "LDOVLY01"
+#define SMD_OVERLAY_VERSION 1
+typedef struct rSMD_Overlay_Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t sectors;   // Sectors in the image, rounded up
+  uint64_t base_size; // Size of the image the overlay was made for
+  uint32_t used;      // Sectors in the overlay
+  uint32_t spare;
+} __attribute__((packed)) SMD_Overlay_Header;
+
+typedef struct rSMD_Overlay {
+  SMD_Overlay_Header hdr;
+  uint32_t *index;
+  off_t data;         // File offset of the first sector
+} SMD_Overlay;
+
+SMD_Overlay disk_ovl[4];
+int disk_ovl_fd[4] = { -1,-1,-1,-1 }; // fd of overlay file
+
+static void *smd_io_worker(void *arg);
+static void smd_io_stop();
+static ssize_t smd_file_io(int fd,int write_op,uint8_t *buf,off_t offset,size_t len);
+
+// Open a unit's overlay, making it if it isn't there
+static int smd_overlay_open(int unit){
+  SMD_Overlay *ov = &disk_ovl[unit];
+  size_t index_len;
+  struct stat st;
+  uint32_t x = 0;
+  if(fstat(disk_fd[unit],&st) < 0){
+    perror("Disk:fstat");
+    return(-1);
+  }
+  disk_ovl_fd[unit] = open(disk_ovl_fn[unit],O_RDWR|O_CREAT|O_EXCL,0644);
+  if(disk_ovl_fd[unit] >= 0){
+    // New overlay
+    bzero(&ov->hdr,sizeof(ov->hdr));
+    memcpy(ov->hdr.magic,SMD_OVERLAY_MAGIC,8);
+    ov->hdr.version = SMD_OVERLAY_VERSION;
+    ov->hdr.sectors = (st.st_size+0x3FF)/0x400;
+    ov->hdr.base_size = st.st_size;
+    if(smd_file_io(disk_ovl_fd[unit],1,(uint8_t *)&ov->hdr,0,sizeof(ov->hdr)) != sizeof(ov->hdr)){
+      perror("Disk:overlay");
+      close(disk_ovl_fd[unit]);
+      disk_ovl_fd[unit] = -1;
+      return(-1);
+    }
+    logmsgf(LT_SMD,0,"Created overlay %s for unit %d\n",disk_ovl_fn[unit],unit);
+  }else{
+    if(errno == EEXIST){ disk_ovl_fd[unit] = open(disk_ovl_fn[unit],O_RDWR); }
+    if(disk_ovl_fd[unit] < 0){
+      perror("Disk:overlay");
+      return(-1);
+    }
+    if(smd_file_io(disk_ovl_fd[unit],0,(uint8_t *)&ov->hdr,0,sizeof(ov->hdr)) != sizeof(ov->hdr) ||
+       memcmp(ov->hdr.magic,SMD_OVERLAY_MAGIC,8) != 0 || ov->hdr.version != SMD_OVERLAY_VERSION){
+      logmsgf(LT_SMD,0,"Disk: %s is not an overlay\n",disk_ovl_fn[unit]);
+      close(disk_ovl_fd[unit]);
+      disk_ovl_fd[unit] = -1;
+      return(-1);
+    }
+    if(ov->hdr.base_size != (uint64_t)st.st_size){
+      logmsgf(LT_SMD,0,"Disk: Overlay %s was not made for %s\n",disk_ovl_fn[unit],disk_fn[unit]);
+      close(disk_ovl_fd[unit]);
+      disk_ovl_fd[unit] = -1;
+      return(-1);
+    }
+  }
+  // The index is kept in memory; sectors start on the next sector boundary
+  index_len = (size_t)ov->hdr.sectors*sizeof(uint32_t);
+  ov->data = (sizeof(ov->hdr)+index_len+0x3FF)&~(off_t)0x3FF;
+  ov->index = calloc(ov->hdr.sectors+1,sizeof(uint32_t));
+  if(ov->index == NULL){
+    perror("Disk:calloc");
+    close(disk_ovl_fd[unit]);
+    disk_ovl_fd[unit] = -1;
+    return(-1);
+  }
+  // A new overlay's index is past its end, and stays zeroes
+  if(smd_file_io(disk_ovl_fd[unit],0,(uint8_t *)ov->index,sizeof(ov->hdr),index_len) < 0){
+    perror("Disk:overlay");
+    close(disk_ovl_fd[unit]);
+    disk_ovl_fd[unit] = -1;
+    return(-1);
+  }
+  while(x < ov->hdr.sectors){
+    if(ov->index[x] > ov->hdr.used){
+      logmsgf(LT_SMD,0,"Disk: Overlay %s is damaged\n",disk_ovl_fn[unit]);
+      close(disk_ovl_fd[unit]);
+      disk_ovl_fd[unit] = -1;
+      return(-1);
+    }
+    x++;
+  }
+  logmsgf(LT_SMD,0,"Using overlay %s for unit %d, %u sectors written\n",disk_ovl_fn[unit],unit,ov->hdr.used);
+  return(0);
+}
 
 int smd_init(){
   int x=0,y=0;
   while(x < 4){
     if(disk_fn[x][0] != 0){
-      disk_fd[x] = open(disk_fn[x],O_RDWR);
+      disk_fd[x] = open(disk_fn[x],disk_ovl_fn[x][0] != 0 ? O_RDONLY : O_RDWR);
       if(disk_fd[x] < 0){
 	perror("Disk:open");
 	disk_fd[x] = -1;
+      }else if(disk_ovl_fn[x][0] != 0 && smd_overlay_open(x) < 0){
+	close(disk_fd[x]);
+	disk_fd[x] = -1;
       }else{
 	y++;
       }
     }
     x++;
   }
+  if(smd_io_mode == SMD_IO_MMAP){
+    x = 0;
+    while(x < 4){
+      struct stat st;
+      // Units with overlays are read and written
+      if(disk_fd[x] >= 0 && disk_ovl_fd[x] < 0 && fstat(disk_fd[x],&st) == 0 && st.st_size >= 1024){
+	// Only whole sectors are mapped. The rest are read and written.
+	disk_map_len[x] = st.st_size&~(off_t)0x3FF;
+	disk_map[x] = mmap(NULL,disk_map_len[x],PROT_READ|PROT_WRITE,MAP_SHARED,disk_fd[x],0);
+	if(disk_map[x] == MAP_FAILED){
+	  perror("Disk:mmap");
+	  disk_map[x] = NULL;
+	}else{
+	  // Read-ahead is asked for an IOPB at a time
+	  madvise(disk_map[x],disk_map_len[x],MADV_RANDOM);
+	}
+      }
+      x++;
+    }
+  }
+  if(smd_io_mode == SMD_IO_ASYNC){
+    if(pthread_create(&smd_io_thread,NULL,smd_io_worker,NULL) != 0){
+      printf("Disk: Unable to start I/O thread\n");
+      return(-1);
+    }
+    smd_io_running = 1;
+    atexit(smd_io_stop);
+  }
   return(y);
 }
 
+// Read or write len bytes at offset. Returns the bytes moved, which are
+// short only at the end of the file, or -1 on error.
+static ssize_t smd_file_io(int fd,int write_op,uint8_t *buf,off_t offset,size_t len){
+  size_t done = 0;
+  while(done < len){
+    ssize_t res;
+    if(write_op != 0){
+      res = pwrite(fd,buf+done,len-done,offset+done);
+    }else{
+      res = pread(fd,buf+done,len-done,offset+done);
+    }
+    if(res < 0){
+      if(errno == EINTR){ continue; }
+      return(-1);
+    }
+    if(res == 0){ break; } // End of file
+    done += res;
+  }
+  return(done);
+}
+
+// Read or write a run of sectors of a unit with an overlay. Sectors past
+// the end of the image can't be written.
+static ssize_t smd_overlay_io(int unit,int write_op,uint8_t *buf,uint32_t sector,int count){
+  SMD_Overlay *ov = &disk_ovl[unit];
+  uint32_t place[SMD_XFER_SECTORS]; // Where a write puts each sector
+  uint32_t *where = ov->index+sector;
+  uint32_t used = ov->hdr.used;
+  int x = 0;
+  if(write_op != 0){
+    if(sector+count > ov->hdr.sectors || count > SMD_XFER_SECTORS){ return(-1); }
+    // Give new sectors their places first, so a run of them is one write.
+    // The index only points at them once they are written.
+    while(x < count){
+      place[x] = (ov->index[sector+x] != 0 ? ov->index[sector+x] : ++used);
+      x++;
+    }
+    where = place;
+    x = 0;
+  }
+  while(x < count){
+    uint32_t first = sector+x;
+    int run = 1;
+    ssize_t res;
+    if(first >= ov->hdr.sectors){ break; } // Past the end of the image
+    // Sectors that are next to each other in the image or in the overlay
+    while(x+run < count && first+run < ov->hdr.sectors &&
+	  where[x+run] == (where[x] != 0 ? where[x]+run : 0)){
+      run++;
+    }
+    if(where[x] == 0){
+      res = smd_file_io(disk_fd[unit],0,buf+(x*0x400),(off_t)first*0x400,run*0x400);
+    }else{
+      res = smd_file_io(disk_ovl_fd[unit],write_op,buf+(x*0x400),ov->data+((off_t)(where[x]-1)*0x400),run*0x400);
+    }
+    if(res < 0){ return(-1); }
+    if(res < run*0x400){
+      // End of the image, or of a sector written short
+      if(write_op != 0){ return(-1); }
+      return((x*0x400)+res);
+    }
+    x += run;
+  }
+  if(write_op != 0){
+    // The sectors reach the disk before the new count, and the count before
+    // the index entries that point at them, so an overlay cut short by a
+    // crash has only lost space. Neither changes in memory until it is
+    // written.
+    if(fdatasync(disk_ovl_fd[unit]) < 0){ return(-1); }
+    if(used != ov->hdr.used){
+      SMD_Overlay_Header hdr = ov->hdr;
+      hdr.used = used;
+      if(smd_file_io(disk_ovl_fd[unit],1,(uint8_t *)&hdr,0,sizeof(hdr)) < 0 ||
+	 fdatasync(disk_ovl_fd[unit]) < 0){ return(-1); }
+      ov->hdr.used = used;
+    }
+    if(smd_file_io(disk_ovl_fd[unit],1,(uint8_t *)place,sizeof(ov->hdr)+(sector*sizeof(uint32_t)),
+		   count*sizeof(uint32_t)) < 0){ return(-1); }
+    memcpy(ov->index+sector,place,count*sizeof(uint32_t));
+  }
+  return(x*0x400);
+}
+
+// Read or write a run of sectors. Returns the bytes moved, which are
+// short only at the end of the image, or -1 on error.
+static ssize_t smd_disk_io(int unit,int write_op,uint8_t *buf,uint32_t sector,int count){
+  if(disk_ovl_fd[unit] >= 0){
+    return(smd_overlay_io(unit,write_op,buf,sector,count));
+  }
+  return(smd_file_io(disk_fd[unit],write_op,buf,(off_t)sector*0x400,count*0x400));
+}
+
+// Where a sector is in a unit's mapped image, or NULL if it isn't mapped
+static uint8_t *smd_map_sector(int unit,uint32_t sector){
+  if(disk_map[unit] == NULL || ((size_t)sector+1)*1024 > disk_map_len[unit]){ return(NULL); }
+  return(disk_map[unit]+((size_t)sector*1024));
+}
+
+// Page aligned span of the mapped sectors from first to last, inclusive
+static size_t smd_map_span(int unit,uint32_t first,uint32_t last,uint8_t **start){
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t from = ((size_t)first*1024)&~(page-1);
+  size_t to = ((size_t)last+1)*1024;
+  if(to > disk_map_len[unit]){ to = disk_map_len[unit]; }
+  *start = disk_map[unit]+from;
+  return(to > from ? to-from : 0);
+}
+
+// Do the controller's requests as they come
+static void *smd_io_worker(void *arg __attribute__ ((unused))){
+  pthread_mutex_lock(&smd_io_lock);
+  while(1){
+    ssize_t res;
+    while(smd_io_queued == 0 && smd_io_stopping == 0){
+      pthread_cond_wait(&smd_io_cond,&smd_io_lock);
+    }
+    if(smd_io_queued == 0){ break; } // Stopping, and nothing left to do
+    pthread_mutex_unlock(&smd_io_lock);
+    res = smd_disk_io(smd_io_req.unit,smd_io_req.write_op,smd_io_req.buf,smd_io_req.sector,smd_io_req.count);
+    pthread_mutex_lock(&smd_io_lock);
+    smd_io_req.result = res;
+    __atomic_store_n(&smd_io_queued,0,__ATOMIC_RELEASE);
+    pthread_cond_broadcast(&smd_io_cond);
+  }
+  pthread_mutex_unlock(&smd_io_lock);
+  return(NULL);
+}
+
+// Finish the request in flight and stop the thread
+static void smd_io_stop(){
+  if(smd_io_running != 0){
+    pthread_mutex_lock(&smd_io_lock);
+    smd_io_stopping = 1;
+    pthread_cond_broadcast(&smd_io_cond);
+    pthread_mutex_unlock(&smd_io_lock);
+    pthread_join(smd_io_thread,NULL);
+    smd_io_running = 0;
+  }
+}
+
+// Start the controller's host read or write. Synchronous I/O is done at
+// once and leaves the result in io_res. Otherwise it is handed to the
+// thread, and SMD_IO_Busy stays set until smd_io_poll() sees it done.
+static void smd_io_start(int unit,int write_op,uint8_t *buf,uint32_t sector,int count){
+  if(smd_io_running == 0){
+    io_res = smd_disk_io(unit,write_op,buf,sector,count);
+    return;
+  }
+  pthread_mutex_lock(&smd_io_lock);
+  smd_io_req.unit = unit;
+  smd_io_req.write_op = write_op;
+  smd_io_req.buf = buf;
+  smd_io_req.sector = sector;
+  smd_io_req.count = count;
+  smd_io_queued = 1;
+  pthread_cond_broadcast(&smd_io_cond);
+  pthread_mutex_unlock(&smd_io_lock);
+  SMD_IO_Busy = 1;
+}
+
+// Collect the controller's host I/O into io_res if it is done, waiting for
+// it if asked to. Returns 0 if it is still going.
+static int smd_io_poll(int wait){
+  if(SMD_IO_Busy == 0){ return(1); }
+  if(__atomic_load_n(&smd_io_queued,__ATOMIC_ACQUIRE) != 0){
+    if(wait == 0){ return(0); }
+    pthread_mutex_lock(&smd_io_lock);
+    while(smd_io_queued != 0){
+      pthread_cond_wait(&smd_io_cond,&smd_io_lock);
+    }
+    pthread_mutex_unlock(&smd_io_lock);
+  }
+  io_res = smd_io_req.result;
+  SMD_IO_Busy = 0;
+  return(1);
+}
+
 void smd_reset(){
   SMD_RStatus.raw = 0;
   if(disk_fd[0] > 0){ SMD_RStatus.Unit1Ready = 1; }
@@ -193,6 +556,57 @@ void smd_reset(){
   if(disk_fd[3] > 0){ SMD_RStatus.Unit4Ready = 1; }
 }
 
+// Snapshot support
+void smd_snapshot(int op){
+  // Host I/O in flight finishes first, into the buffer being saved or
+  // before it is overwritten. A sector being sent from a mapped image is
+  // sent from the buffer instead, so the snapshot holds it.
+  if(op != SNAP_CHECK){
+    smd_io_poll(1);
+    if(SMD_Sector_Data != SMD_BUFFER_RAM){
+      if(op == SNAP_SAVE){ memcpy(SMD_BUFFER_RAM,SMD_Sector_Data,1024); }
+      SMD_Sector_Data = SMD_BUFFER_RAM;
+    }
+  }
+  SNAP_ITEM(SMD_BUFFER_RAM);
+  SNAP_ITEM(SMD_XFER_RAM);
+  SNAP_ITEM(SMD_Xfer_First);
+  SNAP_ITEM(SMD_Xfer_Sectors);
+  SNAP_ITEM(SMD_RStatus);
+  SNAP_ITEM(SMD_RCmd);
+  SNAP_ITEM(SMD_IOPB_Base);
+  SNAP_ITEM(SMD_IOPB);
+  SNAP_ITEM(SMD_Controller_State);
+  SNAP_ITEM(SMD_Xfer_Addr);
+  SNAP_ITEM(NB_Addr);
+  SNAP_ITEM(NB_Data);
+  SNAP_ITEM(SMD_Xfer_Mode);
+  SNAP_ITEM(SMD_Xfer_Count);
+  SNAP_ITEM(SMD_Xfer_Size);
+  SNAP_ITEM(SMD_Sector_Counter);
+  SNAP_ITEM(SMD_Burst_Counter);
+  SNAP_ITEM(SMD_LBA);
+  SNAP_ITEM(SMD_Sector);
+  SNAP_ITEM(SMD_Retries);
+  SNAP_ITEM(SMD_IO_Count);
+  SNAP_ITEM(io_res);
+  SNAP_ITEM(SMD_UIB);
+  SNAP_ITEM(SDU_Shared_Disk_Mode);
+  SNAP_ITEM(Active_SIOPB);
+  SNAP_ITEM(Share_i8086_Addr);
+  SNAP_ITEM(Share_Xfer_Addr);
+  SNAP_ITEM(Share_NB_Addr);
+  SNAP_ITEM(Share_Runme_Addr);
+  SNAP_ITEM(SMD_Share_Interrupt);
+  if(op == SNAP_LOAD){
+    // Unit ready bits follow the disks we have now
+    SMD_RStatus.Unit1Ready = (disk_fd[0] > 0);
+    SMD_RStatus.Unit2Ready = (disk_fd[1] > 0);
+    SMD_RStatus.Unit3Ready = (disk_fd[2] > 0);
+    SMD_RStatus.Unit4Ready = (disk_fd[3] > 0);
+  }
+}
+
 void smd_clock_pulse(){
   if(SMD_Controller_State > 0){
     switch(SMD_Controller_State){
@@ -394,8 +808,15 @@ void smd_clock_pulse(){
 	SMD_IOPB.Sector;
       SMD_Retries = 0;
       SMD_Sector_Counter = 0;
+      SMD_Xfer_Sectors = 0;
       SMD_Xfer_Addr.raw = SMD_IOPB.Buffer_Address;
       SMD_Xfer_Size = SMD_IOPB.DMA_Burst_Size;
+      if(disk_map[SMD_IOPB.Unit] != NULL && SMD_IOPB.SectorCount > 0){
+	// Have the host start reading the IOPB's sectors
+	uint8_t *start;
+	size_t len = smd_map_span(SMD_IOPB.Unit,SMD_Sector,SMD_Sector+SMD_IOPB.SectorCount-1,&start);
+	if(len > 0){ madvise(start,len,MADV_WILLNEED); }
+      }
       SMD_Controller_State++;
       // Falls thru
     case 21: // DISK READ SECTOR
@@ -409,22 +830,38 @@ void smd_clock_pulse(){
       case 3:
 	SMD_RStatus.Unit4Ready = 0; break; // Drive is busy
       }
-      // Reposition the file pointer.
-      seek_res = lseek(disk_fd[SMD_IOPB.Unit],(SMD_Sector*0x400),SEEK_SET);
-      if(seek_res < 0){
-	// Seek error!
-	logmsgf(LT_SMD,1,"SMD: SEEK ERROR!\n");
-	SMD_IOPB.Error = 0x12; // SEEK ERROR
-	SMD_IOPB.Status = 0x82; // OPERATION FAILED
-        SMD_Controller_State = 90; // Free IOPB
-	// ld_die_rq = 1;
-	break;
+      // Read in the rest of the IOPB's sectors if we don't have this one
+      // or can't send it from the image's mapping.
+      io_res = 1024;
+      if(smd_map_sector(SMD_IOPB.Unit,SMD_Sector) == NULL &&
+	 (SMD_Sector < SMD_Xfer_First || SMD_Sector >= SMD_Xfer_First+SMD_Xfer_Sectors)){
+	int count = SMD_IOPB.SectorCount-SMD_Sector_Counter;
+	if(count > SMD_XFER_SECTORS){ count = SMD_XFER_SECTORS; }
+	if(count < 1){ count = 1; }
+	SMD_Xfer_Sectors = 0;
+	SMD_Xfer_First = SMD_Sector;
+	SMD_IO_Count = count;
+	smd_io_start(SMD_IOPB.Unit,0,SMD_XFER_RAM,SMD_Sector,count);
       }
-      // Read in a sector.
-      io_res = read(disk_fd[SMD_IOPB.Unit],SMD_BUFFER_RAM,1024);
       SMD_Controller_State++;
       break;
     case 22: // DISK READ SECTOR: OPERATION COMPLETE
+      if(smd_io_poll(0) == 0){ break; } // Drive is still busy
+      if(SMD_IO_Count > 0){
+	if(io_res >= 0){
+	  // Past the end of the image reads as zeroes
+	  bzero(SMD_XFER_RAM+io_res,(SMD_IO_Count*1024)-io_res);
+	  SMD_Xfer_Sectors = SMD_IO_Count;
+	}
+	SMD_IO_Count = 0;
+      }
+      SMD_Sector_Data = smd_map_sector(SMD_IOPB.Unit,SMD_Sector);
+      if(SMD_Sector_Data == NULL){
+	SMD_Sector_Data = SMD_BUFFER_RAM;
+	if(io_res >= 0){
+	  memcpy(SMD_BUFFER_RAM,SMD_XFER_RAM+((SMD_Sector-SMD_Xfer_First)*1024),1024);
+	}
+      }
       if(io_res < 0){	
         // There was an error
 	// FIXME: USE MAX RETRY COUNT FROM UIB
@@ -462,12 +899,17 @@ void smd_clock_pulse(){
     case 23: // Write Loop
       {
 	uint16_t BurstOffset = SMD_Xfer_Size*SMD_Burst_Counter;
-	if(SMD_Xfer_Mode == 1 && (SMD_Xfer_Size-SMD_Xfer_Count) > 1){
-	  multibus_word_write(SMD_Xfer_Addr,*(uint16_t *)(SMD_BUFFER_RAM+(BurstOffset+SMD_Xfer_Count))); 
+	int moved = multibus_block_write(SMD_Xfer_Addr,SMD_Sector_Data+(BurstOffset+SMD_Xfer_Count),SMD_Xfer_Size-SMD_Xfer_Count);
+	if(moved > 0){
+	  // NUbus block transfer
+	  SMD_Xfer_Count += moved;
+	  SMD_Xfer_Addr.raw += moved;
+	}else if(SMD_Xfer_Mode == 1 && (SMD_Xfer_Size-SMD_Xfer_Count) > 1){
+	  multibus_word_write(SMD_Xfer_Addr,*(uint16_t *)(SMD_Sector_Data+(BurstOffset+SMD_Xfer_Count)));
 	  SMD_Xfer_Count += 2;
 	  SMD_Xfer_Addr.raw += 2;
 	}else{
-	  multibus_write(SMD_Xfer_Addr,SMD_BUFFER_RAM[BurstOffset+SMD_Xfer_Count]);
+	  multibus_write(SMD_Xfer_Addr,SMD_Sector_Data[BurstOffset+SMD_Xfer_Count]);
 	  SMD_Xfer_Count++;
 	  SMD_Xfer_Addr.raw++;
 	}
@@ -529,6 +971,7 @@ void smd_clock_pulse(){
       SMD_Retries = 0;
       SMD_Xfer_Count = 0;
       SMD_Sector_Counter = 0; SMD_Burst_Counter = 0;
+      SMD_Xfer_Sectors = 0;
       SMD_Xfer_Addr.raw = SMD_IOPB.Buffer_Address;
       SMD_Xfer_Size = SMD_IOPB.DMA_Burst_Size;
       SMD_Controller_State++; // Start read loop
@@ -536,6 +979,11 @@ void smd_clock_pulse(){
     case 31: // READ LOOP
       {
         uint16_t BurstOffset = SMD_Xfer_Size*SMD_Burst_Counter;
+	int moved = multibus_block_read(SMD_Xfer_Addr,SMD_BUFFER_RAM+(BurstOffset+SMD_Xfer_Count),SMD_Xfer_Size-SMD_Xfer_Count);
+	if(moved > 0){
+	  // NUbus block transfer
+	  SMD_Xfer_Count += moved; SMD_Xfer_Addr.raw += moved;
+	}else{
 	/*
 	if(SMD_IOPB.Buffer_WordMode != 0 && (SMD_Xfer_Addr.raw&0x01) == 0 && (SMD_Xfer_Size-SMD_Xfer_Count) > 1){
 	  *(uint16_t *)(SMD_BUFFER_RAM+(BurstOffset+SMD_Xfer_Count)) = multibus_word_read(SMD_Xfer_Addr);
@@ -545,6 +993,7 @@ void smd_clock_pulse(){
 	  SMD_BUFFER_RAM[BurstOffset+SMD_Xfer_Count] = multibus_read(SMD_Xfer_Addr);
 	  SMD_Xfer_Count++; SMD_Xfer_Addr.raw++;
 	  // }
+	}
         if(SMD_Xfer_Count >= SMD_Xfer_Size){
           // Done with this burst.
           // logmsgf(LT_SMD,,"SMD: DMA BURST 0x");
@@ -581,21 +1030,41 @@ void smd_clock_pulse(){
       // writeH32(SMD_LBA);
       // logmsgf(LT_SMD,,"\n");
       
-      // Reposition the file pointer.
-      seek_res = lseek(disk_fd[SMD_IOPB.Unit],(SMD_Sector*0x400),SEEK_SET);
-      if(seek_res < 0){
-	// Seek error!
-	logmsgf(LT_SMD,1,"SMD: SEEK ERROR!\n");
-	SMD_IOPB.Error = 0x12; // SEEK ERROR
-	SMD_IOPB.Status = 0x82; // OPERATION FAILED
-        SMD_Controller_State = 90; // Free IOPB
-	// ld_die_rq = 1;
+      // A mapped sector is copied in, and the mapping synced at the end
+      // of the IOPB if that was asked for.
+      if(smd_map_sector(SMD_IOPB.Unit,SMD_Sector) != NULL){
+	memcpy(smd_map_sector(SMD_IOPB.Unit,SMD_Sector),SMD_BUFFER_RAM,1024);
+	io_res = 1024;
+	if(smd_msync != SMD_MSYNC_NONE && SMD_Sector_Counter+1 >= SMD_IOPB.SectorCount){
+	  uint8_t *start;
+	  size_t len = smd_map_span(SMD_IOPB.Unit,SMD_Sector-SMD_Sector_Counter,SMD_Sector,&start);
+	  if(len > 0 && msync(start,len,smd_msync == SMD_MSYNC_SYNC ? MS_SYNC : MS_ASYNC) < 0){
+	    io_res = -1;
+	  }
+	}
+	SMD_Controller_State++;
 	break;
       }
-      io_res = write(disk_fd[SMD_IOPB.Unit],SMD_BUFFER_RAM,1024);
+      // Collect the sector. They are written when the buffer fills or
+      // the IOPB ends, so a retry only repeats the write.
+      if(SMD_Retries == 0){
+	if(SMD_Xfer_Sectors == 0){ SMD_Xfer_First = SMD_Sector; }
+	memcpy(SMD_XFER_RAM+(SMD_Xfer_Sectors*1024),SMD_BUFFER_RAM,1024);
+	SMD_Xfer_Sectors++;
+      }
+      io_res = 1024;
+      if(SMD_Xfer_Sectors == SMD_XFER_SECTORS || SMD_Sector_Counter+1 >= SMD_IOPB.SectorCount){
+	SMD_IO_Count = SMD_Xfer_Sectors;
+	smd_io_start(SMD_IOPB.Unit,1,SMD_XFER_RAM,SMD_Xfer_First,SMD_Xfer_Sectors);
+      }
       SMD_Controller_State++;
       break;
     case 36: // DISK WRITE SECTOR: OPERATION COMPLETE
+      if(smd_io_poll(0) == 0){ break; } // Drive is still busy
+      if(SMD_IO_Count > 0){
+	if(io_res >= 0){ SMD_Xfer_Sectors = 0; }
+	SMD_IO_Count = 0;
+      }
       if(io_res < 0){
         // There was an error
 	// FIXME: USE MAX RETRY COUNT FROM UIB
@@ -836,7 +1305,7 @@ void smd_clock_pulse(){
         // Our request got lost or stolen, repeat it.
         logmsgf(LT_SMD,,"SDU: Bus cycle stolen by card 0x");
         writeH32(NUbus_master);
-        if(NUbus_Busy != 0){ logmsgf(LT_SMD,," - Awaiting bus free\n"); break; }
+        if(NUbus_Busy != 0){ logmsgf(LT_SMD,," - Awaiting bus free\n"); nubus_wait(0xFF); break; }
         logmsgf(LT_SMD,," - Repeating request\n");
         nubus_io_request(VM_READ,0xFF,Share_Runme_Addr,0);
         SMD_Controller_State--;
@@ -952,6 +1421,7 @@ int yaml_disk_sequence_loop(yaml_parser_t *parser){
   int sequence_done = 0;
   int unit = 0;
   char fname[64];
+  char oname[64];
 
   key[0] = 0;
   value[0] = 0;
@@ -986,6 +1456,7 @@ int yaml_disk_sequence_loop(yaml_parser_t *parser){
       // Map entry start. Reinitialize.
       unit = 0;
       fname[0] = 0;
+      oname[0] = 0;
       break;
     case YAML_SEQUENCE_END_EVENT:
       // We are done
@@ -997,6 +1468,7 @@ int yaml_disk_sequence_loop(yaml_parser_t *parser){
       if(unit < 0){ unit = 0; }
       strncpy(disk_fn[unit],fname,64);
       logmsgf(LT_SMD,0,"Using disk image %s for unit %d\n",disk_fn[unit],unit);
+      strncpy(disk_ovl_fn[unit],oname,64);
       break;
     case YAML_ALIAS_EVENT:
       logmsgf(LT_SMD,0,"Unexpected alias (anchor %s)\n", event.data.alias.anchor);
@@ -1015,6 +1487,10 @@ int yaml_disk_sequence_loop(yaml_parser_t *parser){
           strncpy(fname,value,64);
           goto value_done;
         }
+        if(strcmp(key,"overlay") == 0){
+          strncpy(oname,value,64);
+          goto value_done;
+        }
         logmsgf(LT_SMD,0,"disk: Unknown key %s (value %s)\n",key,value);
         return(-1);
         // Done
@@ -1091,6 +1567,45 @@ int yaml_disk_mapping_loop(yaml_parser_t *parser){
         strncpy(key,(const char *)event.data.scalar.value,128);
       }else{
         strncpy(value,(const char *)event.data.scalar.value,128);
+        if(strcmp(key,"io") == 0){
+	  if(strcmp(value,"sync") == 0){
+	    smd_io_mode = SMD_IO_SYNC;
+	  }else if(strcmp(value,"async") == 0){
+	    smd_io_mode = SMD_IO_ASYNC;
+	  }else if(strcmp(value,"mmap") == 0){
+	    smd_io_mode = SMD_IO_MMAP;
+	  }else{
+	    logmsgf(LT_SMD,0,"disk: Invalid io value %s (sync, async or mmap)\n",value);
+	    return(-1);
+	  }
+	  goto value_done;
+        }
+        if(strcmp(key,"msync") == 0){
+	  if(strcmp(value,"none") == 0){
+	    smd_msync = SMD_MSYNC_NONE;
+	  }else if(strcmp(value,"async") == 0){
+	    smd_msync = SMD_MSYNC_ASYNC;
+	  }else if(strcmp(value,"sync") == 0){
+	    smd_msync = SMD_MSYNC_SYNC;
+	  }else{
+	    logmsgf(LT_SMD,0,"disk: Invalid msync value %s (none, async or sync)\n",value);
+	    return(-1);
+	  }
+	  goto value_done;
+        }
+        if(strcmp(key,"overlay") == 0){
+	  char *tok = strtok(value," \t\r\n");
+	  if(tok != NULL){
+	    int dsk = atoi(tok);
+	    tok = strtok(NULL," \t\r\n");
+	    if(dsk >= 0 && dsk < 4 && tok != NULL){
+	      strncpy(disk_ovl_fn[dsk],tok,64);
+	      goto value_done;
+	    }
+	  }
+	  logmsgf(LT_SMD,0,"disk: Invalid overlay value %s (unit and file name)\n",value);
+	  return(-1);
+        }
         if(strcmp(key,"image") == 0){
 	  int dsk = 0;
 	  char *tok = strtok(value," \t\r\n");
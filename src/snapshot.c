@@ -0,0 +1,582 @@
+/* Copyright 2016-2017
+   Daniel Seagraves <dseagrav@lunar-tokyo.net>
+
+   This file is part of LambdaDelta.
+
+   LambdaDelta is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   LambdaDelta is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LambdaDelta.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Machine snapshots
+
+   A snapshot is a header, a fixed-size directory of named items, and the item data.
+   Each module registers its state with SNAP_ITEM() from its snapshot function, and the
+   same function is used to save, check, and load, so the lists can't get out of step.
+   Host resources (file descriptors, sockets, SDL state) are never saved; each module
+   fixes up whatever depends on them after a load.
+
+   A checkpoint is a snapshot holding only the pages that changed since the snapshot
+   or checkpoint before it, which it names as its parent. Main memory is tracked with
+   the dirty map the memory board keeps; everything else is compared against a hash
+   of each page as it was last written. Loading a checkpoint loads the full snapshot
+   at the start of its chain and applies each checkpoint after it in order.
+   tools/snapcompact turns a chain into a single full snapshot.
+
+   Snapshots are only taken between main loop slices, where no device is in the middle
+   of being clocked.
+*/
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "ld.h"
+#include "snapshot.h"
+
+// Snapshot in progress
+static int snap_op = SNAP_SAVE;
+static int snap_error = 0;
+static bool snap_incremental = false;  // Saving a checkpoint
+static bool snap_hash_only = false;    // Only update page hashes, write nothing
+static int snap_fd = -1;
+static uint64_t snap_pos = 0;          // Next data offset when saving
+static uint64_t snap_items = 0;        // Items in directory
+static SnapItem snap_dir[SNAP_MAX_ITEMS];
+
+// Files of the chain being loaded, full snapshot first
+typedef struct rSnapFile {
+  uint8_t *map;
+  size_t size;
+  SnapHeader *hdr;
+  SnapItem *dir;
+} SnapFile;
+static SnapFile snap_file[SNAP_MAX_CHAIN];
+static int snap_files = 0;
+
+// Chain we are checkpointing
+static bool snap_baseline = false;     // Hashes and dirty maps match the last snapshot written or loaded
+static uint64_t snap_chain = 0;
+static uint64_t snap_sequence = 0;
+static char snap_parent[SNAP_PATH_LEN];
+int checkpoint_max = 100;              // Checkpoints in a chain before starting over with a full snapshot
+
+// Page hashes of each item as last saved, in walk order
+typedef struct rSnapHash {
+  char name[SNAP_NAME_LEN];
+  size_t pages;
+  uint64_t *hash;
+} SnapHash;
+static SnapHash snap_hash[SNAP_MAX_ITEMS];
+
+// Dirty maps to clear once a save is complete
+static uint8_t *snap_dirty[SNAP_MAX_ITEMS];
+static size_t snap_dirty_len[SNAP_MAX_ITEMS];
+static int snap_dirty_maps = 0;
+
+static uint32_t snapshot_config(){
+  uint32_t config = 0;
+#ifdef CONFIG_2X2
+  config |= SNAP_CONFIG_2X2;
+#endif
+  return(config);
+}
+
+// Run every module's snapshot function
+static void snapshot_walk(int op){
+  snap_op = op;
+  snap_items = 0;
+  snap_dirty_maps = 0;
+  lambda_snapshot(op);
+  mem_snapshot(op);
+  nubus_snapshot(op);
+  sdu_snapshot(op);
+  i8086_snapshot(op);
+  smd_snapshot(op);
+  tapemaster_snapshot(op);
+  enet_snapshot(op);
+  vcmem_snapshot(op);
+  kernel_snapshot(op);
+}
+
+// Write all of a buffer, or fail
+static int snapshot_write(const void *data,size_t len,uint64_t offset){
+  const uint8_t *p = data;
+  while(len > 0){
+    ssize_t res = pwrite(snap_fd,p,len,offset);
+    if(res < 0){
+      if(errno == EINTR){ continue; }
+      perror("snapshot: pwrite");
+      return(-1);
+    }
+    p += res;
+    offset += res;
+    len -= res;
+  }
+  return(0);
+}
+
+static uint64_t snapshot_hash(const uint8_t *p,size_t len){
+  uint64_t h = 0xCBF29CE484222325ULL;
+  uint64_t w;
+  while(len >= 8){
+    memcpy(&w,p,8);
+    h = (h^w)*0x100000001B3ULL;
+    h ^= h>>29;
+    p += 8;
+    len -= 8;
+  }
+  while(len > 0){
+    h = (h^*p)*0x100000001B3ULL;
+    p++;
+    len--;
+  }
+  return(h);
+}
+
+static size_t snapshot_page_len(uint64_t page,size_t len){
+  size_t left = len-(page*SNAP_PAGE);
+  return(left < SNAP_PAGE ? left : SNAP_PAGE);
+}
+
+// Page hashes for the item about to be registered
+static uint64_t *snapshot_hashes(const char *name,size_t pages){
+  SnapHash *sh = &snap_hash[snap_items];
+  if(sh->hash == NULL || sh->pages != pages || strncmp(sh->name,name,SNAP_NAME_LEN) != 0){
+    free(sh->hash);
+    sh->hash = calloc(pages,sizeof(uint64_t));
+    if(sh->hash == NULL){
+      perror("snapshot: calloc");
+      sh->pages = 0;
+      return(NULL);
+    }
+    sh->pages = pages;
+    strncpy(sh->name,name,SNAP_NAME_LEN-1);
+    snap_baseline = false;
+  }
+  return(sh->hash);
+}
+
+static SnapItem *snapshot_find(SnapFile *sf,const char *name){
+  uint64_t x = 0;
+  while(x < sf->hdr->items){
+    if(strncmp(sf->dir[x].name,name,SNAP_NAME_LEN) == 0){
+      return(&sf->dir[x]);
+    }
+    x++;
+  }
+  return(NULL);
+}
+
+// Make sure an item's data makes sense
+static int snapshot_check_item(SnapFile *sf,SnapItem *ent,size_t len){
+  uint64_t pos = 0;
+  if(ent->length != len){
+    printf("snapshot: item %.*s is %llu bytes, expected %llu\n",SNAP_NAME_LEN,ent->name,
+	   (unsigned long long)ent->length,(unsigned long long)len);
+    return(-1);
+  }
+  if(ent->offset > sf->size || ent->stored > sf->size-ent->offset){
+    printf("snapshot: item %.*s runs past the end of the file\n",SNAP_NAME_LEN,ent->name);
+    return(-1);
+  }
+  if((ent->flags&SNAP_ITEM_PAGES) == 0){
+    if(ent->stored != len){
+      printf("snapshot: item %.*s is incomplete\n",SNAP_NAME_LEN,ent->name);
+      return(-1);
+    }
+    return(0);
+  }
+  while(pos < ent->stored){
+    uint64_t page;
+    if(ent->stored-pos < 8){ goto bad; }
+    memcpy(&page,sf->map+ent->offset+pos,8);
+    pos += 8;
+    if(page >= (len+SNAP_PAGE-1)/SNAP_PAGE){ goto bad; }
+    if(ent->stored-pos < snapshot_page_len(page,len)){ goto bad; }
+    pos += snapshot_page_len(page,len);
+  }
+  return(0);
+ bad:
+  printf("snapshot: item %.*s has a bad page list\n",SNAP_NAME_LEN,ent->name);
+  return(-1);
+}
+
+static void snapshot_apply_item(SnapFile *sf,SnapItem *ent,uint8_t *data,size_t len){
+  uint64_t pos = 0;
+  if((ent->flags&SNAP_ITEM_PAGES) == 0){
+    memcpy(data,sf->map+ent->offset,len);
+    return;
+  }
+  while(pos < ent->stored){
+    uint64_t page;
+    memcpy(&page,sf->map+ent->offset+pos,8);
+    pos += 8;
+    memcpy(data+(page*SNAP_PAGE),sf->map+ent->offset+pos,snapshot_page_len(page,len));
+    pos += snapshot_page_len(page,len);
+  }
+}
+
+static void snapshot_save_item(const char *name,uint8_t *data,size_t len,uint8_t *dirty){
+  size_t pages = (len+SNAP_PAGE-1)/SNAP_PAGE;
+  uint64_t *hash = NULL;
+  SnapItem *ent;
+  uint64_t page = 0;
+  if(snap_items >= SNAP_MAX_ITEMS){
+    printf("snapshot: too many items\n");
+    snap_error = 1;
+    return;
+  }
+  if(dirty != NULL){
+    snap_dirty[snap_dirty_maps] = dirty;
+    snap_dirty_len[snap_dirty_maps] = pages;
+    snap_dirty_maps++;
+  }else if(len >= SNAP_PAGE){
+    hash = snapshot_hashes(name,pages);
+    if(hash == NULL){
+      snap_error = 1;
+      return;
+    }
+  }
+  if(snap_hash_only){
+    while(hash != NULL && page < pages){
+      hash[page] = snapshot_hash(data+(page*SNAP_PAGE),snapshot_page_len(page,len));
+      page++;
+    }
+    snap_items++;
+    return;
+  }
+  ent = &snap_dir[snap_items];
+  bzero(ent,sizeof(SnapItem));
+  strncpy(ent->name,name,SNAP_NAME_LEN-1);
+  if(len >= SNAP_PAGE){
+    snap_pos = (snap_pos+(SNAP_PAGE-1))&~((uint64_t)SNAP_PAGE-1);
+  }
+  ent->offset = snap_pos;
+  ent->length = len;
+  if(len < SNAP_PAGE){
+    // Small items are always written whole
+    if(snapshot_write(data,len,snap_pos) < 0){
+      snap_error = 1;
+      return;
+    }
+    ent->stored = len;
+  }else{
+    // Write the pages that changed, or all of them for a full snapshot
+    if(snap_incremental){
+      ent->flags |= SNAP_ITEM_PAGES;
+    }
+    while(page < pages){
+      size_t plen = snapshot_page_len(page,len);
+      uint8_t *pdata = data+(page*SNAP_PAGE);
+      bool changed = true;
+      if(hash != NULL){
+	uint64_t h = snapshot_hash(pdata,plen);
+	changed = (h != hash[page]);
+	hash[page] = h;
+      }else{
+	changed = (dirty[page] != 0);
+      }
+      if(snap_incremental){
+	if(changed){
+	  if(snapshot_write(&page,8,snap_pos+ent->stored) < 0 ||
+	     snapshot_write(pdata,plen,snap_pos+ent->stored+8) < 0){
+	    snap_error = 1;
+	    return;
+	  }
+	  ent->stored += 8+plen;
+	}
+      }else{
+	if(snapshot_write(pdata,plen,snap_pos+ent->stored) < 0){
+	  snap_error = 1;
+	  return;
+	}
+	ent->stored += plen;
+      }
+      page++;
+    }
+  }
+  snap_pos = (snap_pos+ent->stored+7)&~7ULL;
+  snap_items++;
+}
+
+void snapshot_item(const char *name,void *data,size_t len,uint8_t *dirty){
+  SnapItem *ent;
+  int x = 0;
+  if(snap_error != 0){ return; }
+  if(strlen(name) >= SNAP_NAME_LEN){
+    printf("snapshot: item name %s too long\n",name);
+    snap_error = 1;
+    return;
+  }
+  switch(snap_op){
+  case SNAP_SAVE:
+    snapshot_save_item(name,data,len,dirty);
+    break;
+
+  case SNAP_CHECK:
+    // The full snapshot must have everything, checkpoints only what changed.
+    ent = snapshot_find(&snap_file[0],name);
+    if(ent == NULL){
+      printf("snapshot: item %s missing\n",name);
+      snap_error = 1;
+      return;
+    }
+    if((ent->flags&SNAP_ITEM_PAGES) != 0){
+      printf("snapshot: item %s is not complete in the full snapshot\n",name);
+      snap_error = 1;
+      return;
+    }
+    while(x < snap_files){
+      ent = snapshot_find(&snap_file[x],name);
+      if(ent != NULL && snapshot_check_item(&snap_file[x],ent,len) < 0){
+	snap_error = 1;
+	return;
+      }
+      x++;
+    }
+    break;
+
+  case SNAP_LOAD:
+    while(x < snap_files){
+      ent = snapshot_find(&snap_file[x],name);
+      if(ent != NULL){
+	snapshot_apply_item(&snap_file[x],ent,data,len);
+      }
+      x++;
+    }
+    if(dirty != NULL){
+      bzero(dirty,(len+SNAP_PAGE-1)/SNAP_PAGE);
+    }
+    break;
+  }
+}
+
+// Write a snapshot, full or checkpoint, with the given chain position
+static int snapshot_write_file(const char *fn,const char *parent){
+  SnapHeader hdr;
+  char tmpfn[SNAP_PATH_LEN+8];
+  snprintf(tmpfn,sizeof(tmpfn),"%s.tmp",fn);
+  snap_fd = open(tmpfn,O_RDWR|O_CREAT|O_TRUNC,0660);
+  if(snap_fd < 0){
+    perror("snapshot: open");
+    return(-1);
+  }
+  snap_error = 0;
+  snap_hash_only = false;
+  snap_pos = sizeof(SnapHeader)+sizeof(snap_dir);
+  snapshot_walk(SNAP_SAVE);
+  if(snap_error == 0){
+    bzero(&hdr,sizeof(hdr));
+    memcpy(hdr.magic,SNAP_MAGIC,8);
+    hdr.version = SNAP_VERSION;
+    hdr.config = snapshot_config();
+    hdr.items = snap_items;
+    hdr.chain = snap_chain;
+    hdr.sequence = snap_sequence;
+    if(parent != NULL){
+      strncpy(hdr.parent,parent,SNAP_PATH_LEN-1);
+    }
+    if(snapshot_write(&hdr,sizeof(hdr),0) < 0 ||
+       snapshot_write(snap_dir,sizeof(snap_dir),sizeof(hdr)) < 0){
+      snap_error = 1;
+    }
+  }
+  if(snap_error == 0 && fsync(snap_fd) < 0){
+    perror("snapshot: fsync");
+    snap_error = 1;
+  }
+  close(snap_fd);
+  snap_fd = -1;
+  // Only replace the old snapshot once the new one is complete
+  if(snap_error == 0 && rename(tmpfn,fn) < 0){
+    perror("snapshot: rename");
+    snap_error = 1;
+  }
+  if(snap_error != 0){
+    unlink(tmpfn);
+    printf("snapshot: save to %s failed\n",fn);
+    // Hashes are half updated, so the next checkpoint has to be full
+    snap_baseline = false;
+    return(-1);
+  }
+  // Written pages are clean now
+  while(snap_dirty_maps > 0){
+    snap_dirty_maps--;
+    bzero(snap_dirty[snap_dirty_maps],snap_dirty_len[snap_dirty_maps]);
+  }
+  strncpy(snap_parent,fn,SNAP_PATH_LEN-1);
+  snap_parent[SNAP_PATH_LEN-1] = 0;
+  snap_baseline = true;
+  return(0);
+}
+
+// Full snapshot, which starts a new chain
+int snapshot_save(const char *fn){
+  if(strlen(fn) >= SNAP_PATH_LEN){
+    printf("snapshot: file name %s too long\n",fn);
+    return(-1);
+  }
+  snap_incremental = false;
+  snap_chain = ((uint64_t)time(NULL)<<20)^((uint64_t)getpid()<<4)^(snap_chain+1);
+  snap_sequence = 0;
+  if(snapshot_write_file(fn,NULL) < 0){ return(-1); }
+  logmsgf(LT_SYSTEM,0,"snapshot: saved %llu items to %s\n",(unsigned long long)snap_items,fn);
+  return(0);
+}
+
+// Checkpoint. Written as FN.N, the Nth checkpoint after the full snapshot FN.
+// Starts a new chain with a full snapshot if there isn't one to build on.
+int snapshot_checkpoint(const char *fn){
+  char cpfn[SNAP_PATH_LEN];
+  if(snap_baseline == false || snap_sequence >= (uint64_t)checkpoint_max){
+    return(snapshot_save(fn));
+  }
+  if(snprintf(cpfn,sizeof(cpfn),"%s.%llu",fn,(unsigned long long)snap_sequence+1) >= SNAP_PATH_LEN){
+    printf("snapshot: file name %s too long\n",fn);
+    return(-1);
+  }
+  snap_incremental = true;
+  snap_sequence++;
+  if(snapshot_write_file(cpfn,snap_parent) < 0){
+    snap_sequence--;
+    return(-1);
+  }
+  logmsgf(LT_SYSTEM,1,"snapshot: checkpoint %s\n",cpfn);
+  return(0);
+}
+
+static void snapshot_unmap(){
+  while(snap_files > 0){
+    snap_files--;
+    munmap(snap_file[snap_files].map,snap_file[snap_files].size);
+  }
+}
+
+// Map one file of a chain
+static int snapshot_map(const char *fn,SnapFile *sf){
+  struct stat st;
+  int fd = open(fn,O_RDONLY);
+  if(fd < 0){
+    perror("snapshot: open");
+    printf("snapshot: can't open %s\n",fn);
+    return(-1);
+  }
+  if(fstat(fd,&st) < 0){
+    perror("snapshot: fstat");
+    close(fd);
+    return(-1);
+  }
+  sf->size = st.st_size;
+  if(sf->size < sizeof(SnapHeader)+sizeof(snap_dir)){
+    printf("snapshot: %s is too short\n",fn);
+    close(fd);
+    return(-1);
+  }
+  sf->map = mmap(NULL,sf->size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if(sf->map == MAP_FAILED){
+    perror("snapshot: mmap");
+    return(-1);
+  }
+  sf->hdr = (SnapHeader *)sf->map;
+  sf->dir = (SnapItem *)(sf->map+sizeof(SnapHeader));
+  if(memcmp(sf->hdr->magic,SNAP_MAGIC,8) != 0 || sf->hdr->version != SNAP_VERSION){
+    printf("snapshot: %s is not a snapshot this version can read\n",fn);
+  }else if(sf->hdr->config != snapshot_config()){
+    printf("snapshot: %s was taken with a different configuration\n",fn);
+  }else if(sf->hdr->items > SNAP_MAX_ITEMS){
+    printf("snapshot: %s has a bad directory\n",fn);
+  }else{
+    madvise(sf->map,sf->size,MADV_WILLNEED);
+    return(0);
+  }
+  munmap(sf->map,sf->size);
+  return(-1);
+}
+
+int snapshot_load(const char *fn){
+  char name[SNAP_PATH_LEN];
+  int x = 0;
+  if(strlen(fn) >= SNAP_PATH_LEN){
+    printf("snapshot: file name %s too long\n",fn);
+    return(-1);
+  }
+  strncpy(name,fn,SNAP_PATH_LEN);
+  // Follow the chain back to the full snapshot. The files are collected newest first.
+  snap_files = 0;
+  while(1){
+    SnapFile *sf = &snap_file[snap_files];
+    if(snap_files == SNAP_MAX_CHAIN){
+      printf("snapshot: chain from %s is too long\n",fn);
+      snapshot_unmap();
+      return(-1);
+    }
+    if(snapshot_map(name,sf) < 0){
+      snapshot_unmap();
+      return(-1);
+    }
+    snap_files++;
+    if(snap_files > 1 && (sf->hdr->chain != snap_file[0].hdr->chain ||
+			  sf->hdr->sequence+1 != snap_file[snap_files-2].hdr->sequence)){
+      printf("snapshot: %s does not belong to the same chain as %s\n",name,fn);
+      snapshot_unmap();
+      return(-1);
+    }
+    // A full snapshot has no parent
+    if(sf->hdr->parent[0] == 0){ break; }
+    memcpy(name,sf->hdr->parent,SNAP_PATH_LEN);
+    name[SNAP_PATH_LEN-1] = 0;
+  }
+  // Put the full snapshot first
+  while(x < snap_files/2){
+    SnapFile tmp = snap_file[x];
+    snap_file[x] = snap_file[snap_files-1-x];
+    snap_file[snap_files-1-x] = tmp;
+    x++;
+  }
+  snap_chain = snap_file[snap_files-1].hdr->chain;
+  snap_sequence = snap_file[snap_files-1].hdr->sequence;
+  // Make sure everything is there before changing anything
+  snap_error = 0;
+  snapshot_walk(SNAP_CHECK);
+  if(snap_error == 0){
+    snapshot_walk(SNAP_LOAD);
+  }
+  snapshot_unmap();
+  if(snap_error != 0){
+    printf("snapshot: load from %s failed\n",fn);
+    snap_baseline = false;
+    return(-1);
+  }
+  // Checkpoints continue the chain from here
+  snap_hash_only = true;
+  snapshot_walk(SNAP_SAVE);
+  snap_hash_only = false;
+  strncpy(snap_parent,fn,SNAP_PATH_LEN-1);
+  snap_parent[SNAP_PATH_LEN-1] = 0;
+  snap_baseline = (snap_error == 0);
+  logmsgf(LT_SYSTEM,0,"snapshot: resumed from %s\n",fn);
+  return(0);
+}
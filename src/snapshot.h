@@ -0,0 +1,81 @@
+/* Copyright 2016-2017
+   Daniel Seagraves <dseagrav@lunar-tokyo.net>
+
+   This file is part of LambdaDelta.
+
+   LambdaDelta is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   LambdaDelta is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LambdaDelta.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Machine snapshots */
+
+// Snapshot operations, passed to each module's snapshot function
+#define SNAP_SAVE 0  // Write items to the snapshot
+#define SNAP_CHECK 1 // Make sure the snapshot has every item, change nothing
+#define SNAP_LOAD 2  // Read items back in, then fix up host-side state
+
+// File format
+#define SNAP_MAGIC "LDSNAP02"
+#define SNAP_VERSION 2
+#define SNAP_NAME_LEN 32
+#define SNAP_PATH_LEN 256
+#define SNAP_MAX_ITEMS 256
+#define SNAP_MAX_CHAIN 1024
+#define SNAP_PAGE 4096  // Checkpoint granularity; large items also start on a page boundary
+
+typedef struct rSnapHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t config;   // Configuration flags, see SNAP_CONFIG_xxx
+  uint64_t items;    // Number of items that follow
+  uint64_t chain;    // Chain ID, shared by a full snapshot and the checkpoints built on it
+  uint64_t sequence; // Position in the chain, counting from 0 at the full snapshot it started with
+  char parent[SNAP_PATH_LEN]; // Snapshot this checkpoint applies to, empty if full
+} __attribute__((packed)) SnapHeader;
+
+typedef struct rSnapItem {
+  char name[SNAP_NAME_LEN];
+  uint64_t offset;   // File offset of the data
+  uint64_t length;   // Length of the item
+  uint64_t stored;   // Bytes of data in the file
+  uint32_t flags;    // See SNAP_ITEM_xxx
+  uint32_t spare;
+} __attribute__((packed)) SnapItem;
+
+// Item stored as changed pages only. Each page is a uint64_t page number
+// followed by the page data (shorter for the last page of the item).
+#define SNAP_ITEM_PAGES 0x01
+
+#define SNAP_CONFIG_2X2 0x01
+
+// Register a variable with the snapshot in progress
+#define SNAP_ITEM(x) snapshot_item(#x,(void *)&(x),sizeof(x),NULL)
+// Same, with a page dirty map kept by the owner (one byte per SNAP_PAGE)
+#define SNAP_ITEM_DIRTY(x,map) snapshot_item(#x,(void *)&(x),sizeof(x),map)
+
+void snapshot_item(const char *name,void *data,size_t len,uint8_t *dirty);
+int snapshot_save(const char *fn);
+int snapshot_checkpoint(const char *fn);
+int snapshot_load(const char *fn);
+
+// Module snapshot functions
+void lambda_snapshot(int op);
+void mem_snapshot(int op);
+void nubus_snapshot(int op);
+void sdu_snapshot(int op);
+void i8086_snapshot(int op);
+void smd_snapshot(int op);
+void tapemaster_snapshot(int op);
+void enet_snapshot(int op);
+void vcmem_snapshot(int op);
+void kernel_snapshot(int op);
@@ -36,6 +36,7 @@
 #include "ld.h"
 #include "nubus.h"
 #include "sdu.h"
+#include "snapshot.h"
 
 int tape_fd = -1;            // FD for tape
 int tape_bot = 1;            // At bottom of tape
@@ -640,6 +641,58 @@ void tapemaster_reset(){
   TM_Initialized = 0;
 }
 
+// Snapshot support
+void tapemaster_snapshot(int op){
+  static char snap_tape_fn[32];
+  static off_t snap_tape_pos;
+  if(op == SNAP_SAVE){
+    memcpy(snap_tape_fn,tape_fn,32);
+    snap_tape_pos = 0;
+    if(tape_fd >= 0){ snap_tape_pos = lseek(tape_fd,0,SEEK_CUR); }
+  }
+  SNAP_ITEM(snap_tape_fn);
+  SNAP_ITEM(snap_tape_pos);
+  SNAP_ITEM(tape_bot);
+  SNAP_ITEM(tape_eot);
+  SNAP_ITEM(tape_fm);
+  SNAP_ITEM(tape_reclen);
+  SNAP_ITEM(tape_error);
+  SNAP_ITEM(tape_block);
+  SNAP_ITEM(TM_Controller_State);
+  SNAP_ITEM(TM_Initialized);
+  SNAP_ITEM(TM_Controller_Gate);
+  SNAP_ITEM(TM_Controller_CCW);
+  SNAP_ITEM(TM_Xfer_Addr);
+  SNAP_ITEM(SB_Header_Addr);
+  SNAP_ITEM(TM_NB_Addr);
+  SNAP_ITEM(TM_SCB_Addr);
+  SNAP_ITEM(TM_CCB_Addr);
+  SNAP_ITEM(TM_PB_Addr);
+  SNAP_ITEM(TM_Xfer_Count);
+  SNAP_ITEM(TM_Xfer_Index);
+  SNAP_ITEM(TM_SB_Header);
+  SNAP_ITEM(TM_Xfer_Buffer);
+  SNAP_ITEM(TM_PB);
+  SNAP_ITEM(TM_MB_Addr);
+  SNAP_ITEM(SB_Gate_Wait_Time);
+  if(op == SNAP_LOAD){
+    // Put the tape back where it was if it's the same tape, otherwise start the new one at BOT.
+    if(tape_fd >= 0 && strncmp(snap_tape_fn,tape_fn,32) == 0){
+      if(lseek(tape_fd,snap_tape_pos,SEEK_SET) < 0){
+	perror("TM: lseek");
+      }
+    }else{
+      logmsgf(LT_TAPEMASTER,0,"TM: Snapshot had tape %.32s mounted, now %.32s\n",snap_tape_fn,tape_fn);
+      if(tape_fd >= 0){ lseek(tape_fd,0,SEEK_SET); }
+      tape_bot = 1;
+      tape_eot = 0;
+      tape_fm = 0;
+      tape_error = 0;
+      tape_reclen = 0;
+    }
+  }
+}
+
 void tapemaster_clock_pulse(){
   // Tapemaster execution
   if(TM_Controller_State > 0){
@@ -1090,6 +1143,20 @@ void tapemaster_clock_pulse(){
       break;
     case 31: // Read Tape Block: Copy Data
       if(TM_Xfer_Count < tape_reclen){
+	// Move what we can as a NUbus block
+	int limit = (TM_PB.Command == 0x60 ? TM_SB_Header.Byte_Count : TM_PB.Tape.Buffer_Size);
+	int moved = 0;
+	if(TM_Xfer_Index < limit){
+	  int len = limit-TM_Xfer_Index;
+	  if(len > tape_reclen-TM_Xfer_Count){ len = tape_reclen-TM_Xfer_Count; }
+	  moved = multibus_block_write(TM_Xfer_Addr,tape_block+TM_Xfer_Index,len);
+	}
+	if(moved > 0){
+	  TM_Xfer_Addr.raw += moved;
+	  TM_Xfer_Count += moved;
+	  TM_Xfer_Index += moved;
+	  break;
+	}
 	if(TM_PB.Command == 0x60){
 	  // Streaming
 	  if(TM_Xfer_Index < TM_SB_Header.Byte_Count){
@@ -1217,7 +1284,16 @@ void tapemaster_clock_pulse(){
     case 40: // Write Tape Block
       // Fill the buffer
       if(TM_Xfer_Count < tape_reclen){
-	uint8_t Byte = multibus_read(TM_Xfer_Addr);
+	uint8_t Byte;
+	int moved = multibus_block_read(TM_Xfer_Addr,tape_block+TM_Xfer_Index,tape_reclen-TM_Xfer_Count);
+	if(moved > 0){
+	  // NUbus block transfer
+	  TM_Xfer_Addr.raw += moved;
+	  TM_Xfer_Count += moved;
+	  TM_Xfer_Index += moved;
+	  break;
+	}
+	Byte = multibus_read(TM_Xfer_Addr);
 	tape_block[TM_Xfer_Index] = Byte;
 	TM_Xfer_Addr.raw++;
 	TM_Xfer_Count++; 
@@ -20,6 +20,7 @@
 
 void vcmem_init(int vn,int slot);
 void vcmem_clock_pulse(int vn);
+void vcmem_nubus_slave(int vn);
 void vcmem_kb_int(int vn);
 
 // Register definitions
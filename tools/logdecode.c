@@ -0,0 +1,196 @@
+/* Lambda binary log decoder
+
+   Copyright 2016-2018
+   Daniel Seagraves <dseagrav@lunar-tokyo.net>
+   Barry Silverman <barry@disus.com>
+
+   This file is part of LambdaDelta.
+
+   LambdaDelta is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   LambdaDelta is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LambdaDelta.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Reads a binary log written with "binary" in the log section of the
+   configuration and prints the messages as the emulator would have.
+   With -t each line is prefixed by its time and log type. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../src/log.h"
+
+char *type_name[256];
+char **format_text = NULL;
+uint32_t formats = 0;
+int stamps = 0;
+
+// Print one conversion from a format, using the recorded arguments
+void print_conv(const char *spec,int len,int cls,int stars,uint64_t *arg,const char *strings,uint32_t slen){
+  char fmt[64];
+  int w[2] = { 0, 0 };
+  int x = 0;
+  if(len > 63){ len = 63; }
+  memcpy(fmt,spec,len);
+  fmt[len] = 0;
+  while(x < stars){
+    w[x] = (int)arg[x];
+    x++;
+  }
+  arg += stars;
+#define PRINT(val) (stars == 0 ? printf(fmt,val) : stars == 1 ? printf(fmt,w[0],val) : printf(fmt,w[0],w[1],val))
+  switch(cls){
+  case LOG_ARG_NONE:
+    fputs(fmt[len-1] == '%' ? "%" : fmt,stdout);
+    break;
+  case LOG_ARG_INT:
+    PRINT((int)arg[0]);
+    break;
+  case LOG_ARG_LONG:
+    PRINT((long)arg[0]);
+    break;
+  case LOG_ARG_LLONG:
+    PRINT((long long)arg[0]);
+    break;
+  case LOG_ARG_SIZE:
+    PRINT((size_t)arg[0]);
+    break;
+  case LOG_ARG_DOUBLE:
+    {
+      double d;
+      memcpy(&d,&arg[0],8);
+      PRINT(d);
+    }
+    break;
+  case LOG_ARG_STRING:
+    PRINT(arg[0] < slen ? strings+arg[0] : "(?)");
+    break;
+  case LOG_ARG_POINTER:
+    PRINT((void *)(uintptr_t)arg[0]);
+    break;
+  }
+#undef PRINT
+}
+
+void print_message(LogRecord *rec,uint8_t *data){
+  uint64_t *arg = (uint64_t *)data;
+  const char *strings = (const char *)(data+(rec->args*8));
+  uint32_t slen = rec->length-(rec->args*8);
+  const char *p,*q,*spec;
+  int cls,stars;
+  int n = 0;
+  if(rec->format >= formats || format_text[rec->format] == NULL){
+    printf("(message with unknown format %u)\n",rec->format);
+    return;
+  }
+  if(stamps != 0){
+    printf("%llu.%09llu %s: ",(unsigned long long)(rec->time/1000000000ULL),
+	   (unsigned long long)(rec->time%1000000000ULL),
+	   type_name[rec->type] != NULL ? type_name[rec->type] : "?");
+  }
+  p = format_text[rec->format];
+  while((q = log_next_conv(p,&spec,&cls,&stars)) != NULL){
+    int need = stars+(cls != LOG_ARG_NONE ? 1 : 0);
+    fwrite(p,spec-p,1,stdout);
+    if(n+need > rec->args){
+      // Truncated in the emulator, print what's left of the format as is
+      fputs(spec,stdout);
+      return;
+    }
+    print_conv(spec,q-spec,cls,stars,arg+n,strings,slen);
+    n += need;
+    p = q;
+  }
+  fputs(p,stdout);
+}
+
+int main(int argc, char *argv[]){
+  FILE *in;
+  char magic[8];
+  LogRecord rec;
+  uint8_t *data = NULL;
+  uint32_t data_max = 0;
+  int opt;
+
+  while((opt = getopt(argc,argv,"t")) != -1){
+    if(opt == 't'){
+      stamps = 1;
+    }else{
+      argc = 0;
+    }
+  }
+  if(optind != argc-1){
+    printf("Usage: logdecode [-t] LOGFILE\n");
+    printf("Prints the messages in binary log LOGFILE.\n");
+    printf("  -t  Prefix each message with its time in seconds and its log type\n");
+    exit(-1);
+  }
+  in = fopen(argv[optind],"rb");
+  if(in == NULL){
+    perror(argv[optind]);
+    exit(-1);
+  }
+  if(fread(magic,8,1,in) != 1 || memcmp(magic,LOG_MAGIC,8) != 0){
+    printf("%s: not a binary log\n",argv[optind]);
+    exit(-1);
+  }
+  while(fread(&rec,sizeof(rec),1,in) == 1){
+    if(rec.length+1 > data_max){
+      data_max = rec.length+1;
+      data = realloc(data,data_max);
+      if(data == NULL){
+	perror("realloc");
+	exit(-1);
+      }
+    }
+    if(rec.length > 0 && fread(data,rec.length,1,in) != 1){
+      printf("%s: last record is incomplete\n",argv[optind]);
+      break;
+    }
+    data[rec.length] = 0;
+    switch(rec.kind){
+    case LOG_REC_TYPE:
+      free(type_name[rec.type]);
+      type_name[rec.type] = strdup((char *)data);
+      break;
+    case LOG_REC_FORMAT:
+      if(rec.format >= formats){
+	format_text = realloc(format_text,(rec.format+1)*sizeof(char *));
+	if(format_text == NULL){
+	  perror("realloc");
+	  exit(-1);
+	}
+	while(formats <= rec.format){
+	  format_text[formats++] = NULL;
+	}
+      }
+      free(format_text[rec.format]);
+      format_text[rec.format] = strdup((char *)data);
+      break;
+    case LOG_REC_MESSAGE:
+      if(rec.args > LOG_MAX_ARGS || rec.length < (uint32_t)rec.args*8){
+	printf("%s: bad message record\n",argv[optind]);
+	exit(-1);
+      }
+      print_message(&rec,data);
+      break;
+    default:
+      printf("%s: unknown record kind %d\n",argv[optind],rec.kind);
+      exit(-1);
+    }
+  }
+  fclose(in);
+  return(0);
+}
@@ -0,0 +1,294 @@
+/* Lambda NUbus trace analyzer
+
+   Copyright 2016-2018
+   Daniel Seagraves <dseagrav@lunar-tokyo.net>
+   Barry Silverman <barry@disus.com>
+
+   This file is part of LambdaDelta.
+
+   LambdaDelta is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   LambdaDelta is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LambdaDelta.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Reads a trace written with "nubus_trace" in the lam section of the
+   configuration and summarizes it: bus use and bandwidth by master and by
+   card, the time spent waiting for the bus, the latency distribution,
+   timeouts and the busiest address ranges. A transaction's latency runs from
+   the cycle its master first wanted the bus, so it includes the wait. Bus
+   cycles for a transaction are its latency less the wait, plus the cycle the
+   master takes to release the bus. Fast memory accesses never use the bus;
+   they are counted in the bandwidth but not in the bus cycles. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "../src/nubus.h"
+
+#define LATENCY_MAX 32
+
+typedef struct rStats {
+  uint64_t count;
+  uint64_t reads;
+  uint64_t writes;
+  uint64_t bytes;
+  uint64_t fast;
+  uint64_t bus_cycles;
+  uint64_t wait_cycles;
+  uint64_t waited;   // Requests that had to wait
+  uint64_t timeouts;
+} Stats;
+
+typedef struct rRange {
+  uint32_t key;      // Address or address range
+  uint64_t count;
+  uint64_t bytes;
+} Range;
+
+Stats total;
+Stats by_master[256];
+Stats by_card[256];
+uint64_t latency[LATENCY_MAX+1];
+Range *ranges = NULL;   // One per record, then merged
+Range *timeouts = NULL;
+uint64_t nranges = 0;
+uint64_t ntimeouts = 0;
+int top = 16;
+int range_shift = 16;   // 64KB ranges
+
+int record_bytes(NUbusTraceRecord *rec){
+  if(rec->words != 0){ return(rec->words*4); }
+  if((rec->request&0x02) != 0){ return(1); }
+  return(4);
+}
+
+void count(Stats *st,NUbusTraceRecord *rec){
+  st->count++;
+  if((rec->request&0x01) == 0){
+    st->reads++;
+  }else{
+    st->writes++;
+  }
+  if((rec->flags&NUBUS_TR_TIMEOUT) == 0){
+    st->bytes += record_bytes(rec);
+  }
+  if((rec->flags&NUBUS_TR_FAST) != 0){
+    st->fast++;
+  }else{
+    st->bus_cycles += (rec->latency-rec->wait)+1;
+  }
+  if(rec->wait > 0){
+    st->waited++;
+    st->wait_cycles += rec->wait;
+  }
+  if((rec->flags&NUBUS_TR_TIMEOUT) != 0){
+    st->timeouts++;
+  }
+}
+
+int range_by_key(const void *a,const void *b){
+  const Range *ra = a,*rb = b;
+  return(ra->key < rb->key ? -1 : ra->key > rb->key ? 1 : 0);
+}
+
+int range_by_count(const void *a,const void *b){
+  const Range *ra = a,*rb = b;
+  return(ra->count > rb->count ? -1 : ra->count < rb->count ? 1 : 0);
+}
+
+// Merge equal keys, then sort the busiest first. Returns the new length.
+uint64_t merge_ranges(Range *r,uint64_t n){
+  uint64_t x = 0,y = 0;
+  if(n == 0){ return(0); }
+  qsort(r,n,sizeof(Range),range_by_key);
+  while(x < n){
+    if(y > 0 && r[y-1].key == r[x].key){
+      r[y-1].count += r[x].count;
+      r[y-1].bytes += r[x].bytes;
+    }else{
+      r[y++] = r[x];
+    }
+    x++;
+  }
+  qsort(r,y,sizeof(Range),range_by_count);
+  return(y);
+}
+
+void print_stats(const char *title,const char *what,Stats *st,double seconds){
+  int x = 0;
+  printf("\n%s\n",title);
+  printf("%-6s %12s %12s %12s %10s %10s %8s %8s %9s\n",what,"requests","reads","writes","MB/s","fast","bus %","wait","timeouts");
+  while(x < 256){
+    if(st[x].count > 0){
+      printf("0x%02X   %12llu %12llu %12llu %10.2f %10llu %7.2f%% %8.2f %9llu\n",x,
+	     (unsigned long long)st[x].count,(unsigned long long)st[x].reads,
+	     (unsigned long long)st[x].writes,
+	     seconds > 0 ? (st[x].bytes/seconds)/1000000.0 : 0.0,
+	     (unsigned long long)st[x].fast,
+	     total.bus_cycles > 0 ? (100.0*st[x].bus_cycles)/total.bus_cycles : 0.0,
+	     (double)st[x].wait_cycles/st[x].count,
+	     (unsigned long long)st[x].timeouts);
+    }
+    x++;
+  }
+}
+
+int main(int argc, char *argv[]){
+  struct stat st;
+  NUbusTraceHeader *hdr;
+  NUbusTraceRecord *ring;
+  uint64_t first,records,span,x;
+  uint64_t first_cycle = 0,last_cycle = 0;
+  double seconds;
+  int fd,opt;
+
+  while((opt = getopt(argc,argv,"n:r:")) != -1){
+    switch(opt){
+    case 'n':
+      top = atoi(optarg);
+      break;
+    case 'r':
+      range_shift = atoi(optarg);
+      if(range_shift < 2 || range_shift > 31){ argc = 0; }
+      break;
+    default:
+      argc = 0;
+    }
+  }
+  if(optind != argc-1){
+    printf("Usage: nubustrace [-n N] [-r BITS] TRACEFILE\n");
+    printf("Summarizes the NUbus transactions in TRACEFILE.\n");
+    printf("  -n N     Show the N busiest address ranges and timeouts (default 16)\n");
+    printf("  -r BITS  Address ranges are 2^BITS bytes (default 16)\n");
+    exit(-1);
+  }
+  fd = open(argv[optind],O_RDONLY);
+  if(fd < 0){
+    perror(argv[optind]);
+    exit(-1);
+  }
+  if(fstat(fd,&st) < 0){
+    perror("fstat");
+    exit(-1);
+  }
+  if((size_t)st.st_size < sizeof(NUbusTraceHeader)){
+    printf("%s: too short\n",argv[optind]);
+    exit(-1);
+  }
+  hdr = mmap(NULL,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if(hdr == MAP_FAILED){
+    perror("mmap");
+    exit(-1);
+  }
+  if(memcmp(hdr->magic,NUBUS_TRACE_MAGIC,8) != 0 || hdr->version != NUBUS_TRACE_VERSION ||
+     hdr->size == 0 || (uint64_t)st.st_size < sizeof(NUbusTraceHeader)+(hdr->size*sizeof(NUbusTraceRecord))){
+    printf("%s: not a NUbus trace\n",argv[optind]);
+    exit(-1);
+  }
+  ring = (NUbusTraceRecord *)(hdr+1);
+  records = (hdr->head < hdr->size ? hdr->head : hdr->size);
+  first = hdr->head-records;
+  if(records == 0){
+    printf("%s: no records\n",argv[optind]);
+    return(0);
+  }
+  ranges = calloc(records,sizeof(Range));
+  timeouts = calloc(records,sizeof(Range));
+  if(ranges == NULL || timeouts == NULL){
+    perror("calloc");
+    exit(-1);
+  }
+  // Oldest first
+  x = first;
+  while(x < hdr->head){
+    NUbusTraceRecord *rec = &ring[x%hdr->size];
+    if(x == first){ first_cycle = rec->cycle; }
+    if(rec->cycle+rec->latency > last_cycle){ last_cycle = rec->cycle+rec->latency; }
+    count(&total,rec);
+    count(&by_master[rec->master],rec);
+    count(&by_card[rec->address>>24],rec);
+    if((rec->flags&NUBUS_TR_FAST) == 0){
+      latency[rec->latency < LATENCY_MAX ? rec->latency : LATENCY_MAX]++;
+    }
+    ranges[nranges].key = rec->address>>range_shift;
+    ranges[nranges].count = 1;
+    ranges[nranges].bytes = record_bytes(rec);
+    nranges++;
+    if((rec->flags&NUBUS_TR_TIMEOUT) != 0){
+      timeouts[ntimeouts].key = rec->address;
+      timeouts[ntimeouts].count = 1;
+      ntimeouts++;
+    }
+    x++;
+  }
+  span = last_cycle-first_cycle+1;
+  seconds = (double)span/hdr->rate;
+
+  printf("%llu records", (unsigned long long)records);
+  if(first > 0){
+    printf(" (%llu older ones overwritten)",(unsigned long long)first);
+  }
+  printf(", cycles %llu to %llu (%.3f seconds)\n",(unsigned long long)first_cycle,
+	 (unsigned long long)last_cycle,seconds);
+  printf("%llu on the bus, %llu fast memory, %llu timeouts\n",
+	 (unsigned long long)(total.count-total.fast),(unsigned long long)total.fast,
+	 (unsigned long long)total.timeouts);
+  printf("Bus busy %llu of %llu cycles (%.2f%%), %.2f MB/s moved\n",
+	 (unsigned long long)total.bus_cycles,(unsigned long long)span,
+	 (100.0*total.bus_cycles)/span,(total.bytes/seconds)/1000000.0);
+  printf("%llu requests waited for the bus, %llu cycles in all, %.2f per request\n",
+	 (unsigned long long)total.waited,(unsigned long long)total.wait_cycles,
+	 (double)total.wait_cycles/total.count);
+
+  print_stats("By master:","Master",by_master,seconds);
+  print_stats("By card addressed:","Card",by_card,seconds);
+
+  printf("\nLatency of bus transactions, including the wait for the bus:\n");
+  x = 0;
+  while(x <= LATENCY_MAX){
+    if(latency[x] > 0){
+      printf("%s%2llu cycles %12llu %6.2f%%\n",x == LATENCY_MAX ? ">=" : "  ",
+	     (unsigned long long)x,(unsigned long long)latency[x],
+	     (100.0*latency[x])/(total.count-total.fast));
+    }
+    x++;
+  }
+
+  nranges = merge_ranges(ranges,nranges);
+  printf("\nBusiest %d-byte address ranges:\n",1<<range_shift);
+  x = 0;
+  while(x < nranges && x < (uint64_t)top){
+    printf("0x%08llX %12llu requests %12llu bytes %6.2f%%\n",
+	   (unsigned long long)ranges[x].key<<range_shift,(unsigned long long)ranges[x].count,
+	   (unsigned long long)ranges[x].bytes,(100.0*ranges[x].count)/records);
+    x++;
+  }
+
+  if(ntimeouts > 0){
+    ntimeouts = merge_ranges(timeouts,ntimeouts);
+    printf("\nAddresses that timed out:\n");
+    x = 0;
+    while(x < ntimeouts && x < (uint64_t)top){
+      printf("0x%08X %12llu\n",timeouts[x].key,(unsigned long long)timeouts[x].count);
+      x++;
+    }
+  }
+  return(0);
+}
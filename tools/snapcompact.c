@@ -0,0 +1,243 @@
+/* Lambda snapshot compactor
+
+   Copyright 2016-2018
+   Daniel Seagraves <dseagrav@lunar-tokyo.net>
+   Barry Silverman <barry@disus.com>
+
+   This file is part of LambdaDelta.
+
+   LambdaDelta is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 2 of the License, or
+   (at your option) any later version.
+
+   LambdaDelta is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with LambdaDelta.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/* Reads a checkpoint chain (a full snapshot and the checkpoints after it)
+   and writes one full snapshot equal to its last checkpoint. The output
+   keeps the chain position of the input, so if it replaces the input file,
+   later checkpoints still load and the older files can be deleted. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "../src/snapshot.h"
+
+typedef struct rSnapFile {
+  char name[SNAP_PATH_LEN];
+  uint8_t *map;
+  size_t size;
+  SnapHeader *hdr;
+  SnapItem *dir;
+} SnapFile;
+
+SnapFile chain[SNAP_MAX_CHAIN]; // Newest first
+int chain_len = 0;
+int out_fd = -1;
+
+int map_file(const char *fn,SnapFile *sf){
+  struct stat st;
+  int fd = open(fn,O_RDONLY);
+  if(fd < 0){
+    perror(fn);
+    return(-1);
+  }
+  if(fstat(fd,&st) < 0){
+    perror("fstat");
+    close(fd);
+    return(-1);
+  }
+  sf->size = st.st_size;
+  if(sf->size < sizeof(SnapHeader)+(sizeof(SnapItem)*SNAP_MAX_ITEMS)){
+    printf("%s: too short\n",fn);
+    close(fd);
+    return(-1);
+  }
+  sf->map = mmap(NULL,sf->size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if(sf->map == MAP_FAILED){
+    perror("mmap");
+    return(-1);
+  }
+  strncpy(sf->name,fn,SNAP_PATH_LEN-1);
+  sf->hdr = (SnapHeader *)sf->map;
+  sf->dir = (SnapItem *)(sf->map+sizeof(SnapHeader));
+  if(memcmp(sf->hdr->magic,SNAP_MAGIC,8) != 0 || sf->hdr->version != SNAP_VERSION ||
+     sf->hdr->items > SNAP_MAX_ITEMS){
+    printf("%s: not a snapshot\n",fn);
+    return(-1);
+  }
+  return(0);
+}
+
+SnapItem *find_item(SnapFile *sf,const char *name){
+  uint64_t x = 0;
+  while(x < sf->hdr->items){
+    if(strncmp(sf->dir[x].name,name,SNAP_NAME_LEN) == 0){
+      return(&sf->dir[x]);
+    }
+    x++;
+  }
+  return(NULL);
+}
+
+size_t page_len(uint64_t page,size_t len){
+  size_t left = len-(page*SNAP_PAGE);
+  return(left < SNAP_PAGE ? left : SNAP_PAGE);
+}
+
+// Apply one file's copy of an item to the buffer
+int apply_item(SnapFile *sf,SnapItem *ent,uint8_t *data,size_t len){
+  uint64_t pos = 0;
+  if(ent->length != len || ent->offset > sf->size || ent->stored > sf->size-ent->offset){
+    printf("%s: item %.*s is damaged\n",sf->name,SNAP_NAME_LEN,ent->name);
+    return(-1);
+  }
+  if((ent->flags&SNAP_ITEM_PAGES) == 0){
+    if(ent->stored != len){
+      printf("%s: item %.*s is incomplete\n",sf->name,SNAP_NAME_LEN,ent->name);
+      return(-1);
+    }
+    memcpy(data,sf->map+ent->offset,len);
+    return(0);
+  }
+  while(pos < ent->stored){
+    uint64_t page;
+    if(ent->stored-pos < 8){ goto bad; }
+    memcpy(&page,sf->map+ent->offset+pos,8);
+    pos += 8;
+    if(page >= (len+SNAP_PAGE-1)/SNAP_PAGE || ent->stored-pos < page_len(page,len)){ goto bad; }
+    memcpy(data+(page*SNAP_PAGE),sf->map+ent->offset+pos,page_len(page,len));
+    pos += page_len(page,len);
+  }
+  return(0);
+ bad:
+  printf("%s: item %.*s has a bad page list\n",sf->name,SNAP_NAME_LEN,ent->name);
+  return(-1);
+}
+
+int write_all(const void *data,size_t len,uint64_t offset){
+  const uint8_t *p = data;
+  while(len > 0){
+    ssize_t res = pwrite(out_fd,p,len,offset);
+    if(res < 0){
+      if(errno == EINTR){ continue; }
+      perror("pwrite");
+      return(-1);
+    }
+    p += res;
+    offset += res;
+    len -= res;
+  }
+  return(0);
+}
+
+int main(int argc, char *argv[]){
+  char name[SNAP_PATH_LEN];
+  SnapFile *base;
+  SnapHeader hdr;
+  static SnapItem dir[SNAP_MAX_ITEMS];
+  uint64_t pos = sizeof(SnapHeader)+sizeof(dir);
+  uint64_t x = 0;
+
+  if(argc != 3){
+    printf("Usage: snapcompact CHECKPOINT OUTPUT\n");
+    printf("Writes the state saved in CHECKPOINT, and the chain it belongs to,\n");
+    printf("as a single full snapshot in OUTPUT.\n");
+    exit(-1);
+  }
+  // Follow the chain back to the full snapshot
+  strncpy(name,argv[1],SNAP_PATH_LEN-1);
+  name[SNAP_PATH_LEN-1] = 0;
+  while(1){
+    SnapFile *sf = &chain[chain_len];
+    if(chain_len == SNAP_MAX_CHAIN){
+      printf("Chain is too long\n");
+      exit(-1);
+    }
+    if(map_file(name,sf) < 0){ exit(-1); }
+    chain_len++;
+    if(chain_len > 1 && (sf->hdr->chain != chain[0].hdr->chain ||
+			 sf->hdr->config != chain[0].hdr->config ||
+			 sf->hdr->sequence+1 != chain[chain_len-2].hdr->sequence)){
+      printf("%s does not belong to the same chain as %s\n",name,argv[1]);
+      exit(-1);
+    }
+    if(sf->hdr->parent[0] == 0){ break; }
+    memcpy(name,sf->hdr->parent,SNAP_PATH_LEN);
+    name[SNAP_PATH_LEN-1] = 0;
+  }
+  base = &chain[chain_len-1];
+  printf("Chain of %d files, full snapshot %s\n",chain_len,base->name);
+
+  out_fd = open(argv[2],O_RDWR|O_CREAT|O_TRUNC,0660);
+  if(out_fd < 0){
+    perror(argv[2]);
+    exit(-1);
+  }
+  // Rebuild each item of the full snapshot, oldest file first
+  bzero(dir,sizeof(dir));
+  while(x < base->hdr->items){
+    SnapItem *ent = &base->dir[x];
+    size_t len = ent->length;
+    uint8_t *data = malloc(len > 0 ? len : 1);
+    int y = chain_len-1;
+    if(data == NULL){
+      perror("malloc");
+      exit(-1);
+    }
+    while(y >= 0){
+      SnapItem *cent = find_item(&chain[y],ent->name);
+      if(cent != NULL && apply_item(&chain[y],cent,data,len) < 0){ exit(-1); }
+      if(cent == NULL && y == chain_len-1){
+	printf("%s: item %.*s missing\n",base->name,SNAP_NAME_LEN,ent->name);
+	exit(-1);
+      }
+      y--;
+    }
+    memcpy(dir[x].name,ent->name,SNAP_NAME_LEN);
+    if(len >= SNAP_PAGE){
+      pos = (pos+(SNAP_PAGE-1))&~((uint64_t)SNAP_PAGE-1);
+    }
+    dir[x].offset = pos;
+    dir[x].length = len;
+    dir[x].stored = len;
+    if(write_all(data,len,pos) < 0){ exit(-1); }
+    pos = (pos+len+7)&~7ULL;
+    free(data);
+    x++;
+  }
+  // Header last
+  bzero(&hdr,sizeof(hdr));
+  memcpy(hdr.magic,SNAP_MAGIC,8);
+  hdr.version = SNAP_VERSION;
+  hdr.config = chain[0].hdr->config;
+  hdr.items = base->hdr->items;
+  hdr.chain = chain[0].hdr->chain;
+  hdr.sequence = chain[0].hdr->sequence;
+  if(write_all(&hdr,sizeof(hdr),0) < 0 || write_all(dir,sizeof(dir),sizeof(hdr)) < 0){
+    exit(-1);
+  }
+  if(fsync(out_fd) < 0){
+    perror("fsync");
+    exit(-1);
+  }
+  close(out_fd);
+  printf("Wrote %llu items to %s\n",(unsigned long long)hdr.items,argv[2]);
+  return(0);
+}